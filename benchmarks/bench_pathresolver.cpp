@@ -0,0 +1,325 @@
+#include "pathresolver.h"
+#include "systemdlltable.h"
+#include "benchutil.h"
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+#include <QSet>
+#include <QMutex>
+#include <QDebug>
+#include <thread>
+#include <vector>
+
+namespace {
+// The classification isSystemDLL used before the built-in table: lowercase
+// copy, mutex-guarded cache, QSet lookup and prefix checks
+bool lowercaseSetIsSystemDll(const QString& dllName)
+{
+    static QMutex mutex;
+    static QHash<QString, bool> cache;
+    static const QSet<QString> knownDlls = [] {
+        QSet<QString> names;
+        for (const char* name : SystemDllTable::kNames) {
+            names.insert(QString::fromLatin1(name));
+        }
+        return names;
+    }();
+
+    const QString lowerName = dllName.toLower();
+    QMutexLocker locker(&mutex);
+    auto it = cache.constFind(lowerName);
+    if (it != cache.constEnd()) {
+        return it.value();
+    }
+    const bool isSystem = knownDlls.contains(lowerName) || lowerName.startsWith("api-ms-win-") ||
+                          lowerName.startsWith("ext-ms-win-") || lowerName.startsWith("ucrtbase");
+    cache.insert(lowerName, isSystem);
+    return isSystem;
+}
+}
+
+class BenchPathResolver : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void resolveWithDirectoryIndex();
+    void resolveWithStatProbes();
+    void resolveMissesWithFilter();
+    void resolveMissesWithoutFilter();
+    void resolveContended_data();
+    void resolveContended();
+    void isSystemDllBuiltInTable();
+    void isSystemDllLowercaseSet();
+
+private:
+    void resolveAll(int* found);
+    void resolveMisses(int* found);
+
+    QTemporaryDir m_dir;
+    QByteArray m_savedPath;
+    QStringList m_appDirs;
+    QStringList m_names;
+    QStringList m_missingNames;
+    int m_expectedFound;
+    QByteArray m_importNames;                // Latin-1 import names, as in a mapped image
+    QVector<NameFolding::Name> m_importViews;
+    int m_expectedSystem;
+};
+
+void BenchPathResolver::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    // PATH with many directories full of unrelated files, like a developer
+    // machine with several SDKs and toolchains installed
+    const int pathDirs = int(Bench::envSize("DLLCHECKER_BENCH_PATH_DIRS", 30));
+    const int filesPerDir = int(Bench::envSize("DLLCHECKER_BENCH_FILES_PER_DIR", 200));
+    QStringList pathEntries;
+    for (int d = 0; d < pathDirs; ++d) {
+        const QString dirPath = m_dir.filePath(QString("path%1").arg(d));
+        QVERIFY(QDir().mkpath(dirPath));
+        for (int f = 0; f < filesPerDir; ++f) {
+            QFile file(QDir(dirPath).filePath(QString("tool%1_%2.dll").arg(d).arg(f)));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+        }
+        pathEntries << QDir::toNativeSeparators(dirPath);
+    }
+    m_savedPath = qgetenv("PATH");
+    qputenv("PATH", pathEntries.join(';').toLocal8Bit());
+
+    // Every app directory imports its own DLLs, DLLs from PATH and DLLs that exist nowhere
+    const int appDirs = int(Bench::envSize("DLLCHECKER_BENCH_APP_DIRS", 20));
+    for (int a = 0; a < appDirs; ++a) {
+        const QString dirPath = m_dir.filePath(QString("app%1").arg(a));
+        QVERIFY(QDir().mkpath(dirPath));
+        for (int f = 0; f < 10; ++f) {
+            QFile file(QDir(dirPath).filePath(QString("app_%1.dll").arg(f)));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+        }
+        m_appDirs << dirPath;
+    }
+    for (int f = 0; f < 10; ++f) {
+        m_names << QString("APP_%1.DLL").arg(f);
+        m_names << QString("tool%1_%2.dll").arg((f * 7) % pathDirs).arg(f % filesPerDir);
+        m_names << QString("missing_%1.dll").arg(f);
+    }
+    m_expectedFound = appDirs * 20;
+    for (int f = 0; f < 100; ++f) {
+        m_missingNames << QString("vendor_plugin%1.dll").arg(f);
+    }
+
+    // Import names of a typical Qt/MSVC application, mostly system DLLs
+    const char* const imports[] = {
+        "KERNEL32.dll", "USER32.dll", "GDI32.dll", "ADVAPI32.dll", "SHELL32.dll", "ole32.dll",
+        "api-ms-win-crt-runtime-l1-1-0.dll", "api-ms-win-crt-heap-l1-1-0.dll", "api-ms-win-crt-string-l1-1-0.dll",
+        "ext-ms-win-ntuser-window-l1-1-0.dll", "ucrtbase.dll", "WS2_32.dll", "VERSION.dll", "dbghelp.dll",
+        "libprotobuf.dll", "vendor_sdk64.dll", "Qt5Core.dll", "Qt5Gui.dll", "Qt5Widgets.dll", "opencv_world455.dll"
+    };
+    QVector<int> offsets;
+    for (const char* name : imports) {
+        offsets.append(m_importNames.size());
+        m_importNames.append(name);
+    }
+    for (int i = 0; i < offsets.size(); ++i) {
+        const int end = (i + 1 < offsets.size()) ? offsets.at(i + 1) : m_importNames.size();
+        m_importViews.append(NameFolding::makeName(m_importNames.constData() + offsets.at(i), end - offsets.at(i)));
+    }
+    m_expectedSystem = 14;
+
+    qInfo() << "PATH directories:" << pathDirs << "files per directory:" << filesPerDir
+            << "app directories:" << appDirs << "names:" << m_names.size();
+}
+
+void BenchPathResolver::cleanupTestCase()
+{
+    qputenv("PATH", m_savedPath);
+    PathResolver::setDirectoryIndexEnabled(true);
+    PathResolver::setMissFilterEnabled(true);
+    PathResolver::clearCache();
+}
+
+void BenchPathResolver::resolveMisses(int* found)
+{
+    *found = 0;
+    for (const QString& appDir : m_appDirs) {
+        for (const QString& name : m_missingNames) {
+            if (PathResolver::resolveDLLPath(name, appDir).found) {
+                ++*found;
+            }
+        }
+    }
+}
+
+void BenchPathResolver::resolveAll(int* found)
+{
+    *found = 0;
+    for (const QString& appDir : m_appDirs) {
+        for (const QString& name : m_names) {
+            if (PathResolver::resolveDLLPath(name, appDir).found) {
+                ++*found;
+            }
+        }
+    }
+}
+
+void BenchPathResolver::resolveWithDirectoryIndex()
+{
+    PathResolver::setDirectoryIndexEnabled(true);
+    int found = 0;
+    PathResolver::LookupStatistics stats;
+
+    // A cold cache per iteration, as at the start of every scan
+    QBENCHMARK {
+        PathResolver::clearCache();
+        resolveAll(&found);
+        stats = PathResolver::lookupStatistics();
+    }
+    QCOMPARE(found, m_expectedFound);
+
+    qInfo() << "Directory index: listed" << stats.directoryListings << "directories,"
+            << stats.fileProbes << "stat probes," << stats.missFilterHits << "miss filter hits,"
+            << stats.missFilterFalsePositives << "false positives";
+}
+
+void BenchPathResolver::resolveWithStatProbes()
+{
+    // Baseline: one stat call per candidate path
+    PathResolver::setDirectoryIndexEnabled(false);
+    int found = 0;
+    PathResolver::LookupStatistics stats;
+
+    QBENCHMARK {
+        PathResolver::clearCache();
+        resolveAll(&found);
+        stats = PathResolver::lookupStatistics();
+    }
+    PathResolver::setDirectoryIndexEnabled(true);
+    QCOMPARE(found, m_expectedFound);
+
+    qInfo() << "Stat probes: listed" << stats.directoryListings << "directories,"
+            << stats.fileProbes << "stat probes";
+}
+
+void BenchPathResolver::resolveMissesWithFilter()
+{
+    // Names found nowhere, looked up from every app directory; the filter
+    // answers them without walking system directories and PATH
+    PathResolver::setMissFilterEnabled(true);
+    int found = 0;
+    PathResolver::LookupStatistics stats;
+
+    QBENCHMARK {
+        PathResolver::clearCache();
+        resolveMisses(&found);
+        stats = PathResolver::lookupStatistics();
+    }
+    QCOMPARE(found, 0);
+    QCOMPARE(stats.missFilterHits + stats.missFilterFalsePositives, m_appDirs.size() * m_missingNames.size());
+
+    qInfo() << "Miss filter:" << stats.missFilterHits << "hits," << stats.missFilterFalsePositives
+            << "false positives";
+}
+
+void BenchPathResolver::resolveMissesWithoutFilter()
+{
+    // Baseline: every miss visits every search directory's index
+    PathResolver::setMissFilterEnabled(false);
+    int found = 0;
+
+    QBENCHMARK {
+        PathResolver::clearCache();
+        resolveMisses(&found);
+    }
+    PathResolver::setMissFilterEnabled(true);
+    QCOMPARE(found, 0);
+}
+
+void BenchPathResolver::resolveContended_data()
+{
+    QTest::addColumn<int>("threads");
+    const int threadCounts[] = { 1, 4, 16, 64 };
+    for (int threads : threadCounts) {
+        QTest::newRow(qPrintable(QString("%1 threads").arg(threads))) << threads;
+    }
+}
+
+void BenchPathResolver::resolveContended()
+{
+    // Warm caches, then hammer them with hits like scanDirectoryParallel workers.
+    // Work per thread is constant: flat timings across rows mean hits scale.
+    QFETCH(int, threads);
+    PathResolver::clearCache();
+    int found = 0;
+    resolveAll(&found);
+    QCOMPARE(found, m_expectedFound);
+
+    QVector<ResolverContext> contexts;
+    for (const QString& appDir : m_appDirs) {
+        contexts.append(PathResolver::context(appDir));
+    }
+    const int lookupsPerThread = int(Bench::envSize("DLLCHECKER_BENCH_LOOKUPS_PER_THREAD", 20000));
+    const QStringList& names = m_names;
+
+    QBENCHMARK {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.push_back(std::thread([t, lookupsPerThread, &names, &contexts]() {
+                for (int i = 0; i < lookupsPerThread; ++i) {
+                    const QString& name = names.at((i + t) % names.size());
+                    PathResolver::resolveDLLPath(name, contexts.at((i / names.size() + t) % contexts.size()));
+                    PathResolver::isSystemDLL(name);
+                }
+            }));
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+}
+
+void BenchPathResolver::isSystemDllBuiltInTable()
+{
+    // Import names viewed in place; known names never reach a cache or lock
+    const int rounds = 10000;
+    PathResolver::clearCache();
+    int systemCount = 0;
+
+    QBENCHMARK {
+        systemCount = 0;
+        for (int r = 0; r < rounds; ++r) {
+            for (const NameFolding::Name& name : m_importViews) {
+                if (PathResolver::isSystemDLL(name)) {
+                    ++systemCount;
+                }
+            }
+        }
+    }
+    QCOMPARE(systemCount, m_expectedSystem * rounds);
+}
+
+void BenchPathResolver::isSystemDllLowercaseSet()
+{
+    // Baseline: each import name materialized and lowercased, then looked up under a mutex
+    const int rounds = 10000;
+    int systemCount = 0;
+
+    QBENCHMARK {
+        systemCount = 0;
+        for (int r = 0; r < rounds; ++r) {
+            for (const NameFolding::Name& name : m_importViews) {
+                if (lowercaseSetIsSystemDll(name.toString())) {
+                    ++systemCount;
+                }
+            }
+        }
+    }
+    QCOMPARE(systemCount, m_expectedSystem * rounds);
+}
+
+QTEST_APPLESS_MAIN(BenchPathResolver)
+
+#include "bench_pathresolver.moc"
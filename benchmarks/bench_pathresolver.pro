@@ -0,0 +1,42 @@
+QT += core testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+TARGET = bench_pathresolver
+
+INCLUDEPATH += ../include
+
+SOURCES += \
+    bench_pathresolver.cpp \
+    ../src/pathresolver.cpp \
+    ../src/searchplan.cpp \
+    ../src/targetprofile.cpp \
+    ../src/apisetschema.cpp \
+    ../src/knowndlls.cpp \
+    ../src/peparser.cpp \
+    ../src/peimage.cpp \
+    ../src/versionresource.cpp \
+    ../src/exportindex.cpp \
+    ../src/contentdigest.cpp
+
+HEADERS += \
+    ../include/pathresolver.h \
+    ../include/searchplan.h \
+    ../include/stripedcache.h \
+    ../include/systemdlltable.h \
+    ../include/targetprofile.h \
+    ../include/apisetschema.h \
+    ../include/knowndlls.h \
+    ../include/bloomfilter.h \
+    ../include/namefolding.h \
+    ../include/peparser.h \
+    ../include/peimage.h \
+    ../include/versionresource.h \
+    ../include/exportindex.h \
+    ../include/contentdigest.h
+
+DEFINES += QT_TESTLIB_LIB
@@ -0,0 +1,231 @@
+#include "peparser.h"
+#include "testpeimage.h"
+#include "benchutil.h"
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDebug>
+
+using namespace TestPE;
+
+namespace {
+
+// Baseline import walk: linear section search and a thunk-width check per
+// entry, as PEImage did before the PE32/PE32+ paths were specialized
+qint64 linearRvaToOffset(const PEImage& image, quint32 rva)
+{
+    for (const PEImage::Section& section : image.sections()) {
+        const quint32 extent = section.virtualSize ? section.virtualSize : section.rawSize;
+        if (rva >= section.virtualAddress && rva - section.virtualAddress < extent) {
+            const quint32 delta = rva - section.virtualAddress;
+            return delta < section.rawSize ? qint64(section.rawOffset) + delta : -1;
+        }
+    }
+    return -1;
+}
+
+QVector<PEImage::ImportedModule> readImportsGeneric(const PEImage& image)
+{
+    QVector<PEImage::ImportedModule> modules;
+    quint32 importRva = 0;
+    quint32 importSize = 0;
+    if (!image.directory(1, &importRva, &importSize)) {
+        return modules;
+    }
+
+    const qint64 thunkSize = image.is64Bit() ? 8 : 4;
+    for (qint64 descriptor = linearRvaToOffset(image, importRva); descriptor >= 0; descriptor += 20) {
+        quint32 nameRva = 0;
+        quint32 thunkRva = 0;
+        if (!image.read(descriptor + 12, &nameRva) || nameRva == 0 ||
+            linearRvaToOffset(image, nameRva) < 0 || !image.read(descriptor, &thunkRva)) {
+            break;
+        }
+        PEImage::ImportedModule module;
+        module.name.data = nullptr;
+        module.name.length = 0;
+        const qint64 thunks = linearRvaToOffset(image, thunkRva);
+        for (int i = 0; thunks >= 0; ++i) {
+            quint64 thunk = 0;
+            bool ordinalFlag = false;
+            if (image.is64Bit()) {
+                if (!image.read(thunks + i * thunkSize, &thunk)) {
+                    break;
+                }
+                ordinalFlag = (thunk >> 63) != 0;
+            } else {
+                quint32 thunk32 = 0;
+                if (!image.read(thunks + i * thunkSize, &thunk32)) {
+                    break;
+                }
+                thunk = thunk32;
+                ordinalFlag = (thunk32 >> 31) != 0;
+            }
+            if (thunk == 0) {
+                break;
+            }
+
+            PEImage::ImportedSymbol symbol;
+            symbol.name.data = nullptr;
+            symbol.name.length = 0;
+            symbol.ordinal = 0;
+            if (ordinalFlag) {
+                symbol.ordinal = quint16(thunk & 0xFFFF);
+            } else {
+                const qint64 hint = linearRvaToOffset(image, quint32(thunk));
+                if (hint < 0 || !image.read(hint, &symbol.ordinal)) {
+                    continue;
+                }
+            }
+            module.symbols.append(symbol);
+        }
+        modules.append(module);
+    }
+    return modules;
+}
+
+int countImports(const QVector<PEImage::ImportedModule>& modules)
+{
+    int symbols = 0;
+    for (const PEImage::ImportedModule& module : modules) {
+        symbols += module.symbols.size();
+    }
+    return symbols;
+}
+
+} // namespace
+
+class BenchPEParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void parseLargeImageWindowed();
+    void parseLargeImageWholeMapping();
+    void importWalkSpecialized();
+    void importWalkGeneric();
+
+private:
+    QTemporaryDir m_dir;
+    QByteArray m_importHeavyImage;
+    int m_importHeavySymbols;
+    QString m_largeImage;
+    qint64 m_largeImageSize;
+};
+
+void BenchPEParser::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    // Multi-GB image whose import/resource section sits at the very end,
+    // like the CUDA/cuDNN DLLs. The gap is left sparse where supported.
+    const qint64 sizeMB = Bench::envSize("DLLCHECKER_BENCH_IMAGE_MB", 2048);
+    ImageBuilder builder(kMachineAmd64);
+    builder.addImport("KERNEL32.dll")
+           .addImport("cublas64_11.dll")
+           .addImport("cublasLt64_11.dll")
+           .setVersion((quint64(8) << 48) | (quint64(2) << 32) | (quint64(1) << 16))
+           .setDataOffset(sizeMB * 1024 * 1024);
+
+    m_largeImage = m_dir.filePath("cudnn64_8.dll");
+    QFile file(m_largeImage);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(file.write(builder.headers()) > 0);
+    QVERIFY(file.resize(builder.dataOffset()));
+    QVERIFY(file.seek(builder.dataOffset()));
+    QVERIFY(file.write(builder.section()) > 0);
+    m_largeImageSize = file.size();
+    file.close();
+
+    qInfo() << "Large image:" << m_largeImageSize / (1024 * 1024) << "MB";
+
+    // In-memory image with a realistic section table and a big import directory
+    ImageBuilder heavy(kMachineAmd64);
+    heavy.setExtraSections(16);
+    m_importHeavySymbols = 0;
+    for (int module = 0; module < 200; ++module) {
+        QStringList functions;
+        for (int i = 0; i < 50; ++i) {
+            functions << (i % 10 == 9 ? QString("#%1").arg(i + 1)
+                                      : QString("Function%1_%2").arg(module).arg(i));
+        }
+        heavy.addImport(QString("module%1.dll").arg(module), functions);
+        m_importHeavySymbols += functions.size();
+    }
+    m_importHeavyImage = heavy.build();
+}
+
+void BenchPEParser::parseLargeImageWindowed()
+{
+    const qint64 rssBefore = Bench::currentRss();
+    qint64 mappedBytes = 0;
+
+    QBENCHMARK {
+        WindowedImageGuard source(m_largeImage);
+        const PEImage image(&source);
+        QCOMPARE(image.importedModules().size(), 3);
+        mappedBytes = source.mappedBytes();
+    }
+
+    PEParser::PEInfo info = PEParser::parsePEFile(m_largeImage);
+    QVERIFY(info.isValid);
+    QCOMPARE(info.fileVersion, QString("8.2.1.0"));
+
+    qInfo() << "Windowed: mapped" << mappedBytes / 1024 << "KB of"
+            << m_largeImageSize / (1024 * 1024) << "MB, RSS delta"
+            << (Bench::currentRss() - rssBefore) / 1024 << "KB";
+}
+
+void BenchPEParser::parseLargeImageWholeMapping()
+{
+    // Baseline: map the whole image the way MapAndLoad did
+    const qint64 rssBefore = Bench::currentRss();
+
+    QBENCHMARK {
+        QFile file(m_largeImage);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        uchar* data = file.map(0, file.size());
+        if (!data) {
+            QSKIP("Cannot reserve address space for the whole image");
+        }
+        const PEImage image(data, file.size());
+        QCOMPARE(image.importedModules().size(), 3);
+        file.unmap(data);
+    }
+
+    qInfo() << "Whole mapping: mapped" << m_largeImageSize / (1024 * 1024) << "MB, RSS delta"
+            << (Bench::currentRss() - rssBefore) / 1024 << "KB";
+}
+
+void BenchPEParser::importWalkSpecialized()
+{
+    const PEImage image(reinterpret_cast<const uchar*>(m_importHeavyImage.constData()),
+                        m_importHeavyImage.size());
+    QVERIFY(image.isValid());
+    QCOMPARE(image.sections().size(), 17);
+
+    int symbols = 0;
+    QBENCHMARK {
+        symbols = countImports(image.importTable());
+    }
+    QCOMPARE(symbols, m_importHeavySymbols);
+}
+
+void BenchPEParser::importWalkGeneric()
+{
+    // Baseline for importWalkSpecialized
+    const PEImage image(reinterpret_cast<const uchar*>(m_importHeavyImage.constData()),
+                        m_importHeavyImage.size());
+    QVERIFY(image.isValid());
+
+    int symbols = 0;
+    QBENCHMARK {
+        symbols = countImports(readImportsGeneric(image));
+    }
+    QCOMPARE(symbols, m_importHeavySymbols);
+}
+
+QTEST_APPLESS_MAIN(BenchPEParser)
+
+#include "bench_peparser.moc"
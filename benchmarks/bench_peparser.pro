@@ -0,0 +1,36 @@
+QT += core testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+TARGET = bench_peparser
+
+INCLUDEPATH += ../include ../tests
+
+SOURCES += \
+    bench_peparser.cpp \
+    ../src/peparser.cpp \
+    ../src/peimage.cpp \
+    ../src/versionresource.cpp \
+    ../src/exportindex.cpp \
+    ../src/contentdigest.cpp
+
+HEADERS += \
+    benchutil.h \
+    ../tests/testpeimage.h \
+    ../include/peparser.h \
+    ../include/namefolding.h \
+    ../include/peimage.h \
+    ../include/versionresource.h \
+    ../include/exportindex.h \
+    ../include/contentdigest.h
+
+# Process memory counters
+win32 {
+    LIBS += -lpsapi
+}
+
+DEFINES += QT_TESTLIB_LIB
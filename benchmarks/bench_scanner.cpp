@@ -0,0 +1,390 @@
+#include "dependencyscanner.h"
+#include "testpeimage.h"
+#include "benchutil.h"
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QFileInfo>
+#include <QDebug>
+
+using namespace TestPE;
+
+namespace {
+
+// Tree copy of the graph below node, one node per import path, as the
+// scanner built it before modules were shared
+struct TreeNode {
+    DependencyScanner::NodeHandle module;
+    QList<QSharedPointer<TreeNode>> children;
+};
+
+QSharedPointer<TreeNode> copyAsTree(const DependencyScanner::NodeHandle& node, qint64* count)
+{
+    QSharedPointer<TreeNode> tree(new TreeNode());
+    tree->module = node;
+    ++*count;
+    for (int i = 0; i < node.edgeCount(); ++i) {
+        tree->children.append(copyAsTree(node.edge(i).node, count));
+    }
+    return tree;
+}
+
+// Number of nodes a tree view of the graph has, without building it
+double pathCount(const DependencyGraph& graph, DependencyGraph::Index node,
+                 QHash<DependencyGraph::Index, double>* memo)
+{
+    auto it = memo->constFind(node);
+    if (it != memo->constEnd()) {
+        return it.value();
+    }
+    double count = 1;
+    const DependencyGraph::Edge* edges = graph.edgesOf(node);
+    for (quint32 i = 0; i < graph.node(node).edgeCount; ++i) {
+        count += pathCount(graph, edges[i].node, memo);
+    }
+    memo->insert(node, count);
+    return count;
+}
+
+// The recursive walk the scanner did before it kept an explicit stack, with
+// the depth limit lifted: parse, resolve each import and recurse, one native
+// frame per module on the chain
+DependencyGraph::Index walkRecursive(DependencyGraph* graph, const QString& filePath, const ResolverContext& context,
+                                     QHash<StringTable::Id, DependencyGraph::Index>* cache, QSet<StringTable::Id>* path)
+{
+    StringTable& strings = graph->strings();
+    const StringTable::Id pathId = strings.intern(filePath);
+    const StringTable::Id key = strings.folded(pathId);
+    const DependencyGraph::Index cached = cache->value(key, DependencyGraph::NoIndex);
+    if (cached != DependencyGraph::NoIndex) {
+        return cached;
+    }
+    const DependencyGraph::Index node = graph->addNode(pathId, strings.intern(QFileInfo(filePath).fileName()));
+    if (path->contains(key)) {
+        return node;
+    }
+
+    path->insert(key);
+    const PEParser::PEInfo info = PEParser::parsePEFile(filePath, PEParser::ParseImportSymbols |
+                                                                  PEParser::ParseContentDigest);
+    QVector<DependencyGraph::Edge> edges;
+    for (const PEParser::ImportName& dllName : info.imports) {
+        const PathResolver::ResolveResult result = PathResolver::resolveDLLPath(dllName, context);
+        DependencyGraph::Edge edge;
+        edge.node = result.found ? walkRecursive(graph, result.foundPath, context, cache, path)
+                                 : graph->addNode(dllName.toString(), dllName.toString());
+        edges.append(edge);
+    }
+    path->remove(key);
+
+    graph->node(node).exists = true;
+    graph->node(node).setArch(info.arch);
+    graph->setEdges(node, edges);
+    cache->insert(key, node);
+    return node;
+}
+
+// Node layout before the arena: one heap node per module behind a
+// reference-counted pointer, with a list of heap-allocated edges
+struct PointerNode;
+struct PointerEdge {
+    QSharedPointer<PointerNode> node;
+    QStringList missingSymbols;
+    bool delayLoad;
+    bool viaForwarder;
+    bool archMismatch;
+    bool circular;
+
+    PointerEdge() : delayLoad(false), viaForwarder(false), archMismatch(false), circular(false) {}
+};
+
+struct PointerNode {
+    QString filePath;
+    QString fileName;
+    PEParser::Architecture arch;
+    QString fileVersion;
+    QString productVersion;
+    bool exists;
+    bool delayPending;
+    quint64 contentDigest;
+    QList<PointerEdge> edges;
+
+    PointerNode() : arch(PEParser::Unknown), exists(false), delayPending(false), contentDigest(0) {}
+};
+
+// Synthetic module i of a graph with n modules; the strings are built the
+// same way for both layouts, so the RSS difference is the node storage
+QString syntheticPath(int i)
+{
+    return QString("C:/app/lib%1.dll").arg(i);
+}
+
+int syntheticTarget(int i, int j, int n)
+{
+    return int((qint64(i) * 7 + j * 13 + 1) % n);
+}
+
+} // namespace
+
+
+class BenchScanner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void scanLayeredGraph();
+    void scanLayeredGraphAsTree();
+    void scanWideGraphParallel_data();
+    void scanWideGraphParallel();
+    void scanWideGraphSequential();
+    void scanDeepChain();
+    void scanDeepChainRecursive();
+    void storeNodesInArena();
+    void storeNodesBehindPointers();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_layeredApp;
+    QString m_wideDir;
+    int m_wideModules;
+    QString m_chainRoot;
+    int m_chainLength;
+    int m_storeNodes;
+    int m_storeFanOut;
+};
+
+void BenchScanner::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    // app.exe imports every DLL of layer 1, and each DLL of a layer imports
+    // every DLL of the next one: few modules, but width^layers import paths,
+    // like plugin stacks over a shared runtime
+    const int layers = int(Bench::envSize("DLLCHECKER_BENCH_LAYERS", 10));
+    const int width = int(Bench::envSize("DLLCHECKER_BENCH_LAYER_WIDTH", 3));
+    for (int layer = layers; layer >= 0; --layer) {
+        for (int i = 0; i < (layer == 0 ? 1 : width); ++i) {
+            ImageBuilder builder(kMachineAmd64);
+            if (layer < layers) {
+                for (int j = 0; j < width; ++j) {
+                    builder.addImport(QString("layer%1_%2.dll").arg(layer + 1).arg(j));
+                }
+            }
+            const QString name = layer == 0 ? QString("app.exe") : QString("layer%1_%2.dll").arg(layer).arg(i);
+            QFile file(m_dir.filePath(name));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            QVERIFY(file.write(builder.build()) > 0);
+        }
+    }
+    m_layeredApp = m_dir.filePath("app.exe");
+
+    // DLLCHECKER_BENCH_WIDE_MODULES DLLs in layers of 500; each imports
+    // DLLCHECKER_BENCH_WIDE_FANOUT DLLs of the next layer. Every file is a root
+    // of the directory scan, so most modules are reached from many importers.
+    const int wideModules = int(Bench::envSize("DLLCHECKER_BENCH_WIDE_MODULES", 10000));
+    const int wideFanOut = int(Bench::envSize("DLLCHECKER_BENCH_WIDE_FANOUT", 4));
+    const int layerWidth = qMin(500, wideModules);
+    QVERIFY(QDir(m_dir.path()).mkdir("wide"));
+    m_wideDir = m_dir.filePath("wide");
+    for (int i = 0; i < wideModules; ++i) {
+        ImageBuilder builder(kMachineAmd64);
+        const int nextLayer = (i / layerWidth + 1) * layerWidth;
+        for (int j = 0; j < wideFanOut && nextLayer < wideModules; ++j) {
+            const int target = nextLayer + syntheticTarget(i, j, qMin(layerWidth, wideModules - nextLayer));
+            builder.addImport(QString("wide%1.dll").arg(target));
+        }
+        QFile file(QDir(m_wideDir).filePath(QString("wide%1.dll").arg(i)));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QVERIFY(file.write(builder.build()) > 0);
+    }
+    m_wideModules = wideModules;
+
+    // chain0.dll -> chain1.dll -> ... DLLCHECKER_BENCH_CHAIN_LENGTH modules deep
+    m_chainLength = int(Bench::envSize("DLLCHECKER_BENCH_CHAIN_LENGTH", 1000));
+    QVERIFY(QDir(m_dir.path()).mkdir("chain"));
+    const QDir chainDir(m_dir.filePath("chain"));
+    for (int i = 0; i < m_chainLength; ++i) {
+        ImageBuilder builder(kMachineAmd64);
+        if (i + 1 < m_chainLength) {
+            builder.addImport(QString("chain%1.dll").arg(i + 1));
+        }
+        QFile file(chainDir.filePath(QString("chain%1.dll").arg(i)));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QVERIFY(file.write(builder.build()) > 0);
+    }
+    m_chainRoot = chainDir.filePath("chain0.dll");
+
+    m_storeNodes = int(Bench::envSize("DLLCHECKER_BENCH_GRAPH_NODES", 200000));
+    m_storeFanOut = int(Bench::envSize("DLLCHECKER_BENCH_GRAPH_FANOUT", 4));
+}
+
+void BenchScanner::scanLayeredGraph()
+{
+    DependencyScanner scanner;
+    DependencyScanner::NodeHandle root;
+    QBENCHMARK {
+        root = scanner.scanFile(m_layeredApp);
+    }
+    QVERIFY(root);
+
+    const DependencyGraph& graph = *root.graph();
+    const DependencyGraph::Statistics stats = graph.statistics();
+    const int modules = graph.modules(QVector<DependencyGraph::Index>() << root.index()).size();
+    QHash<DependencyGraph::Index, double> memo;
+    qInfo() << "Modules:" << modules << "edges:" << stats.edges
+            << "tree view nodes:" << pathCount(graph, root.index(), &memo)
+            << "strings:" << stats.strings << "graph bytes:" << stats.bytes;
+}
+
+void BenchScanner::scanLayeredGraphAsTree()
+{
+    // Baseline for scanLayeredGraph: the same scan followed by a copy of
+    // every import path, which is what cloning cached subtrees amounted to
+    DependencyScanner scanner;
+    qint64 treeNodes = 0;
+    const qint64 rssBefore = Bench::currentRss();
+    qint64 rssAfter = rssBefore;
+    QBENCHMARK {
+        treeNodes = 0;
+        const QSharedPointer<TreeNode> tree = copyAsTree(scanner.scanFile(m_layeredApp), &treeNodes);
+        rssAfter = qMax(rssAfter, Bench::currentRss());
+    }
+    qInfo() << "Tree nodes:" << treeNodes << "RSS delta:" << (rssAfter - rssBefore) / 1024 << "KB";
+}
+
+void BenchScanner::scanWideGraphParallel_data()
+{
+    QTest::addColumn<int>("threads");
+    const int threadCounts[] = { 1, 2, 4, 8, 16 };
+    for (int threads : threadCounts) {
+        QTest::newRow(qPrintable(QString("%1 threads").arg(threads))) << threads;
+    }
+}
+
+void BenchScanner::scanWideGraphParallel()
+{
+    // Parse jobs on per-worker deques; each module is parsed by one worker
+    QFETCH(int, threads);
+    DependencyScanner scanner;
+    QList<DependencyScanner::NodeHandle> roots;
+    QBENCHMARK {
+        roots = scanner.scanDirectoryParallel(m_wideDir, false, false, threads);
+    }
+    QCOMPARE(roots.size(), m_wideModules);
+    QCOMPARE(scanner.statistics().modulesParsed, m_wideModules);
+    qInfo() << "Modules:" << DependencyScanner::modules(roots).size()
+            << "parsed:" << scanner.statistics().modulesParsed
+            << "edges:" << roots.first().graph()->statistics().edges;
+}
+
+void BenchScanner::scanWideGraphSequential()
+{
+    // Baseline for scanWideGraphParallel: the same roots walked one by one
+    DependencyScanner scanner;
+    QList<DependencyScanner::NodeHandle> roots;
+    QBENCHMARK {
+        roots = scanner.scanDirectory(m_wideDir);
+    }
+    QCOMPARE(roots.size(), m_wideModules);
+    qInfo() << "Modules:" << DependencyScanner::modules(roots).size()
+            << "parsed:" << scanner.statistics().modulesParsed;
+}
+
+void BenchScanner::scanDeepChain()
+{
+    // Explicit-stack walk; no depth limit by default
+    DependencyScanner scanner;
+    DependencyScanner::NodeHandle root;
+    QBENCHMARK {
+        root = scanner.scanFile(m_chainRoot);
+    }
+    QVERIFY(root);
+    QCOMPARE(DependencyScanner::modules(QList<DependencyScanner::NodeHandle>() << root).size(), m_chainLength);
+}
+
+void BenchScanner::scanDeepChainRecursive()
+{
+    // Baseline for scanDeepChain: the same chain walked on the native stack
+    const ResolverContext context = PathResolver::context(QFileInfo(m_chainRoot).absolutePath());
+    QSharedPointer<DependencyGraph> graph;
+    DependencyGraph::Index root = DependencyGraph::NoIndex;
+    QBENCHMARK {
+        PathResolver::clearCache();
+        graph = QSharedPointer<DependencyGraph>(new DependencyGraph());
+        QHash<StringTable::Id, DependencyGraph::Index> cache;
+        QSet<StringTable::Id> path;
+        root = walkRecursive(graph.data(), m_chainRoot, context, &cache, &path);
+    }
+    QCOMPARE(graph->modules(QVector<DependencyGraph::Index>() << root).size(), m_chainLength);
+}
+
+void BenchScanner::storeNodesInArena()
+{
+    // DLLCHECKER_BENCH_GRAPH_NODES modules with DLLCHECKER_BENCH_GRAPH_FANOUT
+    // imports each, stored the way the scanner stores them now
+    const int n = m_storeNodes;
+    qint64 rssDelta = 0;
+    DependencyGraph::Statistics stats;
+    QBENCHMARK_ONCE {
+        const qint64 rssBefore = Bench::currentRss();
+        QSharedPointer<DependencyGraph> graph(new DependencyGraph());
+        for (int i = 0; i < n; ++i) {
+            const QString path = syntheticPath(i);
+            const DependencyGraph::Index node = graph->addNode(path, path.mid(7));
+            graph->node(node).exists = true;
+            graph->node(node).setArch(PEParser::x64);
+        }
+        QVector<DependencyGraph::Edge> edges(m_storeFanOut);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < m_storeFanOut; ++j) {
+                edges[j].node = DependencyGraph::Index(syntheticTarget(i, j, n));
+            }
+            graph->setEdges(DependencyGraph::Index(i), edges);
+        }
+        rssDelta = Bench::currentRss() - rssBefore;
+        stats = graph->statistics();
+    }
+    qInfo() << "Nodes:" << stats.nodes << "edges:" << stats.edges
+            << "storage bytes per node:" << double(stats.bytes) / stats.nodes
+            << "RSS bytes per node:" << double(rssDelta) / n;
+}
+
+void BenchScanner::storeNodesBehindPointers()
+{
+    // Baseline for storeNodesInArena: the same graph as QSharedPointer nodes
+    // with QList edges, as the scanner stored it before
+    const int n = m_storeNodes;
+    qint64 rssDelta = 0;
+    QBENCHMARK_ONCE {
+        const qint64 rssBefore = Bench::currentRss();
+        QVector<QSharedPointer<PointerNode>> nodes;
+        nodes.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            QSharedPointer<PointerNode> node(new PointerNode());
+            node->filePath = syntheticPath(i);
+            node->fileName = node->filePath.mid(7);
+            node->exists = true;
+            node->arch = PEParser::x64;
+            nodes.append(node);
+        }
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < m_storeFanOut; ++j) {
+                PointerEdge edge;
+                edge.node = nodes.at(syntheticTarget(i, j, n));
+                nodes.at(i)->edges.append(edge);
+            }
+        }
+        rssDelta = Bench::currentRss() - rssBefore;
+    }
+    qInfo() << "Nodes:" << n << "edges:" << qint64(n) * m_storeFanOut
+            << "node record bytes:" << sizeof(PointerNode) << "+ control block,"
+            << "RSS bytes per node:" << double(rssDelta) / n;
+}
+
+QTEST_APPLESS_MAIN(BenchScanner)
+
+#include "bench_scanner.moc"
@@ -0,0 +1,58 @@
+QT += core concurrent testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+TARGET = bench_scanner
+
+INCLUDEPATH += ../include ../tests
+
+SOURCES += \
+    bench_scanner.cpp \
+    ../src/stringtable.cpp \
+    ../src/dependencygraph.cpp \
+    ../src/dependencyscanner.cpp \
+    ../src/logger.cpp \
+    ../src/pathresolver.cpp \
+    ../src/searchplan.cpp \
+    ../src/targetprofile.cpp \
+    ../src/apisetschema.cpp \
+    ../src/knowndlls.cpp \
+    ../src/peparser.cpp \
+    ../src/peimage.cpp \
+    ../src/versionresource.cpp \
+    ../src/exportindex.cpp \
+    ../src/contentdigest.cpp
+
+HEADERS += \
+    benchutil.h \
+    ../tests/testpeimage.h \
+    ../include/stringtable.h \
+    ../include/dependencygraph.h \
+    ../include/workstealingqueue.h \
+    ../include/dependencyscanner.h \
+    ../include/logger.h \
+    ../include/pathresolver.h \
+    ../include/searchplan.h \
+    ../include/stripedcache.h \
+    ../include/systemdlltable.h \
+    ../include/targetprofile.h \
+    ../include/apisetschema.h \
+    ../include/knowndlls.h \
+    ../include/bloomfilter.h \
+    ../include/namefolding.h \
+    ../include/peparser.h \
+    ../include/peimage.h \
+    ../include/versionresource.h \
+    ../include/exportindex.h \
+    ../include/contentdigest.h
+
+# Process memory counters
+win32 {
+    LIBS += -lpsapi
+}
+
+DEFINES += QT_TESTLIB_LIB
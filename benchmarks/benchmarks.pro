@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    bench_peparser.pro \
+    bench_pathresolver.pro \
+    bench_scanner.pro
@@ -0,0 +1,49 @@
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+
+#include <QtGlobal>
+#include <QFile>
+#include <QByteArray>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace Bench {
+
+// Resident set size of the current process in bytes, 0 if unavailable
+inline qint64 currentRss()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return qint64(counters.WorkingSetSize);
+    }
+    return 0;
+#else
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() < 2) {
+        return 0;
+    }
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Integer environment override for benchmark sizes
+inline qint64 envSize(const char* name, qint64 defaultValue)
+{
+    bool ok = false;
+    const qint64 value = qEnvironmentVariable(name).toLongLong(&ok);
+    return ok && value > 0 ? value : defaultValue;
+}
+
+} // namespace Bench
+
+#endif // BENCHUTIL_H
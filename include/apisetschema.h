@@ -0,0 +1,70 @@
+#ifndef APISETSCHEMA_H
+#define APISETSCHEMA_H
+
+#include <QString>
+#include <QVector>
+#include <QPair>
+#include <QMultiHash>
+#include <QSharedPointer>
+#include "namefolding.h"
+
+// API set schema of a Windows installation: the ApiSetMap stored in the
+// .apiset section of System32\apisetschema.dll, which maps virtual contracts
+// such as "api-ms-win-core-file-l1-2-2.dll" to the DLL that implements them.
+// The schema is parsed once into a lookup table keyed by folded name hash,
+// so contracts resolve to host DLLs without touching the file system.
+// Schema versions 2 (Windows 7), 4 (Windows 8.1) and 6 (Windows 10 and later)
+// are understood.
+class ApiSetSchema
+{
+public:
+    // Parse an apisetschema.dll, or a raw .apiset section saved to a file
+    static QSharedPointer<const ApiSetSchema> load(const QString& filePath, QString* error = nullptr);
+
+    // Parse the contents of a .apiset section
+    static QSharedPointer<const ApiSetSchema> fromData(const QByteArray& data, QString* error = nullptr);
+
+    // Raw .apiset section of an apisetschema.dll; empty if the file has none
+    static QByteArray readSection(const QString& filePath, QString* error = nullptr);
+
+    // Names with the api-/ext- prefix are contracts, never files
+    static bool isApiSetName(const QString& name);
+    static bool isApiSetName(const NameFolding::Name& name);
+
+    int version() const { return m_version; }
+    int contractCount() const { return m_contracts.size(); }
+
+    // Host DLL of a contract, e.g. "kernelbase.dll". importingModule selects the
+    // schema's per-importer exceptions. Empty if the target has no such contract
+    // or the contract has no host there; the loader fails to load it in both cases.
+    QString hostFor(const QString& contractName, const QString& importingModule = QString()) const;
+    QString hostFor(const NameFolding::Name& contractName) const;
+
+    // Disable copy
+    ApiSetSchema(const ApiSetSchema&) = delete;
+    ApiSetSchema& operator=(const ApiSetSchema&) = delete;
+
+private:
+    ApiSetSchema();
+
+    struct Contract {
+        QString key;          // Lowercase, without ".dll" (and without the minor version for v6)
+        QString defaultHost;
+        QVector<QPair<QString, QString> > exceptions;  // Importing module -> host
+    };
+
+    bool parseV2(const QByteArray& data, QString* error);
+    bool parseV4(const QByteArray& data, QString* error);
+    bool parseV6(const QByteArray& data, QString* error);
+    void addContract(const QString& name, int keyLength, const QVector<QPair<QString, QString> >& values);
+
+    template <typename Char>
+    const Contract* find(const Char* data, int length) const;
+
+    int m_version;
+    bool m_trimsMinorVersion;  // v6 matches contracts up to the last hyphen
+    QVector<Contract> m_contracts;
+    QMultiHash<uint, int> m_index;  // Folded key hash -> contract
+};
+
+#endif // APISETSCHEMA_H
@@ -0,0 +1,69 @@
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include <QtGlobal>
+#include <QVector>
+
+// Fixed-size Bloom filter over 32-bit name hashes (e.g. NameFolding::hash).
+// mayContain() never returns false for an inserted hash; at 10 bits per
+// expected entry and 7 probes about 1% of absent hashes are let through.
+// Not thread-safe while inserting; build it, then share it read-only.
+class BloomFilter
+{
+public:
+    explicit BloomFilter(int expectedEntries)
+    {
+        quint32 bits = 64;
+        while (bits < quint32(qMax(expectedEntries, 1)) * kBitsPerEntry && bits < (1u << 31)) {
+            bits *= 2;
+        }
+        m_mask = bits - 1;
+        m_words.fill(0, int(bits / 64));
+    }
+
+    void insert(uint hash)
+    {
+        quint32 probe = hash;
+        const quint32 step = stepFor(hash);
+        for (int i = 0; i < kProbes; ++i, probe += step) {
+            const quint32 bit = probe & m_mask;
+            m_words[int(bit >> 6)] |= quint64(1) << (bit & 63);
+        }
+    }
+
+    bool mayContain(uint hash) const
+    {
+        quint32 probe = hash;
+        const quint32 step = stepFor(hash);
+        for (int i = 0; i < kProbes; ++i, probe += step) {
+            const quint32 bit = probe & m_mask;
+            if ((m_words.at(int(bit >> 6)) & (quint64(1) << (bit & 63))) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int bitCount() const { return int(m_mask) + 1; }
+
+private:
+    static const int kProbes = 7;
+    static const quint32 kBitsPerEntry = 10;
+
+    // Double hashing: the second hash is a remix of the first, forced odd so
+    // the probe sequence visits distinct bits
+    static quint32 stepFor(quint32 hash)
+    {
+        hash ^= hash >> 16;
+        hash *= 0x85EBCA6Bu;
+        hash ^= hash >> 13;
+        hash *= 0xC2B2AE35u;
+        hash ^= hash >> 16;
+        return hash | 1;
+    }
+
+    QVector<quint64> m_words;
+    quint32 m_mask;
+};
+
+#endif // BLOOMFILTER_H
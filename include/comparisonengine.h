@@ -19,7 +19,7 @@ public:
 
     // 从目标机扫描结果生成缺失报告
     static MissingReport generateMissingReport(
-        const QList<DependencyScanner::NodePtr>& roots
+        const QList<DependencyScanner::NodeHandle>& roots
     );
     
     // 保存缺失报告到文件
@@ -32,22 +32,22 @@ public:
     static MissingReport loadMissingReport(const QString& filePath);
     
     // 在依赖树中查找并标记缺失的DLL
-    static QList<DependencyScanner::NodePtr> findMissingDLLsInTree(
-        const QList<DependencyScanner::NodePtr>& roots,
+    static QList<DependencyScanner::NodeHandle> findMissingDLLsInTree(
+        const QList<DependencyScanner::NodeHandle>& roots,
         const MissingReport& report
     );
 
 private:
-    // 递归查找DLL节点
+    // 检查单个模块是否匹配（调用方遍历依赖图中的所有模块）
     static void findDLLNodesByName(
-        const DependencyScanner::NodePtr& node,
+        const DependencyScanner::NodeHandle& node,
         const QStringList& dllNames,
-        QList<DependencyScanner::NodePtr>& results
+        QList<DependencyScanner::NodeHandle>& results
     );
     
-    // 递归收集缺失的DLL
+    // 收集单个模块的缺失状态
     static void collectMissingDLLs(
-        const DependencyScanner::NodePtr& node,
+        const DependencyScanner::NodeHandle& node,
         QStringList& missingDLLs
     );
 };
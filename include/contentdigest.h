@@ -0,0 +1,35 @@
+#ifndef CONTENTDIGEST_H
+#define CONTENTDIGEST_H
+
+#include <QtGlobal>
+#include <QString>
+
+// Streaming XXH64 digest of file contents.
+// It is not cryptographic: the digest only identifies byte-identical copies
+// of a DLL (the same vendor DLL shipped in many app folders). Four independent
+// 64-bit lanes per 32-byte stripe let the compiler keep the loop vectorized.
+class ContentDigest
+{
+public:
+    explicit ContentDigest(quint64 seed = 0);
+
+    void update(const uchar* data, qint64 length);
+    quint64 finish() const;
+
+    // One-shot digest of a buffer
+    static quint64 compute(const uchar* data, qint64 length, quint64 seed = 0);
+
+    // 16 lowercase hex digits, as written to reports
+    static QString toHex(quint64 digest);
+
+private:
+    static const int kStripeSize = 32;
+
+    quint64 m_lanes[4];
+    uchar m_buffer[kStripeSize];
+    int m_buffered;
+    quint64 m_totalLength;
+    quint64 m_seed;
+};
+
+#endif // CONTENTDIGEST_H
@@ -0,0 +1,199 @@
+#ifndef DEPENDENCYGRAPH_H
+#define DEPENDENCYGRAPH_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QHash>
+#include "peparser.h"
+#include "stringtable.h"
+
+// Module graph of one scan. Nodes live in fixed-size blocks that never move,
+// so a node index stays valid (and its address stable) for the lifetime of
+// the graph; the imports of a node are a contiguous range of one shared edge
+// array and name their targets by index. A graph of n modules costs n block
+// slots instead of n heap nodes, each behind a reference-counted pointer.
+// Paths, names and versions are IDs into the graph's string table.
+class DependencyGraph
+{
+public:
+    typedef quint32 Index;
+    static const Index NoIndex = 0xffffffffu;
+
+    struct Node {
+        StringTable::Id filePath;
+        StringTable::Id fileName;
+        StringTable::Id fileVersion;
+        StringTable::Id productVersion;
+        quint64 contentDigest;  // XXH64 of the file contents, 0 if not computed
+        quint32 firstEdge;      // Imports are edges [firstEdge, firstEdge + edgeCount)
+        quint32 edgeCount;
+        quint32 archBits : 2;   // PEParser::Architecture
+        quint32 exists : 1;
+        quint32 delayPending : 1;  // Only reached through delay-load imports so far; edges not scanned yet
+
+        Node() : filePath(StringTable::Empty), fileName(StringTable::Empty),
+                 fileVersion(StringTable::Empty), productVersion(StringTable::Empty),
+                 contentDigest(0), firstEdge(0), edgeCount(0), archBits(PEParser::Unknown),
+                 exists(0), delayPending(0) {}
+
+        PEParser::Architecture arch() const { return PEParser::Architecture(archBits); }
+        void setArch(PEParser::Architecture arch) { archBits = quint32(arch); }
+    };
+
+    // One import. Per-importer state lives on the edge, because the target
+    // node is shared by every module that imports it.
+    struct Edge {
+        Index node;
+        quint32 symbolList : 28;  // Missing symbols, 1-based index into the graph's lists; 0 if none
+        quint32 delayLoad : 1;    // Delay-load import
+        quint32 viaForwarder : 1; // Pulled in by a forwarded export rather than the import table
+        quint32 archMismatch : 1; // x64 importer, x86 DLL
+        quint32 circular : 1;     // Import back into a module still being scanned; node is a childless placeholder,
+                              // or the module itself if a full graph had no room for one
+
+        Edge() : node(NoIndex), symbolList(0), delayLoad(0), viaForwarder(0), archMismatch(0), circular(0) {}
+        bool isNull() const { return node == NoIndex; }
+    };
+
+    struct Statistics {
+        int nodes;
+        int edges;
+        int deadEdges; // Slots of ranges replaced by a new walk, until compacted
+        int strings;   // Distinct paths, names and versions
+        qint64 bytes;  // Node blocks, edge array, symbol lists and string table, without string payloads
+
+        Statistics() : nodes(0), edges(0), deadEdges(0), strings(0), bytes(0) {}
+    };
+
+    DependencyGraph();
+    ~DependencyGraph();
+
+    // Thread-safe; the node is visible to other threads once its index is
+    // handed over through a lock (the scanner's cache mutex). NoIndex once
+    // the node blocks or the string table are full.
+    Index addNode(StringTable::Id filePath, StringTable::Id fileName);
+    Index addNode(const QString& filePath, const QString& fileName);
+    bool isFull() const;
+
+    Node& node(Index index) { return m_blocks[index >> BLOCK_SHIFT][index & BLOCK_MASK]; }
+    const Node& node(Index index) const { return m_blocks[index >> BLOCK_SHIFT][index & BLOCK_MASK]; }
+    int nodeCount() const;
+
+    StringTable& strings() { return m_strings; }
+    const StringTable& strings() const { return m_strings; }
+    const QString& string(StringTable::Id id) const { return m_strings.string(id); }
+
+    // Replaces the imports of node. A node walked again (reached by a shorter
+    // chain under a depth limit) overwrites its old range if the new edges fit,
+    // or grows it at the end of the array; otherwise the old range is dropped
+    // and compacted away once dead edges outnumber live ones. The array may
+    // move, so readers of other nodes' edges must not run concurrently; the
+    // scanner publishes and reads edges under its cache mutex.
+    void setEdges(Index node, const QVector<Edge>& edges);
+    const Edge* edgesOf(Index node) const { return m_edges.constData() + this->node(node).firstEdge; }
+    // For passes over a finished graph, e.g. cutting cycles after a parallel scan
+    Edge* edgesOf(Index node) { return m_edges.data() + this->node(node).firstEdge; }
+    const Edge& edge(Index node, int i) const { return m_edges.at(int(this->node(node).firstEdge) + i); }
+
+    // Thread-safe; returns the value for Edge::symbolList
+    quint32 addSymbolList(const QStringList& symbols);
+    QStringList symbolList(quint32 list) const;
+
+    // Every node reachable from roots, once each, in depth-first pre-order.
+    // Placeholders of circular imports are skipped; the module itself is an ancestor.
+    QVector<Index> modules(const QVector<Index>& roots) const;
+
+    // Whether one of targets can be reached from node without crossing a circular edge
+    bool reaches(Index node, const QVector<Index>& targets) const;
+
+    Statistics statistics() const;
+
+    // Disable copy
+    DependencyGraph(const DependencyGraph&) = delete;
+    DependencyGraph& operator=(const DependencyGraph&) = delete;
+
+    class NodeHandle;
+    struct EdgeView;
+
+private:
+    static const int BLOCK_SHIFT = 10;
+    static const Index BLOCK_SIZE = 1u << BLOCK_SHIFT;
+    static const Index BLOCK_MASK = BLOCK_SIZE - 1;
+    static const int MAX_BLOCKS = 4096;  // 4M nodes; the block table never grows, so lookups need no lock
+
+    void compactEdges();
+
+    Node** m_blocks;
+    Index m_nodeCount;
+    StringTable m_strings;
+    QVector<Edge> m_edges;
+    quint32 m_deadEdges;  // Entries of m_edges no node's range covers any more
+    QVector<QStringList> m_symbolLists;
+    mutable QMutex m_mutex;  // Allocation of nodes, edge ranges and symbol lists
+};
+
+// Node of a graph for code outside the scanner. Keeps the graph alive; the
+// nodes themselves are not reference counted.
+class DependencyGraph::NodeHandle
+{
+public:
+    NodeHandle() : m_index(NoIndex) {}
+    NodeHandle(const QSharedPointer<DependencyGraph>& graph, Index index)
+        : m_graph(graph), m_index(graph ? index : NoIndex) {}
+
+    bool isNull() const { return m_index == NoIndex; }
+    explicit operator bool() const { return !isNull(); }
+
+    // Stable address of the node, e.g. as a memo key
+    const Node* data() const { return isNull() ? nullptr : &m_graph->node(m_index); }
+
+    const QString& filePath() const { return m_graph->string(node().filePath); }
+    const QString& fileName() const { return m_graph->string(node().fileName); }
+    const QString& fileVersion() const { return m_graph->string(node().fileVersion); }
+    const QString& productVersion() const { return m_graph->string(node().productVersion); }
+    PEParser::Architecture arch() const { return node().arch(); }
+    bool exists() const { return node().exists; }
+    bool delayPending() const { return node().delayPending; }
+    quint64 contentDigest() const { return node().contentDigest; }
+
+    Index index() const { return m_index; }
+    const QSharedPointer<DependencyGraph>& graph() const { return m_graph; }
+
+    int edgeCount() const { return isNull() ? 0 : int(m_graph->node(m_index).edgeCount); }
+    EdgeView edge(int i) const;
+    QVector<EdgeView> edges() const;
+
+    bool operator==(const NodeHandle& other) const { return m_index == other.m_index && m_graph == other.m_graph; }
+    bool operator!=(const NodeHandle& other) const { return !(*this == other); }
+
+private:
+    const Node& node() const { return m_graph->node(m_index); }
+
+    QSharedPointer<DependencyGraph> m_graph;
+    Index m_index;
+};
+
+// Value copy of one edge with its target as a handle, for views and reports
+struct DependencyGraph::EdgeView {
+    NodeHandle node;
+    QStringList missingSymbols;  // Functions the importer needs but node does not export
+    bool delayLoad;
+    bool viaForwarder;
+    bool archMismatch;
+    bool circular;
+
+    EdgeView() : delayLoad(false), viaForwarder(false), archMismatch(false), circular(false) {}
+    explicit EdgeView(const NodeHandle& target)
+        : node(target), delayLoad(false), viaForwarder(false), archMismatch(false), circular(false) {}
+};
+
+inline uint qHash(const DependencyGraph::NodeHandle& handle, uint seed = 0)
+{
+    return qHash(quintptr(handle.data()), seed);
+}
+
+#endif // DEPENDENCYGRAPH_H
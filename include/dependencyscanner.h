@@ -7,51 +7,76 @@
 #include <QHash>
 #include <QSet>
 #include <QMutex>
+#include <QVector>
 #include <QSharedPointer>
-#include <QWeakPointer>
-#include <memory>
 #include "peparser.h"
+#include "dependencygraph.h"
+#include "pathresolver.h"
 
 class DependencyScanner : public QObject
 {
     Q_OBJECT
 
 public:
-    struct DependencyNode {
-        QString filePath;
-        QString fileName;
-        PEParser::Architecture arch;
-        QString fileVersion;
-        QString productVersion;
-        bool exists;
-        bool archMismatch;
-        QList<QSharedPointer<DependencyNode>> children;
-        QWeakPointer<DependencyNode> parent;
-        int depth;
-        
-        DependencyNode() : arch(PEParser::Unknown), exists(false), 
-                          archMismatch(false), depth(0) {}
-    };
+    // Modules of a scan live in a DependencyGraph; a handle keeps the graph
+    // alive. A DLL imported by several modules is a single node, so the
+    // nodes of a scan form a DAG; tree views expand it on demand.
+    using Index = DependencyGraph::Index;
+    using DependencyNode = DependencyGraph::Node;
+    using NodeHandle = DependencyGraph::NodeHandle;
+    using DependencyEdge = DependencyGraph::EdgeView;
 
-    using NodePtr = QSharedPointer<DependencyNode>;
+    // Counters for the most recent scan
+    struct ScanStatistics {
+        int filesProbed;      // Root files classified by the header probe
+        int rejectedFiles;    // Non-PE files dropped before parsing
+        int leafFiles;        // PE files without imports, not parsed further
+        int deferredDelayLoads;  // Delay-loaded DLLs resolved but left unscanned when first reached
+        int missingSymbols;   // Imported functions not exported by the resolved DLL
+        int sharedParses;     // Files that reused the parse of a byte-identical copy
+        int modulesParsed;    // Modules parsed by the scan, not counting shared copies
+        int negativeFilterHits;  // DLL lookups answered as misses without walking the shared search paths
+        int negativeFilterFalsePositives;  // Lookups the filter let through that still missed
+
+        ScanStatistics() : filesProbed(0), rejectedFiles(0), leafFiles(0),
+                           deferredDelayLoads(0), missingSymbols(0), sharedParses(0),
+                           modulesParsed(0), negativeFilterHits(0), negativeFilterFalsePositives(0) {}
+    };
 
     explicit DependencyScanner(QObject *parent = nullptr);
     ~DependencyScanner();
 
     // Scan a single file
-    // Returned nodes are shared via QSharedPointer.
-    NodePtr scanFile(const QString& filePath, bool includeSystemDLLs = false);
+    NodeHandle scanFile(const QString& filePath, bool includeSystemDLLs = false);
     
-    // Scan a directory for all DLL and EXE files
-    // Returned nodes are shared via QSharedPointer.
-    QList<NodePtr> scanDirectory(const QString& dirPath, bool recursive = false, bool includeSystemDLLs = false);
+    // Scan a directory for all DLL and EXE files; the roots share one graph
+    QList<NodeHandle> scanDirectory(const QString& dirPath, bool recursive = false, bool includeSystemDLLs = false);
     
-    // Scan a directory with parallel processing
-    // Returned nodes are shared via QSharedPointer.
-    QList<NodePtr> scanDirectoryParallel(const QString& dirPath, bool recursive = false, bool includeSystemDLLs = false, int threadCount = 4);
+    // Scan a directory with parallel processing. Parsing a module is the unit
+    // of work: each unique module of all roots is parsed once, by whichever
+    // worker claims it first, and idle workers steal jobs from busy ones.
+    QList<NodeHandle> scanDirectoryParallel(const QString& dirPath, bool recursive = false, bool includeSystemDLLs = false, int threadCount = 4);
+    
+    // Scan the imports of a node left pending by a scan. root is the scanned
+    // file whose graph holds node; the modules of that graph (under any root)
+    // are reused instead of parsed again, and the new nodes and edges are
+    // added to it. Does not clear the process-wide resolver cache.
+    // Returns false if the node has nothing to expand.
+    bool expandDelayLoad(const NodeHandle& node, const NodeHandle& root, bool includeSystemDLLs = false);
+
+    // Every module reachable from roots, once each, in depth-first pre-order
+    static QList<NodeHandle> modules(const QList<NodeHandle>& roots);
     
     // Check for circular dependencies
-    bool hasCircularDependency(const NodePtr& node);
+    bool hasCircularDependency(const NodeHandle& node);
+
+    // Modules more than maxDepth imports below the nearest root are left out
+    // of the graph, with a warning. A module is walked again when a shorter
+    // chain reaches it, so the graph does not depend on the order of the walk.
+    // 0 (the default) scans chains of any depth; the walk keeps its own stack,
+    // so depth costs no native stack.
+    void setMaxDepth(int maxDepth);
+    int maxDepth() const;
 
     // Clear cache
     void clearCache();
@@ -62,25 +87,176 @@ public:
     // Check if cancelled
     bool isCancelled() const;
 
+    // Whether the last scan was stopped because its graph ran out of node or
+    // string slots; its results are incomplete
+    bool isGraphFull() const;
+
+    // Statistics of the most recent scan
+    ScanStatistics statistics() const;
+
 signals:
     void scanProgress(int current, int total, const QString& currentFile);
     void scanCompleted();
 
 private:
-    NodePtr scanFileRecursive(const QString& filePath, const QString& appDir,
-                             const NodePtr& parent, int depth, bool includeSystemDLLs);
-    NodePtr scanFileWithCustomStack(const QString& filePath, const QString& appDir,
-                                   const NodePtr& parent, int depth, bool includeSystemDLLs,
-                                   QStringList& customStack, QSet<QString>& customSet);
-    QHash<QString, QWeakPointer<DependencyNode>> m_cache;
-    QMutex m_cacheMutex;
-    QStringList m_scanningStack;
-    QSet<QString> m_scanningSet;
-    QMutex m_scanningMutex;
+    static const int MAX_FORWARD_HOPS = 16;
+    static const int MAX_SHARED_IMAGES = 256;  // Entries hold copied names, no file or mapping
+    static const int SHARING_PREFIX_SIZE = 4096;  // Bytes that key a windowed file (always larger)
+
+    // Candidates for byte-identical files: sharing digest and size
+    typedef QPair<quint64, qint64> ContentKey;
+    // Parse kept for the copies of one file, with its names detached
+    struct SharedParse {
+        PEParser::PEInfo info;
+        QString filePath;       // File the parse came from
+        quint64 contentDigest;  // Of the whole file; 0 until a hit on a windowed file needs it
+
+        SharedParse() : contentDigest(0) {}
+    };
+    // Forwarder string within one resolver context and importer bitness
+    typedef QPair<quint64, QString> ForwardKey;
+
+    PEParser::HeaderProbe probeRootFile(const QString& filePath);
+    // Node for a root without imports, shared with importers that reach it
+    Index leafNode(const QString& filePath, const PEParser::HeaderProbe& probe);
+    PEParser::PEInfo parseShared(const QString& filePath);
+    // Result of following a forwarder chain such as "NTDLL.RtlAllocateHeap"
+    struct ForwardTarget {
+        QList<PathResolver::ResolveResult> modules;  // Every module visited along the chain
+        QString brokenHop;                           // Forwarder that could not be resolved, empty if none
+        int length;       // Further forwarders the chain followed, for the hop budget of a memo hit
+        bool hopLimited;  // Broken by MAX_FORWARD_HOPS, so it depends on the hops before the forwarder
+
+        ForwardTarget() : length(0), hopLimited(false) {}
+    };
+
+    QSharedPointer<const ExportIndex> exportIndexFor(const QString& filePath);
+    QStringList checkImportedSymbols(const QString& dllPath, const QVector<PEImage::ImportedSymbol>& symbols,
+                                     const ResolverContext& context, bool wow64,
+                                     QList<PathResolver::ResolveResult>* forwardedModules);
+    // wow64: the importer is a 32-bit image, see PathResolver::resolveDLLPath()
+    ForwardTarget resolveForwarder(const QString& forwarder, const ResolverContext& context, bool wow64, int hops);
+    QList<PathResolver::ResolveResult> hiddenDependencies(const QString& filePath,
+                                                          const QVector<DependencyGraph::Edge>& edges,
+                                                          const QList<PathResolver::ResolveResult>& forwardedModules,
+                                                          bool includeSystemDLLs);
+    // Unit of work of a graph scan: parse one module and claim its imports
+    struct ScanJob {
+        Index node;
+        int context;  // Resolver context of the job's root, see GraphScan
+        int depth;
+        int root;     // Result slot of a root file, -1 for an imported module
+
+        ScanJob() : node(DependencyGraph::NoIndex), context(0), depth(0), root(-1) {}
+    };
+    struct GraphScan;
+    class GraphScanWorker;
+
+    // Modules on the import chain being walked; one per thread. In a graph
+    // scan imports are claimed as jobs instead, and the chain stays empty.
+    struct ScanPath {
+        QVector<StringTable::Id> stack;  // Case-folded path IDs
+        QSet<StringTable::Id> set;
+        QVector<Index> rescanning;  // Shared pending nodes whose edges are being scanned in place
+        GraphScan* graphScan;       // Set while running a job of a graph scan
+        int worker;
+        int context;
+
+        ScanPath() : graphScan(nullptr), worker(0), context(0) {}
+    };
+
+    enum ModuleState { ModuleClaimed, ModuleInProgress, ModuleDone };
+
+    // A module being scanned, with the position in its imports that a
+    // recursive walk would have kept on the native stack
+    struct WalkFrame {
+        Index node;
+        StringTable::Id key;  // Case-folded path ID
+        bool rescan;          // Pending node scanned in place
+        bool exists;
+        int depth;
+        QString fileName;
+        PEParser::PEInfo peInfo;
+        QVector<DependencyGraph::Edge> edges;
+        QList<PathResolver::ResolveResult> forwardedModules;  // Reached by the imports' forwarders
+        QList<PathResolver::ResolveResult> forwarders;        // Of those, the ones to scan as edges
+        bool forwardersListed;
+        int nextImport;
+        int nextForwarder;
+        int childImport;      // Import the current child comes from, -1 for a forwarder module
+        QString childPath;    // Empty if the child is not a scanned module
+
+        WalkFrame() : node(DependencyGraph::NoIndex), key(StringTable::Empty), rescan(false), exists(false),
+                      depth(0), forwardersListed(false), nextImport(0), nextForwarder(0), childImport(-1) {}
+    };
+
+    // Adds a node, or stops the scan with an error if the graph is full
+    Index addGraphNode(StringTable::Id filePath, StringTable::Id fileName);
+    // Nodes without edges are shared per case-folded path, so the graph grows
+    // with the modules of a scan and not with its imports
+    Index sharedNode(QHash<StringTable::Id, Index>* nodes, StringTable::Id filePath, StringTable::Id fileName,
+                     bool exists, StringTable::Id fileVersion = StringTable::Empty);
+    // Leaf for a DLL that was not found
+    Index missingNode(const QString& dllName);
+    // Stands in for a module whose node cannot be linked without closing a cycle
+    Index placeholderNode(StringTable::Id filePath);
+    void appendDelayLoadEdges(QVector<DependencyGraph::Edge>* edges, const PEParser::PEInfo& peInfo,
+                              const ResolverContext& context, bool includeSystemDLLs, const ScanPath& path);
+    // Leaf for a DLL that exists only in the target profile
+    Index targetProfileNode(const PathResolver::ResolveResult& result);
+    // Walks filePath and the modules below it depth-first, without recursion
+    DependencyGraph::Edge scanModule(const QString& filePath, const ResolverContext& context,
+                                     bool includeSystemDLLs, ScanPath& path);
+    // Pushes a frame for filePath, or sets *edge if the module needs no walk
+    // (cached, circular, beyond the depth limit or cancelled)
+    bool enterModule(const QString& filePath, int depth, ScanPath& path,
+                     QVector<WalkFrame>* frames, DependencyGraph::Edge* edge);
+    DependencyGraph::Edge leaveModule(WalkFrame* frame, const ResolverContext& context,
+                                      bool includeSystemDLLs, ScanPath& path);
+    // Adds edges for imports up to the next module to scan, whose path goes
+    // to *childPath; false once the imports and forwarder modules are done
+    bool nextImport(WalkFrame* frame, const ResolverContext& context, bool includeSystemDLLs,
+                    const ScanPath& path, QString* childPath);
+    void addImportEdge(WalkFrame* frame, DependencyGraph::Edge edge,
+                       const ResolverContext& context, const ScanPath& path);
+    // First claim of a module queues its job; later ones link the claimed node,
+    // and queue it again if they are shallower under a depth limit
+    DependencyGraph::Edge claimModule(const QString& filePath, int depth, const ScanPath& path, int root = -1);
+    void runScanJob(const ScanJob& job, GraphScan* scan, int worker);
+    void finishGraphScan(const QVector<Index>& roots);
+    // Clears the scanner's own caches and switches to graph; leaves PathResolver alone
+    void resetScanState(const QSharedPointer<DependencyGraph>& graph);
+    QSharedPointer<DependencyGraph> m_graph;  // Graph of the current scan, replaced by clearCache()
+    QHash<StringTable::Id, Index> m_cache;  // Case-folded path ID -> node
+    QSet<Index> m_rescanning;  // Pending nodes claimed by a walk
+    QHash<Index, ModuleState> m_moduleStates;  // Modules claimed by a graph scan
+    QHash<Index, int> m_moduleDepths;  // Shortest depth a module was walked at; kept under a depth limit only
+    QMutex m_cacheMutex;  // m_cache, m_rescanning, m_moduleStates, m_moduleDepths and the edges of m_graph
+    QHash<StringTable::Id, Index> m_missingNodes;      // Case-folded DLL name -> node
+    QHash<StringTable::Id, Index> m_placeholderNodes;  // Case-folded path -> placeholder of circular imports
+    QHash<StringTable::Id, Index> m_targetProfileNodes;  // Case-folded path -> node
+    QMutex m_sharedNodesMutex;  // The three above; taken after m_cacheMutex
+    QHash<StringTable::Id, QSharedPointer<const ExportIndex>> m_exportIndexes;
+    QMutex m_exportIndexMutex;
+    QHash<ForwardKey, ForwardTarget> m_forwardMemo;
+    QMutex m_forwardMutex;
+    QHash<ContentKey, SharedParse> m_parsedImages;
+    QSet<qint64> m_seenSizes;  // A parse is kept only once a second file of its size turns up
+    QMutex m_parsedImagesMutex;  // m_parsedImages and m_seenSizes
+    ScanPath m_scanningPath;
     QAtomicInt m_cancelled;
+    QAtomicInt m_graphFull;
+    int m_maxDepth;
+    QAtomicInt m_filesProbed;
+    QAtomicInt m_rejectedFiles;
+    QAtomicInt m_leafFiles;
+    QAtomicInt m_deferredDelayLoads;
+    QAtomicInt m_missingSymbols;
+    QAtomicInt m_sharedParses;
+    QAtomicInt m_modulesParsed;
 };
 
-Q_DECLARE_METATYPE(DependencyScanner::NodePtr)
-Q_DECLARE_METATYPE(QList<DependencyScanner::NodePtr>)
+Q_DECLARE_METATYPE(DependencyScanner::NodeHandle)
+Q_DECLARE_METATYPE(QList<DependencyScanner::NodeHandle>)
 
 #endif // DEPENDENCYSCANNER_H
@@ -34,7 +34,7 @@ public:
 
     // 从高亮节点列表收集DLL（新方法）
     CollectionResult collectDLLsFromNodes(
-        const QList<DependencyScanner::NodePtr>& nodes,
+        const QList<DependencyScanner::NodeHandle>& nodes,
         const QString& targetDirectory,
         ConflictResolution conflictMode = AskUser
     );
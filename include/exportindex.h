@@ -0,0 +1,57 @@
+#ifndef EXPORTINDEX_H
+#define EXPORTINDEX_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QByteArray>
+#include <QLatin1String>
+#include "peimage.h"
+
+// Compact, immutable hash index over a DLL's export directory.
+// It is built once per DLL and shared by every module that imports from it.
+// Names are copied into a single blob, so the index outlives the mapping
+// it was built from.
+class ExportIndex
+{
+public:
+    struct Entry {
+        quint32 hash;
+        quint32 ordinal;
+        quint32 nameOffset;       // into the name blob
+        quint32 forwarderOffset;  // into the name blob
+        quint16 nameLength;       // 0 for exports by ordinal only
+        quint16 forwarderLength;  // 0 if the export is not forwarded
+    };
+
+    ExportIndex();
+    explicit ExportIndex(const PEImage& image);
+
+    int size() const { return m_entries.size(); }
+    bool isEmpty() const { return m_entries.isEmpty(); }
+
+    // Exact, case-sensitive lookup like GetProcAddress; nullptr if not exported
+    const Entry* findName(const char* name, int length) const;
+    const Entry* findOrdinal(quint32 ordinal) const;
+
+    // Export matching an imported function, by name or by ordinal
+    const Entry* find(const PEImage::ImportedSymbol& symbol) const;
+
+    // True if the DLL provides the imported function (forwarders count as provided)
+    bool contains(const PEImage::ImportedSymbol& symbol) const { return find(symbol) != nullptr; }
+
+    QLatin1String name(const Entry& entry) const;
+    QLatin1String forwarder(const Entry& entry) const;
+    static bool isForwarded(const Entry& entry) { return entry.forwarderLength != 0; }
+
+private:
+    static quint32 hashName(const char* name, int length);
+    static int slotCount(int entries);
+    quint32 appendText(const PEImage::NameRef& text);
+
+    QVector<Entry> m_entries;
+    QVector<qint32> m_nameSlots;     // open addressing over name hashes, -1 = empty
+    QVector<qint32> m_ordinalSlots;  // open addressing over ordinals, -1 = empty
+    QByteArray m_text;
+};
+
+#endif // EXPORTINDEX_H
@@ -0,0 +1,43 @@
+#ifndef KNOWNDLLS_H
+#define KNOWNDLLS_H
+
+#include <QString>
+#include <QStringList>
+#include <QMultiHash>
+#include <QSharedPointer>
+#include "namefolding.h"
+
+// KnownDLLs list of a Windows installation
+// (HKLM\SYSTEM\CurrentControlSet\Control\Session Manager\KnownDLLs). The
+// loader maps these DLLs from the \KnownDlls section directory instead of
+// searching for them, so an app-local copy never shadows the system one.
+class KnownDlls
+{
+public:
+    // Parse a regedit export (.reg, UTF-16 or ANSI) that contains the KnownDLLs key
+    static QSharedPointer<const KnownDlls> loadRegistryExport(const QString& filePath, QString* error = nullptr);
+
+    // DLL file names, e.g. "kernel32.dll"
+    static QSharedPointer<const KnownDlls> fromNames(const QStringList& names);
+
+    // The local machine's list; null where there is no registry to read
+    static QSharedPointer<const KnownDlls> readLocalRegistry();
+
+    QStringList names() const { return m_names; }
+    int count() const { return m_names.size(); }
+
+    bool contains(const QString& name) const;
+    bool contains(const NameFolding::Name& name) const;
+
+    // Disable copy
+    KnownDlls(const KnownDlls&) = delete;
+    KnownDlls& operator=(const KnownDlls&) = delete;
+
+private:
+    KnownDlls() {}
+
+    QStringList m_names;
+    QMultiHash<uint, int> m_index;  // Folded name hash -> m_names
+};
+
+#endif // KNOWNDLLS_H
@@ -9,6 +9,7 @@
 #include <QStatusBar>
 #include <QCheckBox>
 #include <QThread>
+#include <QHash>
 #include <memory>
 #include "dependencyscanner.h"
 #include "comparisonengine.h"
@@ -29,24 +30,37 @@ private slots:
     void onExportMissingReport();
     void onExportReport();
     void onAutoCollectDLLs();
+    void onLoadTargetProfile();
+    void onCaptureTargetProfile();
+    void onLoadApiSetSchema();
+    void onLoadKnownDlls();
+    void onSelectSearchPlan();
+    void onUseLocalSystem();
     void onClearAll();
     void onTreeItemClicked(QTreeWidgetItem* item, int column);
+    void onTreeItemExpanded(QTreeWidgetItem* item);
     void onScanProgress(int current, int total, const QString& file);
-    void onScanFinished(QList<DependencyScanner::NodePtr> results);
+    void onScanFinished(QList<DependencyScanner::NodeHandle> results);
     void onScanError(const QString& errorMessage);
     void onCancelScan();
 
 private:
     void setupUI();
-    void populateTree(const DependencyScanner::NodePtr& root);
+    void populateTree(const DependencyScanner::NodeHandle& root);
     void showDLLDetails(QTreeWidgetItem* item);
-    QTreeWidgetItem* createTreeItem(const DependencyScanner::NodePtr& node);
+    QTreeWidgetItem* createTreeItem(const DependencyScanner::DependencyEdge& edge);
+    void populateTreeItem(QTreeWidgetItem* item);  // 展开时才创建子节点
     void expandMissingNodes(QTreeWidgetItem* item);  // 自动展开缺失项
     bool hasMissingDependencies(QTreeWidgetItem* item);  // 检查是否包含缺失项
+    bool hasMissingBelow(const DependencyScanner::NodeHandle& node);  // 依赖图中该模块之下是否有缺失项
     void highlightMissingDLLs(const QStringList& missingDLLs);  // 高亮显示缺失DLL
-    void highlightTreeItem(QTreeWidgetItem* item, const QStringList& missingDLLs, 
-                          const DependencyScanner::NodePtr& node);  // 递归高亮
-    QList<DependencyScanner::NodePtr> getHighlightedNodes();  // 获取高亮节点
+    void highlightTreeItem(QTreeWidgetItem* item, const QStringList& missingDLLs,
+                          QHash<const DependencyScanner::DependencyNode*, bool>* leadsToMissing);  // 高亮子树
+    void highlightTreeNode(QTreeWidgetItem* item, const DependencyScanner::NodeHandle& node,
+                           const QStringList& missingDLLs);  // 高亮单个节点
+    bool leadsToDll(const DependencyScanner::NodeHandle& node, const QStringList& dllNames,
+                    QHash<const DependencyScanner::DependencyNode*, bool>* memo);  // 该模块之下是否有指定DLL
+    QList<DependencyScanner::NodeHandle> getHighlightedNodes();  // 获取高亮节点
     void clearAllData();  // 清空所有数据
     QString formatErrorWithSuggestion(const QString& errorMessage);  // 格式化错误信息并提供建议
     QString formatFileSize(qint64 bytes);  // 格式化文件大小
@@ -55,14 +69,16 @@ private:
     QTextEdit* m_detailPanel;
     QProgressBar* m_progressBar;
     QToolBar* m_toolBar;
+    QAction* m_targetProfileAction;
     QCheckBox* m_showSystemDLLs;
     QCheckBox* m_recursiveScan;
 
     QThread* m_scanThread;
     ScanWorker* m_scanWorker;
-    QList<DependencyScanner::NodePtr> m_scanResults;
-    QList<DependencyScanner::NodePtr> m_highlightedNodes;
-    QMap<QTreeWidgetItem*, DependencyScanner::NodePtr> m_itemNodeMap;
+    QList<DependencyScanner::NodeHandle> m_scanResults;
+    QList<DependencyScanner::NodeHandle> m_highlightedNodes;
+    QMap<QTreeWidgetItem*, DependencyScanner::DependencyEdge> m_itemEdgeMap;  // 树节点对应依赖图中的一条边
+    QHash<const DependencyScanner::DependencyNode*, bool> m_missingBelow;
     bool m_isScanning;
     bool m_isDestroying;
     qint64 m_scanStartTime;
@@ -0,0 +1,131 @@
+#ifndef NAMEFOLDING_H
+#define NAMEFOLDING_H
+
+#include <QString>
+#include <QChar>
+#include <QLatin1String>
+
+// Case-insensitive hashing and comparison of DLL names that work the same on
+// raw Latin-1 bytes (import names inside a mapped image) and on QStrings,
+// so lookups from the scanner's hot path need no temporary lowercase copies.
+namespace NameFolding {
+
+// Non-owning DLL name (Latin-1 bytes) with its precomputed folded hash
+struct Name {
+    const char* data;
+    int length;
+    uint hash;
+
+    QLatin1String toLatin1() const { return QLatin1String(data, length); }
+    QString toString() const { return QString::fromLatin1(data, length); }
+};
+
+// Windows compares file names by upcasing each UTF-16 unit on its own (no
+// locale, no multi-character mappings), so two units are equal exactly when
+// their simple uppercase forms are. ASCII folds to lowercase, which keeps
+// the hashes of ASCII names those of the lowercase name.
+inline ushort fold(ushort ch)
+{
+    if (ch >= 0x80) {
+        ch = QChar(ch).toUpper().unicode();
+    }
+    return (ch >= 'A' && ch <= 'Z') ? ushort(ch + ('a' - 'A')) : ch;
+}
+
+// FNV-1a over the folded UTF-16 code units
+inline uint hash(const char* data, int length)
+{
+    uint h = 2166136261u;
+    for (int i = 0; i < length; ++i) {
+        h = (h ^ fold(uchar(data[i]))) * 16777619u;
+    }
+    return h;
+}
+
+inline uint hash(const QString& text)
+{
+    uint h = 2166136261u;
+    const QChar* chars = text.constData();
+    for (int i = 0; i < text.size(); ++i) {
+        h = (h ^ fold(chars[i].unicode())) * 16777619u;
+    }
+    return h;
+}
+
+inline bool equals(const char* data, int length, const QString& text)
+{
+    if (length != text.size()) {
+        return false;
+    }
+    const QChar* chars = text.constData();
+    for (int i = 0; i < length; ++i) {
+        if (fold(uchar(data[i])) != fold(chars[i].unicode())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool equals(const QString& a, const QString& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    const QChar* left = a.constData();
+    const QChar* right = b.constData();
+    for (int i = 0; i < a.size(); ++i) {
+        if (fold(left[i].unicode()) != fold(right[i].unicode())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool equals(const Name& a, const Name& b)
+{
+    if (a.hash != b.hash || a.length != b.length) {
+        return false;
+    }
+    for (int i = 0; i < a.length; ++i) {
+        if (fold(uchar(a.data[i])) != fold(uchar(b.data[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Case-insensitive prefix tests; prefix must be lowercase ASCII
+inline bool startsWith(const char* data, int length, const char* prefix)
+{
+    int i = 0;
+    for (; prefix[i] != '\0'; ++i) {
+        if (i >= length || fold(uchar(data[i])) != ushort(uchar(prefix[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool startsWith(const QString& text, const char* prefix)
+{
+    int i = 0;
+    for (; prefix[i] != '\0'; ++i) {
+        if (i >= text.size() || fold(text.at(i).unicode()) != ushort(uchar(prefix[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline Name makeName(const char* data, int length)
+{
+    Name name;
+    name.data = data;
+    name.length = length;
+    name.hash = hash(data, length);
+    return name;
+}
+
+} // namespace NameFolding
+
+#endif // NAMEFOLDING_H
@@ -3,6 +3,60 @@
 
 #include <QString>
 #include <QStringList>
+#include <QSharedPointer>
+#include <QVector>
+#include "namefolding.h"
+#include "searchplan.h"
+
+class TargetProfile;
+class ApiSetSchema;
+class KnownDlls;
+
+// Frozen DLL search order for one application directory: a SearchPlan
+// compiled against the app directory, the system directories, the current
+// directory and the filtered PATH, once per scan. Copies share the same
+// compiled list; its id keys the resolver caches, so lookups build no
+// per-call environment snapshot or string keys.
+class ResolverContext
+{
+public:
+    // One directory of the compiled search order
+    struct SearchDirectory {
+        QString path;          // Absolute, or target-side for target profile directories
+        QString listingKey;    // Key of the directory index
+        int profileDirectory;  // Directory in the target profile, -1 for the local disk
+        bool inMissFilter;     // One of the shared search paths the miss filter covers
+
+        SearchDirectory() : profileDirectory(-1), inMissFilter(false) {}
+    };
+
+    ResolverContext() {}
+
+    bool isValid() const { return !d.isNull(); }
+    quint32 id() const { return d ? d->id : 0; }
+    QString applicationDir() const { return d ? d->applicationDir : QString(); }
+    SearchPlan plan() const { return d ? d->plan : SearchPlan(); }
+    QStringList searchPaths() const { return d ? d->searchPaths : QStringList(); }
+    QVector<SearchDirectory> searchDirectories() const { return d ? d->directories : QVector<SearchDirectory>(); }
+    QSharedPointer<const TargetProfile> targetProfile() const
+    {
+        return d ? d->profile : QSharedPointer<const TargetProfile>();
+    }
+
+private:
+    friend class PathResolver;
+
+    struct Data {
+        quint32 id;
+        QString applicationDir;
+        SearchPlan plan;
+        QStringList searchPaths;  // Absolute, de-duplicated, in search order
+        QVector<SearchDirectory> directories;  // The same paths, compiled
+        QSharedPointer<const TargetProfile> profile;  // Profile the paths were compiled against
+    };
+
+    QSharedPointer<const Data> d;
+};
 
 class PathResolver
 {
@@ -12,18 +66,93 @@ public:
         QString foundPath;
         bool found;
         QStringList searchedPaths;
+        bool fromTargetProfile;  // foundPath is a target-side path listed in the target profile
+        QString fileVersion;     // Version recorded in the target profile
+        QString apiSetHost;      // Host DLL an API set contract maps to, empty otherwise
+        bool knownDll;           // Taken from KnownDLLs without running the search order
+        
+        ResolveResult() : found(false), fromTargetProfile(false), knownDll(false) {}
+    };
+
+    // File system work done by lookups since the last clearCache()
+    struct LookupStatistics {
+        int directoryListings;  // Search directories listed into the index
+        int fileProbes;         // Candidate paths checked with a stat call
+        int missFilterHits;     // Lookups the miss filter kept out of the shared search paths
+        int missFilterFalsePositives;  // Names the filter let through that were still not found
         
-        ResolveResult() : found(false) {}
+        LookupStatistics() : directoryListings(0), fileProbes(0), missFilterHits(0), missFilterFalsePositives(0) {}
     };
 
     // Resolve DLL path according to Windows DLL search order
     static ResolveResult resolveDLLPath(const QString& dllName, const QString& applicationDir);
     
+    // Same, for an import name viewed in place; cache hits do not allocate
+    static ResolveResult resolveDLLPath(const NameFolding::Name& dllName, const QString& applicationDir);
+    
+    // Resolve against a context from context(); an invalid context means no application directory.
+    // wow64: the importer is a 32-bit image, whose KnownDLLs come from SysWOW64 where there is one.
+    static ResolveResult resolveDLLPath(const QString& dllName, const ResolverContext& context, bool wow64 = false);
+    static ResolveResult resolveDLLPath(const NameFolding::Name& dllName, const ResolverContext& context,
+                                        bool wow64 = false);
+    
+    // Search order for an application directory, built once until clearCache().
+    // Without a plan the one set with setSearchPlan() is used.
+    static ResolverContext context(const QString& applicationDir);
+    static ResolverContext context(const QString& applicationDir, const SearchPlan& plan);
+    
+    // Search order of the process being checked, e.g. a service that calls
+    // SetDefaultDllDirectories(LOAD_LIBRARY_SEARCH_DEFAULT_DIRS). Contexts are
+    // cached per plan, so switching keeps the caches. Default: SearchPlan::standard().
+    static void setSearchPlan(const SearchPlan& plan);
+    static SearchPlan searchPlan();
+    
     // Get system DLL search paths
     static QStringList getSystemSearchPaths();
     
     // Check if a DLL is a system DLL
     static bool isSystemDLL(const QString& dllName);
+    static bool isSystemDLL(const NameFolding::Name& dllName);
+    
+    // Drop resolve results and directory listings, and re-read PATH on the next lookup
+    static void clearCache();
+    
+    // Search directories are listed once and looked up by folded name hash.
+    // Re-list one directory (all if dirPath is empty) after files in it changed.
+    static void refreshDirectoryIndex(const QString& dirPath = QString());
+    
+    // With the index disabled every candidate path is probed with a stat call
+    // (the old behaviour, kept as a baseline for benchmarks)
+    static void setDirectoryIndexEnabled(bool enabled);
+    
+    // A Bloom filter over the file names of the shared search paths answers
+    // most misses without visiting them. It is built from the directory index
+    // once per cache generation; disabling it restores the full walk.
+    static void setMissFilterEnabled(bool enabled);
+    
+    static LookupStatistics lookupStatistics();
+    
+    // Resolve system directories against a captured target Windows installation
+    // instead of the local machine. Drops all caches; contexts must be rebuilt.
+    static bool loadTargetProfile(const QString& profilePath, QString* error = nullptr);
+    static void setTargetProfile(const QSharedPointer<const TargetProfile>& profile);
+    static void clearTargetProfile();
+    static QSharedPointer<const TargetProfile> targetProfile();
+    
+    // API set contracts (api-ms-win-*, ext-ms-win-*) resolve to their host DLL
+    // through the schema of the machine being resolved for: an explicitly loaded
+    // one, else the target profile's, else the local System32\apisetschema.dll.
+    // Without any schema contracts are treated as system DLLs by name.
+    static bool loadApiSetSchema(const QString& filePath, QString* error = nullptr);
+    static void setApiSetSchema(const QSharedPointer<const ApiSetSchema>& schema);
+    static QSharedPointer<const ApiSetSchema> apiSetSchema();
+    
+    // KnownDLLs resolve straight to the system directory (System32, or
+    // SysWOW64 for 32-bit importers) before the search plan runs. The list comes from an explicitly loaded registry export,
+    // else the target profile, else the local registry.
+    static bool loadKnownDlls(const QString& registryExportPath, QString* error = nullptr);
+    static void setKnownDlls(const QSharedPointer<const KnownDlls>& knownDlls);
+    static QSharedPointer<const KnownDlls> knownDlls();
 };
 
 #endif // PATHRESOLVER_H
@@ -0,0 +1,170 @@
+#ifndef PEIMAGE_H
+#define PEIMAGE_H
+
+#include <QtGlobal>
+#include <QtEndian>
+#include <QVector>
+
+// Supplies file bytes to PEImage on demand, so large files never have to be
+// mapped as a whole. Returned pointers stay valid for the source's lifetime.
+class PEImageSource
+{
+public:
+    virtual ~PEImageSource() {}
+
+    virtual qint64 size() const = 0;
+
+    // Make [offset, offset + length) available contiguously; nullptr on failure
+    virtual const uchar* map(qint64 offset, qint64 length) = 0;
+};
+
+// Platform-independent, bounds-checked view over the raw bytes of a PE file.
+// The image does not own the bytes; the caller keeps the buffer or source
+// alive for as long as the PEImage (and any pointers obtained from it) is in use.
+class PEImage
+{
+public:
+    enum Status {
+        Ok,
+        Truncated,
+        BadDosSignature,
+        BadNtSignature,
+        BadOptionalHeader
+    };
+
+    // IMAGE_DIRECTORY_ENTRY_* indexes used by the scanner
+    enum DirectoryEntry {
+        ExportDirectory = 0,
+        ImportDirectory = 1,
+        ResourceDirectory = 2,
+        DelayImportDirectory = 13
+    };
+
+    enum MachineType {
+        MachineI386 = 0x014c,
+        MachineAmd64 = 0x8664
+    };
+
+    struct Section {
+        char name[8];  // Not NUL-terminated when all 8 bytes are used
+        quint32 virtualAddress;
+        quint32 virtualSize;
+        quint32 rawOffset;
+        quint32 rawSize;
+    };
+
+    // Non-owning reference to a NUL-terminated ANSI string inside the image
+    struct NameRef {
+        const char* data;
+        int length;
+    };
+
+    // Function imported from a module, by name or by ordinal
+    struct ImportedSymbol {
+        NameRef name;      // data == nullptr for imports by ordinal
+        quint16 ordinal;   // The ordinal, or the hint for imports by name
+    };
+
+    struct ImportedModule {
+        NameRef name;
+        QVector<ImportedSymbol> symbols;
+    };
+
+    // Entry of the export directory
+    struct ExportedSymbol {
+        NameRef name;        // data == nullptr for exports by ordinal only
+        quint32 ordinal;     // Biased by the export ordinal base
+        NameRef forwarder;   // "Module.Function" or "Module.#Ordinal"; data == nullptr if not forwarded
+    };
+
+    // View over a buffer that already holds (a prefix of) the file
+    PEImage(const uchar* data, qint64 size);
+
+    // View that pulls only the byte ranges it touches from the source
+    explicit PEImage(PEImageSource* source);
+
+    Status status() const { return m_status; }
+    bool isValid() const { return m_status == Ok; }
+
+    quint16 machine() const { return m_machine; }
+    bool is64Bit() const { return m_is64; }
+
+    // Data directory lookup; returns false if the directory is absent
+    bool directory(int index, quint32* rva, quint32* size) const;
+
+    // The header declares directories that lie past the bytes available, so
+    // directory() cannot tell those from absent ones (a prefix buffer only)
+    bool directoriesTruncated() const { return m_directoriesTruncated; }
+
+    // Section headers, sorted by virtual address
+    const QVector<Section>& sections() const { return m_sections; }
+
+    // First section with the given name (e.g. ".apiset"); false if there is none
+    bool findSection(const char* name, Section* section) const;
+
+    // Translate an RVA to a file offset, -1 if it is not backed by file data
+    qint64 rvaToOffset(quint32 rva) const;
+
+    // Bounds-checked access to [offset, offset + length), nullptr when out of range
+    const uchar* at(qint64 offset, qint64 length) const;
+
+    // Read a NUL-terminated string starting at the given RVA
+    bool stringAtRva(quint32 rva, NameRef* name) const;
+
+    // Names of all modules listed in the import directory
+    QVector<NameRef> importedModules() const;
+
+    // Import directory including the functions imported from each module,
+    // in the same order as importedModules()
+    QVector<ImportedModule> importTable() const;
+
+    // All named and ordinal-only exports
+    QVector<ExportedSymbol> exportedSymbols() const;
+
+    // Names of all modules listed in the delay-load import directory
+    QVector<NameRef> delayImportedModules() const;
+
+    // Locate the first language instance of a resource by numeric type/id.
+    // Passing id == 0 accepts any id. Returns the file offset and size of the data.
+    bool findResource(quint32 type, quint32 id, qint64* offset, quint32* size) const;
+
+    // Location of the RT_VERSION resource (a VS_VERSIONINFO block)
+    bool versionResource(qint64* offset, quint32* size) const;
+
+    template <typename T>
+    bool read(qint64 offset, T* value) const;
+
+private:
+    void parseHeaders();
+
+    // Instantiated for the PE32 and PE32+ layouts in peimage.cpp
+    template <typename Layout>
+    void parseOptionalHeader(qint64 optionalHeader, quint16 sizeOfOptionalHeader);
+    template <typename Layout>
+    QVector<ImportedModule> readImportTable() const;
+
+    const uchar* m_data;
+    PEImageSource* m_source;
+    qint64 m_size;
+    Status m_status;
+    quint16 m_machine;
+    bool m_is64;
+    bool m_directoriesTruncated;
+    quint32 m_sizeOfHeaders;
+    quint64 m_imageBase;
+    QVector<quint32> m_directories;  // rva/size pairs
+    QVector<Section> m_sections;     // sorted by virtualAddress
+};
+
+template <typename T>
+inline bool PEImage::read(qint64 offset, T* value) const
+{
+    const uchar* p = at(offset, sizeof(T));
+    if (!p) {
+        return false;
+    }
+    *value = qFromLittleEndian<T>(p);
+    return true;
+}
+
+#endif // PEIMAGE_H
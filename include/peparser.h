@@ -4,44 +4,60 @@
 #include <QString>
 #include <QStringList>
 #include <QPair>
+#include <QMap>
 #include <QDateTime>
-#include <Windows.h>
-#include <ImageHlp.h>
+#include <QFile>
+#include <QSharedPointer>
+#include "namefolding.h"
+#include "peimage.h"
+#include "exportindex.h"
+#include "versionresource.h"
+#include "contentdigest.h"
 
-#pragma comment(lib, "imagehlp.lib")
-#pragma comment(lib, "version.lib")
-
-// RAII wrapper for LOADED_IMAGE to ensure proper resource cleanup
-class LoadedImageGuard
+// RAII wrapper that maps only the parts of a file PEImage actually touches.
+// Small files are mapped in one piece; large ones in fixed-size windows, so the
+// headers, section table and directory ranges are read without mapping
+// (or faulting in) the rest of a multi-GB image.
+class WindowedImageGuard : public PEImageSource
 {
-private:
-    PLOADED_IMAGE m_image;
-    bool m_valid;
-
 public:
-    explicit LoadedImageGuard(const QString& filePath) : m_valid(false)
-    {
-        m_image = new LOADED_IMAGE();
-        if (MapAndLoad(filePath.toLocal8Bit().constData(), 
-                       NULL, m_image, TRUE, TRUE)) {
-            m_valid = true;
-        }
-    }
-
-    ~LoadedImageGuard()
-    {
-        if (m_valid && m_image) {
-            UnMapAndLoad(m_image);
-            delete m_image;
-        }
-    }
-
-    bool isValid() const { return m_valid; }
-    PLOADED_IMAGE get() const { return m_image; }
+    explicit WindowedImageGuard(const QString& filePath);
+    ~WindowedImageGuard() override;
+
+    bool isValid() const { return m_size > 0; }
+    qint64 size() const override { return m_size; }
+    const uchar* map(qint64 offset, qint64 length) override;
+
+    QString filePath() const { return m_file.fileName(); }
+
+    // Mapped in one piece by the constructor, so a digest reads no extra bytes
+    bool isWholeMapped() const;
+
+    // Total bytes currently mapped, for diagnostics and benchmarks
+    qint64 mappedBytes() const { return m_mappedBytes; }
+
+    // XXH64 of the whole file, computed once per guard. Files mapped whole
+    // are hashed from the existing mapping; larger ones are streamed through
+    // temporary windows. 0 if the file is empty, unreadable or too large.
+    quint64 contentDigest();
 
     // Disable copy
-    LoadedImageGuard(const LoadedImageGuard&) = delete;
-    LoadedImageGuard& operator=(const LoadedImageGuard&) = delete;
+    WindowedImageGuard(const WindowedImageGuard&) = delete;
+    WindowedImageGuard& operator=(const WindowedImageGuard&) = delete;
+
+private:
+    struct Window {
+        qint64 offset;
+        qint64 length;
+        uchar* data;
+    };
+
+    QFile m_file;
+    qint64 m_size;
+    qint64 m_mappedBytes;
+    QVector<Window> m_windows;
+    quint64 m_contentDigest;
+    bool m_digestComputed;
 };
 
 class PEParser
@@ -53,34 +69,99 @@ public:
         x64
     };
 
+    // Optional parsing stages
+    enum ParseFlag {
+        ParseDefault = 0x0,
+        ParseVersionStrings = 0x1,  // Decode StringFileInfo entries as well
+        ParseImportViews = 0x2,     // Fill PEInfo::imports instead of PEInfo::dependencies
+        ParseImportSymbols = 0x4,   // Also fill PEInfo::importSymbols (implies ParseImportViews)
+        ParseContentDigest = 0x8    // Fill PEInfo::contentDigest if the file is mapped whole anyway
+    };
+
+    // Import name pointing into the mapped image, with its case-folded hash
+    typedef NameFolding::Name ImportName;
+
+    // Classification from the first page only, used to skip junk before a full parse
+    enum HeaderClass {
+        NotPE,          // Missing MZ/PE signature or bad optional header
+        NoImports,      // Valid PE without an import or delay-import directory (leaf)
+        HasImports,     // Valid PE with an import or delay-import directory
+        NeedsFullParse  // Headers or import RVA cannot be judged from the first page
+    };
+
+    struct HeaderProbe {
+        HeaderClass kind;
+        Architecture arch;
+
+        HeaderProbe() : kind(NotPE), arch(Unknown) {}
+    };
+
     struct PEInfo {
         QString filePath;
         Architecture arch;
         QString fileVersion;
         QString productVersion;
+        QMap<QString, QString> versionStrings;  // Only filled with ParseVersionStrings
         QStringList dependencies;
+        QStringList delayDependencies;                // Delay-load imports
+        QVector<ImportName> imports;                  // Only filled with ParseImportViews
+        QVector<ImportName> delayImports;             // Only filled with ParseImportViews
+        QVector<QVector<PEImage::ImportedSymbol> > importSymbols;  // Parallel to imports, with ParseImportSymbols
+        QSharedPointer<WindowedImageGuard> image;     // Keeps the import views valid
+        QSharedPointer<const QByteArray> names;       // Or, after detachImports(), a copy of the names
         bool isValid;
         QString errorMessage;
         quint64 fileSize;
         QDateTime modifiedTime;
+        quint64 contentDigest;                        // Only filled with ParseContentDigest; 0 if unknown
         
-        PEInfo() : arch(Unknown), isValid(false), fileSize(0) {}
+        PEInfo() : arch(Unknown), isValid(false), fileSize(0), contentDigest(0) {}
     };
 
     // Parse PE file and get all information
-    static PEInfo parsePEFile(const QString& filePath);
+    static PEInfo parsePEFile(const QString& filePath, int flags = ParseDefault);
+    
+    // Parse through an already opened image, e.g. one whose digest was just checked
+    static PEInfo parsePEFile(const QSharedPointer<WindowedImageGuard>& source, int flags = ParseDefault);
+    
+    // Copy the names the import views point at out of the mapping and drop
+    // the image, so a kept PEInfo holds no file handle or mapped window
+    static void detachImports(PEInfo* info);
+    
+    // Read only the first page and classify the file
+    static HeaderProbe probeHeader(const QString& filePath);
     
     // Get imported DLLs from PE file
     static QStringList getImportedDLLs(const QString& filePath);
     
+    // Get delay-loaded DLLs from PE file
+    static QStringList getDelayImportedDLLs(const QString& filePath);
+    
+    // Build the export hash index of a DLL; null if the file is not a valid PE
+    static QSharedPointer<const ExportIndex> getExportIndex(const QString& filePath);
+    
+    // Content digest of a file (see WindowedImageGuard::contentDigest)
+    static quint64 getContentDigest(const QString& filePath);
+    
     // Get architecture of PE file
     static Architecture getArchitecture(const QString& filePath);
     
     // Get version information
     static QPair<QString, QString> getVersionInfo(const QString& filePath);
     
+    // Get StringFileInfo entries (CompanyName, OriginalFilename, ...)
+    static QMap<QString, QString> getVersionStrings(const QString& filePath);
+    
     // Convert architecture enum to string
     static QString architectureToString(Architecture arch);
+
+private:
+    static Architecture architectureFromImage(const PEImage& image);
+    static QString formatVersion(quint64 version);
+    static QString toQString(const VersionResource::Utf16Ref& text);
+    static QStringList toStringList(const QVector<PEImage::NameRef>& names);
+    static QVector<ImportName> toImportNames(const QVector<PEImage::NameRef>& names);
+    static bool readVersionResource(const PEImage& image, PEInfo* info, int flags);
 };
 
 #endif // PEPARSER_H
@@ -3,6 +3,7 @@
 
 #include <QString>
 #include <QList>
+#include <QSet>
 #include <QIODevice>
 #include "dependencyscanner.h"
 #include "comparisonengine.h"
@@ -18,31 +19,40 @@ public:
     };
 
     // Generate missing dependency report
-    static QString generateMissingReport(const QList<DependencyScanner::NodePtr>& roots,
+    static QString generateMissingReport(const QList<DependencyScanner::NodeHandle>& roots,
                                         ReportFormat format);
 
     // Stream missing dependency report to file (for large datasets)
-    static bool writeMissingReport(const QList<DependencyScanner::NodePtr>& roots,
+    static bool writeMissingReport(const QList<DependencyScanner::NodeHandle>& roots,
                                   ReportFormat format,
                                   const QString& filePath);
-    static bool writeMissingReportToFile(const QList<DependencyScanner::NodePtr>& roots,
+    static bool writeMissingReportToFile(const QList<DependencyScanner::NodeHandle>& roots,
                                          ReportFormat format,
                                          QIODevice* device);
     
     // Generate target missing report (only DLL names)
-    static QString generateTargetMissingReport(const QList<DependencyScanner::NodePtr>& roots,
+    static QString generateTargetMissingReport(const QList<DependencyScanner::NodeHandle>& roots,
                                               ReportFormat format = JSON);
     
     // Generate dependency tree report
-    static QString generateDependencyTreeReport(const DependencyScanner::NodePtr& root,
+    static QString generateDependencyTreeReport(const DependencyScanner::NodeHandle& root,
                                                ReportFormat format);
 
 private:
-    static void collectMissingDependencies(const DependencyScanner::NodePtr& node,
+    // Direct imports of one module; callers walk DependencyScanner::modules()
+    static void collectMissingDependencies(const DependencyScanner::NodeHandle& node,
                                           QMap<QString, QStringList>& missingMap);
-    static void collectMissingDLLsRecursive(const DependencyScanner::NodePtr& node,
-                                           QStringList& missingDLLs);
-    static QString generateTreeText(const DependencyScanner::NodePtr& node, int indent);
+    static void collectMissingSymbols(const DependencyScanner::NodeHandle& node,
+                                      QMap<QString, QStringList>& symbolMap);
+    static void collectMissingDLLs(const DependencyScanner::NodeHandle& node,
+                                   QStringList& missingDLLs);
+    // Tree view of the graph below edge; modules already in printed are not expanded again
+    static QString generateTreeText(const DependencyScanner::DependencyEdge& edge, int indent,
+                                    QSet<const DependencyScanner::DependencyNode*>* printed);
+    // Appends the line of one edge to text; returns the imports to print below it
+    static QVector<DependencyScanner::DependencyEdge> appendTreeLine(
+        const DependencyScanner::DependencyEdge& edge, int indent,
+        QSet<const DependencyScanner::DependencyNode*>* printed, QString* text);
 };
 
 #endif // REPORTGENERATOR_H
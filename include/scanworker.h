@@ -39,16 +39,18 @@ public:
 
 signals:
     void scanProgress(int current, int total, const QString& currentFile);
-    void scanFinished(QList<DependencyScanner::NodePtr> results);
+    void scanFinished(QList<DependencyScanner::NodeHandle> results);
     void scanError(const QString& errorMessage);
 
 private slots:
     void onScanProgress(int current, int total, const QString& currentFile);
 
 private:
+    QString graphFullMessage() const;
+
     DependencyScanner* m_scanner;
     QAtomicInt m_cancelled;
-    QList<DependencyScanner::NodePtr> m_results;
+    QList<DependencyScanner::NodeHandle> m_results;
 };
 
 #endif // SCANWORKER_H
@@ -0,0 +1,72 @@
+#ifndef SEARCHPLAN_H
+#define SEARCHPLAN_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// One DLL search order of the Windows loader as plain data: the steps a
+// LoadLibrary call walks, plus the directories the SetDllDirectory and
+// AddDllDirectory steps name. PathResolver compiles a plan once per
+// application directory into a ResolverContext, so lookups walk a flat
+// directory list whichever plan is active.
+class SearchPlan
+{
+public:
+    enum Step {
+        ApplicationDirectory,
+        DllDirectory,        // SetDllDirectory
+        UserDirectories,     // AddDllDirectory, in the order added
+        SystemDirectories,   // System32 and SysWOW64
+        System32Directory,   // System32 alone (LOAD_LIBRARY_SEARCH_SYSTEM32)
+        WindowsDirectory,
+        CurrentDirectory,
+        PathDirectories
+    };
+
+    // LoadLibrary without flags. SafeDllSearchMode (on by default) searches
+    // the current directory after the system directories instead of before.
+    static SearchPlan standard(bool safeDllSearchMode = true);
+
+    // After SetDllDirectory(directory): the directory takes the place of the
+    // current directory, which is no longer searched
+    static SearchPlan withDllDirectory(const QString& directory);
+
+    // LOAD_LIBRARY_SEARCH_DEFAULT_DIRS, or SetDefaultDllDirectories with it:
+    // application directory, AddDllDirectory paths and System32 only
+    static SearchPlan defaultDirs(const QStringList& userDirectories = QStringList());
+
+    // standard()
+    SearchPlan();
+
+    // Any order of steps, e.g. LOAD_LIBRARY_SEARCH_SYSTEM32 alone
+    explicit SearchPlan(const QVector<Step>& steps);
+
+    QVector<Step> steps() const { return m_steps; }
+    QString dllDirectory() const { return m_dllDirectory; }
+    QStringList userDirectories() const { return m_userDirectories; }
+
+    void setDllDirectory(const QString& directory);
+
+    // AddDllDirectory; only searched by plans with the UserDirectories step
+    void addDllDirectory(const QString& directory);
+
+    // Equal for equal plans; keys the resolver's context cache
+    QString key() const { return m_key; }
+
+    // Steps in search order, for the UI and logs
+    QString description() const;
+
+    bool operator==(const SearchPlan& other) const { return m_key == other.m_key; }
+    bool operator!=(const SearchPlan& other) const { return m_key != other.m_key; }
+
+private:
+    void updateKey();
+
+    QVector<Step> m_steps;
+    QString m_dllDirectory;
+    QStringList m_userDirectories;
+    QString m_key;
+};
+
+#endif // SEARCHPLAN_H
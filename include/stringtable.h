@@ -0,0 +1,79 @@
+#ifndef STRINGTABLE_H
+#define STRINGTABLE_H
+
+#include <QString>
+#include <QMultiHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QAtomicInt>
+
+// Scan-scoped intern table for the paths, file names and versions of a
+// dependency graph. Every distinct string is stored once and named by a
+// small integer ID, with its case-folded hash computed when it is added.
+// Strings that differ only in case (as the loader compares file names)
+// share a folded ID, which keys the scanner's module cache and cycle set
+// without toLower() copies.
+class StringTable
+{
+public:
+    typedef quint32 Id;
+    static const Id Empty = 0;  // The empty string, interned up front
+
+    StringTable();
+    ~StringTable();
+
+    // Thread-safe; returns the ID of text, adding it if needed. Once the
+    // table is full, strings not in it yet come back as Empty.
+    Id intern(const QString& text);
+    bool isFull() const { return m_full.loadAcquire() != 0; }
+
+    // Lock-free: entries never move once added
+    const QString& string(Id id) const { return entry(id).text; }
+    uint foldedHash(Id id) const { return entry(id).hash; }
+
+    // ID of the first string added that equals id's without regard to case
+    Id folded(Id id) const { return entry(id).folded; }
+
+    int count() const;
+    // Entry blocks and index, without string payloads
+    qint64 bytes() const;
+
+    // Disable copy
+    StringTable(const StringTable&) = delete;
+    StringTable& operator=(const StringTable&) = delete;
+
+private:
+    struct Entry {
+        QString text;
+        uint hash;
+        Id folded;
+
+        Entry() : hash(0), folded(Empty) {}
+    };
+
+    // Strings with the same folded hash share a stripe, so an insert decides
+    // both its exact and its folded match under one lock
+    struct Stripe {
+        mutable QReadWriteLock lock;
+        QMultiHash<uint, Id> ids;  // Folded hash -> entries
+    };
+
+    static const int BLOCK_SHIFT = 10;
+    static const Id BLOCK_SIZE = 1u << BLOCK_SHIFT;
+    static const Id BLOCK_MASK = BLOCK_SIZE - 1;
+    static const int MAX_BLOCKS = 4096;  // 4M strings; the block table never grows, so lookups need no lock
+    static const int STRIPE_COUNT = 16;
+
+    const Entry& entry(Id id) const { return m_blocks[id >> BLOCK_SHIFT][id & BLOCK_MASK]; }
+    Id find(const Stripe& stripe, const QString& text, uint hash, Id* folded) const;
+    // Empty if every block is taken
+    Id allocate(const QString& text, uint hash);
+
+    Entry** m_blocks;
+    Id m_count;
+    QAtomicInt m_full;
+    Stripe m_stripes[STRIPE_COUNT];
+    mutable QMutex m_allocMutex;
+};
+
+#endif // STRINGTABLE_H
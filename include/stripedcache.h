@@ -0,0 +1,88 @@
+#ifndef STRIPEDCACHE_H
+#define STRIPEDCACHE_H
+
+#include <QHash>
+#include <QVector>
+#include <QReadWriteLock>
+
+// Read-mostly concurrent multi-map split into independently locked stripes.
+// Lookups take only a shared lock on one stripe, so cache hits from parallel
+// scan workers never serialize; inserts lock a single stripe exclusively.
+// Entries under one key form a small bucket that callers search with a
+// predicate (e.g. a case-insensitive name match after a hash collision).
+template <typename Key, typename Entry>
+class StripedCache
+{
+public:
+    StripedCache() {}
+
+    // First entry under key accepted by match, copied to *found
+    template <typename Match>
+    bool find(const Key& key, Match match, Entry* found) const
+    {
+        const Stripe& stripe = stripeFor(key);
+        QReadLocker locker(&stripe.lock);
+        const auto bucket = stripe.entries.constFind(key);
+        if (bucket == stripe.entries.constEnd()) {
+            return false;
+        }
+        for (const Entry& entry : *bucket) {
+            if (match(entry)) {
+                *found = entry;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Adds entry unless a matching one is present; returns the entry that is cached.
+    // Racing inserters of the same value all end up with the first one.
+    template <typename Match>
+    Entry insert(const Key& key, const Entry& entry, Match match)
+    {
+        Stripe& stripe = stripeFor(key);
+        QWriteLocker locker(&stripe.lock);
+        QVector<Entry>& bucket = stripe.entries[key];
+        for (const Entry& existing : bucket) {
+            if (match(existing)) {
+                return existing;
+            }
+        }
+        bucket.append(entry);
+        return entry;
+    }
+
+    void remove(const Key& key)
+    {
+        Stripe& stripe = stripeFor(key);
+        QWriteLocker locker(&stripe.lock);
+        stripe.entries.remove(key);
+    }
+
+    void clear()
+    {
+        for (Stripe& stripe : m_stripes) {
+            QWriteLocker locker(&stripe.lock);
+            stripe.entries.clear();
+        }
+    }
+
+    // Disable copy
+    StripedCache(const StripedCache&) = delete;
+    StripedCache& operator=(const StripedCache&) = delete;
+
+private:
+    static const int kStripes = 16;  // Power of two
+
+    struct Stripe {
+        mutable QReadWriteLock lock;
+        QHash<Key, QVector<Entry> > entries;
+    };
+
+    const Stripe& stripeFor(const Key& key) const { return m_stripes[qHash(key) & (kStripes - 1)]; }
+    Stripe& stripeFor(const Key& key) { return m_stripes[qHash(key) & (kStripes - 1)]; }
+
+    Stripe m_stripes[kStripes];
+};
+
+#endif // STRIPEDCACHE_H
@@ -0,0 +1,174 @@
+#ifndef SYSTEMDLLTABLE_H
+#define SYSTEMDLLTABLE_H
+
+#include "namefolding.h"
+
+// Well-known Windows system DLLs and the api-set/UCRT name prefixes, matched
+// without locks or allocation. The names are hashed at compile time with the
+// same folded FNV-1a as NameFolding, so the hash an import name already
+// carries indexes a perfect hash table directly: one slot, one comparison.
+namespace SystemDllTable {
+
+// Lowercase ASCII only. A new name may collide with an existing one; the
+// static_assert below then asks for another multiplier.
+constexpr const char* kNames[] = {
+    "kernel32.dll", "user32.dll", "gdi32.dll", "advapi32.dll",
+    "shell32.dll", "ole32.dll", "oleaut32.dll", "comctl32.dll",
+    "comdlg32.dll", "ws2_32.dll", "msvcrt.dll", "ntdll.dll",
+    "rpcrt4.dll", "secur32.dll", "winmm.dll", "version.dll",
+    "imagehlp.dll", "dbghelp.dll", "psapi.dll", "iphlpapi.dll",
+    "netapi32.dll", "userenv.dll", "winspool.drv", "imm32.dll",
+    "msimg32.dll", "setupapi.dll", "wininet.dll", "crypt32.dll",
+    "wintrust.dll", "shlwapi.dll", "mpr.dll", "credui.dll"
+};
+constexpr int kNameCount = int(sizeof(kNames) / sizeof(kNames[0]));
+
+// Multiply-shift slot selection over 64 slots
+constexpr int kSlotBits = 6;
+constexpr int kSlotCount = 1 << kSlotBits;
+constexpr uint kMultiplier = 0x9E37D70Du;
+
+// NameFolding::hash of a lowercase ASCII name
+constexpr uint hash(const char* name, uint h = 2166136261u)
+{
+    return *name ? hash(name + 1, (h ^ uchar(*name)) * 16777619u) : h;
+}
+
+constexpr int slotOf(uint hash)
+{
+    return int((hash * kMultiplier) >> (32 - kSlotBits));
+}
+
+constexpr bool isLowerAscii(const char* name)
+{
+    return !*name || (uchar(*name) < 0x80 && !(*name >= 'A' && *name <= 'Z') && isLowerAscii(name + 1));
+}
+
+constexpr bool slotTaken(int slot, int before)
+{
+    return before > 0 && (slotOf(hash(kNames[before - 1])) == slot || slotTaken(slot, before - 1));
+}
+
+constexpr bool isPerfect(int i = 0)
+{
+    return i == kNameCount ||
+           (isLowerAscii(kNames[i]) && !slotTaken(slotOf(hash(kNames[i])), i) && isPerfect(i + 1));
+}
+
+static_assert(isPerfect(), "System DLL names must be lowercase ASCII and collision-free; pick another kMultiplier");
+
+// Index of the name owning slot, -1 for an empty slot
+constexpr int nameForSlot(int slot, int i = 0)
+{
+    return i == kNameCount ? -1 : (slotOf(hash(kNames[i])) == slot ? i : nameForSlot(slot, i + 1));
+}
+
+constexpr uint hashForSlot(int slot)
+{
+    return nameForSlot(slot) < 0 ? 0 : hash(kNames[nameForSlot(slot)]);
+}
+
+// The slot table, expanded at compile time from the slot indexes 0..kSlotCount-1
+template <int... Slots>
+struct SlotSequence {};
+
+template <int N, int... Slots>
+struct MakeSlotSequence : MakeSlotSequence<N - 1, N - 1, Slots...> {};
+
+template <int... Slots>
+struct MakeSlotSequence<0, Slots...> {
+    typedef SlotSequence<Slots...> Type;
+};
+
+template <typename Sequence>
+struct SlotTable;
+
+template <int... Slots>
+struct SlotTable<SlotSequence<Slots...> > {
+    static constexpr qint8 names[kSlotCount] = { qint8(nameForSlot(Slots))... };
+    static constexpr uint hashes[kSlotCount] = { hashForSlot(Slots)... };
+};
+
+template <int... Slots>
+constexpr qint8 SlotTable<SlotSequence<Slots...> >::names[kSlotCount];
+template <int... Slots>
+constexpr uint SlotTable<SlotSequence<Slots...> >::hashes[kSlotCount];
+
+typedef SlotTable<MakeSlotSequence<kSlotCount>::Type> Table;
+
+inline ushort unit(char ch) { return uchar(ch); }
+inline ushort unit(QChar ch) { return ch.unicode(); }
+
+template <typename Char>
+inline bool equalsName(const Char* data, int length, const char* name)
+{
+    int i = 0;
+    for (; i < length && name[i] != '\0'; ++i) {
+        if (NameFolding::fold(unit(data[i])) != ushort(uchar(name[i]))) {
+            return false;
+        }
+    }
+    return i == length && name[i] == '\0';
+}
+
+// Case-insensitive prefix test at offset; prefix is lowercase ASCII
+template <typename Char>
+inline bool matchesAt(const Char* data, int length, int offset, const char* prefix)
+{
+    for (int i = offset; *prefix != '\0'; ++i, ++prefix) {
+        if (i >= length || NameFolding::fold(unit(data[i])) != ushort(uchar(*prefix))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// "api-ms-win-", "ext-ms-win-" or "ucrtbase", dispatched on the first character
+template <typename Char>
+inline bool hasSystemPrefix(const Char* data, int length)
+{
+    if (length < 8) {
+        return false;
+    }
+    switch (NameFolding::fold(unit(data[0]))) {
+    case 'a':
+        return matchesAt(data, length, 1, "pi-ms-win-");
+    case 'e':
+        return matchesAt(data, length, 1, "xt-ms-win-");
+    case 'u':
+        return matchesAt(data, length, 1, "crtbase");
+    default:
+        return false;
+    }
+}
+
+// hash must be the NameFolding hash of the name
+template <typename Char>
+inline bool contains(const Char* data, int length, uint hash)
+{
+    const int slot = slotOf(hash);
+    const int index = Table::names[slot];
+    if (index >= 0 && Table::hashes[slot] == hash && equalsName(data, length, kNames[index])) {
+        return true;
+    }
+    return hasSystemPrefix(data, length);
+}
+
+inline bool contains(const NameFolding::Name& name)
+{
+    return contains(name.data, name.length, name.hash);
+}
+
+inline bool contains(const QString& name, uint hash)
+{
+    return contains(name.constData(), name.size(), hash);
+}
+
+inline bool contains(const QString& name)
+{
+    return contains(name, NameFolding::hash(name));
+}
+
+} // namespace SystemDllTable
+
+#endif // SYSTEMDLLTABLE_H
@@ -0,0 +1,118 @@
+#ifndef TARGETPROFILE_H
+#define TARGETPROFILE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QFile>
+#include <QSharedPointer>
+
+class ApiSetSchema;
+class KnownDlls;
+
+// Snapshot of a target Windows installation's system directories
+// (System32, SysWOW64, the Windows directory and WinSxS assemblies) with the
+// file version of every file, captured once and stored in a compact binary
+// file. The file is memory-mapped and queried in place, so resolving against
+// a foreign Windows image is fast, reproducible and needs no Windows host.
+//
+// Layout (little endian):
+//   Header       magic "DLLTPRF1", version, counts, target root offset/length,
+//                ApiSet offset/size, KnownDLLs offset/size
+//   Directories  {nameOffset, nameLength, kind} per directory
+//   Files        {hash, nameOffset, nameLength, directory, version} per file
+//   Slots        open-addressing table over folded name hashes, 0 = empty
+//   Strings      UTF-8 names
+//   ApiSet       raw .apiset section of System32\apisetschema.dll, if present
+//   KnownDLLs    UTF-8 DLL names, one per line, if a registry export was given
+class TargetProfile
+{
+public:
+    enum DirectoryKind {
+        System32,
+        SysWOW64,
+        WindowsDirectory,
+        SideBySide  // One WinSxS assembly directory
+    };
+
+    struct FileEntry {
+        QString directory;  // Target-side path, e.g. "C:/Windows/System32"
+        QString fileName;   // Case as stored on the target
+        DirectoryKind kind;
+        quint64 fileVersion;  // 0 if the file has no version resource
+
+        FileEntry() : kind(SideBySide), fileVersion(0) {}
+    };
+
+    ~TargetProfile();
+
+    // Map a captured profile; returns null and sets *error on failure
+    static QSharedPointer<const TargetProfile> load(const QString& filePath, QString* error = nullptr);
+
+    // List windowsDir (a target's Windows directory, possibly a mounted image)
+    // and write a profile. targetRoot is the path the directory has on the target.
+    // knownDllsExport is an optional regedit export of the target's KnownDLLs key.
+    static bool capture(const QString& windowsDir, const QString& outputPath,
+                        const QString& targetRoot = QString("C:/Windows"), QString* error = nullptr,
+                        const QString& knownDllsExport = QString());
+
+    QString filePath() const { return m_file.fileName(); }
+    QString targetRoot() const;
+    int directoryCount() const;
+    int fileCount() const;
+
+    // Target-side path and kind of a directory
+    QString directoryPath(int directory) const;
+    DirectoryKind directoryKind(int directory) const;
+
+    // Directory index for a target-side path, -1 if it is not in the profile
+    int findDirectory(const QString& path) const;
+
+    // Folded name hashes (NameFolding::hash) of the files in one directory
+    QVector<uint> fileHashes(int directory) const;
+
+    // System32, SysWOW64 and the Windows directory, in loader search order
+    QStringList systemDirectories() const;
+
+    // The target's API set schema; null if the profile was captured without one
+    QSharedPointer<const ApiSetSchema> apiSetSchema() const { return m_apiSetSchema; }
+
+    // The target's KnownDLLs; null if the profile was captured without them
+    QSharedPointer<const KnownDlls> knownDlls() const { return m_knownDlls; }
+
+    // Case-insensitive lookup in one directory (-1 = any directory of the given kind)
+    bool findFile(const QString& fileName, int directory, FileEntry* entry = nullptr) const;
+    bool findFileOfKind(const QString& fileName, DirectoryKind kind, FileEntry* entry = nullptr) const;
+
+    // "a.b.c.d" for a packed file version, empty for 0
+    static QString versionToString(quint64 version);
+
+    // Disable copy
+    TargetProfile(const TargetProfile&) = delete;
+    TargetProfile& operator=(const TargetProfile&) = delete;
+
+private:
+    TargetProfile();
+
+    quint32 u32(qint64 offset) const;
+    QString text(quint32 offset, quint32 length) const;
+    FileEntry entryAt(quint32 index) const;
+    template <typename Accept>
+    bool lookup(const QString& fileName, Accept accept, FileEntry* entry) const;
+
+    QFile m_file;
+    const uchar* m_data;
+    qint64 m_size;
+    quint32 m_directoryCount;
+    quint32 m_fileCount;
+    quint32 m_slotCount;
+    qint64 m_directoriesOffset;
+    qint64 m_filesOffset;
+    qint64 m_slotsOffset;
+    qint64 m_stringsOffset;
+    quint32 m_stringsSize;
+    QSharedPointer<const ApiSetSchema> m_apiSetSchema;
+    QSharedPointer<const KnownDlls> m_knownDlls;
+};
+
+#endif // TARGETPROFILE_H
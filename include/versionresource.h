@@ -0,0 +1,68 @@
+#ifndef VERSIONRESOURCE_H
+#define VERSIONRESOURCE_H
+
+#include <QtGlobal>
+#include <QVector>
+
+// In-place decoder for a VS_VERSIONINFO block (the RT_VERSION resource).
+// Works directly on the mapped resource bytes; nothing is copied, so the
+// returned text references are only valid while the mapping is alive.
+class VersionResource
+{
+public:
+    // Little-endian UTF-16 text inside the resource (length in code units)
+    struct Utf16Ref {
+        const uchar* data;
+        int length;
+
+        Utf16Ref() : data(nullptr), length(0) {}
+        quint16 at(int i) const { return quint16(data[i * 2] | (data[i * 2 + 1] << 8)); }
+        bool equals(const char* ascii) const;
+    };
+
+    struct StringEntry {
+        Utf16Ref key;
+        Utf16Ref value;
+    };
+
+    VersionResource(const uchar* data, qint64 size);
+
+    // True if the root block is a VS_VERSION_INFO block
+    bool isValid() const { return m_valid; }
+
+    // VS_FIXEDFILEINFO versions (MS << 32 | LS)
+    bool hasFixedInfo() const { return m_hasFixedInfo; }
+    quint64 fileVersion() const { return m_fileVersion; }
+    quint64 productVersion() const { return m_productVersion; }
+
+    // Entries of the first StringFileInfo string table (CompanyName, OriginalFilename, ...)
+    QVector<StringEntry> strings() const;
+
+    // Look up a single StringFileInfo value by key
+    bool findString(const char* key, Utf16Ref* value) const;
+
+private:
+    struct Block {
+        qint64 offset;       // start of the block
+        qint64 end;          // offset + wLength, clamped to the resource
+        quint16 valueLength;
+        quint16 type;
+        Utf16Ref key;
+        qint64 value;        // start of the value, 32-bit aligned
+        qint64 children;     // start of the first child, 32-bit aligned
+    };
+
+    bool readBlock(qint64 offset, qint64 limit, Block* block) const;
+    bool findChild(const Block& parent, const char* key, Block* child) const;
+    bool firstStringTable(Block* table) const;
+
+    const uchar* m_data;
+    qint64 m_size;
+    bool m_valid;
+    bool m_hasFixedInfo;
+    quint64 m_fileVersion;
+    quint64 m_productVersion;
+    Block m_root;
+};
+
+#endif // VERSIONRESOURCE_H
@@ -0,0 +1,129 @@
+#ifndef WORKSTEALINGQUEUE_H
+#define WORKSTEALINGQUEUE_H
+
+#include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QAtomicInt>
+
+// Job queue for a fixed set of workers, one deque each. A worker pushes the
+// jobs it spawns onto its own deque and takes them back newest first, which
+// keeps its walk depth-first; a worker whose deque is empty steals the
+// oldest job of another, the one most likely to spawn a large subtree.
+// Jobs may push further jobs; take() returns false once every job pushed
+// has been finished.
+template <typename Job>
+class WorkStealingQueue
+{
+public:
+    explicit WorkStealingQueue(int workers)
+        : m_workerCount(qMax(1, workers)), m_deques(new Deque[m_workerCount]),
+          m_unfinished(0), m_generation(0) {}
+    ~WorkStealingQueue() { delete[] m_deques; }
+
+    int workerCount() const { return m_workerCount; }
+
+    void push(int worker, const Job& job)
+    {
+        m_unfinished.ref();
+        {
+            Deque& deque = m_deques[worker];
+            QMutexLocker locker(&deque.lock);
+            deque.jobs.append(job);
+        }
+        QMutexLocker locker(&m_idleLock);
+        ++m_generation;
+        m_idle.wakeOne();
+    }
+
+    // Blocks until a job is available for worker or all jobs are finished
+    bool take(int worker, Job* job)
+    {
+        for (;;) {
+            quint64 generation;
+            {
+                QMutexLocker locker(&m_idleLock);
+                generation = m_generation;
+            }
+            if (popOwn(worker, job) || steal(worker, job)) {
+                return true;
+            }
+
+            // A push after the scan above bumps the generation, so it is not missed
+            QMutexLocker locker(&m_idleLock);
+            while (generation == m_generation) {
+                if (m_unfinished.loadAcquire() == 0) {
+                    return false;
+                }
+                m_idle.wait(&m_idleLock);
+            }
+        }
+    }
+
+    // Called once per job taken, after the jobs it spawned have been pushed
+    void finish()
+    {
+        if (!m_unfinished.deref()) {
+            QMutexLocker locker(&m_idleLock);
+            ++m_generation;
+            m_idle.wakeAll();
+        }
+    }
+
+    // Disable copy
+    WorkStealingQueue(const WorkStealingQueue&) = delete;
+    WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+private:
+    struct Deque {
+        QMutex lock;
+        QVector<Job> jobs;  // Owner end is the back
+        int head;           // Steal end; jobs before it are taken
+
+        Deque() : head(0) {}
+    };
+
+    bool popOwn(int worker, Job* job)
+    {
+        Deque& deque = m_deques[worker];
+        QMutexLocker locker(&deque.lock);
+        if (deque.jobs.size() == deque.head) {
+            return false;
+        }
+        *job = deque.jobs.takeLast();
+        if (deque.jobs.size() == deque.head) {
+            deque.jobs.clear();
+            deque.head = 0;
+        }
+        return true;
+    }
+
+    bool steal(int thief, Job* job)
+    {
+        // Start after the thief, so idle workers spread over their victims
+        for (int i = 1; i < m_workerCount; ++i) {
+            Deque& deque = m_deques[(thief + i) % m_workerCount];
+            QMutexLocker locker(&deque.lock);
+            if (deque.jobs.size() == deque.head) {
+                continue;
+            }
+            *job = deque.jobs.at(deque.head++);
+            if (deque.jobs.size() == deque.head) {
+                deque.jobs.clear();
+                deque.head = 0;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    int m_workerCount;
+    Deque* m_deques;  // Not copyable, so not a QVector
+    QAtomicInt m_unfinished;  // Pushed and not yet finished
+    QMutex m_idleLock;
+    QWaitCondition m_idle;
+    quint64 m_generation;     // Bumped by every push and by the last finish
+};
+
+#endif // WORKSTEALINGQUEUE_H
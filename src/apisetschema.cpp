@@ -0,0 +1,356 @@
+#include "apisetschema.h"
+#include "peimage.h"
+#include "peparser.h"
+#include <QFile>
+#include <QtEndian>
+
+namespace {
+const qint64 kMaxRawSchemaSize = 16 * 1024 * 1024;
+const quint32 kMaxContracts = 64 * 1024;
+const quint32 kMaxValues = 256;
+
+inline ushort unit(char ch) { return uchar(ch); }
+inline ushort unit(QChar ch) { return ch.unicode(); }
+
+bool readU32(const QByteArray& data, quint64 offset, quint32* value)
+{
+    if (offset + 4 > quint64(data.size())) {
+        return false;
+    }
+    *value = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data.constData()) + offset);
+    return true;
+}
+
+// UTF-16LE string at offset; names in the schema are not NUL-terminated
+bool readName(const QByteArray& data, quint32 offset, quint32 byteLength, QString* name)
+{
+    if ((byteLength & 1) != 0 || quint64(offset) + byteLength > quint64(data.size())) {
+        return false;
+    }
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData()) + offset;
+    name->resize(int(byteLength / 2));
+    QChar* chars = name->data();
+    for (quint32 i = 0; i < byteLength / 2; ++i) {
+        chars[i] = QChar(qFromLittleEndian<quint16>(bytes + i * 2));
+    }
+    return true;
+}
+
+bool corrupt(QString* error)
+{
+    if (error) {
+        *error = QString("ApiSet架构数据已损坏");
+    }
+    return false;
+}
+}
+
+ApiSetSchema::ApiSetSchema()
+    : m_version(0)
+    , m_trimsMinorVersion(false)
+{
+}
+
+QSharedPointer<const ApiSetSchema> ApiSetSchema::load(const QString& filePath, QString* error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = QString("无法打开ApiSet架构文件: %1").arg(filePath);
+        }
+        return QSharedPointer<const ApiSetSchema>();
+    }
+
+    // apisetschema.dll itself, or a section dump captured from one
+    if (file.peek(2) == QByteArray("MZ")) {
+        file.close();
+        const QByteArray section = readSection(filePath, error);
+        return section.isEmpty() ? QSharedPointer<const ApiSetSchema>() : fromData(section, error);
+    }
+    if (file.size() > kMaxRawSchemaSize) {
+        corrupt(error);
+        return QSharedPointer<const ApiSetSchema>();
+    }
+    return fromData(file.readAll(), error);
+}
+
+QByteArray ApiSetSchema::readSection(const QString& filePath, QString* error)
+{
+    WindowedImageGuard source(filePath);
+    const PEImage image(&source);
+    PEImage::Section section;
+    if (!image.isValid() || !image.findSection(".apiset", &section)) {
+        if (error) {
+            *error = QString("文件中没有ApiSet架构: %1").arg(filePath);
+        }
+        return QByteArray();
+    }
+
+    // The file holds rawSize bytes; anything past virtualSize is alignment padding
+    const quint32 length = section.virtualSize ? qMin(section.virtualSize, section.rawSize) : section.rawSize;
+    const uchar* data = image.at(section.rawOffset, length);
+    if (!data || length == 0) {
+        corrupt(error);
+        return QByteArray();
+    }
+    return QByteArray(reinterpret_cast<const char*>(data), int(length));
+}
+
+QSharedPointer<const ApiSetSchema> ApiSetSchema::fromData(const QByteArray& data, QString* error)
+{
+    QSharedPointer<ApiSetSchema> schema(new ApiSetSchema());
+    quint32 version = 0;
+    if (!readU32(data, 0, &version)) {
+        corrupt(error);
+        return QSharedPointer<const ApiSetSchema>();
+    }
+
+    bool parsed = false;
+    switch (version) {
+    case 2:
+        parsed = schema->parseV2(data, error);
+        break;
+    case 4:
+        parsed = schema->parseV4(data, error);
+        break;
+    case 6:
+        parsed = schema->parseV6(data, error);
+        break;
+    default:
+        if (error) {
+            *error = QString("不支持的ApiSet架构版本: %1").arg(version);
+        }
+        break;
+    }
+    if (!parsed) {
+        return QSharedPointer<const ApiSetSchema>();
+    }
+
+    schema->m_version = int(version);
+    return schema;
+}
+
+bool ApiSetSchema::isApiSetName(const QString& name)
+{
+    return NameFolding::startsWith(name, "api-") || NameFolding::startsWith(name, "ext-");
+}
+
+bool ApiSetSchema::isApiSetName(const NameFolding::Name& name)
+{
+    return NameFolding::startsWith(name.data, name.length, "api-") ||
+           NameFolding::startsWith(name.data, name.length, "ext-");
+}
+
+QString ApiSetSchema::hostFor(const QString& contractName, const QString& importingModule) const
+{
+    const Contract* contract = find(contractName.constData(), contractName.size());
+    if (!contract) {
+        return QString();
+    }
+    if (!importingModule.isEmpty()) {
+        for (const QPair<QString, QString>& exception : contract->exceptions) {
+            if (NameFolding::equals(exception.first, importingModule)) {
+                return exception.second;
+            }
+        }
+    }
+    return contract->defaultHost;
+}
+
+QString ApiSetSchema::hostFor(const NameFolding::Name& contractName) const
+{
+    const Contract* contract = find(contractName.data, contractName.length);
+    return contract ? contract->defaultHost : QString();
+}
+
+// Windows 7: {version, count}, entries {nameOffset, nameLength, dataOffset},
+// value arrays {count}, values {nameOffset, nameLength, valueOffset, valueLength}
+bool ApiSetSchema::parseV2(const QByteArray& data, QString* error)
+{
+    quint32 count = 0;
+    if (!readU32(data, 4, &count) || count > kMaxContracts) {
+        return corrupt(error);
+    }
+
+    for (quint32 i = 0; i < count; ++i) {
+        const quint64 entry = 8 + quint64(i) * 12;
+        quint32 nameOffset, nameLength, dataOffset, valueCount;
+        QString name;
+        if (!readU32(data, entry, &nameOffset) || !readU32(data, entry + 4, &nameLength) ||
+            !readU32(data, entry + 8, &dataOffset) || !readName(data, nameOffset, nameLength, &name) ||
+            !readU32(data, dataOffset, &valueCount) || valueCount > kMaxValues) {
+            return corrupt(error);
+        }
+
+        QVector<QPair<QString, QString> > values;
+        for (quint32 j = 0; j < valueCount; ++j) {
+            const quint64 value = quint64(dataOffset) + 4 + quint64(j) * 16;
+            quint32 importerOffset, importerLength, hostOffset, hostLength;
+            QString importer, host;
+            if (!readU32(data, value, &importerOffset) || !readU32(data, value + 4, &importerLength) ||
+                !readU32(data, value + 8, &hostOffset) || !readU32(data, value + 12, &hostLength) ||
+                !readName(data, importerOffset, importerLength, &importer) ||
+                !readName(data, hostOffset, hostLength, &host)) {
+                return corrupt(error);
+            }
+            values.append(qMakePair(importer, host));
+        }
+
+        // Stored without the "api-" prefix, e.g. "MS-Win-Core-Console-L1-1-0"
+        if (!isApiSetName(name)) {
+            name.prepend(QLatin1String("api-"));
+        }
+        addContract(name, name.size(), values);
+    }
+    return true;
+}
+
+// Windows 8.1: {version, size, flags, count}, entries {flags, nameOffset,
+// nameLength, aliasOffset, aliasLength, dataOffset}, value arrays {flags, count},
+// values {flags, nameOffset, nameLength, valueOffset, valueLength}
+bool ApiSetSchema::parseV4(const QByteArray& data, QString* error)
+{
+    quint32 count = 0;
+    if (!readU32(data, 12, &count) || count > kMaxContracts) {
+        return corrupt(error);
+    }
+
+    for (quint32 i = 0; i < count; ++i) {
+        const quint64 entry = 16 + quint64(i) * 24;
+        quint32 nameOffset, nameLength, dataOffset, valueCount;
+        QString name;
+        if (!readU32(data, entry + 4, &nameOffset) || !readU32(data, entry + 8, &nameLength) ||
+            !readU32(data, entry + 20, &dataOffset) || !readName(data, nameOffset, nameLength, &name) ||
+            !readU32(data, quint64(dataOffset) + 4, &valueCount) || valueCount > kMaxValues) {
+            return corrupt(error);
+        }
+
+        QVector<QPair<QString, QString> > values;
+        for (quint32 j = 0; j < valueCount; ++j) {
+            const quint64 value = quint64(dataOffset) + 8 + quint64(j) * 20;
+            quint32 importerOffset, importerLength, hostOffset, hostLength;
+            QString importer, host;
+            if (!readU32(data, value + 4, &importerOffset) || !readU32(data, value + 8, &importerLength) ||
+                !readU32(data, value + 12, &hostOffset) || !readU32(data, value + 16, &hostLength) ||
+                !readName(data, importerOffset, importerLength, &importer) ||
+                !readName(data, hostOffset, hostLength, &host)) {
+                return corrupt(error);
+            }
+            values.append(qMakePair(importer, host));
+        }
+
+        if (!isApiSetName(name)) {
+            name.prepend(QLatin1String("api-"));
+        }
+        addContract(name, name.size(), values);
+    }
+    return true;
+}
+
+// Windows 10+: {version, size, flags, count, entryOffset, hashOffset, hashFactor},
+// entries {flags, nameOffset, nameLength, hashedLength, valueOffset, valueCount},
+// values {flags, nameOffset, nameLength, valueOffset, valueLength}
+bool ApiSetSchema::parseV6(const QByteArray& data, QString* error)
+{
+    quint32 count = 0;
+    quint32 entryOffset = 0;
+    if (!readU32(data, 12, &count) || !readU32(data, 16, &entryOffset) || count > kMaxContracts) {
+        return corrupt(error);
+    }
+
+    for (quint32 i = 0; i < count; ++i) {
+        const quint64 entry = quint64(entryOffset) + quint64(i) * 24;
+        quint32 nameOffset, nameLength, hashedLength, valueOffset, valueCount;
+        QString name;
+        if (!readU32(data, entry + 4, &nameOffset) || !readU32(data, entry + 8, &nameLength) ||
+            !readU32(data, entry + 12, &hashedLength) || !readU32(data, entry + 16, &valueOffset) ||
+            !readU32(data, entry + 20, &valueCount) || valueCount > kMaxValues ||
+            hashedLength > nameLength || !readName(data, nameOffset, nameLength, &name)) {
+            return corrupt(error);
+        }
+
+        QVector<QPair<QString, QString> > values;
+        for (quint32 j = 0; j < valueCount; ++j) {
+            const quint64 value = quint64(valueOffset) + quint64(j) * 20;
+            quint32 importerOffset, importerLength, hostOffset, hostLength;
+            QString importer, host;
+            if (!readU32(data, value + 4, &importerOffset) || !readU32(data, value + 8, &importerLength) ||
+                !readU32(data, value + 12, &hostOffset) || !readU32(data, value + 16, &hostLength) ||
+                !readName(data, importerOffset, importerLength, &importer) ||
+                !readName(data, hostOffset, hostLength, &host)) {
+                return corrupt(error);
+            }
+            values.append(qMakePair(importer, host));
+        }
+
+        // The hashed part stops before the minor version: "api-ms-win-core-file-l1-2"
+        addContract(name, int(hashedLength / 2), values);
+    }
+
+    m_trimsMinorVersion = true;
+    return true;
+}
+
+void ApiSetSchema::addContract(const QString& name, int keyLength, const QVector<QPair<QString, QString> >& values)
+{
+    Contract contract;
+    contract.key = name.left(keyLength).toLower();
+    if (contract.key.endsWith(QLatin1String(".dll"))) {
+        contract.key.chop(4);
+    }
+
+    // The value without an importing module is the default host
+    bool hasDefault = false;
+    for (const QPair<QString, QString>& value : values) {
+        if (value.first.isEmpty() && !hasDefault) {
+            contract.defaultHost = value.second;
+            hasDefault = true;
+        } else if (!value.first.isEmpty()) {
+            contract.exceptions.append(value);
+        }
+    }
+
+    m_index.insert(NameFolding::hash(contract.key), m_contracts.size());
+    m_contracts.append(contract);
+}
+
+template <typename Char>
+const ApiSetSchema::Contract* ApiSetSchema::find(const Char* data, int length) const
+{
+    // Match the way the loader does: without ".dll", and for v6 up to the last hyphen
+    if (length > 4 && unit(data[length - 4]) == '.' &&
+        NameFolding::fold(unit(data[length - 3])) == 'd' &&
+        NameFolding::fold(unit(data[length - 2])) == 'l' &&
+        NameFolding::fold(unit(data[length - 1])) == 'l') {
+        length -= 4;
+    }
+    if (m_trimsMinorVersion) {
+        int hyphen = length - 1;
+        while (hyphen >= 0 && unit(data[hyphen]) != '-') {
+            --hyphen;
+        }
+        if (hyphen > 0) {
+            length = hyphen;
+        }
+    }
+
+    uint hash = 2166136261u;
+    for (int i = 0; i < length; ++i) {
+        hash = (hash ^ NameFolding::fold(unit(data[i]))) * 16777619u;
+    }
+
+    for (auto it = m_index.constFind(hash); it != m_index.constEnd() && it.key() == hash; ++it) {
+        const Contract& contract = m_contracts.at(it.value());
+        if (contract.key.size() != length) {
+            continue;
+        }
+        int i = 0;
+        while (i < length && NameFolding::fold(unit(data[i])) == contract.key.at(i).unicode()) {
+            ++i;
+        }
+        if (i == length) {
+            return &contract;
+        }
+    }
+    return nullptr;
+}
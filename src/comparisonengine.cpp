@@ -6,7 +6,7 @@
 #include <QSysInfo>
 
 ComparisonEngine::MissingReport ComparisonEngine::generateMissingReport(
-    const QList<DependencyScanner::NodePtr>& roots)
+    const QList<DependencyScanner::NodeHandle>& roots)
 {
     MissingReport report;
     report.generatedTime = QDateTime::currentDateTime();
@@ -14,11 +14,9 @@ ComparisonEngine::MissingReport ComparisonEngine::generateMissingReport(
     
     QStringList missingDLLs;
     
-    // 递归收集所有缺失的DLL
-    for (const auto& root : roots) {
-        if (root) {
-            collectMissingDLLs(root, missingDLLs);
-        }
+    // 依赖图中的每个模块只检查一次
+    for (const auto& module : DependencyScanner::modules(roots)) {
+        collectMissingDLLs(module, missingDLLs);
     }
     
     // 去重
@@ -29,22 +27,17 @@ ComparisonEngine::MissingReport ComparisonEngine::generateMissingReport(
 }
 
 void ComparisonEngine::collectMissingDLLs(
-    const DependencyScanner::NodePtr& node,
+    const DependencyScanner::NodeHandle& node,
     QStringList& missingDLLs)
 {
     if (!node) return;
     
     // 如果当前节点是缺失的DLL，添加到列表
-    if (!node->exists && !node->fileName.isEmpty()) {
-        if (!missingDLLs.contains(node->fileName)) {
-            missingDLLs.append(node->fileName);
+    if (!node.exists() && !node.fileName().isEmpty()) {
+        if (!missingDLLs.contains(node.fileName())) {
+            missingDLLs.append(node.fileName());
         }
     }
-    
-    // 递归处理子节点
-    for (const auto& child : node->children) {
-        collectMissingDLLs(child, missingDLLs);
-    }
 }
 
 bool ComparisonEngine::saveMissingReport(
@@ -102,37 +95,28 @@ ComparisonEngine::MissingReport ComparisonEngine::loadMissingReport(const QStrin
     return report;
 }
 
-QList<DependencyScanner::NodePtr> ComparisonEngine::findMissingDLLsInTree(
-    const QList<DependencyScanner::NodePtr>& roots,
+QList<DependencyScanner::NodeHandle> ComparisonEngine::findMissingDLLsInTree(
+    const QList<DependencyScanner::NodeHandle>& roots,
     const MissingReport& report)
 {
-    QList<DependencyScanner::NodePtr> results;
+    QList<DependencyScanner::NodeHandle> results;
     
-    for (const auto& root : roots) {
-        if (root) {
-            findDLLNodesByName(root, report.missingDLLs, results);
-        }
+    for (const auto& module : DependencyScanner::modules(roots)) {
+        findDLLNodesByName(module, report.missingDLLs, results);
     }
     
     return results;
 }
 
 void ComparisonEngine::findDLLNodesByName(
-    const DependencyScanner::NodePtr& node,
+    const DependencyScanner::NodeHandle& node,
     const QStringList& dllNames,
-    QList<DependencyScanner::NodePtr>& results)
+    QList<DependencyScanner::NodeHandle>& results)
 {
     if (!node) return;
     
     // 检查当前节点是否匹配
-    if (dllNames.contains(node->fileName, Qt::CaseInsensitive)) {
-        if (!results.contains(node)) {
-            results.append(node);
-        }
-    }
-    
-    // 递归处理子节点
-    for (const auto& child : node->children) {
-        findDLLNodesByName(child, dllNames, results);
+    if (dllNames.contains(node.fileName(), Qt::CaseInsensitive)) {
+        results.append(node);
     }
 }
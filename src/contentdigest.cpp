@@ -0,0 +1,147 @@
+#include "contentdigest.h"
+#include <cstring>
+
+namespace {
+const quint64 kPrime1 = 0x9E3779B185EBCA87ull;
+const quint64 kPrime2 = 0xC2B2AE3D27D4EB4Full;
+const quint64 kPrime3 = 0x165667B19E3779F9ull;
+const quint64 kPrime4 = 0x85EBCA77C2B2AE63ull;
+const quint64 kPrime5 = 0x27D4EB2F165667C5ull;
+
+inline quint64 rotl(quint64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline quint64 readU64(const uchar* p)
+{
+    return quint64(p[0]) | (quint64(p[1]) << 8) | (quint64(p[2]) << 16) | (quint64(p[3]) << 24) |
+           (quint64(p[4]) << 32) | (quint64(p[5]) << 40) | (quint64(p[6]) << 48) | (quint64(p[7]) << 56);
+}
+
+inline quint32 readU32(const uchar* p)
+{
+    return quint32(p[0]) | (quint32(p[1]) << 8) | (quint32(p[2]) << 16) | (quint32(p[3]) << 24);
+}
+
+inline quint64 round(quint64 lane, quint64 input)
+{
+    lane += input * kPrime2;
+    lane = rotl(lane, 31);
+    return lane * kPrime1;
+}
+
+inline quint64 mergeRound(quint64 acc, quint64 lane)
+{
+    acc ^= round(0, lane);
+    return acc * kPrime1 + kPrime4;
+}
+
+// Consumes whole 32-byte stripes and returns the number of bytes used
+inline qint64 consumeStripes(quint64* lanes, const uchar* data, qint64 length)
+{
+    quint64 v1 = lanes[0];
+    quint64 v2 = lanes[1];
+    quint64 v3 = lanes[2];
+    quint64 v4 = lanes[3];
+    qint64 offset = 0;
+    for (; offset + 32 <= length; offset += 32) {
+        v1 = round(v1, readU64(data + offset));
+        v2 = round(v2, readU64(data + offset + 8));
+        v3 = round(v3, readU64(data + offset + 16));
+        v4 = round(v4, readU64(data + offset + 24));
+    }
+    lanes[0] = v1;
+    lanes[1] = v2;
+    lanes[2] = v3;
+    lanes[3] = v4;
+    return offset;
+}
+}
+
+ContentDigest::ContentDigest(quint64 seed)
+    : m_buffered(0)
+    , m_totalLength(0)
+    , m_seed(seed)
+{
+    m_lanes[0] = seed + kPrime1 + kPrime2;
+    m_lanes[1] = seed + kPrime2;
+    m_lanes[2] = seed;
+    m_lanes[3] = seed - kPrime1;
+}
+
+void ContentDigest::update(const uchar* data, qint64 length)
+{
+    if (!data || length <= 0) {
+        return;
+    }
+    m_totalLength += quint64(length);
+
+    // Complete a stripe left over from the previous call
+    if (m_buffered > 0) {
+        const int take = int(qMin<qint64>(kStripeSize - m_buffered, length));
+        std::memcpy(m_buffer + m_buffered, data, size_t(take));
+        m_buffered += take;
+        data += take;
+        length -= take;
+        if (m_buffered < kStripeSize) {
+            return;
+        }
+        consumeStripes(m_lanes, m_buffer, kStripeSize);
+        m_buffered = 0;
+    }
+
+    const qint64 used = consumeStripes(m_lanes, data, length);
+    m_buffered = int(length - used);
+    std::memcpy(m_buffer, data + used, size_t(m_buffered));
+}
+
+quint64 ContentDigest::finish() const
+{
+    quint64 hash;
+    if (m_totalLength >= quint64(kStripeSize)) {
+        hash = rotl(m_lanes[0], 1) + rotl(m_lanes[1], 7) + rotl(m_lanes[2], 12) + rotl(m_lanes[3], 18);
+        for (int i = 0; i < 4; ++i) {
+            hash = mergeRound(hash, m_lanes[i]);
+        }
+    } else {
+        hash = m_seed + kPrime5;
+    }
+    hash += m_totalLength;
+
+    // Tail: the bytes that did not fill a stripe
+    const uchar* p = m_buffer;
+    const uchar* end = m_buffer + m_buffered;
+    for (; p + 8 <= end; p += 8) {
+        hash ^= round(0, readU64(p));
+        hash = rotl(hash, 27) * kPrime1 + kPrime4;
+    }
+    if (p + 4 <= end) {
+        hash ^= quint64(readU32(p)) * kPrime1;
+        hash = rotl(hash, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= quint64(*p) * kPrime5;
+        hash = rotl(hash, 11) * kPrime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+quint64 ContentDigest::compute(const uchar* data, qint64 length, quint64 seed)
+{
+    ContentDigest digest(seed);
+    digest.update(data, length);
+    return digest.finish();
+}
+
+QString ContentDigest::toHex(quint64 digest)
+{
+    return QString("%1").arg(digest, 16, 16, QChar('0'));
+}
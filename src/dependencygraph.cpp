@@ -0,0 +1,209 @@
+#include "dependencygraph.h"
+#include <QMutexLocker>
+#include <QSet>
+#include <algorithm>
+
+const DependencyGraph::Index DependencyGraph::NoIndex;
+
+DependencyGraph::DependencyGraph()
+    : m_blocks(new Node*[MAX_BLOCKS]())
+    , m_nodeCount(0)
+    , m_deadEdges(0)
+{
+}
+
+DependencyGraph::~DependencyGraph()
+{
+    for (int i = 0; i < MAX_BLOCKS && m_blocks[i]; ++i) {
+        delete[] m_blocks[i];
+    }
+    delete[] m_blocks;
+}
+
+DependencyGraph::Index DependencyGraph::addNode(const QString& filePath, const QString& fileName)
+{
+    return addNode(m_strings.intern(filePath), m_strings.intern(fileName));
+}
+
+DependencyGraph::Index DependencyGraph::addNode(StringTable::Id filePath, StringTable::Id fileName)
+{
+    // A full string table hands out Empty, which would name the node wrongly
+    QMutexLocker locker(&m_mutex);
+    const Index index = m_nodeCount;
+    const Index block = index >> BLOCK_SHIFT;
+    if (block >= Index(MAX_BLOCKS) || m_strings.isFull()) {
+        return NoIndex;
+    }
+    if (!m_blocks[block]) {
+        m_blocks[block] = new Node[BLOCK_SIZE];
+    }
+    ++m_nodeCount;
+
+    Node& node = m_blocks[block][index & BLOCK_MASK];
+    node.filePath = filePath;
+    node.fileName = fileName;
+    return index;
+}
+
+int DependencyGraph::nodeCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return int(m_nodeCount);
+}
+
+bool DependencyGraph::isFull() const
+{
+    QMutexLocker locker(&m_mutex);
+    return (m_nodeCount >> BLOCK_SHIFT) >= Index(MAX_BLOCKS) || m_strings.isFull();
+}
+
+void DependencyGraph::setEdges(Index node, const QVector<Edge>& edges)
+{
+    QMutexLocker locker(&m_mutex);
+    Node& target = this->node(node);
+    const quint32 count = quint32(edges.size());
+    if (count <= target.edgeCount) {
+        std::copy(edges.constBegin(), edges.constEnd(), m_edges.begin() + target.firstEdge);
+        m_deadEdges += target.edgeCount - count;
+    } else if (target.edgeCount > 0 && target.firstEdge + target.edgeCount == quint32(m_edges.size())) {
+        // The last range grows in place
+        m_edges.resize(int(target.firstEdge));
+        m_edges += edges;
+    } else {
+        m_deadEdges += target.edgeCount;
+        target.firstEdge = quint32(m_edges.size());
+        m_edges += edges;
+    }
+    target.edgeCount = count;
+    if (m_deadEdges > quint32(m_edges.size()) / 2) {
+        compactEdges();
+    }
+}
+
+void DependencyGraph::compactEdges()
+{
+    // Called with m_mutex held; ranges keep their node order
+    QVector<Edge> live;
+    live.reserve(m_edges.size() - int(m_deadEdges));
+    for (Index i = 0; i < m_nodeCount; ++i) {
+        Node& current = node(i);
+        const quint32 first = quint32(live.size());
+        for (quint32 k = 0; k < current.edgeCount; ++k) {
+            live.append(m_edges.at(int(current.firstEdge + k)));
+        }
+        current.firstEdge = first;
+    }
+    m_edges.swap(live);
+    m_deadEdges = 0;
+}
+
+quint32 DependencyGraph::addSymbolList(const QStringList& symbols)
+{
+    if (symbols.isEmpty()) {
+        return 0;
+    }
+    QMutexLocker locker(&m_mutex);
+    m_symbolLists.append(symbols);
+    return quint32(m_symbolLists.size());
+}
+
+QStringList DependencyGraph::symbolList(quint32 list) const
+{
+    if (list == 0) {
+        return QStringList();
+    }
+    QMutexLocker locker(&m_mutex);
+    return m_symbolLists.at(int(list) - 1);
+}
+
+QVector<DependencyGraph::Index> DependencyGraph::modules(const QVector<Index>& roots) const
+{
+    QVector<Index> result;
+    QVector<bool> seen(int(m_nodeCount), false);
+    QVector<Index> stack;
+    for (int i = roots.size() - 1; i >= 0; --i) {
+        if (roots.at(i) != NoIndex) {
+            stack.append(roots.at(i));
+        }
+    }
+
+    while (!stack.isEmpty()) {
+        const Index index = stack.takeLast();
+        if (seen.at(int(index))) {
+            continue;
+        }
+        seen[int(index)] = true;
+        result.append(index);
+        const Node& current = node(index);
+        for (int i = int(current.edgeCount) - 1; i >= 0; --i) {
+            const Edge& child = m_edges.at(int(current.firstEdge) + i);
+            if (!child.circular && !seen.at(int(child.node))) {
+                stack.append(child.node);
+            }
+        }
+    }
+    return result;
+}
+
+bool DependencyGraph::reaches(Index node, const QVector<Index>& targets) const
+{
+    QSet<Index> seen;
+    QVector<Index> stack;
+    stack.append(node);
+    seen.insert(node);
+    while (!stack.isEmpty()) {
+        const Index index = stack.takeLast();
+        if (targets.contains(index)) {
+            return true;
+        }
+        const Node& current = this->node(index);
+        for (quint32 i = 0; i < current.edgeCount; ++i) {
+            const Edge& child = m_edges.at(int(current.firstEdge + i));
+            if (!child.circular && !seen.contains(child.node)) {
+                seen.insert(child.node);
+                stack.append(child.node);
+            }
+        }
+    }
+    return false;
+}
+
+DependencyGraph::Statistics DependencyGraph::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    Statistics stats;
+    stats.nodes = int(m_nodeCount);
+    stats.edges = m_edges.size() - int(m_deadEdges);
+    stats.deadEdges = int(m_deadEdges);
+    const qint64 blocks = (m_nodeCount + BLOCK_MASK) >> BLOCK_SHIFT;
+    stats.strings = m_strings.count();
+    stats.bytes = qint64(sizeof(Node*)) * MAX_BLOCKS +
+                  blocks * BLOCK_SIZE * qint64(sizeof(Node)) +
+                  m_edges.capacity() * qint64(sizeof(Edge)) +
+                  m_symbolLists.capacity() * qint64(sizeof(QStringList)) +
+                  m_strings.bytes();
+    return stats;
+}
+
+DependencyGraph::EdgeView DependencyGraph::NodeHandle::edge(int i) const
+{
+    const Edge& stored = m_graph->edge(m_index, i);
+    EdgeView view(NodeHandle(m_graph, stored.node));
+    view.missingSymbols = m_graph->symbolList(stored.symbolList);
+    view.delayLoad = stored.delayLoad;
+    view.viaForwarder = stored.viaForwarder;
+    view.archMismatch = stored.archMismatch;
+    view.circular = stored.circular;
+    return view;
+}
+
+QVector<DependencyGraph::EdgeView> DependencyGraph::NodeHandle::edges() const
+{
+    QVector<EdgeView> views;
+    const int count = edgeCount();
+    views.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        views.append(edge(i));
+    }
+    return views;
+}
@@ -2,6 +2,7 @@
 #include "peparser.h"
 #include "pathresolver.h"
 #include "logger.h"
+#include "workstealingqueue.h"
 #include <QDir>
 #include <QFileInfo>
 #include <QDirIterator>
@@ -13,87 +14,92 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <QMetaObject>
+#include <QVector>
 #include <utility>
 
 DependencyScanner::DependencyScanner(QObject *parent)
     : QObject(parent)
+    , m_graph(new DependencyGraph())
     , m_cancelled(0)
+    , m_graphFull(0)
+    , m_maxDepth(0)
+    , m_filesProbed(0)
+    , m_rejectedFiles(0)
+    , m_leafFiles(0)
+    , m_deferredDelayLoads(0)
+    , m_missingSymbols(0)
+    , m_sharedParses(0)
+    , m_modulesParsed(0)
 {
 }
 
 DependencyScanner::~DependencyScanner()
 {
-    clearCache();
+    // The process-wide resolver cache stays: short-lived scanners expand
+    // delay-loads while a background scan may be resolving
 }
 
-static DependencyScanner::NodePtr cloneNodeShallow(
-    const DependencyScanner::DependencyNode* src,
-    const DependencyScanner::NodePtr& parent,
-    int depth)
+static void markArchMismatch(DependencyGraph::Edge* edge, const DependencyGraph& graph,
+                             const QString& importerName, PEParser::Architecture importerArch)
 {
-    if (!src) {
-        return DependencyScanner::NodePtr();
+    // x64 cannot load x86 DLLs (but x86 can load x86 DLLs on x64 system via WOW64)
+    const DependencyGraph::Node& node = graph.node(edge->node);
+    if (importerArch == PEParser::x64 && node.arch() == PEParser::x86) {
+        edge->archMismatch = true;
+        LOG_WARNING("DependencyScanner", QString("架构不匹配: %1 (x64) -> %2 (x86)")
+            .arg(importerName)
+            .arg(graph.string(node.fileName)));
     }
+}
 
-    DependencyScanner::NodePtr node(new DependencyScanner::DependencyNode());
-    node->filePath = src->filePath;
-    node->fileName = src->fileName;
-    node->arch = src->arch;
-    node->fileVersion = src->fileVersion;
-    node->productVersion = src->productVersion;
-    node->exists = src->exists;
-    node->archMismatch = src->archMismatch;
-    node->parent = parent;
-    node->depth = depth;
+// Shared state of one graph scan; jobs carry indexes into it
+struct DependencyScanner::GraphScan {
+    WorkStealingQueue<ScanJob> queue;
+    QVector<ResolverContext> contexts;  // One per application directory of the roots
+    QVector<Index> roots;               // Node per root file, NoIndex once rejected
+    QStringList files;
+    bool includeSystemDLLs;
+    QAtomicInt rootsStarted;            // For progress
 
-    return node;
-}
+    explicit GraphScan(int workers) : queue(workers), includeSystemDLLs(false), rootsStarted(0) {}
+};
 
-static DependencyScanner::NodePtr cloneNodeDeep(
-    const DependencyScanner::DependencyNode* src,
-    const DependencyScanner::NodePtr& parent,
-    int depth)
+class DependencyScanner::GraphScanWorker : public QRunnable
 {
-    if (!src) {
-        return DependencyScanner::NodePtr();
-    }
+public:
+    GraphScanWorker(DependencyScanner* scanner, GraphScan* scan, int worker)
+        : m_scanner(scanner), m_scan(scan), m_worker(worker) {}
 
-    DependencyScanner::NodePtr node = cloneNodeShallow(src, parent, depth);
-    if (!node) {
-        return DependencyScanner::NodePtr();
-    }
-
-    for (const auto& child : src->children) {
-        if (!child) {
-            continue;
-        }
-        DependencyScanner::NodePtr childClone =
-            cloneNodeDeep(child.data(), node, depth + 1);
-        if (childClone) {
-            node->children.append(childClone);
+    void run() override
+    {
+        ScanJob job;
+        while (m_scan->queue.take(m_worker, &job)) {
+            m_scanner->runScanJob(job, m_scan, m_worker);
+            m_scan->queue.finish();
         }
     }
 
-    return node;
-}
-DependencyScanner::NodePtr DependencyScanner::scanFile(const QString& filePath, bool includeSystemDLLs)
+private:
+    DependencyScanner* m_scanner;
+    GraphScan* m_scan;
+    int m_worker;
+};
+
+DependencyScanner::NodeHandle DependencyScanner::scanFile(const QString& filePath, bool includeSystemDLLs)
 {
     clearCache();
-    m_scanningStack.clear();
-    m_scanningSet.clear();
     
+    // One frozen search order for the whole scan
     QFileInfo fileInfo(filePath);
-    QString appDir = fileInfo.absolutePath();
+    const ResolverContext context = PathResolver::context(fileInfo.absolutePath());
     
-    return scanFileRecursive(filePath, appDir, NodePtr(), 0, includeSystemDLLs);
+    return NodeHandle(m_graph, scanModule(filePath, context, includeSystemDLLs, m_scanningPath).node);
 }
 
-QList<DependencyScanner::NodePtr> DependencyScanner::scanDirectory(const QString& dirPath, bool recursive, bool includeSystemDLLs)
+QList<DependencyScanner::NodeHandle> DependencyScanner::scanDirectory(const QString& dirPath, bool recursive, bool includeSystemDLLs)
 {
-    QList<NodePtr> results;
+    QList<NodeHandle> results;
     clearCache();
-    m_scanningStack.clear();
-    m_scanningSet.clear();
     
     // Find all DLL and EXE files
     QStringList filters;
@@ -124,13 +130,22 @@ QList<DependencyScanner::NodePtr> DependencyScanner::scanDirectory(const QString
         current++;
         emit scanProgress(current, total, QFileInfo(filePath).fileName());
 
-        m_scanningStack.clear();
-        m_scanningSet.clear();
+        m_scanningPath = ScanPath();
+
+        const PEParser::HeaderProbe probe = probeRootFile(filePath);
+        if (probe.kind == PEParser::NotPE) {
+            continue;
+        }
 
-        const QString appDir = QFileInfo(filePath).absolutePath();
-        NodePtr node = scanFileRecursive(filePath, appDir, NodePtr(), 0, includeSystemDLLs);
-        if (node) {
-            results.append(node);
+        Index node = DependencyGraph::NoIndex;
+        if (probe.kind == PEParser::NoImports) {
+            node = leafNode(filePath, probe);
+        } else {
+            const ResolverContext context = PathResolver::context(QFileInfo(filePath).absolutePath());
+            node = scanModule(filePath, context, includeSystemDLLs, m_scanningPath).node;
+        }
+        if (node != DependencyGraph::NoIndex) {
+            results.append(NodeHandle(m_graph, node));
         }
     }
 
@@ -138,14 +153,12 @@ QList<DependencyScanner::NodePtr> DependencyScanner::scanDirectory(const QString
     return results;
 }
 
-QList<DependencyScanner::NodePtr> DependencyScanner::scanDirectoryParallel(const QString& dirPath, bool recursive, bool includeSystemDLLs, int threadCount)
+QList<DependencyScanner::NodeHandle> DependencyScanner::scanDirectoryParallel(const QString& dirPath, bool recursive, bool includeSystemDLLs, int threadCount)
 {
     LOG_INFO("DependencyScanner", QString("开始并行扫描目录: %1 (线程数: %2)").arg(dirPath).arg(threadCount));
     
-    QList<NodePtr> results;
+    QList<NodeHandle> results;
     clearCache();
-    m_scanningStack.clear();
-    m_scanningSet.clear();
     
     // Find all DLL and EXE files
     QStringList filters;
@@ -168,388 +181,1086 @@ QList<DependencyScanner::NodePtr> DependencyScanner::scanDirectoryParallel(const
     LOG_INFO("DependencyScanner", QString("找到 %1 个文件待扫描，使用 %2 个线程并行处理")
         .arg(files.size()).arg(threadCount));
     
+    // Roots are claimed up front, so a root that another root imports is
+    // parsed once, by its own job. Roots in one folder share a resolver context.
+    GraphScan scan(threadCount);
+    scan.files = files;
+    scan.includeSystemDLLs = includeSystemDLLs;
+    QHash<QString, int> contextIndexes;
+    for (int i = 0; i < files.size(); ++i) {
+        const QString appDir = QFileInfo(files.at(i)).absolutePath();
+        int context = contextIndexes.value(appDir, -1);
+        if (context < 0) {
+            context = scan.contexts.size();
+            scan.contexts.append(PathResolver::context(appDir));
+            contextIndexes.insert(appDir, context);
+        }
+
+        ScanPath seed;
+        seed.graphScan = &scan;
+        seed.worker = i % scan.queue.workerCount();
+        seed.context = context;
+        scan.roots.append(claimModule(files.at(i), 0, seed, i).node);
+    }
+
     QThreadPool* pool = QThreadPool::globalInstance();
     int originalMaxThreadCount = pool->maxThreadCount();
-    pool->setMaxThreadCount(threadCount);
-    
-    QMutex resultMutex;
-    int total = files.size();
-    QAtomicInt current(0);
-    
-    class ScanTask : public QRunnable {
-    public:
-        ScanTask(const QString& filePath, DependencyScanner* scanner, 
-                 bool includeSystemDLLs, QAtomicInt* current, int total,
-                 QMutex* resultMutex, QList<NodePtr>* results)
-            : m_filePath(filePath), m_scanner(scanner), 
-              m_includeSystemDLLs(includeSystemDLLs), 
-              m_current(current), m_total(total),
-              m_resultMutex(resultMutex), m_results(results) {}
-              
-        void run() override {
-            if (m_scanner->isCancelled()) {
-                return;
-            }
-            
-            int currentVal = m_current->fetchAndAddAcquire(1) + 1;
-            QMetaObject::invokeMethod(m_scanner, "scanProgress", 
-                Qt::QueuedConnection,
-                Q_ARG(int, currentVal), 
-                Q_ARG(int, m_total), 
-                Q_ARG(QString, QFileInfo(m_filePath).fileName()));
-            
-            QStringList threadStack;
-            QSet<QString> threadSet;
-            QString appDir = QFileInfo(m_filePath).absolutePath();
-            
-            NodePtr node = m_scanner->scanFileWithCustomStack(
-                m_filePath, appDir, NodePtr(), 0, m_includeSystemDLLs, threadStack, threadSet);
-            
-            if (node) {
-                QMutexLocker locker(m_resultMutex);
-                m_results->append(node);
-            }
-        }
-        
-    private:
-        QString m_filePath;
-        DependencyScanner* m_scanner;
-        bool m_includeSystemDLLs;
-        QAtomicInt* m_current;
-        int m_total;
-        QMutex* m_resultMutex;
-        QList<NodePtr>* m_results;
-    };
-    
-    QList<ScanTask*> tasks;
-    for (const QString& filePath : files) {
-        ScanTask* task = new ScanTask(filePath, this, includeSystemDLLs, 
-                                       &current, total, &resultMutex, &results);
+    pool->setMaxThreadCount(scan.queue.workerCount());
+    for (int worker = 0; worker < scan.queue.workerCount(); ++worker) {
+        GraphScanWorker* task = new GraphScanWorker(this, &scan, worker);
         task->setAutoDelete(true);
-        tasks.append(task);
         pool->start(task);
     }
-    
+
     pool->waitForDone();
     pool->setMaxThreadCount(originalMaxThreadCount);
     
-    if (isCancelled()) {
+    if (isCancelled() && !isGraphFull()) {
         LOG_WARNING("DependencyScanner", "并行扫描被用户取消");
     }
+
+    finishGraphScan(scan.roots);
+    for (Index root : scan.roots) {
+        if (root != DependencyGraph::NoIndex) {
+            results.append(NodeHandle(m_graph, root));
+        }
+    }
     
-    LOG_INFO("DependencyScanner", QString("并行扫描完成，共扫描 %1 个文件").arg(results.size()));
+    LOG_INFO("DependencyScanner", QString("并行扫描完成，共扫描 %1 个文件 (跳过非PE文件: %2, 无导入表: %3, 解析模块: %4)")
+        .arg(results.size()).arg(m_rejectedFiles.loadAcquire()).arg(m_leafFiles.loadAcquire())
+        .arg(m_modulesParsed.loadAcquire()));
     emit scanCompleted();
     return results;
 }
 
-DependencyScanner::NodePtr DependencyScanner::scanFileWithCustomStack(
-    const QString& filePath,
-    const QString& appDir,
-    const DependencyScanner::NodePtr& parent,
-    int depth,
-    bool includeSystemDLLs,
-    QStringList& customStack,
-    QSet<QString>& customSet)
+DependencyGraph::Edge DependencyScanner::scanModule(const QString& filePath,
+                                                    const ResolverContext& context,
+                                                    bool includeSystemDLLs,
+                                                    ScanPath& path)
+{
+    // Depth-first walk on an explicit stack: a chain of imports can be as
+    // deep as the depth policy allows, whatever the thread's stack size
+    QVector<WalkFrame> frames;
+    DependencyGraph::Edge edge;
+    if (!enterModule(filePath, 0, path, &frames, &edge)) {
+        return edge;
+    }
+
+    QString childPath;
+    for (;;) {
+        if (nextImport(&frames.last(), context, includeSystemDLLs, path, &childPath)) {
+            DependencyGraph::Edge child;
+            if (!enterModule(childPath, frames.last().depth + 1, path, &frames, &child)) {
+                addImportEdge(&frames.last(), child, context, path);
+            }
+            continue;
+        }
+
+        // All imports done: publish the module and hand its edge to the importer
+        edge = leaveModule(&frames.last(), context, includeSystemDLLs, path);
+        frames.removeLast();
+        if (frames.isEmpty()) {
+            return edge;
+        }
+        addImportEdge(&frames.last(), edge, context, path);
+    }
+}
+
+bool DependencyScanner::enterModule(const QString& filePath, int depth, ScanPath& path,
+                                    QVector<WalkFrame>* frames, DependencyGraph::Edge* edge)
 {
     // Check for cancellation
     if (isCancelled()) {
-        return NodePtr();
+        return false;
     }
 
-    // Limit recursion depth to prevent stack overflow
-    const int MAX_DEPTH = 50;
-    if (depth > MAX_DEPTH) {
-        LOG_DEBUG("DependencyScanner", QString("达到最大递归深度: %1").arg(filePath));
-        return NodePtr();
+    if (m_maxDepth > 0 && depth > m_maxDepth) {
+        LOG_WARNING("DependencyScanner", QString("达到最大扫描深度: %1").arg(filePath));
+        return false;
     }
 
-    // Check for circular dependency
-    QString lowerPath = filePath.toLower();
-    if (customSet.contains(lowerPath)) {
+    DependencyGraph* graph = m_graph.data();
+    StringTable& strings = graph->strings();
+
+    // Check for circular dependency. Paths are keyed by their case-folded ID.
+    const StringTable::Id pathId = strings.intern(filePath);
+    const StringTable::Id key = strings.folded(pathId);
+    if (path.set.contains(key)) {
         LOG_DEBUG("DependencyScanner", QString("检测到循环依赖: %1").arg(filePath));
-        NodePtr node(new DependencyNode());
-        node->filePath = filePath;
-        node->fileName = QFileInfo(filePath).fileName();
-        node->exists = true;
-        node->parent = parent;
-        node->depth = depth;
-        return node;
+        edge->node = placeholderNode(pathId);
+        edge->circular = true;
+        return false;
     }
 
-    // Check cache (thread-safe)
+    // A module already in the graph is shared. A pending one (only delay-loaded
+    // so far) gets its edges scanned in place, unless another walk is doing that
+    // already; this walk then builds a node of its own. So does one walked deeper
+    // than here under a depth limit, as its imports may have been cut.
+    Index node = DependencyGraph::NoIndex;
     {
         QMutexLocker locker(&m_cacheMutex);
-        if (m_cache.contains(lowerPath)) {
-            QSharedPointer<DependencyNode> cached = m_cache.value(lowerPath).toStrongRef();
-            if (cached) {
-                return cloneNodeDeep(cached.data(), parent, depth);
+        const Index cached = m_cache.value(key, DependencyGraph::NoIndex);
+        if (cached != DependencyGraph::NoIndex && !m_rescanning.contains(cached)) {
+            const bool shallower = m_maxDepth > 0 && depth < m_moduleDepths.value(cached, depth);
+            if (!graph->node(cached).delayPending && !shallower) {
+                // Fresh nodes are invisible to other modules; only nodes rescanned in place can close a cycle
+                if (!path.rescanning.isEmpty() && graph->reaches(cached, path.rescanning)) {
+                    edge->node = placeholderNode(pathId);
+                    edge->circular = true;
+                } else {
+                    edge->node = cached;
+                }
+                return false;
             }
+            m_rescanning.insert(cached);
+            node = cached;
         }
     }
 
-    // Add to custom scanning stack
-    customStack.append(lowerPath);
-    customSet.insert(lowerPath);
+    const bool rescan = node != DependencyGraph::NoIndex;
+    if (!rescan) {
+        node = addGraphNode(pathId, strings.intern(QFileInfo(filePath).fileName()));
+        if (node == DependencyGraph::NoIndex) {
+            return false;
+        }
+    }
+    frames->append(WalkFrame());
+    WalkFrame& frame = frames->last();
+    frame.rescan = rescan;
+    frame.node = node;
+    frame.key = key;
+    frame.depth = depth;
+    frame.fileName = graph->string(graph->node(node).fileName);
 
-    auto popCurrent = [&customStack, &customSet]() {
-        if (!customStack.isEmpty()) {
-            const QString current = customStack.takeLast();
-            customSet.remove(current);
+    // Add to scanning stack
+    path.stack.append(key);
+    path.set.insert(key);
+    if (frame.rescan) {
+        path.rescanning.append(node);
+    }
+
+    frame.exists = QFileInfo::exists(filePath);
+    if (frame.exists) {
+        frame.peInfo = parseShared(filePath);
+        if (frame.peInfo.isValid) {
+            LOG_DEBUG("DependencyScanner", QString("解析成功: %1, 架构: %2, 依赖数: %3")
+                .arg(frame.fileName)
+                .arg(PEParser::architectureToString(frame.peInfo.arch))
+                .arg(frame.peInfo.imports.size()));
+        } else {
+            LOG_ERROR("DependencyScanner", QString("PE解析失败: %1").arg(filePath));
         }
-    };
+    }
+    return true;
+}
 
-    // Create node
-    NodePtr node(new DependencyNode());
-    node->filePath = filePath;
-    node->fileName = QFileInfo(filePath).fileName();
-    node->parent = parent;
-    node->depth = depth;
+DependencyGraph::Edge DependencyScanner::leaveModule(WalkFrame* frame, const ResolverContext& context,
+                                                     bool includeSystemDLLs, ScanPath& path)
+{
+    DependencyGraph* graph = m_graph.data();
+    StringTable& strings = graph->strings();
+    const PEParser::PEInfo& peInfo = frame->peInfo;
 
-    // Check if file exists
-    QFileInfo fileInfo(filePath);
-    node->exists = fileInfo.exists();
+    // Delay-load imports are resolved now but expanded on demand
+    if (peInfo.isValid && !isCancelled()) {
+        appendDelayLoadEdges(&frame->edges, peInfo, context, includeSystemDLLs, path);
+    }
 
-    if (!node->exists) {
-        popCurrent();
-        return node;
+    // Published under the lock, which cycle checks of other walks hold while reading edges
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        DependencyGraph::Node& published = graph->node(frame->node);
+        published.exists = frame->exists;
+        if (peInfo.isValid) {
+            published.setArch(peInfo.arch);
+            published.fileVersion = strings.intern(peInfo.fileVersion);
+            published.productVersion = strings.intern(peInfo.productVersion);
+            published.contentDigest = peInfo.contentDigest;
+        }
+        graph->setEdges(frame->node, frame->edges);
+        published.delayPending = false;
+        if (m_maxDepth > 0) {
+            m_moduleDepths.insert(frame->node, frame->depth);
+        }
+        if (frame->rescan) {
+            m_rescanning.remove(frame->node);
+        } else {
+            m_cache.insert(frame->key, frame->node);
+        }
     }
-    
-    // Parse PE file
-    PEParser::PEInfo peInfo = PEParser::parsePEFile(filePath);
-    if (!peInfo.isValid) {
-        LOG_DEBUG("DependencyScanner", QString("PE解析失败: %1").arg(filePath));
-        popCurrent();
-        return node;
+
+    // Remove from scanning stack
+    path.stack.removeLast();
+    path.set.remove(frame->key);
+    if (frame->rescan) {
+        path.rescanning.removeLast();
     }
-    
-    node->arch = peInfo.arch;
-    node->fileVersion = peInfo.fileVersion;
-    node->productVersion = peInfo.productVersion;
-    
-    // Check architecture mismatch with parent
-    if (parent && parent->arch != PEParser::Unknown && node->arch != PEParser::Unknown) {
-        if (parent->arch == PEParser::x64 && node->arch == PEParser::x86) {
-            node->archMismatch = true;
-            LOG_DEBUG("DependencyScanner", QString("架构不匹配: %1 (x64) -> %2 (x86)")
-                .arg(parent->fileName)
-                .arg(node->fileName));
-        }
+
+    DependencyGraph::Edge edge;
+    edge.node = frame->node;
+    return edge;
+}
+
+bool DependencyScanner::nextImport(WalkFrame* frame, const ResolverContext& context,
+                                   bool includeSystemDLLs, const ScanPath& path, QString* childPath)
+{
+    const PEParser::PEInfo& peInfo = frame->peInfo;
+    if (!peInfo.isValid) {
+        return false;
     }
-    
-    // Scan dependencies
-    for (const QString& dllName : peInfo.dependencies) {
-        if (isCancelled()) {
-            break;
-        }
+
+    // Import names are views into peInfo.image; no copies unless a node needs one
+    while (frame->nextImport < peInfo.imports.size() && !isCancelled()) {
+        const int i = frame->nextImport++;
+        const PEParser::ImportName& dllName = peInfo.imports.at(i);
 
         // Skip system DLLs to reduce noise (unless user wants to see them)
         if (!includeSystemDLLs && PathResolver::isSystemDLL(dllName)) {
             continue;
         }
-        
+
         // Resolve DLL path
-        PathResolver::ResolveResult resolveResult = PathResolver::resolveDLLPath(dllName, appDir);
-        
-        NodePtr childNode;
+        const PathResolver::ResolveResult resolveResult =
+            PathResolver::resolveDLLPath(dllName, context, peInfo.arch == PEParser::x86);
+        frame->childImport = i;
+        if (resolveResult.found && !resolveResult.fromTargetProfile) {
+            frame->childPath = resolveResult.foundPath;
+            *childPath = resolveResult.foundPath;
+            return true;
+        }
 
-        if (resolveResult.found) {
-            // Recursively scan the dependency
-            childNode = scanFileWithCustomStack(resolveResult.foundPath, appDir, node, depth + 1, includeSystemDLLs, customStack, customSet);
-        } else {
-            // DLL not found
-            childNode = NodePtr(new DependencyNode());
-            childNode->filePath = dllName;
-            childNode->fileName = dllName;
-            childNode->exists = false;
-            childNode->parent = node;
-            childNode->depth = depth + 1;
+        // A DLL that lives on the target machine only is listed, but not parsed
+        DependencyGraph::Edge edge;
+        edge.node = resolveResult.fromTargetProfile ? targetProfileNode(resolveResult)
+                                                    : missingNode(dllName.toString());
+        frame->childPath.clear();
+        addImportEdge(frame, edge, context, path);
+    }
+
+    // Modules reached through forwarded exports are real dependencies as well
+    if (!frame->forwardersListed) {
+        frame->forwarders = hiddenDependencies(peInfo.filePath, frame->edges, frame->forwardedModules,
+                                               includeSystemDLLs);
+        frame->forwardersListed = true;
+    }
+    while (frame->nextForwarder < frame->forwarders.size() && !isCancelled()) {
+        const PathResolver::ResolveResult& module = frame->forwarders.at(frame->nextForwarder++);
+        frame->childImport = -1;
+        if (module.found && !module.fromTargetProfile) {
+            frame->childPath = module.foundPath;
+            *childPath = module.foundPath;
+            return true;
+        }
+
+        DependencyGraph::Edge edge;
+        edge.node = module.fromTargetProfile ? targetProfileNode(module) : missingNode(module.dllName);
+        frame->childPath.clear();
+        addImportEdge(frame, edge, context, path);
+    }
+    return false;
+}
+
+void DependencyScanner::addImportEdge(WalkFrame* frame, DependencyGraph::Edge edge,
+                                      const ResolverContext& context, const ScanPath& path)
+{
+    if (edge.isNull()) {
+        return;
+    }
+
+    if (frame->childImport < 0) {
+        edge.viaForwarder = true;
+    } else if (!frame->childPath.isEmpty()) {
+        // Per-edge state: a shared DLL may lack functions for one importer only
+        edge.symbolList = m_graph->addSymbolList(
+            checkImportedSymbols(frame->childPath, frame->peInfo.importSymbols.value(frame->childImport),
+                                 context, frame->peInfo.arch == PEParser::x86, &frame->forwardedModules));
+    }
+
+    // A claimed module may not be parsed yet; a graph scan checks after the last job
+    if (!path.graphScan) {
+        markArchMismatch(&edge, *m_graph, frame->fileName, frame->peInfo.arch);
+    }
+    frame->edges.append(edge);
+}
+
+PEParser::HeaderProbe DependencyScanner::probeRootFile(const QString& filePath)
+{
+    // Cheap first-page check before the expensive parse/resolve stages
+    const PEParser::HeaderProbe probe = PEParser::probeHeader(filePath);
+    m_filesProbed.ref();
+
+    if (probe.kind == PEParser::NotPE) {
+        m_rejectedFiles.ref();
+        LOG_DEBUG("DependencyScanner", QString("跳过非PE文件: %1").arg(filePath));
+    } else if (probe.kind == PEParser::NoImports) {
+        // Nothing to resolve: the file is a leaf of the dependency tree
+        m_leafFiles.ref();
+    }
+    return probe;
+}
+
+DependencyScanner::Index DependencyScanner::leafNode(const QString& filePath, const PEParser::HeaderProbe& probe)
+{
+    // The version resource is read in place; no import or export parsing
+    const QPair<QString, QString> versions = PEParser::getVersionInfo(filePath);
+
+    // Through the cache, so a leaf root that another root imports stays one node
+    StringTable& strings = m_graph->strings();
+    const StringTable::Id pathId = strings.intern(filePath);
+    const StringTable::Id key = strings.folded(pathId);
+    QMutexLocker locker(&m_cacheMutex);
+    Index node = m_cache.value(key, DependencyGraph::NoIndex);
+    if (node != DependencyGraph::NoIndex && !m_graph->node(node).delayPending) {
+        return node;
+    }
+    if (node == DependencyGraph::NoIndex) {
+        node = addGraphNode(pathId, strings.intern(QFileInfo(filePath).fileName()));
+        if (node == DependencyGraph::NoIndex) {
+            return node;
         }
-        
-        if (childNode) {
-            node->children.append(childNode);
+        m_cache.insert(key, node);
+    }
+    DependencyGraph::Node& leaf = m_graph->node(node);
+    leaf.setArch(probe.arch);
+    leaf.fileVersion = strings.intern(versions.first);
+    leaf.productVersion = strings.intern(versions.second);
+    leaf.exists = true;
+    leaf.delayPending = false;
+    return node;
+}
+
+DependencyGraph::Edge DependencyScanner::claimModule(const QString& filePath, int depth, const ScanPath& path, int root)
+{
+    DependencyGraph::Edge edge;
+    if (m_maxDepth > 0 && depth > m_maxDepth) {
+        LOG_WARNING("DependencyScanner", QString("达到最大扫描深度: %1").arg(filePath));
+        return edge;
+    }
+
+    DependencyGraph* graph = m_graph.data();
+    StringTable& strings = graph->strings();
+    const StringTable::Id pathId = strings.intern(filePath);
+    const StringTable::Id key = strings.folded(pathId);
+
+    QMutexLocker locker(&m_cacheMutex);
+    Index node = m_cache.value(key, DependencyGraph::NoIndex);
+    if (node != DependencyGraph::NoIndex && m_moduleStates.contains(node)) {
+        // Claimed already; the job that parses it may still be queued
+        edge.node = node;
+        if (m_maxDepth > 0 && depth < m_moduleDepths.value(node)) {
+            // A queued job reads the new depth when it starts; a started one
+            // may have cut imports this claim keeps, so the module is queued
+            // again and the stale job drops its result
+            m_moduleDepths.insert(node, depth);
+            if (m_moduleStates.value(node) != ModuleClaimed) {
+                m_moduleStates.insert(node, ModuleClaimed);
+                ScanJob job;
+                job.node = node;
+                job.context = path.context;
+                job.depth = depth;
+                path.graphScan->queue.push(path.worker, job);
+            }
         }
+        return edge;
     }
-    
-    // Cache the node (thread-safe)
+    if (node == DependencyGraph::NoIndex) {
+        node = addGraphNode(pathId, strings.intern(QFileInfo(filePath).fileName()));
+        if (node == DependencyGraph::NoIndex) {
+            return edge;
+        }
+        m_cache.insert(key, node);
+    } else {
+        // Only delay-loaded so far: its edges are scanned in place
+        graph->node(node).delayPending = false;
+    }
+    m_moduleStates.insert(node, ModuleClaimed);
+    if (m_maxDepth > 0) {
+        m_moduleDepths.insert(node, depth);
+    }
+    edge.node = node;
+
+    ScanJob job;
+    job.node = node;
+    job.context = path.context;
+    job.depth = depth;
+    job.root = root;
+    path.graphScan->queue.push(path.worker, job);
+    return edge;
+}
+
+void DependencyScanner::runScanJob(const ScanJob& job, GraphScan* scan, int worker)
+{
+    if (isCancelled()) {
+        return;
+    }
+
+    DependencyGraph* graph = m_graph.data();
+    StringTable& strings = graph->strings();
+    int depth = job.depth;
     {
         QMutexLocker locker(&m_cacheMutex);
-        m_cache.insert(lowerPath, QWeakPointer<DependencyNode>(node));
+        Q_ASSERT(m_moduleStates.value(job.node) == ModuleClaimed);
+        m_moduleStates.insert(job.node, ModuleInProgress);
+        if (m_maxDepth > 0) {
+            depth = m_moduleDepths.value(job.node);
+        }
     }
-    
-    // Remove from scanning stack
-    popCurrent();
-    
-    return node;
+    const QString filePath = graph->string(graph->node(job.node).filePath);
+    const QString fileName = graph->string(graph->node(job.node).fileName);
+
+    bool exists = true;
+    WalkFrame frame;
+    frame.node = job.node;
+    frame.depth = depth;
+    frame.fileName = fileName;
+    PEParser::HeaderProbe probe;
+    probe.kind = PEParser::NeedsFullParse;
+    if (job.root >= 0) {
+        const int current = scan->rootsStarted.fetchAndAddAcquire(1) + 1;
+        QMetaObject::invokeMethod(this, "scanProgress",
+            Qt::QueuedConnection,
+            Q_ARG(int, current),
+            Q_ARG(int, scan->files.size()),
+            Q_ARG(QString, fileName));
+        probe = probeRootFile(filePath);
+        if (probe.kind == PEParser::NotPE) {
+            // Dropped from the results; importers still link the node
+            scan->roots[job.root] = DependencyGraph::NoIndex;
+        }
+    } else {
+        exists = QFileInfo::exists(filePath);
+    }
+
+    if (exists && probe.kind != PEParser::NotPE && probe.kind != PEParser::NoImports) {
+        frame.peInfo = parseShared(filePath);
+        if (frame.peInfo.isValid) {
+            LOG_DEBUG("DependencyScanner", QString("解析成功: %1, 架构: %2, 依赖数: %3")
+                .arg(fileName)
+                .arg(PEParser::architectureToString(frame.peInfo.arch))
+                .arg(frame.peInfo.imports.size()));
+            // Imports are claimed instead of walked; their jobs parse them
+            ScanPath path;
+            path.graphScan = scan;
+            path.worker = worker;
+            path.context = job.context;
+            const ResolverContext& context = scan->contexts.at(job.context);
+            QString childPath;
+            while (nextImport(&frame, context, scan->includeSystemDLLs, path, &childPath)) {
+                addImportEdge(&frame, claimModule(childPath, depth + 1, path), context, path);
+            }
+            if (!isCancelled()) {
+                appendDelayLoadEdges(&frame.edges, frame.peInfo, context, scan->includeSystemDLLs, path);
+            }
+        } else {
+            LOG_ERROR("DependencyScanner", QString("PE解析失败: %1").arg(filePath));
+        }
+    }
+
+    const PEParser::PEInfo& peInfo = frame.peInfo;
+    QPair<QString, QString> leafVersions;
+    if (probe.kind == PEParser::NoImports) {
+        leafVersions = PEParser::getVersionInfo(filePath);
+    }
+    QMutexLocker locker(&m_cacheMutex);
+    if (m_maxDepth > 0 && m_moduleDepths.value(job.node) != depth) {
+        // A shallower claim queued the module again; that job publishes it
+        return;
+    }
+    DependencyGraph::Node& published = graph->node(job.node);
+    published.exists = exists;
+    if (peInfo.isValid) {
+        published.setArch(peInfo.arch);
+        published.fileVersion = strings.intern(peInfo.fileVersion);
+        published.productVersion = strings.intern(peInfo.productVersion);
+        published.contentDigest = peInfo.contentDigest;
+    } else if (probe.kind == PEParser::NoImports) {
+        published.setArch(probe.arch);
+        published.fileVersion = strings.intern(leafVersions.first);
+        published.productVersion = strings.intern(leafVersions.second);
+    }
+    graph->setEdges(job.node, frame.edges);
+    m_moduleStates.insert(job.node, ModuleDone);
 }
 
-bool DependencyScanner::hasCircularDependency(const DependencyScanner::NodePtr& node)
+void DependencyScanner::finishGraphScan(const QVector<Index>& roots)
 {
-    if (!node) return false;
-    
-    // Check if this node's file path is in the scanning set
-    return m_scanningSet.contains(node->filePath.toLower());
+    // Jobs link modules without knowing the import chain, so imports may close
+    // cycles. The walk cuts each one at the import back into a module on its
+    // path, where a sequential walk of the same roots would have cut it.
+    DependencyGraph* graph = m_graph.data();
+    enum Mark { Unvisited, OnPath, Finished };
+    QVector<quint8> marks(graph->nodeCount(), Unvisited);
+    struct Frame {
+        Index node;
+        quint32 next;
+    };
+    QVector<Frame> stack;
+    for (Index root : roots) {
+        if (root == DependencyGraph::NoIndex || marks.at(int(root)) != Unvisited) {
+            continue;
+        }
+        marks[int(root)] = OnPath;
+        stack.append(Frame{root, 0});
+        while (!stack.isEmpty()) {
+            Frame& top = stack.last();
+            const DependencyGraph::Node& current = graph->node(top.node);
+            if (top.next == current.edgeCount) {
+                marks[int(top.node)] = Finished;
+                stack.removeLast();
+                continue;
+            }
+            DependencyGraph::Edge& edge = graph->edgesOf(top.node)[top.next++];
+            // Placeholders added below lie past the marks and have no edges
+            if (edge.circular || edge.node >= Index(marks.size())) {
+                continue;
+            }
+            if (marks.at(int(edge.node)) == OnPath) {
+                LOG_DEBUG("DependencyScanner", QString("检测到循环依赖: %1")
+                    .arg(graph->string(graph->node(edge.node).filePath)));
+                // A full graph has no room for the placeholder; the cycle is cut all the same
+                const Index placeholder = placeholderNode(graph->node(edge.node).filePath);
+                if (placeholder != DependencyGraph::NoIndex) {
+                    edge.node = placeholder;
+                }
+                edge.circular = true;
+            } else if (marks.at(int(edge.node)) == Unvisited) {
+                marks[int(edge.node)] = OnPath;
+                stack.append(Frame{edge.node, 0});
+            }
+        }
+    }
+
+    // Every module is parsed now, so the architectures of both ends are known
+    for (Index module : graph->modules(roots)) {
+        const DependencyGraph::Node& importer = graph->node(module);
+        DependencyGraph::Edge* edges = graph->edgesOf(module);
+        for (quint32 i = 0; i < importer.edgeCount; ++i) {
+            markArchMismatch(&edges[i], *graph, graph->string(importer.fileName), importer.arch());
+        }
+    }
 }
 
-void DependencyScanner::clearCache()
+void DependencyScanner::appendDelayLoadEdges(QVector<DependencyGraph::Edge>* edges, const PEParser::PEInfo& peInfo,
+                                             const ResolverContext& context, bool includeSystemDLLs,
+                                             const ScanPath& path)
 {
-    m_cancelled.storeRelease(0);
-    m_scanningStack.clear();
-    m_scanningSet.clear();
-    m_cache.clear();
+    DependencyGraph* graph = m_graph.data();
+    for (const PEParser::ImportName& dllName : peInfo.delayImports) {
+        // A DLL that is also imported normally is already in the graph
+        bool alsoImported = false;
+        for (const PEParser::ImportName& imported : peInfo.imports) {
+            if (NameFolding::equals(imported, dllName)) {
+                alsoImported = true;
+                break;
+            }
+        }
+        if (alsoImported) {
+            continue;
+        }
+
+        if (!includeSystemDLLs && PathResolver::isSystemDLL(dllName)) {
+            continue;
+        }
+
+        // Resolve only; missing delay-load DLLs still show up in the missing report
+        const PathResolver::ResolveResult resolveResult =
+            PathResolver::resolveDLLPath(dllName, context, peInfo.arch == PEParser::x86);
+
+        DependencyGraph::Edge edge;
+        edge.delayLoad = true;
+        if (resolveResult.fromTargetProfile) {
+            edge.node = targetProfileNode(resolveResult);
+        } else if (resolveResult.found) {
+            // The module's node if the graph has one; otherwise a pending node,
+            // scanned in place by a later import or by expandDelayLoad
+            const StringTable::Id pathId = graph->strings().intern(resolveResult.foundPath);
+            const StringTable::Id key = graph->strings().folded(pathId);
+            if (path.set.contains(key)) {
+                edge.node = placeholderNode(pathId);
+                edge.circular = true;
+            } else {
+                QMutexLocker locker(&m_cacheMutex);
+                const Index cached = m_cache.value(key, DependencyGraph::NoIndex);
+                if (cached != DependencyGraph::NoIndex && !m_rescanning.contains(cached)) {
+                    if (!path.rescanning.isEmpty() && graph->reaches(cached, path.rescanning)) {
+                        edge.node = placeholderNode(pathId);
+                        edge.circular = true;
+                    } else {
+                        edge.node = cached;
+                    }
+                } else {
+                    // Its own node, not a shared placeholder: a later scan fills it in
+                    edge.node = addGraphNode(pathId,
+                        graph->strings().intern(QFileInfo(resolveResult.foundPath).fileName()));
+                    if (edge.node != DependencyGraph::NoIndex) {
+                        graph->node(edge.node).exists = true;
+                        graph->node(edge.node).delayPending = true;
+                        m_deferredDelayLoads.ref();
+                        if (cached == DependencyGraph::NoIndex) {
+                            m_cache.insert(key, edge.node);
+                        }
+                    }
+                }
+            }
+        } else {
+            edge.node = missingNode(dllName.toString());
+        }
+        if (!edge.isNull()) {
+            edges->append(edge);
+        }
+    }
 }
 
-void DependencyScanner::cancel()
+DependencyScanner::Index DependencyScanner::targetProfileNode(const PathResolver::ResolveResult& result)
 {
-    m_cancelled.storeRelease(1);
+    StringTable& strings = m_graph->strings();
+    return sharedNode(&m_targetProfileNodes, strings.intern(result.foundPath),
+                      strings.intern(QFileInfo(result.foundPath).fileName()), true,
+                      strings.intern(result.fileVersion));
 }
 
-bool DependencyScanner::isCancelled() const
+DependencyScanner::Index DependencyScanner::missingNode(const QString& dllName)
 {
-    return m_cancelled.loadAcquire() != 0;
+    const StringTable::Id name = m_graph->strings().intern(dllName);
+    return sharedNode(&m_missingNodes, name, name, false);
 }
 
-DependencyScanner::NodePtr DependencyScanner::scanFileRecursive(const QString& filePath,
-                                                                        const QString& appDir,
-                                                                        const DependencyScanner::NodePtr& parent,
-                                                                        int depth,
-                                                                        bool includeSystemDLLs)
+DependencyScanner::Index DependencyScanner::placeholderNode(StringTable::Id filePath)
 {
-    // Check for cancellation
-    if (isCancelled()) {
-        return NodePtr();
-    }
-
-    // Limit recursion depth to prevent stack overflow
-    const int MAX_DEPTH = 50;
-    if (depth > MAX_DEPTH) {
-        LOG_WARNING("DependencyScanner", QString("达到最大递归深度: %1").arg(filePath));
-        return NodePtr();
-    }
-
-    // Check for circular dependency
-    QString lowerPath = filePath.toLower();
-    if (m_scanningSet.contains(lowerPath)) {
-        // Circular dependency detected
-        LOG_WARNING("DependencyScanner", QString("检测到循环依赖: %1").arg(filePath));
-        NodePtr node(new DependencyNode());
-        node->filePath = filePath;
-        node->fileName = QFileInfo(filePath).fileName();
-        node->exists = true;
-        node->parent = parent;
-        node->depth = depth;
-        return node;
+    StringTable& strings = m_graph->strings();
+    return sharedNode(&m_placeholderNodes, filePath,
+                      strings.intern(QFileInfo(strings.string(filePath)).fileName()), true);
+}
+
+DependencyScanner::Index DependencyScanner::sharedNode(QHash<StringTable::Id, Index>* nodes, StringTable::Id filePath,
+                                                       StringTable::Id fileName, bool exists,
+                                                       StringTable::Id fileVersion)
+{
+    // Filled in before it is handed out; such nodes never change afterwards
+    const StringTable::Id key = m_graph->strings().folded(filePath);
+    QMutexLocker locker(&m_sharedNodesMutex);
+    Index node = nodes->value(key, DependencyGraph::NoIndex);
+    if (node == DependencyGraph::NoIndex) {
+        node = addGraphNode(filePath, fileName);
+        if (node != DependencyGraph::NoIndex) {
+            m_graph->node(node).exists = exists;
+            m_graph->node(node).fileVersion = fileVersion;
+            nodes->insert(key, node);
+        }
     }
+    return node;
+}
 
-    // Check cache
+DependencyScanner::Index DependencyScanner::addGraphNode(StringTable::Id filePath, StringTable::Id fileName)
+{
+    // Past the fixed node and string tables the scan stops as if cancelled;
+    // the graph keeps the modules added so far
+    const Index node = m_graph->addNode(filePath, fileName);
+    if (node == DependencyGraph::NoIndex && m_graphFull.testAndSetOrdered(0, 1)) {
+        LOG_ERROR("DependencyScanner", QString("依赖图已满 (节点: %1, 字符串: %2)，扫描已中止")
+            .arg(m_graph->nodeCount()).arg(m_graph->strings().count()));
+        m_cancelled.storeRelease(1);
+    }
+    return node;
+}
+
+PEParser::PEInfo DependencyScanner::parseShared(const QString& filePath)
+{
+    // Copies have equal sizes; a file of a size not seen before is just parsed
+    QSharedPointer<WindowedImageGuard> source(new WindowedImageGuard(filePath));
+    bool sizeSeen = false;
     {
-        QMutexLocker locker(&m_cacheMutex);
-        if (m_cache.contains(lowerPath)) {
-            // Fast path: avoid deep subtree cloning on repeated dependencies.
-            // This keeps scan latency stable for large dependency graphs.
-            QSharedPointer<DependencyNode> cached = m_cache.value(lowerPath).toStrongRef();
-            if (cached) {
-                return cloneNodeDeep(cached.data(), parent, depth);
+        QMutexLocker locker(&m_parsedImagesMutex);
+        sizeSeen = m_seenSizes.contains(source->size());
+        if (!sizeSeen) {
+            m_seenSizes.insert(source->size());
+        }
+    }
+
+    // Files mapped whole are keyed by their digest, from the mapping the parse
+    // uses anyway. Windowed ones by their first page; a hit is confirmed with
+    // a full digest, so only copies pay for reading a large file through.
+    ContentKey key(0, source->size());
+    if (sizeSeen) {
+        if (source->isWholeMapped()) {
+            key.first = source->contentDigest();
+        } else if (const uchar* prefix = source->map(0, SHARING_PREFIX_SIZE)) {
+            key.first = ContentDigest::compute(prefix, SHARING_PREFIX_SIZE);
+        }
+    }
+    if (key.first != 0) {
+        SharedParse shared;
+        bool found = false;
+        {
+            QMutexLocker locker(&m_parsedImagesMutex);
+            auto it = m_parsedImages.constFind(key);
+            if (it != m_parsedImages.constEnd()) {
+                shared = it.value();
+                found = true;
+            }
+        }
+        quint64 digest = key.first;
+        if (found && !source->isWholeMapped()) {
+            digest = source->contentDigest();
+            if (digest != 0 && shared.contentDigest == 0) {
+                shared.contentDigest = PEParser::getContentDigest(shared.filePath);
+                QMutexLocker locker(&m_parsedImagesMutex);
+                auto it = m_parsedImages.find(key);
+                if (it != m_parsedImages.end()) {
+                    it->contentDigest = shared.contentDigest;
+                }
             }
+            found = digest != 0 && digest == shared.contentDigest;
+        }
+        if (found) {
+            // Byte-identical copy, e.g. the same vendor DLL in another app folder
+            m_sharedParses.ref();
+            PEParser::PEInfo info = shared.info;
+            info.filePath = filePath;
+            info.modifiedTime = QFileInfo(filePath).lastModified();
+            info.contentDigest = digest;
+            return info;
         }
     }
 
-    // Add to scanning stack
-    m_scanningStack.append(lowerPath);
-    m_scanningSet.insert(lowerPath);
+    m_modulesParsed.ref();
+    const PEParser::PEInfo info = PEParser::parsePEFile(source, PEParser::ParseImportSymbols |
+                                                                PEParser::ParseContentDigest);
+    if (key.first != 0 && info.isValid) {
+        SharedParse shared;
+        shared.info = info;
+        PEParser::detachImports(&shared.info);
+        shared.filePath = filePath;
+        shared.contentDigest = info.contentDigest;
+        QMutexLocker locker(&m_parsedImagesMutex);
+        if (m_parsedImages.size() < MAX_SHARED_IMAGES && !m_parsedImages.contains(key)) {
+            m_parsedImages.insert(key, shared);
+        }
+    }
+    return info;
+}
 
-    auto popCurrent = [this]() {
-        if (!m_scanningStack.isEmpty()) {
-            const QString current = m_scanningStack.takeLast();
-            m_scanningSet.remove(current);
+QSharedPointer<const ExportIndex> DependencyScanner::exportIndexFor(const QString& filePath)
+{
+    StringTable& strings = m_graph->strings();
+    const StringTable::Id key = strings.folded(strings.intern(filePath));
+    {
+        QMutexLocker locker(&m_exportIndexMutex);
+        auto it = m_exportIndexes.constFind(key);
+        if (it != m_exportIndexes.constEnd()) {
+            return it.value();
         }
-    };
+    }
 
-    // Create node
-    NodePtr node(new DependencyNode());
-    node->filePath = filePath;
-    node->fileName = QFileInfo(filePath).fileName();
-    node->parent = parent;
-    node->depth = depth;
+    // Parsed once per DLL and scan, then shared by all importers
+    QSharedPointer<const ExportIndex> index = PEParser::getExportIndex(filePath);
 
-    // Check if file exists
-    QFileInfo fileInfo(filePath);
-    node->exists = fileInfo.exists();
+    QMutexLocker locker(&m_exportIndexMutex);
+    auto it = m_exportIndexes.constFind(key);
+    if (it != m_exportIndexes.constEnd()) {
+        return it.value();
+    }
+    m_exportIndexes.insert(key, index);
+    return index;
+}
 
-    if (!node->exists) {
-        popCurrent();
-        return node;
+QStringList DependencyScanner::checkImportedSymbols(const QString& dllPath,
+                                                    const QVector<PEImage::ImportedSymbol>& symbols,
+                                                    const ResolverContext& context, bool wow64,
+                                                    QList<PathResolver::ResolveResult>* forwardedModules)
+{
+    QStringList missing;
+    if (symbols.isEmpty()) {
+        return missing;
     }
-    
-    // Parse PE file
-    PEParser::PEInfo peInfo = PEParser::parsePEFile(filePath);
-    if (!peInfo.isValid) {
-        LOG_ERROR("DependencyScanner", QString("PE解析失败: %1").arg(filePath));
-        popCurrent();
-        return node;
+
+    const QSharedPointer<const ExportIndex> index = exportIndexFor(dllPath);
+    if (!index) {
+        return missing;
     }
-    
-    node->arch = peInfo.arch;
-    node->fileVersion = peInfo.fileVersion;
-    node->productVersion = peInfo.productVersion;
-    
-    LOG_DEBUG("DependencyScanner", QString("解析成功: %1, 架构: %2, 依赖数: %3")
-        .arg(node->fileName)
-        .arg(PEParser::architectureToString(node->arch))
-        .arg(peInfo.dependencies.size()));
-    
-    // Check architecture mismatch with parent
-    if (parent && parent->arch != PEParser::Unknown && node->arch != PEParser::Unknown) {
-        // x64 cannot load x86 DLLs (but x86 can load x86 DLLs on x64 system via WOW64)
-        if (parent->arch == PEParser::x64 && node->arch == PEParser::x86) {
-            node->archMismatch = true;
-            LOG_WARNING("DependencyScanner", QString("架构不匹配: %1 (x64) -> %2 (x86)")
-                .arg(parent->fileName)
-                .arg(node->fileName));
+
+    for (const PEImage::ImportedSymbol& symbol : symbols) {
+        const ExportIndex::Entry* entry = index->find(symbol);
+        const QString symbolName = symbol.name.data ? QString::fromLatin1(symbol.name.data, symbol.name.length)
+                                                    : QString("#%1").arg(symbol.ordinal);
+        if (!entry) {
+            missing.append(symbolName);
+            continue;
+        }
+        if (!ExportIndex::isForwarded(*entry)) {
+            continue;
+        }
+
+        // Follow the forwarder to the module that really implements the function
+        const ForwardTarget target = resolveForwarder(QString(index->forwarder(*entry)), context, wow64, 0);
+        forwardedModules->append(target.modules);
+        if (!target.brokenHop.isEmpty()) {
+            missing.append(QString("%1 -> %2").arg(symbolName).arg(target.brokenHop));
         }
     }
-    
-    // Scan dependencies
-    for (const QString& dllName : peInfo.dependencies) {
-        if (isCancelled()) {
-            break;
+
+    if (!missing.isEmpty()) {
+        m_missingSymbols.fetchAndAddRelaxed(missing.size());
+        LOG_DEBUG("DependencyScanner", QString("缺少导出函数: %1 (%2)")
+            .arg(dllPath)
+            .arg(missing.join(", ")));
+    }
+    return missing;
+}
+
+DependencyScanner::ForwardTarget DependencyScanner::resolveForwarder(const QString& forwarder,
+                                                                     const ResolverContext& context, bool wow64,
+                                                                     int hops)
+{
+    // Every hop is memoized, so a popular forwarder is walked once per scan.
+    // A chain cut by the hop limit is memoized only where it was entered:
+    // entered at a later hop, the same chain may end within the limit. A
+    // memoized chain too long for the hops left is walked again to the cut.
+    const ForwardKey key((quint64(context.id()) << 1) | (wow64 ? 1 : 0), forwarder);
+    {
+        QMutexLocker locker(&m_forwardMutex);
+        auto it = m_forwardMemo.constFind(key);
+        if (it != m_forwardMemo.constEnd() && (it->hopLimited || hops + it->length < MAX_FORWARD_HOPS)) {
+            return it.value();
         }
+    }
 
-        // Skip system DLLs to reduce noise (unless user wants to see them)
-        if (!includeSystemDLLs && PathResolver::isSystemDLL(dllName)) {
+    ForwardTarget target;
+    const int dot = forwarder.lastIndexOf(QLatin1Char('.'));
+    if (dot <= 0 || dot == forwarder.size() - 1 || hops >= MAX_FORWARD_HOPS) {
+        target.brokenHop = forwarder;
+        target.hopLimited = hops >= MAX_FORWARD_HOPS;
+        return target;
+    }
+
+    // "MODULE.Function" or "MODULE.#Ordinal"; the module name has no extension
+    QString moduleName = forwarder.left(dot);
+    if (!moduleName.contains(QLatin1Char('.'))) {
+        moduleName += QLatin1String(".dll");
+    }
+    const QString symbolName = forwarder.mid(dot + 1);
+
+    const PathResolver::ResolveResult module = PathResolver::resolveDLLPath(moduleName, context, wow64);
+    target.modules.append(module);
+
+    const QSharedPointer<const ExportIndex> index = module.found ? exportIndexFor(module.foundPath)
+                                                                 : QSharedPointer<const ExportIndex>();
+    const ExportIndex::Entry* entry = nullptr;
+    if (index) {
+        if (symbolName.startsWith(QLatin1Char('#'))) {
+            entry = index->findOrdinal(symbolName.mid(1).toUInt());
+        } else {
+            const QByteArray latin1 = symbolName.toLatin1();
+            entry = index->findName(latin1.constData(), latin1.size());
+        }
+    }
+
+    if (!entry) {
+        // Exports of target-side DLLs are not captured, so their forwarders are trusted
+        if (!module.fromTargetProfile) {
+            target.brokenHop = forwarder;
+        }
+    } else if (ExportIndex::isForwarded(*entry)) {
+        const ForwardTarget next = resolveForwarder(QString(index->forwarder(*entry)), context, wow64, hops + 1);
+        target.modules.append(next.modules);
+        target.brokenHop = next.brokenHop;
+        target.length = next.length + 1;
+        target.hopLimited = next.hopLimited;
+    }
+
+    if (!target.hopLimited || hops == 0) {
+        QMutexLocker locker(&m_forwardMutex);
+        m_forwardMemo.insert(key, target);
+    }
+    return target;
+}
+
+QList<PathResolver::ResolveResult> DependencyScanner::hiddenDependencies(
+    const QString& filePath, const QVector<DependencyGraph::Edge>& edges,
+    const QList<PathResolver::ResolveResult>& forwardedModules, bool includeSystemDLLs)
+{
+    QList<PathResolver::ResolveResult> hidden;
+    StringTable& strings = m_graph->strings();
+    QSet<StringTable::Id> seen;
+    seen.insert(strings.folded(strings.intern(filePath)));
+    for (const DependencyGraph::Edge& edge : edges) {
+        seen.insert(strings.folded(m_graph->node(edge.node).filePath));
+    }
+
+    for (const PathResolver::ResolveResult& module : forwardedModules) {
+        const StringTable::Id key = strings.folded(strings.intern(module.found ? module.foundPath : module.dllName));
+        if (seen.contains(key)) {
             continue;
         }
-        
-        // Resolve DLL path
-        PathResolver::ResolveResult resolveResult = PathResolver::resolveDLLPath(dllName, appDir);
-        
-        NodePtr childNode;
+        seen.insert(key);
+        if (!includeSystemDLLs && PathResolver::isSystemDLL(module.dllName)) {
+            continue;
+        }
+        hidden.append(module);
+    }
+    return hidden;
+}
 
-        if (resolveResult.found) {
-            // Recursively scan the dependency
-            childNode = scanFileRecursive(resolveResult.foundPath, appDir, node, depth + 1, includeSystemDLLs);
+bool DependencyScanner::expandDelayLoad(const NodeHandle& node, const NodeHandle& root, bool includeSystemDLLs)
+{
+    if (!node || !root || node.graph() != root.graph() || !node.delayPending()) {
+        return false;
+    }
+
+    // New nodes and edges go into the graph of the scan that left node pending.
+    // The resolver cache is process-wide and stays as it is.
+    if (m_graph != node.graph()) {
+        resetScanState(node.graph());
+    }
+
+    // Seed the cache with every module of the graph, under any root of the
+    // scan, so the new edges point at existing nodes and modules that import
+    // node back are cut as cycles. node goes first, to be scanned in place.
+    // Nodes that were never parsed (missing DLLs, target profile entries) stay out.
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        const StringTable& strings = m_graph->strings();
+        m_cache.insert(strings.folded(node.data()->filePath), node.index());
+        const Index count = Index(m_graph->nodeCount());
+        for (Index module = 0; module < count; ++module) {
+            const DependencyNode& seeded = m_graph->node(module);
+            const StringTable::Id key = strings.folded(seeded.filePath);
+            if (seeded.exists && (seeded.delayPending || seeded.arch() != PEParser::Unknown) &&
+                !m_cache.contains(key)) {
+                m_cache.insert(key, module);
+            }
+        }
+    }
+
+    // The application directory is the one of the root file, as in the original scan
+    const ResolverContext context = PathResolver::context(QFileInfo(root.filePath()).absolutePath());
+    ScanPath path;
+    const DependencyGraph::Edge expanded = scanModule(node.filePath(), context, includeSystemDLLs, path);
+    return expanded.node == node.index() && !node.delayPending();
+}
+
+QList<DependencyScanner::NodeHandle> DependencyScanner::modules(const QList<NodeHandle>& roots)
+{
+    // Roots of one scan share a graph; each graph is walked once
+    QList<QSharedPointer<DependencyGraph>> graphs;
+    QList<QVector<Index>> graphRoots;
+    for (const NodeHandle& root : roots) {
+        if (!root) {
+            continue;
+        }
+        const int i = graphs.indexOf(root.graph());
+        if (i < 0) {
+            graphs.append(root.graph());
+            graphRoots.append(QVector<Index>() << root.index());
         } else {
-            // DLL not found
-            childNode = NodePtr(new DependencyNode());
-            childNode->filePath = dllName;
-            childNode->fileName = dllName;
-            childNode->exists = false;
-            childNode->parent = node;
-            childNode->depth = depth + 1;
+            graphRoots[i].append(root.index());
         }
-        
-        if (childNode) {
-            node->children.append(childNode);
+    }
+
+    QList<NodeHandle> result;
+    for (int i = 0; i < graphs.size(); ++i) {
+        for (Index module : graphs.at(i)->modules(graphRoots.at(i))) {
+            result.append(NodeHandle(graphs.at(i), module));
         }
     }
+    return result;
+}
+
+bool DependencyScanner::hasCircularDependency(const DependencyScanner::NodeHandle& node)
+{
+    if (!node || node.graph() != m_graph) return false;
     
-    // Cache the node
+    // Check if this node's file path is in the scanning set
+    return m_scanningPath.set.contains(m_graph->strings().folded(node.data()->filePath));
+}
+
+void DependencyScanner::setMaxDepth(int maxDepth)
+{
+    m_maxDepth = qMax(0, maxDepth);
+}
+
+int DependencyScanner::maxDepth() const
+{
+    return m_maxDepth;
+}
+
+void DependencyScanner::clearCache()
+{
+    resetScanState(QSharedPointer<DependencyGraph>(new DependencyGraph()));
+    PathResolver::clearCache();
+}
+
+void DependencyScanner::resetScanState(const QSharedPointer<DependencyGraph>& graph)
+{
+    m_cancelled.storeRelease(0);
+    m_graphFull.storeRelease(0);
+    m_scanningPath = ScanPath();
     {
+        // Handles returned by earlier scans keep their graph alive
         QMutexLocker locker(&m_cacheMutex);
-        m_cache.insert(lowerPath, QWeakPointer<DependencyNode>(node));
+        m_graph = graph;
+        m_cache.clear();
+        m_rescanning.clear();
+        m_moduleStates.clear();
+        m_moduleDepths.clear();
     }
+    {
+        QMutexLocker locker(&m_sharedNodesMutex);
+        m_missingNodes.clear();
+        m_placeholderNodes.clear();
+        m_targetProfileNodes.clear();
+    }
+    {
+        QMutexLocker locker(&m_exportIndexMutex);
+        m_exportIndexes.clear();
+    }
+    {
+        QMutexLocker locker(&m_forwardMutex);
+        m_forwardMemo.clear();
+    }
+    {
+        QMutexLocker locker(&m_parsedImagesMutex);
+        m_parsedImages.clear();
+        m_seenSizes.clear();
+    }
+    m_filesProbed.storeRelease(0);
+    m_rejectedFiles.storeRelease(0);
+    m_leafFiles.storeRelease(0);
+    m_deferredDelayLoads.storeRelease(0);
+    m_missingSymbols.storeRelease(0);
+    m_sharedParses.storeRelease(0);
+    m_modulesParsed.storeRelease(0);
+}
+
+void DependencyScanner::cancel()
+{
+    m_cancelled.storeRelease(1);
+}
+
+bool DependencyScanner::isCancelled() const
+{
+    return m_cancelled.loadAcquire() != 0;
+}
+
+bool DependencyScanner::isGraphFull() const
+{
+    return m_graphFull.loadAcquire() != 0;
+}
+
+DependencyScanner::ScanStatistics DependencyScanner::statistics() const
+{
+    ScanStatistics stats;
+    stats.filesProbed = m_filesProbed.loadAcquire();
+    stats.rejectedFiles = m_rejectedFiles.loadAcquire();
+    stats.leafFiles = m_leafFiles.loadAcquire();
+    stats.deferredDelayLoads = m_deferredDelayLoads.loadAcquire();
+    stats.missingSymbols = m_missingSymbols.loadAcquire();
+    stats.sharedParses = m_sharedParses.loadAcquire();
+    stats.modulesParsed = m_modulesParsed.loadAcquire();
     
-    // Remove from scanning stack
-    popCurrent();
-    
-    return node;
+    // Resolver counters restart with the scan, which clears the resolver cache
+    const PathResolver::LookupStatistics lookups = PathResolver::lookupStatistics();
+    stats.negativeFilterHits = lookups.missFilterHits;
+    stats.negativeFilterFalsePositives = lookups.missFilterFalsePositives;
+    return stats;
 }
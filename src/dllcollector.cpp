@@ -1,8 +1,10 @@
 #include "dllcollector.h"
 #include "logger.h"
+#include "peparser.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
+#include <QHash>
 
 DLLCollector::DLLCollector(QObject *parent)
     : QObject(parent)
@@ -14,7 +16,7 @@ DLLCollector::~DLLCollector()
 }
 
 DLLCollector::CollectionResult DLLCollector::collectDLLsFromNodes(
-    const QList<DependencyScanner::NodePtr>& nodes,
+    const QList<DependencyScanner::NodeHandle>& nodes,
     const QString& targetDirectory,
     ConflictResolution conflictMode)
 {
@@ -30,7 +32,7 @@ DLLCollector::CollectionResult DLLCollector::collectDLLsFromNodes(
             // 无法创建目标目录
             for (const auto& node : nodes) {
                 if (node) {
-                    result.failedFiles[node->fileName] = tr("Failed to create target directory");
+                    result.failedFiles[node.fileName()] = tr("Failed to create target directory");
                 }
             }
             result.failedCount = result.totalFiles;
@@ -39,6 +41,9 @@ DLLCollector::CollectionResult DLLCollector::collectDLLsFromNodes(
         }
     }
 
+    // 本次已复制文件的内容摘要（小写文件名 -> 摘要），用于跳过相同副本
+    QHash<QString, quint64> collectedDigests;
+
     // 遍历所有需要复制的DLL节点
     int current = 0;
     for (const auto& node : nodes) {
@@ -50,23 +55,40 @@ DLLCollector::CollectionResult DLLCollector::collectDLLsFromNodes(
             continue;
         }
         
-        QString dllName = node->fileName;
-        QString sourcePath = node->filePath;
+        QString dllName = node.fileName();
+        QString sourcePath = node.filePath();
         QString targetPath = targetDir.filePath(dllName);
 
         // 发送进度信号
         emit copyProgress(current, result.totalFiles, dllName);
 
         // 检查源文件是否存在
-        if (!node->exists || !QFile::exists(sourcePath)) {
+        if (!node.exists() || !QFile::exists(sourcePath)) {
             result.failedFiles[dllName] = tr("Source file not found: %1").arg(sourcePath);
             result.failedCount++;
             continue;
         }
 
+        // 同一DLL的相同副本（内容摘要一致）只复制一次
+        const QString digestKey = dllName.toLower();
+        if (node.contentDigest() != 0 && collectedDigests.value(digestKey) == node.contentDigest()) {
+            LOG_DEBUG("DLLCollector", QString("跳过相同副本: %1").arg(sourcePath));
+            result.successFiles.append(dllName);
+            result.successCount++;
+            continue;
+        }
+
         // 检查目标文件是否已存在
         bool shouldCopy = true;
-        if (QFile::exists(targetPath)) {
+        if (QFile::exists(targetPath) && node.contentDigest() != 0 &&
+            QFileInfo(targetPath).size() == QFileInfo(sourcePath).size() &&
+            PEParser::getContentDigest(targetPath) == node.contentDigest()) {
+            // 目标文件与源文件内容相同，无需覆盖或询问
+            shouldCopy = false;
+            result.successFiles.append(dllName);
+            result.successCount++;
+            collectedDigests.insert(digestKey, node.contentDigest());
+        } else if (QFile::exists(targetPath)) {
             if (conflictMode == Skip) {
                 shouldCopy = false;
                 result.successFiles.append(dllName);
@@ -87,6 +109,9 @@ DLLCollector::CollectionResult DLLCollector::collectDLLsFromNodes(
             if (copyDLL(sourcePath, targetPath, conflictMode == Overwrite)) {
                 result.successFiles.append(dllName);
                 result.successCount++;
+                if (node.contentDigest() != 0) {
+                    collectedDigests.insert(digestKey, node.contentDigest());
+                }
             } else {
                 result.failedFiles[dllName] = tr("Failed to copy file");
                 result.failedCount++;
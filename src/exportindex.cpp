@@ -0,0 +1,124 @@
+#include "exportindex.h"
+#include <cstring>
+
+ExportIndex::ExportIndex()
+{
+}
+
+ExportIndex::ExportIndex(const PEImage& image)
+{
+    const QVector<PEImage::ExportedSymbol> symbols = image.exportedSymbols();
+    m_entries.reserve(symbols.size());
+
+    for (const PEImage::ExportedSymbol& symbol : symbols) {
+        Entry entry;
+        entry.ordinal = symbol.ordinal;
+        entry.nameLength = quint16(qMin(symbol.name.length, 0xFFFF));
+        entry.nameOffset = entry.nameLength ? appendText(symbol.name) : 0;
+        entry.hash = hashName(symbol.name.data, entry.nameLength);
+        entry.forwarderLength = quint16(qMin(symbol.forwarder.length, 0xFFFF));
+        entry.forwarderOffset = entry.forwarderLength ? appendText(symbol.forwarder) : 0;
+        m_entries.append(entry);
+    }
+    m_text.squeeze();
+
+    // Two linear-probing tables at most half full
+    const int slots = slotCount(m_entries.size());
+    const quint32 mask = quint32(slots - 1);
+    m_nameSlots.fill(-1, slots);
+    m_ordinalSlots.fill(-1, slots);
+    for (int i = 0; i < m_entries.size(); ++i) {
+        const Entry& entry = m_entries.at(i);
+        if (entry.nameLength) {
+            quint32 slot = entry.hash & mask;
+            while (m_nameSlots.at(int(slot)) >= 0) {
+                slot = (slot + 1) & mask;
+            }
+            m_nameSlots[int(slot)] = i;
+        }
+        quint32 slot = (entry.ordinal * 2654435761u) & mask;
+        while (m_ordinalSlots.at(int(slot)) >= 0) {
+            slot = (slot + 1) & mask;
+        }
+        m_ordinalSlots[int(slot)] = i;
+    }
+}
+
+const ExportIndex::Entry* ExportIndex::findName(const char* name, int length) const
+{
+    if (m_nameSlots.isEmpty() || length <= 0) {
+        return nullptr;
+    }
+
+    const quint32 hash = hashName(name, length);
+    const quint32 mask = quint32(m_nameSlots.size() - 1);
+    for (quint32 slot = hash & mask; m_nameSlots.at(int(slot)) >= 0; slot = (slot + 1) & mask) {
+        const Entry& entry = m_entries.at(m_nameSlots.at(int(slot)));
+        if (entry.hash == hash && entry.nameLength == length &&
+            std::memcmp(m_text.constData() + entry.nameOffset, name, size_t(length)) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const ExportIndex::Entry* ExportIndex::findOrdinal(quint32 ordinal) const
+{
+    if (m_ordinalSlots.isEmpty()) {
+        return nullptr;
+    }
+
+    const quint32 mask = quint32(m_ordinalSlots.size() - 1);
+    for (quint32 slot = (ordinal * 2654435761u) & mask; m_ordinalSlots.at(int(slot)) >= 0;
+         slot = (slot + 1) & mask) {
+        const Entry& entry = m_entries.at(m_ordinalSlots.at(int(slot)));
+        if (entry.ordinal == ordinal) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const ExportIndex::Entry* ExportIndex::find(const PEImage::ImportedSymbol& symbol) const
+{
+    if (symbol.name.data) {
+        return findName(symbol.name.data, symbol.name.length);
+    }
+    return findOrdinal(symbol.ordinal);
+}
+
+QLatin1String ExportIndex::name(const Entry& entry) const
+{
+    return QLatin1String(m_text.constData() + entry.nameOffset, entry.nameLength);
+}
+
+QLatin1String ExportIndex::forwarder(const Entry& entry) const
+{
+    return QLatin1String(m_text.constData() + entry.forwarderOffset, entry.forwarderLength);
+}
+
+quint32 ExportIndex::hashName(const char* name, int length)
+{
+    // FNV-1a; export names are case-sensitive
+    quint32 hash = 2166136261u;
+    for (int i = 0; i < length; ++i) {
+        hash = (hash ^ uchar(name[i])) * 16777619u;
+    }
+    return hash;
+}
+
+int ExportIndex::slotCount(int entries)
+{
+    int slots = 8;
+    while (slots < entries * 2) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+quint32 ExportIndex::appendText(const PEImage::NameRef& text)
+{
+    const quint32 offset = quint32(m_text.size());
+    m_text.append(text.data, qMin(text.length, 0xFFFF));
+    return offset;
+}
@@ -0,0 +1,150 @@
+#include "knowndlls.h"
+#include <QFile>
+#include <QTextStream>
+#ifdef Q_OS_WIN
+#include <QSettings>
+#endif
+
+namespace {
+const char kKnownDllsKey[] = "\\session manager\\knowndlls";
+
+// Value names that configure the list instead of naming a DLL
+bool isDirectoryValue(const QString& valueName)
+{
+    return valueName.compare(QLatin1String("DllDirectory"), Qt::CaseInsensitive) == 0 ||
+           valueName.compare(QLatin1String("DllDirectory32"), Qt::CaseInsensitive) == 0;
+}
+
+// A regedit string starting at *pos ("...", with \\ and \" escapes)
+bool readQuoted(const QString& line, int* pos, QString* text)
+{
+    if (*pos >= line.size() || line.at(*pos) != QLatin1Char('"')) {
+        return false;
+    }
+    text->clear();
+    for (int i = *pos + 1; i < line.size(); ++i) {
+        const QChar ch = line.at(i);
+        if (ch == QLatin1Char('\\') && i + 1 < line.size()) {
+            text->append(line.at(++i));
+        } else if (ch == QLatin1Char('"')) {
+            *pos = i + 1;
+            return true;
+        } else {
+            text->append(ch);
+        }
+    }
+    return false;
+}
+}
+
+QSharedPointer<const KnownDlls> KnownDlls::loadRegistryExport(const QString& filePath, QString* error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = QString("无法打开注册表导出文件: %1").arg(filePath);
+        }
+        return QSharedPointer<const KnownDlls>();
+    }
+
+    // regedit writes UTF-16 with a BOM (REGEDIT4 files are ANSI); QTextStream detects both
+    QTextStream stream(&file);
+    const QString signature = stream.readLine().trimmed();
+    if (signature != QLatin1String("Windows Registry Editor Version 5.00") &&
+        signature != QLatin1String("REGEDIT4")) {
+        if (error) {
+            *error = QString("不是注册表导出文件: %1").arg(filePath);
+        }
+        return QSharedPointer<const KnownDlls>();
+    }
+
+    QStringList names;
+    bool sawKey = false;
+    bool inKey = false;
+    QString line;
+    while (!stream.atEnd()) {
+        line += stream.readLine().trimmed();
+        // A trailing backslash continues the value on the next line
+        if (line.endsWith(QLatin1Char('\\'))) {
+            line.chop(1);
+            continue;
+        }
+
+        if (line.startsWith(QLatin1Char('[')) && line.endsWith(QLatin1Char(']'))) {
+            inKey = !line.startsWith(QLatin1String("[-")) &&
+                    line.mid(1, line.size() - 2).toLower().endsWith(QLatin1String(kKnownDllsKey));
+            sawKey = sawKey || inKey;
+        } else if (inKey) {
+            // "name"="value"; other value types never name a DLL
+            int pos = 0;
+            QString valueName;
+            QString value;
+            if (readQuoted(line, &pos, &valueName) && pos < line.size() && line.at(pos) == QLatin1Char('=')) {
+                ++pos;
+                if (readQuoted(line, &pos, &value) && !value.isEmpty() && !isDirectoryValue(valueName)) {
+                    names.append(value);
+                }
+            }
+        }
+        line.clear();
+    }
+
+    if (!sawKey) {
+        if (error) {
+            *error = QString("注册表导出中没有 KnownDLLs 项: %1").arg(filePath);
+        }
+        return QSharedPointer<const KnownDlls>();
+    }
+    return fromNames(names);
+}
+
+QSharedPointer<const KnownDlls> KnownDlls::fromNames(const QStringList& names)
+{
+    QSharedPointer<KnownDlls> knownDlls(new KnownDlls());
+    for (const QString& name : names) {
+        if (!name.isEmpty() && !knownDlls->contains(name)) {
+            knownDlls->m_index.insert(NameFolding::hash(name), knownDlls->m_names.size());
+            knownDlls->m_names.append(name);
+        }
+    }
+    return knownDlls;
+}
+
+QSharedPointer<const KnownDlls> KnownDlls::readLocalRegistry()
+{
+#ifdef Q_OS_WIN
+    QSettings registry("HKEY_LOCAL_MACHINE\\SYSTEM\\CurrentControlSet\\Control\\Session Manager\\KnownDLLs",
+                       QSettings::NativeFormat);
+    QStringList names;
+    const QStringList valueNames = registry.childKeys();
+    for (const QString& valueName : valueNames) {
+        if (!isDirectoryValue(valueName)) {
+            names.append(registry.value(valueName).toString());
+        }
+    }
+    return fromNames(names);
+#else
+    return QSharedPointer<const KnownDlls>();
+#endif
+}
+
+bool KnownDlls::contains(const QString& name) const
+{
+    const uint hash = NameFolding::hash(name);
+    for (auto it = m_index.constFind(hash); it != m_index.constEnd() && it.key() == hash; ++it) {
+        if (NameFolding::equals(m_names.at(it.value()), name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool KnownDlls::contains(const NameFolding::Name& name) const
+{
+    for (auto it = m_index.constFind(name.hash); it != m_index.constEnd() && it.key() == name.hash; ++it) {
+        if (NameFolding::equals(name.data, name.length, m_names.at(it.value()))) {
+            return true;
+        }
+    }
+    return false;
+}
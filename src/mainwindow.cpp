@@ -2,6 +2,10 @@
 #include "reportgenerator.h"
 #include "dllcollector.h"
 #include "inputvalidator.h"
+#include "pathresolver.h"
+#include "targetprofile.h"
+#include "apisetschema.h"
+#include "knowndlls.h"
 #include "logger.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -11,6 +15,10 @@
 #include <QMessageBox>
 #include <QHeaderView>
 #include <QAction>
+#include <QMenu>
+#include <QToolButton>
+#include <QInputDialog>
+#include <QApplication>
 #include <QCheckBox>
 #include <QProgressDialog>
 #include <QJsonDocument>
@@ -20,6 +28,80 @@
 #include <QUrl>
 #include <QPointer>
 
+namespace {
+// Whether an import below node satisfies hit, cached per module. Walked on an
+// explicit stack, so import chains of any depth are safe on the GUI thread.
+template <typename Hit>
+bool anyImportBelow(const DependencyScanner::NodeHandle& node, const Hit& hit,
+                    QHash<const DependencyScanner::DependencyNode*, bool>* memo)
+{
+    struct Frame {
+        DependencyScanner::NodeHandle node;
+        int next;
+    };
+    auto cached = memo->constFind(node.data());
+    if (cached != memo->constEnd()) {
+        return cached.value();
+    }
+
+    QVector<Frame> stack;
+    stack.append(Frame{node, 0});
+    while (!stack.isEmpty()) {
+        const int top = stack.size() - 1;
+        bool found = false;
+        bool descended = false;
+        while (stack.at(top).next < stack.at(top).node.edgeCount()) {
+            const DependencyScanner::DependencyEdge child = stack.at(top).node.edge(stack[top].next++);
+            if (hit(child)) {
+                found = true;
+                break;
+            }
+            if (child.circular) {
+                continue;
+            }
+            cached = memo->constFind(child.node.data());
+            if (cached == memo->constEnd()) {
+                stack.append(Frame{child.node, 0});
+                descended = true;
+                break;
+            }
+            if (cached.value()) {
+                found = true;
+                break;
+            }
+        }
+        if (descended) {
+            continue;
+        }
+        if (found) {
+            // Every module still on the stack imports this one
+            for (const Frame& frame : stack) {
+                memo->insert(frame.node.data(), true);
+            }
+            return true;
+        }
+        memo->insert(stack.last().node.data(), false);
+        stack.removeLast();
+    }
+    return false;
+}
+
+bool isMissingImport(const DependencyScanner::DependencyEdge& edge)
+{
+    return !edge.node.exists() || !edge.missingSymbols.isEmpty();
+}
+
+// Import of one of a set of DLLs, by file name
+struct ImportOf {
+    const QStringList& dllNames;
+
+    bool operator()(const DependencyScanner::DependencyEdge& edge) const
+    {
+        return dllNames.contains(edge.node.fileName(), Qt::CaseInsensitive);
+    }
+};
+}
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_scanThread(nullptr)
@@ -80,6 +162,36 @@ void MainWindow::setupUI()
     scanFileAction->setToolTip(tr("扫描单个文件的DLL依赖关系"));
     connect(scanFileAction, &QAction::triggered, this, &MainWindow::onScanSingleFile);
     
+    // Resolve system DLLs against another Windows installation
+    QMenu* targetMenu = new QMenu(this);
+    connect(targetMenu->addAction(tr("加载目标配置...")), &QAction::triggered, this, &MainWindow::onLoadTargetProfile);
+    connect(targetMenu->addAction(tr("采集目标配置...")), &QAction::triggered, this, &MainWindow::onCaptureTargetProfile);
+    connect(targetMenu->addAction(tr("加载ApiSet架构...")), &QAction::triggered, this, &MainWindow::onLoadApiSetSchema);
+    connect(targetMenu->addAction(tr("加载KnownDLLs注册表导出...")), &QAction::triggered, this, &MainWindow::onLoadKnownDlls);
+    
+    // Search order of the process being checked
+    QMenu* planMenu = targetMenu->addMenu(tr("DLL搜索顺序"));
+    const QString planNames[] = {
+        tr("标准（SafeDllSearchMode 开启）"),
+        tr("标准（SafeDllSearchMode 关闭）"),
+        tr("SetDllDirectory..."),
+        tr("LOAD_LIBRARY_SEARCH_DEFAULT_DIRS...")
+    };
+    for (int i = 0; i < 4; ++i) {
+        QAction* planAction = planMenu->addAction(planNames[i]);
+        planAction->setData(i);
+        connect(planAction, &QAction::triggered, this, &MainWindow::onSelectSearchPlan);
+    }
+    targetMenu->addSeparator();
+    connect(targetMenu->addAction(tr("使用本机系统")), &QAction::triggered, this, &MainWindow::onUseLocalSystem);
+    m_targetProfileAction = m_toolBar->addAction(QIcon(":/icons/check.svg"), tr("目标系统: 本机"));
+    m_targetProfileAction->setMenu(targetMenu);
+    m_targetProfileAction->setToolTip(tr("按目标机的系统目录解析系统DLL"));
+    QToolButton* targetButton = qobject_cast<QToolButton*>(m_toolBar->widgetForAction(m_targetProfileAction));
+    if (targetButton) {
+        targetButton->setPopupMode(QToolButton::InstantPopup);
+    }
+    
     m_toolBar->addSeparator();
     
     QAction* importReportAction = m_toolBar->addAction(QIcon(":/icons/import.svg"), tr("导入差异报告"));
@@ -148,6 +260,8 @@ void MainWindow::setupUI()
     m_treeWidget->setStyleSheet("");
     connect(m_treeWidget, &QTreeWidget::itemClicked,
             this, &MainWindow::onTreeItemClicked);
+    connect(m_treeWidget, &QTreeWidget::itemExpanded,
+            this, &MainWindow::onTreeItemExpanded);
     
     // Create detail panel
     m_detailPanel = new QTextEdit(this);
@@ -195,7 +309,8 @@ void MainWindow::onScanDirectory()
     m_progressBar->setRange(0, 0);
 
     m_treeWidget->clear();
-    m_itemNodeMap.clear();
+    m_itemEdgeMap.clear();
+    m_missingBelow.clear();
     m_scanResults.clear();
 
     m_isScanning = true;
@@ -269,7 +384,8 @@ void MainWindow::onScanSingleFile()
     m_progressBar->setValue(0);
 
     m_treeWidget->clear();
-    m_itemNodeMap.clear();
+    m_itemEdgeMap.clear();
+    m_missingBelow.clear();
     m_scanResults.clear();
 
     m_isScanning = true;
@@ -370,7 +486,7 @@ void MainWindow::onImportMissingReport()
         if (!node) {
             continue;
         }
-        uniqueDLLs.insert(node->fileName);
+        uniqueDLLs.insert(node.fileName());
     }
     
     QString resultText = tr("已找到并高亮显示 %1 个缺失的DLL（共 %2 处位置）:\n\n")
@@ -383,12 +499,12 @@ void MainWindow::onImportMissingReport()
         if (!node) {
             continue;
         }
-        if (displayedDLLs.contains(node->fileName)) {
+        if (displayedDLLs.contains(node.fileName())) {
             continue; // 跳过重复的DLL
         }
         if (count >= 10) break;
-        resultText += tr("  • %1\n    路径: %2\n").arg(node->fileName).arg(node->filePath);
-        displayedDLLs.append(node->fileName);
+        resultText += tr("  • %1\n    路径: %2\n").arg(node.fileName()).arg(node.filePath());
+        displayedDLLs.append(node.fileName());
         count++;
     }
     if (uniqueDLLs.size() > 10) {
@@ -491,6 +607,34 @@ void MainWindow::onTreeItemClicked(QTreeWidgetItem* item, int column)
     }
 }
 
+void MainWindow::onTreeItemExpanded(QTreeWidgetItem* item)
+{
+    auto it = m_itemEdgeMap.find(item);
+    if (it == m_itemEdgeMap.end() || !it.value().node) {
+        return;
+    }
+    
+    DependencyScanner::NodeHandle node = it.value().node;
+    if (node.delayPending()) {
+        // 延迟加载的DLL在首次展开时才扫描，依赖图中已有的模块直接复用
+        QTreeWidgetItem* top = item;
+        while (top->parent()) {
+            top = top->parent();
+        }
+        DependencyScanner scanner;
+        if (!scanner.expandDelayLoad(node, m_itemEdgeMap.value(top).node, m_showSystemDLLs->isChecked())) {
+            return;
+        }
+        m_missingBelow.clear();
+        item->setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicatorWhenChildless);
+        item->setText(2, PEParser::architectureToString(node.arch()));
+        item->setText(3, node.fileVersion());
+        statusBar()->showMessage(tr("已展开延迟加载依赖: %1").arg(node.fileName()));
+    }
+    
+    populateTreeItem(item);
+}
+
 void MainWindow::onScanProgress(int current, int total, const QString& file)
 {
     if (m_isDestroying) {
@@ -528,16 +672,13 @@ void MainWindow::onScanProgress(int current, int total, const QString& file)
     statusBar()->showMessage(statusText);
 }
 
-void MainWindow::populateTree(const DependencyScanner::NodePtr& root)
+void MainWindow::populateTree(const DependencyScanner::NodeHandle& root)
 {
     if (!root) return;
     
-    QTreeWidgetItem* item = createTreeItem(root);
+    QTreeWidgetItem* item = createTreeItem(DependencyScanner::DependencyEdge(root));
     m_treeWidget->addTopLevelItem(item);
     
-    // 保存item到node的映射
-    m_itemNodeMap[item] = root;
-    
     // 自动展开包含缺失项的节点
     expandMissingNodes(item);
 }
@@ -549,13 +690,14 @@ void MainWindow::showDLLDetails(QTreeWidgetItem* item)
         return;
     }
 
-    auto it = m_itemNodeMap.find(item);
-    if (it == m_itemNodeMap.end()) {
+    auto it = m_itemEdgeMap.find(item);
+    if (it == m_itemEdgeMap.end()) {
         m_detailPanel->setHtml(tr("<h3>未找到DLL信息</h3>"));
         return;
     }
 
-    DependencyScanner::NodePtr node = it.value();
+    const DependencyScanner::DependencyEdge edge = it.value();
+    DependencyScanner::NodeHandle node = edge.node;
     if (!node) {
         m_detailPanel->setHtml(tr("<h3>DLL信息不可用</h3>"));
         return;
@@ -565,10 +707,10 @@ void MainWindow::showDLLDetails(QTreeWidgetItem* item)
 
     details += tr("<h4>基本信息</h4>");
     details += tr("<table border='0' cellpadding='5' cellspacing='0'>");
-    details += tr("<tr><td width='150'><b>文件名：</b></td><td>%1</td></tr>").arg(node->fileName);
-    details += tr("<tr><td><b>完整路径：</b></td><td>%1</td></tr>").arg(node->filePath);
+    details += tr("<tr><td width='150'><b>文件名：</b></td><td>%1</td></tr>").arg(node.fileName());
+    details += tr("<tr><td><b>完整路径：</b></td><td>%1</td></tr>").arg(node.filePath());
     
-    QFileInfo fileInfo(node->filePath);
+    QFileInfo fileInfo(node.filePath());
     if (fileInfo.exists()) {
         details += tr("<tr><td><b>文件大小：</b></td><td>%1</td></tr>")
             .arg(formatFileSize(fileInfo.size()));
@@ -576,55 +718,100 @@ void MainWindow::showDLLDetails(QTreeWidgetItem* item)
             .arg(fileInfo.lastModified().toString("yyyy-MM-dd hh:mm:ss"));
     }
     
-    QString archStr = PEParser::architectureToString(node->arch);
+    QString archStr = PEParser::architectureToString(node.arch());
     details += tr("<tr><td><b>架构：</b></td><td>%1</td></tr>").arg(archStr);
     details += tr("</table>");
 
     details += tr("<h4>版本信息</h4>");
     details += tr("<table border='0' cellpadding='5' cellspacing='0'>");
     details += tr("<tr><td width='150'><b>文件版本：</b></td><td>%1</td></tr>")
-        .arg(node->fileVersion.isEmpty() ? tr("未知") : node->fileVersion);
+        .arg(node.fileVersion().isEmpty() ? tr("未知") : node.fileVersion());
     details += tr("<tr><td><b>产品版本：</b></td><td>%1</td></tr>")
-        .arg(node->productVersion.isEmpty() ? tr("未知") : node->productVersion);
+        .arg(node.productVersion().isEmpty() ? tr("未知") : node.productVersion());
+    if (fileInfo.exists()) {
+        const QMap<QString, QString> versionStrings = PEParser::getVersionStrings(node.filePath());
+        if (!versionStrings.value("CompanyName").isEmpty()) {
+            details += tr("<tr><td><b>公司名称：</b></td><td>%1</td></tr>")
+                .arg(versionStrings.value("CompanyName").toHtmlEscaped());
+        }
+        if (!versionStrings.value("FileDescription").isEmpty()) {
+            details += tr("<tr><td><b>文件描述：</b></td><td>%1</td></tr>")
+                .arg(versionStrings.value("FileDescription").toHtmlEscaped());
+        }
+        if (!versionStrings.value("OriginalFilename").isEmpty()) {
+            details += tr("<tr><td><b>原始文件名：</b></td><td>%1</td></tr>")
+                .arg(versionStrings.value("OriginalFilename").toHtmlEscaped());
+        }
+    }
+    if (node.contentDigest() != 0) {
+        details += tr("<tr><td><b>内容摘要：</b></td><td>XXH64 %1</td></tr>")
+            .arg(ContentDigest::toHex(node.contentDigest()));
+    }
     details += tr("</table>");
 
     details += tr("<h4>状态信息</h4>");
     details += tr("<table border='0' cellpadding='5' cellspacing='0'>");
-    if (node->exists) {
+    if (node.exists()) {
         details += tr("<tr><td width='150'><b>状态：</b></td><td><font color='green'>正常</font></td></tr>");
     } else {
         details += tr("<tr><td width='150'><b>状态：</b></td><td><font color='red'>缺失</font></td></tr>");
         details += tr("<tr><td></td><td><i>该DLL文件不存在于系统中，可能导致程序无法正常运行。</i></td></tr>");
     }
     
-    if (node->archMismatch) {
+    if (edge.archMismatch) {
         details += tr("<tr><td><b>架构：</b></td><td><font color='orange'>不匹配</font></td></tr>");
         details += tr("<tr><td></td><td><i>DLL架构与主程序不匹配，可能导致加载失败。</i></td></tr>");
     } else {
         details += tr("<tr><td><b>架构：</b></td><td>匹配</td></tr>");
     }
+    if (!edge.missingSymbols.isEmpty()) {
+        details += tr("<tr><td><b>导出函数：</b></td><td><font color='red'>缺失 %1 个</font></td></tr>")
+            .arg(edge.missingSymbols.size());
+        details += tr("<tr><td></td><td><i>%1</i></td></tr>")
+            .arg(edge.missingSymbols.join(", ").toHtmlEscaped());
+    }
+    if (edge.delayLoad) {
+        details += tr("<tr><td><b>加载方式：</b></td><td>延迟加载%1</td></tr>")
+            .arg(node.delayPending() ? tr(" (展开节点后扫描其依赖)") : QString());
+    } else if (edge.viaForwarder) {
+        details += tr("<tr><td><b>加载方式：</b></td><td>由转发导出间接引入</td></tr>");
+    }
     details += tr("</table>");
 
     details += tr("<h4>依赖关系</h4>");
     details += tr("<table border='0' cellpadding='5' cellspacing='0'>");
     details += tr("<tr><td width='150'><b>依赖DLL数：</b></td><td>%1</td></tr>")
-        .arg(node->children.size());
+        .arg(node.edgeCount());
     
     int missingChildren = 0;
-    for (const auto& child : node->children) {
-        if (!child->exists) {
+    for (const auto& child : node.edges()) {
+        if (!child.node.exists()) {
             missingChildren++;
         }
     }
     details += tr("<tr><td><b>缺失依赖：</b></td><td>%1</td></tr>")
         .arg(missingChildren);
     
+    // 层级取自当前树路径；同一模块在依赖图中只有一个节点，被依赖数统计所有导入它的模块
+    int depth = 0;
+    for (QTreeWidgetItem* up = item->parent(); up; up = up->parent()) {
+        depth++;
+    }
     details += tr("<tr><td><b>依赖层级：</b></td><td>%1</td></tr>")
-        .arg(node->depth);
-    
-    if (!node->parent.isNull()) {
+        .arg(depth);
+    
+    if (item->parent()) {
+        int importers = 0;
+        for (const auto& module : DependencyScanner::modules(m_scanResults)) {
+            for (const auto& imported : module.edges()) {
+                if (imported.node == node) {
+                    importers++;
+                    break;
+                }
+            }
+        }
         details += tr("<tr><td><b>被依赖：</b></td><td>是 (被 %1 个文件依赖)</td></tr>")
-            .arg(1);
+            .arg(importers);
     } else {
         details += tr("<tr><td><b>被依赖：</b></td><td>否 (根节点)</td></tr>");
     }
@@ -633,11 +820,11 @@ void MainWindow::showDLLDetails(QTreeWidgetItem* item)
     if (missingChildren > 0) {
         details += tr("<h4>缺失的依赖DLL</h4>");
         details += tr("<ul>");
-        for (const auto& child : node->children) {
-            if (!child->exists) {
+        for (const auto& child : node.edges()) {
+            if (!child.node.exists()) {
                 details += tr("<li><font color='red'>%1</font> (%2)</li>")
-                    .arg(child->fileName)
-                    .arg(child->filePath);
+                    .arg(child.node.fileName())
+                    .arg(child.node.filePath());
             }
         }
         details += tr("</ul>");
@@ -646,50 +833,81 @@ void MainWindow::showDLLDetails(QTreeWidgetItem* item)
     m_detailPanel->setHtml(details);
 }
 
-QTreeWidgetItem* MainWindow::createTreeItem(const DependencyScanner::NodePtr& node)
+QTreeWidgetItem* MainWindow::createTreeItem(const DependencyScanner::DependencyEdge& edge)
 {
+    const DependencyScanner::NodeHandle& node = edge.node;
     QTreeWidgetItem* item = new QTreeWidgetItem();
-    item->setText(0, node->fileName);
-    item->setText(1, node->filePath);
-    item->setText(2, PEParser::architectureToString(node->arch));
-    item->setText(3, node->fileVersion);
-    item->setText(4, node->exists ? tr("正常") : tr("缺失"));
-    item->setData(1, Qt::UserRole, node->filePath);
+    item->setText(0, node.fileName());
+    item->setText(1, node.filePath());
+    item->setText(2, PEParser::architectureToString(node.arch()));
+    item->setText(3, node.fileVersion());
+    QString status = node.exists() ? tr("正常") : tr("缺失");
+    if (node.exists() && !edge.missingSymbols.isEmpty()) {
+        status = tr("缺失导出函数");
+    }
+    if (edge.delayLoad) {
+        status += tr(" (延迟加载)");
+    } else if (edge.viaForwarder) {
+        status += tr(" (转发导出)");
+    }
+    item->setText(4, status);
+    item->setData(1, Qt::UserRole, node.filePath());
     
-    // 保存item到node的映射
-    m_itemNodeMap[item] = node;
+    // 保存item到边的映射
+    m_itemEdgeMap[item] = edge;
     
     // Set color based on status
-    if (!node->exists) {
+    if (!node.exists() || !edge.missingSymbols.isEmpty()) {
         item->setForeground(4, Qt::red);
-    } else if (node->archMismatch) {
+    } else if (edge.archMismatch) {
         item->setForeground(4, QColor(255, 165, 0)); // Orange
     }
     
-    // Add children
-    for (const auto& child : node->children) {
-        item->addChild(createTreeItem(child));
+    // 子节点在展开时才创建；延迟加载的子树在展开时才扫描
+    if (node.edgeCount() > 0 || node.delayPending()) {
+        item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
     }
     
     return item;
 }
 
+void MainWindow::populateTreeItem(QTreeWidgetItem* item)
+{
+    // 共享模块在每条路径上各有一个树节点，按需从依赖图派生
+    if (!item || item->childCount() > 0) {
+        return;
+    }
+    const DependencyScanner::NodeHandle node = m_itemEdgeMap.value(item).node;
+    if (!node) {
+        return;
+    }
+    for (const auto& child : node.edges()) {
+        item->addChild(createTreeItem(child));
+    }
+}
+
 void MainWindow::expandMissingNodes(QTreeWidgetItem* item)
 {
     if (!item) return;
     
-    // 检查当前节点或其子节点是否包含缺失项
-    if (hasMissingDependencies(item)) {
-        // 展开当前节点
-        item->setExpanded(true);
+    // 用显式栈代替递归，任意深度的依赖链都不会耗尽GUI线程的栈
+    QVector<QTreeWidgetItem*> pending;
+    pending.append(item);
+    while (!pending.isEmpty()) {
+        QTreeWidgetItem* current = pending.takeLast();
         
-        // 递归展开所有子节点
-        for (int i = 0; i < item->childCount(); ++i) {
-            expandMissingNodes(item->child(i));
+        // 检查当前节点或其子节点是否包含缺失项
+        if (hasMissingDependencies(current)) {
+            // 展开当前节点，再处理所有子节点
+            populateTreeItem(current);
+            current->setExpanded(true);
+            for (int i = current->childCount() - 1; i >= 0; --i) {
+                pending.append(current->child(i));
+            }
+        } else {
+            // 如果没有缺失项，保持折叠状态（默认行为）
+            current->setExpanded(false);
         }
-    } else {
-        // 如果没有缺失项，保持折叠状态（默认行为）
-        item->setExpanded(false);
     }
 }
 
@@ -697,46 +915,65 @@ bool MainWindow::hasMissingDependencies(QTreeWidgetItem* item)
 {
     if (!item) return false;
     
-    // 检查当前节点是否为缺失状态
-    QString status = item->text(4);
-    if (status == tr("缺失")) {
-        return true;
+    const DependencyScanner::DependencyEdge edge = m_itemEdgeMap.value(item);
+    if (!edge.node) {
+        return false;
     }
     
-    // 递归检查所有子节点
-    for (int i = 0; i < item->childCount(); ++i) {
-        if (hasMissingDependencies(item->child(i))) {
-            return true;
-        }
+    // 检查当前节点是否为缺失状态
+    if (!edge.node.exists() || !edge.missingSymbols.isEmpty()) {
+        return true;
     }
     
-    return false;
+    return hasMissingBelow(edge.node);
+}
+
+bool MainWindow::hasMissingBelow(const DependencyScanner::NodeHandle& node)
+{
+    // 按模块缓存结果，共享的子图只检查一次
+    return anyImportBelow(node, isMissingImport, &m_missingBelow);
 }
 
 void MainWindow::highlightMissingDLLs(const QStringList& missingDLLs)
 {
-    // 清除之前的映射
-    m_itemNodeMap.clear();
+    QHash<const DependencyScanner::DependencyNode*, bool> leadsToMissing;
     
     // 遍历所有顶层项
     for (int i = 0; i < m_treeWidget->topLevelItemCount(); ++i) {
-        QTreeWidgetItem* item = m_treeWidget->topLevelItem(i);
-        if (i < m_scanResults.size()) {
-            highlightTreeItem(item, missingDLLs, m_scanResults[i]);
+        highlightTreeItem(m_treeWidget->topLevelItem(i), missingDLLs, &leadsToMissing);
+    }
+}
+
+void MainWindow::highlightTreeItem(QTreeWidgetItem* root, const QStringList& missingDLLs,
+                                   QHash<const DependencyScanner::DependencyNode*, bool>* leadsToMissing)
+{
+    // 用显式栈代替递归，任意深度的依赖链都不会耗尽GUI线程的栈
+    QVector<QTreeWidgetItem*> pending;
+    if (root) {
+        pending.append(root);
+    }
+    while (!pending.isEmpty()) {
+        QTreeWidgetItem* item = pending.takeLast();
+        const DependencyScanner::NodeHandle node = m_itemEdgeMap.value(item).node;
+        if (node) {
+            highlightTreeNode(item, node, missingDLLs);
+            
+            // 只为通向缺失DLL的子图创建子节点
+            if (leadsToDll(node, missingDLLs, leadsToMissing)) {
+                populateTreeItem(item);
+                for (int i = item->childCount() - 1; i >= 0; --i) {
+                    pending.append(item->child(i));
+                }
+            }
         }
     }
 }
 
-void MainWindow::highlightTreeItem(QTreeWidgetItem* item, const QStringList& missingDLLs, 
-                                   const DependencyScanner::NodePtr& node)
+void MainWindow::highlightTreeNode(QTreeWidgetItem* item, const DependencyScanner::NodeHandle& node,
+                                   const QStringList& missingDLLs)
 {
-    if (!item || !node) return;
-    
-    // 保存item到node的映射
-    m_itemNodeMap[item] = node;
-    
     // 检查当前节点是否在缺失列表中
-    if (missingDLLs.contains(node->fileName, Qt::CaseInsensitive)) {
+    if (missingDLLs.contains(node.fileName(), Qt::CaseInsensitive)) {
         // 高亮显示：使用黄色背景
         for (int col = 0; col < item->columnCount(); ++col) {
             item->setBackground(col, QColor(255, 255, 0, 100));  // 半透明黄色
@@ -756,16 +993,16 @@ void MainWindow::highlightTreeItem(QTreeWidgetItem* item, const QStringList& mis
         }
         item->setExpanded(true);
     }
-    
-    // 递归处理子节点
-    for (int i = 0; i < item->childCount(); ++i) {
-        if (i < node->children.size()) {
-            highlightTreeItem(item->child(i), missingDLLs, node->children[i]);
-        }
-    }
 }
 
-QList<DependencyScanner::NodePtr> MainWindow::getHighlightedNodes()
+bool MainWindow::leadsToDll(const DependencyScanner::NodeHandle& node, const QStringList& dllNames,
+                            QHash<const DependencyScanner::DependencyNode*, bool>* memo)
+{
+    const ImportOf hit = { dllNames };
+    return anyImportBelow(node, hit, memo);
+}
+
+QList<DependencyScanner::NodeHandle> MainWindow::getHighlightedNodes()
 {
     return m_highlightedNodes;
 }
@@ -774,7 +1011,8 @@ void MainWindow::clearAllData()
 {
     m_treeWidget->clear();
     m_detailPanel->clear();
-    m_itemNodeMap.clear();
+    m_itemEdgeMap.clear();
+    m_missingBelow.clear();
     m_highlightedNodes.clear();
     m_scanResults.clear();
     statusBar()->showMessage(tr("数据已清空"));
@@ -790,6 +1028,192 @@ void MainWindow::onClearAll()
     }
 }
 
+void MainWindow::onLoadTargetProfile()
+{
+    if (m_isScanning) {
+        QMessageBox::warning(this, tr("正在扫描"), tr("请等待当前扫描完成后再切换目标系统。"));
+        return;
+    }
+    
+    QString profilePath = QFileDialog::getOpenFileName(this, tr("选择目标系统配置"),
+                                                     QString(), tr("目标系统配置 (*.dllprofile);;所有文件 (*)"));
+    if (profilePath.isEmpty()) {
+        return;
+    }
+    
+    QString error;
+    if (!PathResolver::loadTargetProfile(profilePath, &error)) {
+        LOG_ERROR("MainWindow", error);
+        QMessageBox::critical(this, tr("加载失败"), error);
+        return;
+    }
+    
+    const QSharedPointer<const TargetProfile> profile = PathResolver::targetProfile();
+    m_targetProfileAction->setText(tr("目标系统: %1").arg(QFileInfo(profilePath).completeBaseName()));
+    m_targetProfileAction->setToolTip(tr("系统DLL按目标配置解析: %1").arg(profilePath));
+    LOG_INFO("MainWindow", QString("已加载目标系统配置: %1, 目录数: %2, 文件数: %3")
+        .arg(profilePath)
+        .arg(profile->directoryCount())
+        .arg(profile->fileCount()));
+    statusBar()->showMessage(tr("已加载目标系统配置（%1 个文件），重新扫描后生效").arg(profile->fileCount()));
+}
+
+void MainWindow::onCaptureTargetProfile()
+{
+    // The Windows directory of the target, e.g. a mounted system image
+    QString windowsDir = QFileDialog::getExistingDirectory(this, tr("选择目标机的Windows目录"));
+    if (windowsDir.isEmpty()) {
+        return;
+    }
+    
+    bool ok = false;
+    const QString targetRoot = QInputDialog::getText(this, tr("目标路径"),
+        tr("该目录在目标机上的路径:"), QLineEdit::Normal, QString("C:\\Windows"), &ok);
+    if (!ok || targetRoot.isEmpty()) {
+        return;
+    }
+    
+    QString outputPath = QFileDialog::getSaveFileName(this, tr("保存目标系统配置"),
+                                                    QString("target.dllprofile"),
+                                                    tr("目标系统配置 (*.dllprofile)"));
+    if (outputPath.isEmpty()) {
+        return;
+    }
+    
+    // Optional: regedit export of the target's KnownDLLs key; cancel to skip
+    const QString knownDllsExport = QFileDialog::getOpenFileName(this, tr("选择目标机的 KnownDLLs 注册表导出（可跳过）"),
+                                                               QString(), tr("注册表文件 (*.reg);;所有文件 (*)"));
+    
+    statusBar()->showMessage(tr("正在采集目标系统配置: %1").arg(windowsDir));
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QString error;
+    const bool captured = TargetProfile::capture(windowsDir, outputPath, targetRoot, &error, knownDllsExport);
+    QApplication::restoreOverrideCursor();
+    
+    if (!captured) {
+        LOG_ERROR("MainWindow", error);
+        QMessageBox::critical(this, tr("采集失败"), error);
+        statusBar()->showMessage(tr("就绪"));
+        return;
+    }
+    LOG_INFO("MainWindow", QString("目标系统配置已保存: %1").arg(outputPath));
+    statusBar()->showMessage(tr("目标系统配置已保存: %1").arg(outputPath));
+}
+
+void MainWindow::onLoadApiSetSchema()
+{
+    if (m_isScanning) {
+        QMessageBox::warning(this, tr("正在扫描"), tr("请等待当前扫描完成后再切换目标系统。"));
+        return;
+    }
+    
+    // apisetschema.dll of the target, or a .apiset section saved from it
+    QString schemaPath = QFileDialog::getOpenFileName(this, tr("选择目标机的 apisetschema.dll"),
+                                                    QString(), tr("ApiSet架构 (apisetschema.dll *.apiset);;所有文件 (*)"));
+    if (schemaPath.isEmpty()) {
+        return;
+    }
+    
+    QString error;
+    if (!PathResolver::loadApiSetSchema(schemaPath, &error)) {
+        LOG_ERROR("MainWindow", error);
+        QMessageBox::critical(this, tr("加载失败"), error);
+        return;
+    }
+    
+    const QSharedPointer<const ApiSetSchema> schema = PathResolver::apiSetSchema();
+    LOG_INFO("MainWindow", QString("已加载ApiSet架构: %1, 版本: %2, 契约数: %3")
+        .arg(schemaPath)
+        .arg(schema->version())
+        .arg(schema->contractCount()));
+    statusBar()->showMessage(tr("已加载ApiSet架构（%1 个契约），重新扫描后生效").arg(schema->contractCount()));
+}
+
+void MainWindow::onLoadKnownDlls()
+{
+    if (m_isScanning) {
+        QMessageBox::warning(this, tr("正在扫描"), tr("请等待当前扫描完成后再切换目标系统。"));
+        return;
+    }
+    
+    // reg export "HKLM\SYSTEM\CurrentControlSet\Control\Session Manager\KnownDLLs" on the target
+    QString exportPath = QFileDialog::getOpenFileName(this, tr("选择目标机的 KnownDLLs 注册表导出"),
+                                                    QString(), tr("注册表文件 (*.reg);;所有文件 (*)"));
+    if (exportPath.isEmpty()) {
+        return;
+    }
+    
+    QString error;
+    if (!PathResolver::loadKnownDlls(exportPath, &error)) {
+        LOG_ERROR("MainWindow", error);
+        QMessageBox::critical(this, tr("加载失败"), error);
+        return;
+    }
+    
+    const int count = PathResolver::knownDlls()->count();
+    LOG_INFO("MainWindow", QString("已加载KnownDLLs: %1, 条目数: %2").arg(exportPath).arg(count));
+    statusBar()->showMessage(tr("已加载KnownDLLs（%1 个），重新扫描后生效").arg(count));
+}
+
+void MainWindow::onSelectSearchPlan()
+{
+    QAction* action = qobject_cast<QAction*>(sender());
+    if (!action) {
+        return;
+    }
+    if (m_isScanning) {
+        QMessageBox::warning(this, tr("正在扫描"), tr("请等待当前扫描完成后再切换搜索顺序。"));
+        return;
+    }
+    
+    SearchPlan plan;
+    switch (action->data().toInt()) {
+    case 0:
+        plan = SearchPlan::standard(true);
+        break;
+    case 1:
+        plan = SearchPlan::standard(false);
+        break;
+    case 2: {
+        const QString dllDirectory = QFileDialog::getExistingDirectory(this, tr("选择 SetDllDirectory 目录"));
+        if (dllDirectory.isEmpty()) {
+            return;
+        }
+        plan = SearchPlan::withDllDirectory(dllDirectory);
+        break;
+    }
+    default: {
+        bool ok = false;
+        const QString userDirectories = QInputDialog::getText(this, tr("AddDllDirectory"),
+            tr("AddDllDirectory 添加的目录（以分号分隔，可为空）:"), QLineEdit::Normal, QString(), &ok);
+        if (!ok) {
+            return;
+        }
+        plan = SearchPlan::defaultDirs(userDirectories.split(';', Qt::SkipEmptyParts));
+        break;
+    }
+    }
+    
+    PathResolver::setSearchPlan(plan);
+    LOG_INFO("MainWindow", QString("DLL搜索顺序: %1").arg(plan.description()));
+    statusBar()->showMessage(tr("DLL搜索顺序: %1，重新扫描后生效").arg(plan.description()));
+}
+
+void MainWindow::onUseLocalSystem()
+{
+    if (m_isScanning) {
+        QMessageBox::warning(this, tr("正在扫描"), tr("请等待当前扫描完成后再切换目标系统。"));
+        return;
+    }
+    
+    PathResolver::clearTargetProfile();
+    PathResolver::setApiSetSchema(QSharedPointer<const ApiSetSchema>());
+    PathResolver::setKnownDlls(QSharedPointer<const KnownDlls>());
+    m_targetProfileAction->setText(tr("目标系统: 本机"));
+    m_targetProfileAction->setToolTip(tr("按目标机的系统目录解析系统DLL"));
+    statusBar()->showMessage(tr("已切换为本机系统目录，重新扫描后生效"));
+}
+
 void MainWindow::onAutoCollectDLLs()
 {
     // 步骤1: 检查是否有高亮节点
@@ -806,13 +1230,13 @@ void MainWindow::onAutoCollectDLLs()
     }
     
     // 步骤1.5: 去重 - 每个DLL只保留一个节点
-    QMap<QString, DependencyScanner::NodePtr> uniqueNodes;
+    QMap<QString, DependencyScanner::NodeHandle> uniqueNodes;
     for (const auto& node : m_highlightedNodes) {
-        if (node && !uniqueNodes.contains(node->fileName)) {
-            uniqueNodes.insert(node->fileName, node);
+        if (node && !uniqueNodes.contains(node.fileName())) {
+            uniqueNodes.insert(node.fileName(), node);
         }
     }
-    QList<DependencyScanner::NodePtr> nodesToCollect = uniqueNodes.values();
+    QList<DependencyScanner::NodeHandle> nodesToCollect = uniqueNodes.values();
     
     // 步骤2: 显示高亮DLL列表预览
     QString previewText = tr("找到 %1 个高亮的 DLL 需要收集:\n\n").arg(nodesToCollect.size());
@@ -820,16 +1244,16 @@ void MainWindow::onAutoCollectDLLs()
     qint64 totalSize = 0;
     for (const auto& node : nodesToCollect) {
         if (count < 10) {
-            QFileInfo fileInfo(node->filePath);
+            QFileInfo fileInfo(node.filePath());
             qint64 fileSize = fileInfo.size();
             totalSize += fileSize;
             previewText += tr("  • %1\n    路径: %2\n    大小: %3 KB\n")
-                .arg(node->fileName)
-                .arg(node->filePath)
+                .arg(node.fileName())
+                .arg(node.filePath())
                 .arg(fileSize / 1024.0, 0, 'f', 2);
             count++;
         } else {
-            QFileInfo fileInfo(node->filePath);
+            QFileInfo fileInfo(node.filePath());
             totalSize += fileInfo.size();
         }
     }
@@ -942,7 +1366,7 @@ void MainWindow::onAutoCollectDLLs()
     delete collector;
 }
 
-void MainWindow::onScanFinished(QList<DependencyScanner::NodePtr> results)
+void MainWindow::onScanFinished(QList<DependencyScanner::NodeHandle> results)
 {
     if (m_isDestroying) {
         return;
@@ -1,51 +1,125 @@
 #include "pathresolver.h"
+#include "stripedcache.h"
+#include "systemdlltable.h"
+#include "targetprofile.h"
+#include "apisetschema.h"
+#include "bloomfilter.h"
+#include "knowndlls.h"
 #include <QDir>
+#include <QDirIterator>
 #include <QFileInfo>
 #include <QProcessEnvironment>
 #include <QHash>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QReadWriteLock>
 #include <QSet>
+#include <QVector>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#ifdef Q_OS_WIN
 #include <Windows.h>
+#endif
 
 namespace {
-QStringList cachedSystemPaths()
-{
-    static QMutex mutex;
-    static bool initialized = false;
-    static QStringList paths;
+// Windows matches file names case-insensitively whatever the host does;
+// elsewhere a stat call only finds the exact case
+#ifdef Q_OS_WIN
+const bool kCaseSensitiveFileSystem = false;
+#else
+const bool kCaseSensitiveFileSystem = true;
+#endif
 
-    QMutexLocker locker(&mutex);
-    if (initialized) {
-        return paths;
+QString queryWindowsDirectory()
+{
+#ifdef Q_OS_WIN
+    wchar_t windowsPath[MAX_PATH];
+    if (GetWindowsDirectoryW(windowsPath, MAX_PATH)) {
+        return QString::fromWCharArray(windowsPath);
     }
+#endif
+    return QString();
+}
 
+QString querySystem32Directory()
+{
+#ifdef Q_OS_WIN
     wchar_t system32Path[MAX_PATH];
     if (GetSystemDirectoryW(system32Path, MAX_PATH)) {
-        paths.append(QString::fromWCharArray(system32Path));
+        return QString::fromWCharArray(system32Path);
     }
+#endif
+    return QString();
+}
 
+// Empty on 32-bit Windows
+QString querySysWow64Directory()
+{
+#ifdef Q_OS_WIN
     wchar_t wow64Path[MAX_PATH];
     if (GetSystemWow64DirectoryW(wow64Path, MAX_PATH)) {
-        paths.append(QString::fromWCharArray(wow64Path));
+        return QString::fromWCharArray(wow64Path);
     }
+#endif
+    return QString();
+}
 
-    wchar_t windowsPath[MAX_PATH];
-    if (GetWindowsDirectoryW(windowsPath, MAX_PATH)) {
-        paths.append(QString::fromWCharArray(windowsPath));
+QStringList querySystemPaths()
+{
+    QStringList paths;
+
+#ifdef Q_OS_WIN
+    const QString system32Path = querySystem32Directory();
+    if (!system32Path.isEmpty()) {
+        paths.append(system32Path);
     }
 
-    initialized = true;
+    const QString wow64Path = querySysWow64Directory();
+    if (!wow64Path.isEmpty()) {
+        paths.append(wow64Path);
+    }
+
+#endif
+
+    const QString windowsPath = queryWindowsDirectory();
+    if (!windowsPath.isEmpty()) {
+        paths.append(windowsPath);
+    }
+    return paths;
+}
+
+QStringList cachedSystemPaths()
+{
+    // Thread-safe one-time initialization; later calls take no lock
+    static const QStringList paths = querySystemPaths();
     return paths;
 }
 
+// Schema of the local machine, read once
+QSharedPointer<const ApiSetSchema> localApiSetSchema()
+{
+    static const QSharedPointer<const ApiSetSchema> schema = [] {
+        const QStringList paths = cachedSystemPaths();
+        return paths.isEmpty() ? QSharedPointer<const ApiSetSchema>()
+                               : ApiSetSchema::load(QDir(paths.first()).filePath("apisetschema.dll"));
+    }();
+    return schema;
+}
+
 QStringList cachedFilteredPathDirs(const QString& pathEnv)
 {
-    static QMutex mutex;
+    static QReadWriteLock lock;
     static QString cachedPathEnv;
     static QStringList cachedDirs;
 
-    QMutexLocker locker(&mutex);
+    {
+        QReadLocker locker(&lock);
+        if (cachedPathEnv == pathEnv) {
+            return cachedDirs;
+        }
+    }
+
+    QWriteLocker locker(&lock);
     if (cachedPathEnv == pathEnv) {
         return cachedDirs;
     }
@@ -82,153 +156,905 @@ QStringList cachedFilteredPathDirs(const QString& pathEnv)
 
     return cachedDirs;
 }
+
+// A DLL name given either as a QString or as an in-place import name.
+// Both forms share one folded hash, so they hit the same cache entries.
+struct LookupName {
+    const QString* text;
+    NameFolding::Name view;
+    uint hash;
+
+    explicit LookupName(const QString& name) : text(&name), view(), hash(NameFolding::hash(name)) {}
+    explicit LookupName(const NameFolding::Name& name) : text(nullptr), view(name), hash(name.hash) {}
+
+    bool matches(const QString& other) const
+    {
+        return text ? NameFolding::equals(*text, other) : NameFolding::equals(view.data, view.length, other);
+    }
+
+    bool isApiSetName() const
+    {
+        return text ? ApiSetSchema::isApiSetName(*text) : ApiSetSchema::isApiSetName(view);
+    }
+
+    QString apiSetHost(const ApiSetSchema& schema) const
+    {
+        return text ? schema.hostFor(*text) : schema.hostFor(view);
+    }
+
+    bool isBuiltInSystemDll() const
+    {
+        return text ? SystemDllTable::contains(*text, hash) : SystemDllTable::contains(view);
+    }
+
+    bool isKnownDll(const KnownDlls& knownDlls) const
+    {
+        return text ? knownDlls.contains(*text) : knownDlls.contains(view);
+    }
+
+    QString toString() const { return text ? *text : view.toString(); }
+};
+
+// Entry names of one search directory, indexed by folded hash
+struct DirectoryListing {
+    QString path;
+    QMultiHash<uint, QString> files;
+    QMultiHash<uint, QString> directories;  // For names with a directory part
+};
+
+typedef QPair<QString, bool> SystemDllEntry;
+
+// Resolver caches, keyed by folded name hash. Hits only take a shared lock
+// on one stripe, so parallel scan workers do not convoy on them.
+struct ResolverCache {
+    QMutex mutex;  // Guards the environment snapshot only
+    bool hasPathSnapshot;
+    QString pathEnv;
+    QString currentDir;
+    StripedCache<QString, ResolverContext> contexts;  // Keyed by plan and application directory
+    StripedCache<QPair<quint64, uint>, PathResolver::ResolveResult> resolved;  // Keyed by resolveKey() and name hash
+    StripedCache<uint, SystemDllEntry> systemDlls;
+    StripedCache<QString, QSharedPointer<const DirectoryListing> > listings;  // Keyed by listingKey()
+    mutable QReadWriteLock profileLock;
+    QSharedPointer<const TargetProfile> profile;  // Null: resolve against the local machine
+    QSharedPointer<const ApiSetSchema> apiSetSchema;  // Explicitly loaded; overrides the defaults
+    QSharedPointer<const KnownDlls> knownDlls;  // Explicitly loaded; overrides the defaults
+    SearchPlan searchPlan;  // Also guarded by profileLock
+    mutable QReadWriteLock filterLock;
+    QSharedPointer<const BloomFilter> missFilter;  // Built on first use
+    QAtomicInt indexEnabled;
+    QAtomicInt filterEnabled;
+    QAtomicInt directoryListings;
+    QAtomicInt fileProbes;
+    QAtomicInt missFilterHits;
+    QAtomicInt missFilterFalsePositives;
+
+    ResolverCache() : hasPathSnapshot(false), indexEnabled(1), filterEnabled(1), directoryListings(0),
+                      fileProbes(0), missFilterHits(0), missFilterFalsePositives(0) {}
+};
+
+ResolverCache& resolverCache()
+{
+    static ResolverCache cache;
+    return cache;
+}
+
+// PATH and the current directory are read once per cache generation instead
+// of once per lookup, so every context and the miss filter see the same ones
+void environmentSnapshot(QString* pathEnv, QString* currentDir)
+{
+    ResolverCache& cache = resolverCache();
+    QMutexLocker locker(&cache.mutex);
+    if (!cache.hasPathSnapshot) {
+        cache.pathEnv = QProcessEnvironment::systemEnvironment().value("PATH");
+        cache.currentDir = QDir::currentPath();
+        cache.hasPathSnapshot = true;
+    }
+    *pathEnv = cache.pathEnv;
+    *currentDir = cache.currentDir;
 }
 
-PathResolver::ResolveResult PathResolver::resolveDLLPath(const QString& dllName, const QString& applicationDir)
+QSharedPointer<const TargetProfile> activeProfile()
 {
-    static QMutex cacheMutex;
-    static QHash<QString, ResolveResult> resolveCache;
+    ResolverCache& cache = resolverCache();
+    QReadLocker locker(&cache.profileLock);
+    return cache.profile;
+}
 
-    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-    const QString pathEnv = env.value("PATH");
-    const QString cacheKey = QString("%1|%2|%3")
-        .arg(dllName.toLower())
-        .arg(applicationDir.toLower())
-        .arg(QString::number(qHash(pathEnv)));
+QSharedPointer<const ApiSetSchema> activeApiSetSchema()
+{
+    ResolverCache& cache = resolverCache();
+    {
+        QReadLocker locker(&cache.profileLock);
+        if (cache.apiSetSchema) {
+            return cache.apiSetSchema;
+        }
+        if (cache.profile) {
+            return cache.profile->apiSetSchema();
+        }
+    }
+    return localApiSetSchema();
+}
 
+// KnownDLLs of the machine being resolved for: explicitly loaded, else the
+// target profile's, else the local registry. A profile without a list means
+// none; the local machine's list says nothing about the target.
+QSharedPointer<const KnownDlls> activeKnownDlls()
+{
+    ResolverCache& cache = resolverCache();
     {
-        QMutexLocker locker(&cacheMutex);
-        if (resolveCache.contains(cacheKey)) {
-            return resolveCache.value(cacheKey);
+        QReadLocker locker(&cache.profileLock);
+        if (cache.knownDlls) {
+            return cache.knownDlls;
+        }
+        if (cache.profile) {
+            return cache.profile->knownDlls();
+        }
+    }
+    static const QSharedPointer<const KnownDlls> local = KnownDlls::readLocalRegistry();
+    return local;
+}
+
+// System32, SysWOW64 and the Windows directory of the machine being resolved for
+QStringList systemPaths()
+{
+    const QSharedPointer<const TargetProfile> profile = activeProfile();
+    return profile ? profile->systemDirectories() : cachedSystemPaths();
+}
+
+// The system directory of one kind in the profile, empty if it has none
+QString profileDirectory(const TargetProfile& profile, TargetProfile::DirectoryKind kind)
+{
+    const QStringList paths = profile.systemDirectories();
+    for (const QString& path : paths) {
+        if (profile.directoryKind(profile.findDirectory(path)) == kind) {
+            return path;
+        }
+    }
+    return QString();
+}
+
+// The Windows directory alone, which restricted search plans leave out
+QString windowsDirectory()
+{
+    const QSharedPointer<const TargetProfile> profile = activeProfile();
+    if (!profile) {
+        static const QString path = queryWindowsDirectory();
+        return path;
+    }
+    return profileDirectory(*profile, TargetProfile::WindowsDirectory);
+}
+
+// System32 alone, the one system directory LOAD_LIBRARY_SEARCH_SYSTEM32 searches
+QString system32Directory()
+{
+    const QSharedPointer<const TargetProfile> profile = activeProfile();
+    if (!profile) {
+        static const QString path = querySystem32Directory();
+        return path;
+    }
+    return profileDirectory(*profile, TargetProfile::System32);
+}
+
+// Where KnownDLLs are mapped from for an importer: System32, or SysWOW64
+// for a 32-bit image on 64-bit Windows, whose System32 WOW64 redirects
+QString knownDllDirectory(bool wow64)
+{
+    if (wow64) {
+        const QSharedPointer<const TargetProfile> profile = activeProfile();
+        static const QString localPath = querySysWow64Directory();
+        const QString path = profile ? profileDirectory(*profile, TargetProfile::SysWOW64) : localPath;
+        if (!path.isEmpty()) {
+            return path;
+        }
+    }
+    return system32Directory();
+}
+
+// Target-side paths are kept verbatim; "C:/..." is not absolute on every host
+QString absoluteSearchPath(const QString& path, const TargetProfile* profile)
+{
+    return (profile && profile->findDirectory(path) >= 0) ? path : QDir(path).absolutePath();
+}
+
+// Tail of every search order: system directories, current directory and the
+// filtered PATH, de-duplicated
+QStringList sharedSearchPaths()
+{
+    const QSharedPointer<const TargetProfile> profile = activeProfile();
+    QString pathEnv;
+    QString currentDir;
+    environmentSnapshot(&pathEnv, &currentDir);
+
+    QStringList candidates = systemPaths();
+    candidates.append(currentDir);
+    candidates.append(cachedFilteredPathDirs(pathEnv));
+
+    QStringList paths;
+    QSet<QString> seen;
+    for (const QString& path : candidates) {
+        if (path.isEmpty()) {
+            continue;
+        }
+        const QString absolute = absoluteSearchPath(path, profile.data());
+        const QString normalized = absolute.toLower();
+        if (!seen.contains(normalized)) {
+            seen.insert(normalized);
+            paths.append(absolute);
+        }
+    }
+    return paths;
+}
+
+template <typename Entry>
+bool anyEntry(const Entry&)
+{
+    return true;
+}
+
+// Directories differing only in case are distinct on a case-sensitive file system
+QString listingKey(const QString& dirPath)
+{
+    const QString path = QDir::cleanPath(dirPath);
+    return kCaseSensitiveFileSystem ? path : path.toLower();
+}
+
+QSharedPointer<const DirectoryListing> directoryListing(const QString& dirPath, const QString& key)
+{
+    ResolverCache& cache = resolverCache();
+    QSharedPointer<const DirectoryListing> cached;
+    if (cache.listings.find(key, anyEntry<QSharedPointer<const DirectoryListing> >, &cached)) {
+        return cached;
+    }
+
+    // One directory read replaces a stat call per candidate name
+    QSharedPointer<DirectoryListing> listing(new DirectoryListing());
+    listing->path = dirPath;
+    QDirIterator it(dirPath, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+    while (it.hasNext()) {
+        it.next();
+        const QString name = it.fileName();
+        if (it.fileInfo().isDir()) {
+            listing->directories.insert(NameFolding::hash(name), name);
+        } else {
+            listing->files.insert(NameFolding::hash(name), name);
+        }
+    }
+    cache.directoryListings.ref();
+
+    return cache.listings.insert(key, listing, anyEntry<QSharedPointer<const DirectoryListing> >);
+}
+
+QSharedPointer<const DirectoryListing> directoryListing(const QString& dirPath)
+{
+    return directoryListing(dirPath, listingKey(dirPath));
+}
+
+// dirPath compiled for repeated lookups
+ResolverContext::SearchDirectory searchDirectory(const QString& dirPath, const TargetProfile* profile,
+                                                 bool inMissFilter)
+{
+    ResolverContext::SearchDirectory directory;
+    directory.path = dirPath;
+    directory.profileDirectory = profile ? profile->findDirectory(dirPath) : -1;
+    if (directory.profileDirectory < 0) {
+        directory.listingKey = listingKey(dirPath);
+    }
+    directory.inMissFilter = inMissFilter;
+    return directory;
+}
+
+// Every file name in the shared search paths, from the profile or the
+// directory index. Null while the filter or the index is disabled.
+QSharedPointer<const BloomFilter> missFilter()
+{
+    ResolverCache& cache = resolverCache();
+    if (!cache.filterEnabled.loadAcquire() || !cache.indexEnabled.loadAcquire()) {
+        return QSharedPointer<const BloomFilter>();
+    }
+    {
+        QReadLocker locker(&cache.filterLock);
+        if (cache.missFilter) {
+            return cache.missFilter;
+        }
+    }
+
+    // Built outside the lock; a racing builder produces the same filter
+    const QSharedPointer<const TargetProfile> profile = activeProfile();
+    QVector<QVector<uint> > hashes;
+    int total = 0;
+    const QStringList paths = sharedSearchPaths();
+    for (const QString& path : paths) {
+        const int profileDirectory = profile ? profile->findDirectory(path) : -1;
+        if (profileDirectory >= 0) {
+            hashes.append(profile->fileHashes(profileDirectory));
+        } else {
+            hashes.append(directoryListing(path)->files.uniqueKeys().toVector());
+        }
+        total += hashes.last().size();
+    }
+
+    QSharedPointer<BloomFilter> filter(new BloomFilter(total));
+    for (const QVector<uint>& directory : hashes) {
+        for (uint hash : directory) {
+            filter->insert(hash);
+        }
+    }
+
+    QWriteLocker locker(&cache.filterLock);
+    if (!cache.missFilter) {
+        cache.missFilter = filter;
+    }
+    return cache.missFilter;
+}
+
+void dropMissFilter()
+{
+    ResolverCache& cache = resolverCache();
+    QWriteLocker locker(&cache.filterLock);
+    cache.missFilter.clear();
+}
+
+// Entry of a listing matching name case-insensitively, or an empty string
+QString findListed(const QMultiHash<uint, QString>& entries, const QString& name, uint hash)
+{
+    for (auto it = entries.constFind(hash); it != entries.constEnd() && it.key() == hash; ++it) {
+        if (NameFolding::equals(it.value(), name)) {
+            return it.value();
+        }
+    }
+    return QString();
+}
+
+// A name with directory parts ("plugins\x.dll", "../x.dll" or an absolute
+// path), relative to dirPath. The exact path is probed first; on a
+// case-sensitive file system a miss walks the folded index one component
+// at a time, as the Windows loader would match it.
+QString findRelativeFile(const QString& dirPath, const QString& fileName)
+{
+    ResolverCache& cache = resolverCache();
+    const QString relative = QString(fileName).replace(QLatin1Char('\\'), QLatin1Char('/'));
+    const QString exactPath = QDir(dirPath).filePath(relative);
+
+    cache.fileProbes.ref();
+    const QFileInfo fileInfo(exactPath);
+    if (fileInfo.exists() && fileInfo.isFile()) {
+        return fileInfo.absoluteFilePath();
+    }
+    if (!kCaseSensitiveFileSystem) {
+        return QString();
+    }
+
+    QString current = QDir::isAbsolutePath(relative) ? QDir::rootPath() : dirPath;
+    const QStringList parts = relative.split(QLatin1Char('/'), Qt::SkipEmptyParts);
+    for (int i = 0; i < parts.size(); ++i) {
+        const QString& part = parts.at(i);
+        if (part == QLatin1String(".")) {
+            continue;
+        }
+        if (part == QLatin1String("..")) {
+            current = QDir::cleanPath(current + QLatin1String("/.."));
+            continue;
+        }
+        const QSharedPointer<const DirectoryListing> listing = directoryListing(current);
+        const bool last = (i == parts.size() - 1);
+        const QString match = findListed(last ? listing->files : listing->directories, part, NameFolding::hash(part));
+        if (match.isEmpty()) {
+            return QString();
+        }
+        current = QDir(listing->path).filePath(match);
+    }
+    return QDir::cleanPath(current);
+}
+
+// Absolute path of fileName inside dirPath, or an empty string. Directories
+// of the target profile are answered from the profile, never the local disk;
+// *profileEntry is filled in for such hits.
+QString findInDirectory(const ResolverContext::SearchDirectory& directory, const TargetProfile* profile,
+                        const QString& fileName, uint hash, TargetProfile::FileEntry* profileEntry = nullptr)
+{
+    ResolverCache& cache = resolverCache();
+    const QString& dirPath = directory.path;
+
+    if (directory.profileDirectory >= 0) {
+        TargetProfile::FileEntry entry;
+        if (!profile->findFile(fileName, directory.profileDirectory, &entry)) {
+            return QString();
+        }
+        if (profileEntry) {
+            *profileEntry = entry;
+        }
+        return entry.directory + QLatin1Char('/') + entry.fileName;
+    }
+
+    if (fileName.contains('/') || fileName.contains('\\')) {
+        return findRelativeFile(dirPath, fileName);
+    }
+
+    if (!cache.indexEnabled.loadAcquire()) {
+        cache.fileProbes.ref();
+        const QFileInfo fileInfo(QDir(dirPath).filePath(fileName));
+        if (fileInfo.exists() && fileInfo.isFile()) {
+            return fileInfo.absoluteFilePath();
+        }
+        // The probe only sees the exact case; fall back to the index for the rest
+        if (!kCaseSensitiveFileSystem) {
+            return QString();
         }
     }
 
-    ResolveResult result;
+    const QSharedPointer<const DirectoryListing> listing = directoryListing(dirPath, directory.listingKey);
+    const QString match = findListed(listing->files, fileName, hash);
+    return match.isEmpty() ? QString() : QDir(listing->path).filePath(match);
+}
+
+// Same, for a directory outside any compiled search order
+QString findInDirectory(const QString& dirPath, const QString& fileName, uint hash,
+                        TargetProfile::FileEntry* profileEntry = nullptr)
+{
+    const QSharedPointer<const TargetProfile> profile = activeProfile();
+    return findInDirectory(searchDirectory(dirPath, profile.data(), false), profile.data(),
+                           fileName, hash, profileEntry);
+}
+
+// fileName in the first of paths that has it, filling in *result
+bool findInSystemDirectories(const QString& fileName, const QStringList& paths, PathResolver::ResolveResult* result)
+{
+    const uint hash = NameFolding::hash(fileName);
+    for (const QString& systemPath : paths) {
+        result->searchedPaths.append(QDir(systemPath).filePath(fileName));
+        TargetProfile::FileEntry profileEntry;
+        const QString foundPath = findInDirectory(systemPath, fileName, hash, &profileEntry);
+        if (!foundPath.isEmpty()) {
+            result->foundPath = foundPath;
+            result->found = true;
+            result->fromTargetProfile = !profileEntry.fileName.isEmpty();
+            result->fileVersion = TargetProfile::versionToString(profileEntry.fileVersion);
+            return true;
+        }
+    }
+    return false;
+}
+
+PathResolver::ResolveResult resolveUncached(const QString& dllName, const ResolverContext& context, bool wow64)
+{
+    PathResolver::ResolveResult result;
     result.dllName = dllName;
     result.found = false;
 
-    QFileInfo inputFileInfo(dllName);
-    if (inputFileInfo.isAbsolute() && inputFileInfo.exists() && inputFileInfo.isFile()) {
-        result.foundPath = inputFileInfo.absoluteFilePath();
-        result.found = true;
-        QMutexLocker locker(&cacheMutex);
-        resolveCache.insert(cacheKey, result);
+    if (QDir::isAbsolutePath(dllName)) {
+        const QString foundPath = findRelativeFile(QString(), dllName);
+        if (!foundPath.isEmpty()) {
+            result.foundPath = foundPath;
+            result.found = true;
+            return result;
+        }
+    }
+    
+    // API set contracts are virtual: the schema names the host, which is
+    // always loaded from the system directory
+    if (ApiSetSchema::isApiSetName(dllName)) {
+        const QSharedPointer<const ApiSetSchema> schema = activeApiSetSchema();
+        if (schema) {
+            result.apiSetHost = schema->hostFor(dllName);
+            if (result.apiSetHost.isEmpty()) {
+                return result;
+            }
+            findInSystemDirectories(result.apiSetHost, systemPaths(), &result);
+            return result;
+        }
+    }
+
+    // KnownDLLs are mapped from the system's section directory: no search
+    // order, so an app-local copy cannot shadow them. The sections come from
+    // the importer's system directory only; a known name missing there falls
+    // back to the normal search, as in the loader.
+    const QSharedPointer<const KnownDlls> knownDlls = activeKnownDlls();
+    const QString knownDir = knownDlls && knownDlls->contains(dllName) ? knownDllDirectory(wow64) : QString();
+    if (!knownDir.isEmpty()) {
+        if (findInSystemDirectories(dllName, QStringList() << knownDir, &result)) {
+            result.knownDll = true;
+            return result;
+        }
+        result.searchedPaths.clear();
+    }
+
+    // Search for the DLL in each directory of the compiled search order. The
+    // shared paths are skipped when the miss filter has never seen the name;
+    // names with a directory part are not in the index, so they always walk.
+    const uint hash = NameFolding::hash(dllName);
+    const QVector<ResolverContext::SearchDirectory> directories = context.searchDirectories();
+    const QSharedPointer<const TargetProfile> profile = context.targetProfile();
+    QSharedPointer<const BloomFilter> filter;
+    if (!dllName.contains('/') && !dllName.contains('\\')) {
+        filter = missFilter();
+    }
+    const bool definiteMiss = filter && !filter->mayContain(hash);
+    if (definiteMiss) {
+        resolverCache().missFilterHits.ref();
+    }
+    for (const ResolverContext::SearchDirectory& directory : directories) {
+        result.searchedPaths.append(QDir(directory.path).filePath(dllName));
+        if (definiteMiss && directory.inMissFilter) {
+            continue;
+        }
+        
+        TargetProfile::FileEntry profileEntry;
+        const QString foundPath = findInDirectory(directory, profile.data(), dllName, hash, &profileEntry);
+        if (!foundPath.isEmpty()) {
+            result.foundPath = foundPath;
+            result.found = true;
+            result.fromTargetProfile = !profileEntry.fileName.isEmpty();
+            result.fileVersion = TargetProfile::versionToString(profileEntry.fileVersion);
+            return result;
+        }
+    }
+
+    if (filter && !definiteMiss) {
+        resolverCache().missFilterFalsePositives.ref();
+    }
+    return result;
+}
+
+// KnownDLLs resolve by the importer's bitness, so it is part of the key
+quint64 resolveKey(const ResolverContext& context, bool wow64)
+{
+    return (quint64(context.id()) << 1) | (wow64 ? 1 : 0);
+}
+
+PathResolver::ResolveResult resolveCached(const LookupName& name, const ResolverContext& context, bool wow64)
+{
+    ResolverCache& cache = resolverCache();
+    const QPair<quint64, uint> key(resolveKey(context, wow64), name.hash);
+    auto sameName = [&name](const PathResolver::ResolveResult& entry) { return name.matches(entry.dllName); };
+    PathResolver::ResolveResult result;
+    if (cache.resolved.find(key, sameName, &result)) {
         return result;
     }
+
+    // Miss: only now materialize the name
+    result = resolveUncached(name.toString(), context, wow64);
+    return cache.resolved.insert(key, result, sameName);
+}
+
+bool isSystemDllCached(const LookupName& name)
+{
+    // A contract is part of the system exactly when the schema has a host for it
+    if (name.isApiSetName()) {
+        const QSharedPointer<const ApiSetSchema> schema = activeApiSetSchema();
+        if (schema) {
+            return !name.apiSetHost(*schema).isEmpty();
+        }
+    }
+
+    // Known system DLLs and api-set prefixes: no lock, no allocation
+    if (name.isBuiltInSystemDll()) {
+        return true;
+    }
+    
+    const QSharedPointer<const KnownDlls> knownDlls = activeKnownDlls();
+    if (knownDlls && name.isKnownDll(*knownDlls)) {
+        return true;
+    }
+
+    ResolverCache& cache = resolverCache();
+    auto sameName = [&name](const SystemDllEntry& entry) { return name.matches(entry.first); };
+    SystemDllEntry cached;
+    if (cache.systemDlls.find(name.hash, sameName, &cached)) {
+        return cached.second;
+    }
+
+    // Check if the DLL is in a system directory
+    const QString dllName = name.toString();
+    bool isSystem = false;
+    const QStringList paths = systemPaths();
+    for (const QString& systemPath : paths) {
+        if (!findInDirectory(systemPath, dllName, name.hash).isEmpty()) {
+            isSystem = true;
+            break;
+        }
+    }
     
-    // Build search paths according to Windows DLL search order
-    QStringList searchPaths;
+    // Side-by-side assemblies ship with the target OS as well
+    if (!isSystem) {
+        const QSharedPointer<const TargetProfile> profile = activeProfile();
+        isSystem = profile && profile->findFileOfKind(dllName, TargetProfile::SideBySide);
+    }
+
+    return cache.systemDlls.insert(name.hash, qMakePair(dllName, isSystem), sameName).second;
+}
+}
+
+PathResolver::ResolveResult PathResolver::resolveDLLPath(const QString& dllName, const QString& applicationDir)
+{
+    return resolveCached(LookupName(dllName), context(applicationDir), false);
+}
+
+PathResolver::ResolveResult PathResolver::resolveDLLPath(const NameFolding::Name& dllName, const QString& applicationDir)
+{
+    return resolveCached(LookupName(dllName), context(applicationDir), false);
+}
+
+PathResolver::ResolveResult PathResolver::resolveDLLPath(const QString& dllName, const ResolverContext& context,
+                                                         bool wow64)
+{
+    return resolveCached(LookupName(dllName), context.isValid() ? context : PathResolver::context(QString()), wow64);
+}
+
+PathResolver::ResolveResult PathResolver::resolveDLLPath(const NameFolding::Name& dllName, const ResolverContext& context,
+                                                         bool wow64)
+{
+    return resolveCached(LookupName(dllName), context.isValid() ? context : PathResolver::context(QString()), wow64);
+}
+
+ResolverContext PathResolver::context(const QString& applicationDir)
+{
+    return context(applicationDir, searchPlan());
+}
+
+ResolverContext PathResolver::context(const QString& applicationDir, const SearchPlan& plan)
+{
+    ResolverCache& cache = resolverCache();
+    const QString key = plan.key() + QLatin1Char('\n') + applicationDir;
+    ResolverContext cached;
+    if (cache.contexts.find(key, anyEntry<ResolverContext>, &cached)) {
+        return cached;
+    }
+
+    // Ids are never reused, so results cached for a stale context cannot leak into a new one
+    static QAtomicInt nextId(0);
+    QSharedPointer<ResolverContext::Data> data(new ResolverContext::Data());
+    data->id = quint32(nextId.fetchAndAddRelaxed(1) + 1);
+    data->applicationDir = applicationDir;
+    data->plan = plan;
+    data->profile = activeProfile();
+
+    // Directories the miss filter covers
+    QSet<QString> filtered;
+    const QStringList sharedPaths = sharedSearchPaths();
+    for (const QString& path : sharedPaths) {
+        filtered.insert(path.toLower());
+    }
+
     QSet<QString> addedSearchPath;
-    auto tryAddSearchPath = [&searchPaths, &addedSearchPath](const QString& path) {
+    auto tryAddSearchPath = [&data, &addedSearchPath, &filtered](const QString& path) {
         if (path.isEmpty()) {
             return;
         }
-        const QString normalized = QDir(path).absolutePath().toLower();
+        const QString absolute = absoluteSearchPath(path, data->profile.data());
+        const QString normalized = absolute.toLower();
         if (addedSearchPath.contains(normalized)) {
             return;
         }
         addedSearchPath.insert(normalized);
-        searchPaths.append(QDir(path).absolutePath());
+        data->searchPaths.append(absolute);
+        data->directories.append(searchDirectory(absolute, data->profile.data(), filtered.contains(normalized)));
     };
-    
-    // 1. Application directory
-    if (!applicationDir.isEmpty()) {
-        tryAddSearchPath(applicationDir);
-    }
-    
-    // 2/3/4. System paths
-    const QStringList systemPaths = cachedSystemPaths();
-    for (const QString& path : systemPaths) {
-        tryAddSearchPath(path);
-    }
-    
-    // 5. Current directory
-    tryAddSearchPath(QDir::currentPath());
-    
-    // 6. PATH environment variable directories (filtered and cached)
+
+    // Compile the plan's steps into one flat list of directories
+    QString pathEnv;
+    QString currentDir;
+    environmentSnapshot(&pathEnv, &currentDir);
+    const QString windowsDir = windowsDirectory();
+    const QStringList systemDirs = systemPaths();
+    const QStringList userDirs = plan.userDirectories();
     const QStringList pathDirs = cachedFilteredPathDirs(pathEnv);
-    for (const QString& path : pathDirs) {
-        tryAddSearchPath(path);
-    }
-    
-    // Search for the DLL in each path
-    for (const QString& searchPath : searchPaths) {
-        QString fullPath = QDir(searchPath).filePath(dllName);
-        result.searchedPaths.append(fullPath);
-        
-        QFileInfo fileInfo(fullPath);
-        if (fileInfo.exists() && fileInfo.isFile()) {
-            result.foundPath = fileInfo.absoluteFilePath();
-            result.found = true;
-            QMutexLocker locker(&cacheMutex);
-            resolveCache.insert(cacheKey, result);
-            return result;
+    const QVector<SearchPlan::Step> steps = plan.steps();
+    for (SearchPlan::Step step : steps) {
+        switch (step) {
+        case SearchPlan::ApplicationDirectory:
+            tryAddSearchPath(applicationDir);
+            break;
+        case SearchPlan::DllDirectory:
+            tryAddSearchPath(plan.dllDirectory());
+            break;
+        case SearchPlan::UserDirectories:
+            for (const QString& path : userDirs) {
+                tryAddSearchPath(path);
+            }
+            break;
+        case SearchPlan::SystemDirectories:
+            for (const QString& path : systemDirs) {
+                if (!NameFolding::equals(path, windowsDir)) {
+                    tryAddSearchPath(path);
+                }
+            }
+            break;
+        case SearchPlan::System32Directory:
+            tryAddSearchPath(system32Directory());
+            break;
+        case SearchPlan::WindowsDirectory:
+            tryAddSearchPath(windowsDir);
+            break;
+        case SearchPlan::CurrentDirectory:
+            tryAddSearchPath(currentDir);
+            break;
+        case SearchPlan::PathDirectories:
+            for (const QString& path : pathDirs) {
+                tryAddSearchPath(path);
+            }
+            break;
         }
     }
 
-    QMutexLocker locker(&cacheMutex);
-    resolveCache.insert(cacheKey, result);
-    return result;
+    ResolverContext context;
+    context.d = data;
+
+    return cache.contexts.insert(key, context, anyEntry<ResolverContext>);
+}
+
+void PathResolver::setSearchPlan(const SearchPlan& plan)
+{
+    ResolverCache& cache = resolverCache();
+    {
+        QWriteLocker locker(&cache.profileLock);
+        cache.searchPlan = plan;
+    }
+}
+
+SearchPlan PathResolver::searchPlan()
+{
+    ResolverCache& cache = resolverCache();
+    QReadLocker locker(&cache.profileLock);
+    return cache.searchPlan;
 }
 
 QStringList PathResolver::getSystemSearchPaths()
 {
-    return cachedSystemPaths();
+    return systemPaths();
 }
 
 bool PathResolver::isSystemDLL(const QString& dllName)
 {
-    static QMutex cacheMutex;
-    static QHash<QString, bool> systemDllCache;
+    return isSystemDllCached(LookupName(dllName));
+}
 
-    const QString lowerName = dllName.toLower();
+bool PathResolver::isSystemDLL(const NameFolding::Name& dllName)
+{
+    return isSystemDllCached(LookupName(dllName));
+}
+
+void PathResolver::clearCache()
+{
+    ResolverCache& cache = resolverCache();
     {
-        QMutexLocker locker(&cacheMutex);
-        if (systemDllCache.contains(lowerName)) {
-            return systemDllCache.value(lowerName);
-        }
-    }
-
-    // Common Windows system DLLs
-    static const QSet<QString> systemDLLs = {
-        "kernel32.dll", "user32.dll", "gdi32.dll", "advapi32.dll",
-        "shell32.dll", "ole32.dll", "oleaut32.dll", "comctl32.dll",
-        "comdlg32.dll", "ws2_32.dll", "msvcrt.dll", "ntdll.dll",
-        "rpcrt4.dll", "secur32.dll", "winmm.dll", "version.dll",
-        "imagehlp.dll", "dbghelp.dll", "psapi.dll", "iphlpapi.dll",
-        "netapi32.dll", "userenv.dll", "winspool.drv", "imm32.dll",
-        "msimg32.dll", "setupapi.dll", "wininet.dll", "crypt32.dll",
-        "wintrust.dll", "shlwapi.dll", "mpr.dll", "credui.dll"
-    };
+        QMutexLocker locker(&cache.mutex);
+        cache.hasPathSnapshot = false;
+        cache.pathEnv.clear();
+    }
+    cache.contexts.clear();
+    cache.resolved.clear();
+    cache.systemDlls.clear();
+    cache.listings.clear();
+    dropMissFilter();
+    cache.directoryListings.storeRelease(0);
+    cache.fileProbes.storeRelease(0);
+    cache.missFilterHits.storeRelease(0);
+    cache.missFilterFalsePositives.storeRelease(0);
+}
 
-    bool isSystem = false;
-    
-    // Check if it's in the known system DLLs list
-    if (systemDLLs.contains(lowerName)) {
-        isSystem = true;
+void PathResolver::refreshDirectoryIndex(const QString& dirPath)
+{
+    ResolverCache& cache = resolverCache();
+    if (dirPath.isEmpty()) {
+        cache.listings.clear();
+    } else {
+        cache.listings.remove(listingKey(QDir(dirPath).absolutePath()));
     }
     
-    // Check if it starts with common system prefixes
-    if (!isSystem &&
-        (lowerName.startsWith("api-ms-win-") ||
-         lowerName.startsWith("ext-ms-win-") ||
-         lowerName.startsWith("ucrtbase"))) {
-        isSystem = true;
+    // Any cached answer, and the miss filter, may have come from the old listing
+    dropMissFilter();
+    cache.resolved.clear();
+    cache.systemDlls.clear();
+}
+
+void PathResolver::setDirectoryIndexEnabled(bool enabled)
+{
+    ResolverCache& cache = resolverCache();
+    cache.indexEnabled.storeRelease(enabled ? 1 : 0);
+    dropMissFilter();
+    cache.resolved.clear();
+    cache.systemDlls.clear();
+}
+
+void PathResolver::setMissFilterEnabled(bool enabled)
+{
+    ResolverCache& cache = resolverCache();
+    cache.filterEnabled.storeRelease(enabled ? 1 : 0);
+    cache.resolved.clear();
+}
+
+PathResolver::LookupStatistics PathResolver::lookupStatistics()
+{
+    ResolverCache& cache = resolverCache();
+    LookupStatistics stats;
+    stats.directoryListings = cache.directoryListings.loadAcquire();
+    stats.fileProbes = cache.fileProbes.loadAcquire();
+    stats.missFilterHits = cache.missFilterHits.loadAcquire();
+    stats.missFilterFalsePositives = cache.missFilterFalsePositives.loadAcquire();
+    return stats;
+}
+
+bool PathResolver::loadTargetProfile(const QString& profilePath, QString* error)
+{
+    const QSharedPointer<const TargetProfile> profile = TargetProfile::load(profilePath, error);
+    if (!profile) {
+        return false;
+    }
+    setTargetProfile(profile);
+    return true;
+}
+
+void PathResolver::setTargetProfile(const QSharedPointer<const TargetProfile>& profile)
+{
+    ResolverCache& cache = resolverCache();
+    {
+        QWriteLocker locker(&cache.profileLock);
+        cache.profile = profile;
     }
     
-    // Check if the DLL is in a system directory
-    if (!isSystem) {
-        QStringList systemPaths = getSystemSearchPaths();
-        for (const QString& systemPath : systemPaths) {
-            QString fullPath = QDir(systemPath).filePath(dllName);
-            if (QFileInfo::exists(fullPath)) {
-                isSystem = true;
-                break;
-            }
-        }
+    // Search orders and every cached answer depend on the system directories
+    clearCache();
+}
+
+void PathResolver::clearTargetProfile()
+{
+    setTargetProfile(QSharedPointer<const TargetProfile>());
+}
+
+QSharedPointer<const TargetProfile> PathResolver::targetProfile()
+{
+    return activeProfile();
+}
+
+bool PathResolver::loadApiSetSchema(const QString& filePath, QString* error)
+{
+    const QSharedPointer<const ApiSetSchema> schema = ApiSetSchema::load(filePath, error);
+    if (!schema) {
+        return false;
     }
+    setApiSetSchema(schema);
+    return true;
+}
+
+void PathResolver::setApiSetSchema(const QSharedPointer<const ApiSetSchema>& schema)
+{
+    ResolverCache& cache = resolverCache();
+    {
+        QWriteLocker locker(&cache.profileLock);
+        cache.apiSetSchema = schema;
+    }
+    cache.resolved.clear();
+    cache.systemDlls.clear();
+}
+
+QSharedPointer<const ApiSetSchema> PathResolver::apiSetSchema()
+{
+    return activeApiSetSchema();
+}
 
-    QMutexLocker locker(&cacheMutex);
-    systemDllCache.insert(lowerName, isSystem);
-    return isSystem;
+bool PathResolver::loadKnownDlls(const QString& registryExportPath, QString* error)
+{
+    const QSharedPointer<const KnownDlls> knownDlls = KnownDlls::loadRegistryExport(registryExportPath, error);
+    if (!knownDlls) {
+        return false;
+    }
+    setKnownDlls(knownDlls);
+    return true;
+}
+
+void PathResolver::setKnownDlls(const QSharedPointer<const KnownDlls>& knownDlls)
+{
+    ResolverCache& cache = resolverCache();
+    {
+        QWriteLocker locker(&cache.profileLock);
+        cache.knownDlls = knownDlls;
+    }
+    cache.resolved.clear();
+    cache.systemDlls.clear();
+}
+
+QSharedPointer<const KnownDlls> PathResolver::knownDlls()
+{
+    return activeKnownDlls();
 }
@@ -0,0 +1,581 @@
+#include "peimage.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+const quint16 kDosSignature = 0x5A4D;      // "MZ"
+const quint32 kNtSignature = 0x00004550;   // "PE\0\0"
+const quint16 kOptionalMagicPE32 = 0x10b;
+const quint16 kOptionalMagicPE32Plus = 0x20b;
+const quint32 kResourceTypeVersion = 16;   // RT_VERSION
+
+const qint64 kFileHeaderSize = 20;
+const qint64 kSectionHeaderSize = 40;
+const qint64 kImportDescriptorSize = 20;
+const qint64 kDelayImportDescriptorSize = 32;
+const quint32 kDelayAttributeRvaBased = 0x1;
+const qint64 kResourceEntrySize = 8;
+const int kMaxDirectories = 16;
+const qint64 kMaxNameLength = 64 * 1024;
+const qint64 kExportDirectorySize = 40;
+const int kMaxSymbolsPerModule = 64 * 1024;
+
+// The only places where PE32 and PE32+ differ for the parser.
+// Code templated on these has no runtime width checks.
+struct PE32Layout {
+    typedef quint32 ImageBase;
+    typedef quint32 Thunk;
+    static const quint64 OrdinalFlag = 0x80000000u;
+    static const qint64 ImageBaseOffset = 28;
+    static const qint64 DirectoryCountOffset = 92;
+};
+
+struct PE64Layout {
+    typedef quint64 ImageBase;
+    typedef quint64 Thunk;
+    static const quint64 OrdinalFlag = 0x8000000000000000ull;
+    static const qint64 ImageBaseOffset = 24;
+    static const qint64 DirectoryCountOffset = 108;
+};
+
+bool sectionBefore(const PEImage::Section& a, const PEImage::Section& b)
+{
+    return a.virtualAddress < b.virtualAddress;
+}
+}
+
+PEImage::PEImage(const uchar* data, qint64 size)
+    : m_data(data)
+    , m_source(nullptr)
+    , m_size(data ? size : 0)
+    , m_status(Truncated)
+    , m_machine(0)
+    , m_is64(false)
+    , m_directoriesTruncated(false)
+    , m_sizeOfHeaders(0)
+    , m_imageBase(0)
+{
+    parseHeaders();
+}
+
+PEImage::PEImage(PEImageSource* source)
+    : m_data(nullptr)
+    , m_source(source)
+    , m_size(source ? source->size() : 0)
+    , m_status(Truncated)
+    , m_machine(0)
+    , m_is64(false)
+    , m_directoriesTruncated(false)
+    , m_sizeOfHeaders(0)
+    , m_imageBase(0)
+{
+    parseHeaders();
+}
+
+void PEImage::parseHeaders()
+{
+    quint16 dosMagic = 0;
+    if (!read(0, &dosMagic)) {
+        m_status = Truncated;
+        return;
+    }
+    if (dosMagic != kDosSignature) {
+        m_status = BadDosSignature;
+        return;
+    }
+
+    quint32 ntOffset = 0;
+    if (!read(0x3C, &ntOffset)) {
+        m_status = Truncated;
+        return;
+    }
+
+    quint32 ntSignature = 0;
+    if (!read(ntOffset, &ntSignature)) {
+        m_status = Truncated;
+        return;
+    }
+    if (ntSignature != kNtSignature) {
+        m_status = BadNtSignature;
+        return;
+    }
+
+    const qint64 fileHeader = qint64(ntOffset) + 4;
+    quint16 numberOfSections = 0;
+    quint16 sizeOfOptionalHeader = 0;
+    if (!read(fileHeader, &m_machine) ||
+        !read(fileHeader + 2, &numberOfSections) ||
+        !read(fileHeader + 16, &sizeOfOptionalHeader)) {
+        m_status = Truncated;
+        return;
+    }
+
+    // Images without an optional header still report their machine type,
+    // they simply expose no data directories.
+    const qint64 optionalHeader = fileHeader + kFileHeaderSize;
+    if (sizeOfOptionalHeader >= 2) {
+        quint16 magic = 0;
+        if (!read(optionalHeader, &magic)) {
+            m_status = Truncated;
+            return;
+        }
+        if (magic != kOptionalMagicPE32 && magic != kOptionalMagicPE32Plus) {
+            m_status = BadOptionalHeader;
+            return;
+        }
+        m_is64 = (magic == kOptionalMagicPE32Plus);
+        if (m_is64) {
+            parseOptionalHeader<PE64Layout>(optionalHeader, sizeOfOptionalHeader);
+        } else {
+            parseOptionalHeader<PE32Layout>(optionalHeader, sizeOfOptionalHeader);
+        }
+    }
+
+    const qint64 sectionTable = optionalHeader + sizeOfOptionalHeader;
+    m_sections.reserve(numberOfSections);
+    for (int i = 0; i < numberOfSections; ++i) {
+        const qint64 entry = sectionTable + i * kSectionHeaderSize;
+        Section section;
+        const uchar* name = at(entry, sizeof(section.name));
+        if (!name) {
+            break;
+        }
+        memcpy(section.name, name, sizeof(section.name));
+        if (!read(entry + 8, &section.virtualSize) ||
+            !read(entry + 12, &section.virtualAddress) ||
+            !read(entry + 16, &section.rawSize) ||
+            !read(entry + 20, &section.rawOffset)) {
+            break;
+        }
+        m_sections.append(section);
+    }
+
+    // Sorted once, so every RVA translation is a binary search
+    std::stable_sort(m_sections.begin(), m_sections.end(), sectionBefore);
+
+    m_status = Ok;
+}
+
+template <typename Layout>
+void PEImage::parseOptionalHeader(qint64 optionalHeader, quint16 sizeOfOptionalHeader)
+{
+    typename Layout::ImageBase imageBase = 0;
+    read(optionalHeader + Layout::ImageBaseOffset, &imageBase);
+    m_imageBase = imageBase;
+    read(optionalHeader + 60, &m_sizeOfHeaders);
+
+    const qint64 countOffset = optionalHeader + Layout::DirectoryCountOffset;
+    const qint64 directoryOffset = countOffset + 4;
+    quint32 count = 0;
+    if (countOffset + 4 > optionalHeader + sizeOfOptionalHeader) {
+        return;
+    }
+    if (!read(countOffset, &count)) {
+        m_directoriesTruncated = true;
+        return;
+    }
+
+    count = qMin<quint32>(count, kMaxDirectories);
+    const qint64 available = (optionalHeader + sizeOfOptionalHeader - directoryOffset) / 8;
+    count = quint32(qMin<qint64>(count, available));
+    m_directories.reserve(int(count) * 2);
+    for (quint32 i = 0; i < count; ++i) {
+        quint32 rva = 0;
+        quint32 size = 0;
+        if (!read(directoryOffset + i * 8, &rva) ||
+            !read(directoryOffset + i * 8 + 4, &size)) {
+            m_directoriesTruncated = true;
+            break;
+        }
+        m_directories.append(rva);
+        m_directories.append(size);
+    }
+}
+
+bool PEImage::directory(int index, quint32* rva, quint32* size) const
+{
+    if (index < 0 || index * 2 + 1 >= m_directories.size()) {
+        return false;
+    }
+    const quint32 dirRva = m_directories.at(index * 2);
+    const quint32 dirSize = m_directories.at(index * 2 + 1);
+    if (dirRva == 0) {
+        return false;
+    }
+    if (rva) {
+        *rva = dirRva;
+    }
+    if (size) {
+        *size = dirSize;
+    }
+    return true;
+}
+
+bool PEImage::findSection(const char* name, Section* section) const
+{
+    const size_t length = qstrlen(name);
+    if (length > sizeof(section->name)) {
+        return false;
+    }
+    for (const Section& candidate : m_sections) {
+        if (memcmp(candidate.name, name, length) == 0 &&
+            (length == sizeof(candidate.name) || candidate.name[length] == '\0')) {
+            *section = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+qint64 PEImage::rvaToOffset(quint32 rva) const
+{
+    // Last section starting at or below the RVA
+    Section key;
+    key.virtualAddress = rva;
+    auto it = std::upper_bound(m_sections.constBegin(), m_sections.constEnd(), key, sectionBefore);
+    if (it != m_sections.constBegin()) {
+        const Section& section = *(it - 1);
+        const quint32 extent = section.virtualSize ? section.virtualSize : section.rawSize;
+        const quint32 delta = rva - section.virtualAddress;
+        if (delta < extent) {
+            if (delta >= section.rawSize) {
+                return -1;  // Uninitialized data, not present in the file
+            }
+            return qint64(section.rawOffset) + delta;
+        }
+    }
+
+    // RVAs inside the headers map 1:1 to file offsets
+    if (rva < m_sizeOfHeaders || m_sections.isEmpty()) {
+        return rva < m_size ? qint64(rva) : -1;
+    }
+    return -1;
+}
+
+const uchar* PEImage::at(qint64 offset, qint64 length) const
+{
+    if (offset < 0 || length < 0 || offset > m_size || length > m_size - offset) {
+        return nullptr;
+    }
+    if (m_source) {
+        return m_source->map(offset, length);
+    }
+    return m_data ? m_data + offset : nullptr;
+}
+
+bool PEImage::stringAtRva(quint32 rva, NameRef* name) const
+{
+    const qint64 offset = rvaToOffset(rva);
+    if (offset < 0 || offset >= m_size) {
+        return false;
+    }
+
+    // Names are short; grow the window only if the terminator is not found
+    const qint64 limit = qMin(m_size - offset, kMaxNameLength);
+    for (qint64 window = qMin<qint64>(256, limit); ; window = qMin(window * 16, limit)) {
+        const char* begin = reinterpret_cast<const char*>(at(offset, window));
+        if (!begin) {
+            return false;
+        }
+        const void* end = std::memchr(begin, '\0', size_t(window));
+        if (end) {
+            name->data = begin;
+            name->length = int(static_cast<const char*>(end) - begin);
+            return true;
+        }
+        if (window == limit) {
+            return false;
+        }
+    }
+}
+
+QVector<PEImage::NameRef> PEImage::importedModules() const
+{
+    QVector<NameRef> modules;
+
+    quint32 importRva = 0;
+    if (!isValid() || !directory(ImportDirectory, &importRva, nullptr)) {
+        return modules;
+    }
+
+    const qint64 base = rvaToOffset(importRva);
+    if (base < 0) {
+        return modules;
+    }
+
+    for (qint64 descriptor = base; ; descriptor += kImportDescriptorSize) {
+        quint32 nameRva = 0;
+        if (!read(descriptor + 12, &nameRva) || nameRva == 0) {
+            break;
+        }
+        NameRef name;
+        if (stringAtRva(nameRva, &name) && name.length > 0) {
+            modules.append(name);
+        }
+    }
+
+    return modules;
+}
+
+QVector<PEImage::ImportedModule> PEImage::importTable() const
+{
+    // Pick the layout once instead of checking the thunk width per entry
+    return m_is64 ? readImportTable<PE64Layout>() : readImportTable<PE32Layout>();
+}
+
+template <typename Layout>
+QVector<PEImage::ImportedModule> PEImage::readImportTable() const
+{
+    typedef typename Layout::Thunk Thunk;
+    QVector<ImportedModule> modules;
+
+    quint32 importRva = 0;
+    if (!isValid() || !directory(ImportDirectory, &importRva, nullptr)) {
+        return modules;
+    }
+
+    const qint64 base = rvaToOffset(importRva);
+    if (base < 0) {
+        return modules;
+    }
+
+    for (qint64 descriptor = base; ; descriptor += kImportDescriptorSize) {
+        quint32 nameRva = 0;
+        if (!read(descriptor + 12, &nameRva) || nameRva == 0) {
+            break;
+        }
+        ImportedModule module;
+        if (!stringAtRva(nameRva, &module.name) || module.name.length == 0) {
+            continue;
+        }
+
+        // Prefer the lookup table (OriginalFirstThunk); old linkers only fill the IAT
+        quint32 thunkRva = 0;
+        if (!read(descriptor, &thunkRva) || thunkRva == 0) {
+            read(descriptor + 16, &thunkRva);
+        }
+        const qint64 thunks = thunkRva ? rvaToOffset(thunkRva) : -1;
+
+        for (int i = 0; thunks >= 0 && i < kMaxSymbolsPerModule; ++i) {
+            Thunk thunk = 0;
+            if (!read(thunks + qint64(i) * qint64(sizeof(Thunk)), &thunk) || thunk == 0) {
+                break;
+            }
+
+            ImportedSymbol symbol;
+            symbol.name.data = nullptr;
+            symbol.name.length = 0;
+            if (thunk & Thunk(Layout::OrdinalFlag)) {
+                symbol.ordinal = quint16(thunk & 0xFFFF);
+            } else {
+                // IMAGE_IMPORT_BY_NAME: Hint, then the NUL-terminated name
+                const quint32 hintNameRva = quint32(thunk & 0x7FFFFFFF);
+                const qint64 hintOffset = rvaToOffset(hintNameRva);
+                if (hintOffset < 0 || !read(hintOffset, &symbol.ordinal) ||
+                    !stringAtRva(hintNameRva + 2, &symbol.name)) {
+                    continue;
+                }
+            }
+            module.symbols.append(symbol);
+        }
+
+        modules.append(module);
+    }
+
+    return modules;
+}
+
+QVector<PEImage::NameRef> PEImage::delayImportedModules() const
+{
+    QVector<NameRef> modules;
+
+    quint32 delayRva = 0;
+    if (!isValid() || !directory(DelayImportDirectory, &delayRva, nullptr)) {
+        return modules;
+    }
+
+    const qint64 base = rvaToOffset(delayRva);
+    if (base < 0) {
+        return modules;
+    }
+
+    // IMAGE_DELAYLOAD_DESCRIPTOR: Attributes, DllNameRVA, ... (32 bytes each)
+    for (qint64 descriptor = base; ; descriptor += kDelayImportDescriptorSize) {
+        quint32 attributes = 0;
+        quint32 nameField = 0;
+        if (!read(descriptor, &attributes) || !read(descriptor + 4, &nameField) || nameField == 0) {
+            break;
+        }
+
+        // Pre-VC7 descriptors hold virtual addresses instead of RVAs
+        quint64 nameRva = nameField;
+        if (!(attributes & kDelayAttributeRvaBased)) {
+            if (nameRva < m_imageBase) {
+                continue;
+            }
+            nameRva -= m_imageBase;
+        }
+
+        NameRef name;
+        if (nameRva <= 0xFFFFFFFFu && stringAtRva(quint32(nameRva), &name) && name.length > 0) {
+            modules.append(name);
+        }
+    }
+
+    return modules;
+}
+
+QVector<PEImage::ExportedSymbol> PEImage::exportedSymbols() const
+{
+    QVector<ExportedSymbol> symbols;
+
+    quint32 exportRva = 0;
+    quint32 exportSize = 0;
+    if (!isValid() || !directory(ExportDirectory, &exportRva, &exportSize)) {
+        return symbols;
+    }
+
+    const qint64 directoryOffset = rvaToOffset(exportRva);
+    const uchar* directoryData = directoryOffset >= 0 ? at(directoryOffset, kExportDirectorySize) : nullptr;
+    if (!directoryData) {
+        return symbols;
+    }
+
+    // IMAGE_EXPORT_DIRECTORY
+    const quint32 ordinalBase = qFromLittleEndian<quint32>(directoryData + 16);
+    const quint32 functionCount = qFromLittleEndian<quint32>(directoryData + 20);
+    quint32 nameCount = qFromLittleEndian<quint32>(directoryData + 24);
+    const quint32 functionsRva = qFromLittleEndian<quint32>(directoryData + 28);
+    const quint32 namesRva = qFromLittleEndian<quint32>(directoryData + 32);
+    const quint32 ordinalsRva = qFromLittleEndian<quint32>(directoryData + 36);
+
+    // Address tables are bounds-checked once and then read directly
+    const qint64 functionsOffset = rvaToOffset(functionsRva);
+    const uchar* functions = functionsOffset >= 0 ? at(functionsOffset, qint64(functionCount) * 4) : nullptr;
+    if (!functions) {
+        return symbols;
+    }
+    const qint64 namesOffset = rvaToOffset(namesRva);
+    const qint64 ordinalsOffset = rvaToOffset(ordinalsRva);
+    const uchar* names = namesOffset >= 0 ? at(namesOffset, qint64(nameCount) * 4) : nullptr;
+    const uchar* nameOrdinals = ordinalsOffset >= 0 ? at(ordinalsOffset, qint64(nameCount) * 2) : nullptr;
+    if (!names || !nameOrdinals) {
+        nameCount = 0;
+    }
+
+    // Export RVAs that point back into the export directory are forwarder strings
+    auto makeSymbol = [&](quint32 index, const NameRef& name, ExportedSymbol* symbol) -> bool {
+        const quint32 rva = qFromLittleEndian<quint32>(functions + qint64(index) * 4);
+        if (rva == 0) {
+            return false;
+        }
+        symbol->name = name;
+        symbol->ordinal = ordinalBase + index;
+        symbol->forwarder.data = nullptr;
+        symbol->forwarder.length = 0;
+        if (rva - exportRva < exportSize && !stringAtRva(rva, &symbol->forwarder)) {
+            return false;
+        }
+        return true;
+    };
+
+    symbols.reserve(int(qMin<quint32>(functionCount, quint32(m_size / 4))));
+    QVector<bool> named(int(functionCount), false);
+    for (quint32 i = 0; i < nameCount; ++i) {
+        const quint16 index = qFromLittleEndian<quint16>(nameOrdinals + qint64(i) * 2);
+        NameRef name;
+        ExportedSymbol symbol;
+        if (index >= functionCount ||
+            !stringAtRva(qFromLittleEndian<quint32>(names + qint64(i) * 4), &name) ||
+            !makeSymbol(index, name, &symbol)) {
+            continue;
+        }
+        named[index] = true;
+        symbols.append(symbol);
+    }
+
+    // Exports reachable by ordinal only
+    NameRef noName;
+    noName.data = nullptr;
+    noName.length = 0;
+    for (quint32 index = 0; index < functionCount; ++index) {
+        ExportedSymbol symbol;
+        if (!named[int(index)] && makeSymbol(index, noName, &symbol)) {
+            symbols.append(symbol);
+        }
+    }
+
+    return symbols;
+}
+
+bool PEImage::findResource(quint32 type, quint32 id, qint64* offset, quint32* size) const
+{
+    quint32 resourceRva = 0;
+    if (!isValid() || !directory(ResourceDirectory, &resourceRva, nullptr)) {
+        return false;
+    }
+
+    const qint64 root = rvaToOffset(resourceRva);
+    if (root < 0) {
+        return false;
+    }
+
+    // Find the entry with the given numeric id in the directory at dirOffset.
+    // Returns the raw OffsetToData field, or 0 if not found.
+    auto findEntry = [this](qint64 dirOffset, quint32 wantedId) -> quint32 {
+        quint16 namedCount = 0;
+        quint16 idCount = 0;
+        if (!read(dirOffset + 12, &namedCount) || !read(dirOffset + 14, &idCount)) {
+            return 0;
+        }
+        const qint64 entries = dirOffset + 16;
+        for (int i = namedCount; i < namedCount + idCount; ++i) {
+            quint32 entryName = 0;
+            quint32 entryData = 0;
+            if (!read(entries + i * kResourceEntrySize, &entryName) ||
+                !read(entries + i * kResourceEntrySize + 4, &entryData)) {
+                return 0;
+            }
+            if ((entryName & 0x80000000u) == 0 && (wantedId == 0 || entryName == wantedId)) {
+                return entryData;
+            }
+        }
+        return 0;
+    };
+
+    // Type -> Name -> Language
+    quint32 entry = findEntry(root, type);
+    if (!(entry & 0x80000000u)) {
+        return false;
+    }
+    entry = findEntry(root + (entry & 0x7FFFFFFFu), id);
+    if (!(entry & 0x80000000u)) {
+        return false;
+    }
+    entry = findEntry(root + (entry & 0x7FFFFFFFu), 0);
+    if (entry == 0 || (entry & 0x80000000u)) {
+        return false;
+    }
+
+    // IMAGE_RESOURCE_DATA_ENTRY
+    quint32 dataRva = 0;
+    quint32 dataSize = 0;
+    const qint64 dataEntry = root + entry;
+    if (!read(dataEntry, &dataRva) || !read(dataEntry + 4, &dataSize)) {
+        return false;
+    }
+
+    const qint64 dataOffset = rvaToOffset(dataRva);
+    if (dataOffset < 0 || !at(dataOffset, dataSize)) {
+        return false;
+    }
+
+    *offset = dataOffset;
+    *size = dataSize;
+    return true;
+}
+
+bool PEImage::versionResource(qint64* offset, quint32* size) const
+{
+    return findResource(kResourceTypeVersion, 0, offset, size);
+}
@@ -1,10 +1,126 @@
 #include "peparser.h"
-#include <QFile>
 #include <QFileInfo>
 #include <QDateTime>
+#include <cstring>
 
-PEParser::PEInfo PEParser::parsePEFile(const QString& filePath)
+namespace {
+const qint64 kProbePageSize = 4096;
+
+// Files up to this size are mapped whole; larger ones in windows
+const qint64 kWholeMapThreshold = 16 * 1024 * 1024;
+const qint64 kWindowSize = 64 * 1024;
+
+// Upper bound of mapped bytes per file, whatever the file size
+const qint64 kMaxMappedBytes = 64 * 1024 * 1024;
+
+// Larger files are not digested: the windowed parse reads only a few pages
+// of a multi-GB CUDA DLL, while hashing would read all of it.
+// Streaming windows are mapped one at a time.
+const qint64 kMaxDigestSize = 64 * 1024 * 1024;
+const qint64 kDigestWindowSize = 4 * 1024 * 1024;
+}
+
+WindowedImageGuard::WindowedImageGuard(const QString& filePath)
+    : m_file(filePath)
+    , m_size(0)
+    , m_mappedBytes(0)
+    , m_contentDigest(0)
+    , m_digestComputed(false)
+{
+    if (m_file.open(QIODevice::ReadOnly)) {
+        m_size = m_file.size();
+        if (m_size > 0 && m_size <= kWholeMapThreshold) {
+            map(0, m_size);
+        }
+    }
+}
+
+WindowedImageGuard::~WindowedImageGuard()
 {
+    for (const Window& window : m_windows) {
+        m_file.unmap(window.data);
+    }
+}
+
+const uchar* WindowedImageGuard::map(qint64 offset, qint64 length)
+{
+    if (offset < 0 || length < 0 || offset + length > m_size) {
+        return nullptr;
+    }
+
+    for (const Window& window : m_windows) {
+        if (offset >= window.offset && offset + length <= window.offset + window.length) {
+            return window.data + (offset - window.offset);
+        }
+    }
+
+    // Map a new window rounded out to kWindowSize boundaries
+    const qint64 start = offset - offset % kWindowSize;
+    const qint64 end = qMin(m_size, ((offset + length + kWindowSize - 1) / kWindowSize) * kWindowSize);
+    if (m_mappedBytes + (end - start) > kMaxMappedBytes) {
+        return nullptr;
+    }
+
+    uchar* data = m_file.map(start, end - start);
+    if (!data) {
+        return nullptr;
+    }
+
+    Window window;
+    window.offset = start;
+    window.length = end - start;
+    window.data = data;
+    m_windows.append(window);
+    m_mappedBytes += window.length;
+    return data + (offset - start);
+}
+
+bool WindowedImageGuard::isWholeMapped() const
+{
+    return m_size > 0 && m_size <= kWholeMapThreshold;
+}
+
+quint64 WindowedImageGuard::contentDigest()
+{
+    if (m_digestComputed) {
+        return m_contentDigest;
+    }
+    m_digestComputed = true;
+    
+    if (m_size <= 0 || m_size > kMaxDigestSize) {
+        return 0;
+    }
+    
+    if (m_size <= kWholeMapThreshold) {
+        // Already mapped in one piece by the constructor
+        const uchar* data = map(0, m_size);
+        m_contentDigest = data ? ContentDigest::compute(data, m_size) : 0;
+        return m_contentDigest;
+    }
+    
+    // Stream the file without keeping the windows, so the parse budget is untouched
+    ContentDigest digest;
+    for (qint64 offset = 0; offset < m_size; offset += kDigestWindowSize) {
+        const qint64 length = qMin(kDigestWindowSize, m_size - offset);
+        uchar* data = m_file.map(offset, length);
+        if (!data) {
+            return 0;
+        }
+        digest.update(data, length);
+        m_file.unmap(data);
+    }
+    m_contentDigest = digest.finish();
+    return m_contentDigest;
+}
+
+PEParser::PEInfo PEParser::parsePEFile(const QString& filePath, int flags)
+{
+    return parsePEFile(QSharedPointer<WindowedImageGuard>(new WindowedImageGuard(filePath)), flags);
+}
+
+PEParser::PEInfo PEParser::parsePEFile(const QSharedPointer<WindowedImageGuard>& source, int flags)
+{
+    const QString filePath = source->filePath();
     PEInfo info;
     info.filePath = filePath;
     info.isValid = false;
@@ -20,8 +136,17 @@ PEParser::PEInfo PEParser::parsePEFile(const QString& filePath)
     info.fileSize = fileInfo.size();
     info.modifiedTime = fileInfo.lastModified();
     
+    // Headers, imports and version resource are read through the same
+    // bounded set of mapped windows
+    const PEImage image(source.data());
+    if ((flags & ParseContentDigest) && source->isWholeMapped()) {
+        // Larger files would be streamed through extra windows; the caller
+        // asks for their digest only when it needs one
+        info.contentDigest = source->contentDigest();
+    }
+    
     // Get architecture
-    info.arch = getArchitecture(filePath);
+    info.arch = architectureFromImage(image);
     if (info.arch == Unknown) {
         info.errorMessage = QString("无效的PE文件或不支持的架构: %1\n\n"
             "可能的原因：\n"
@@ -32,151 +157,290 @@ PEParser::PEInfo PEParser::parsePEFile(const QString& filePath)
     }
     
     // Get imported DLLs
-    info.dependencies = getImportedDLLs(filePath);
+    const QVector<PEImage::NameRef> delayModules = image.delayImportedModules();
+    if (flags & (ParseImportViews | ParseImportSymbols)) {
+        // Names stay in the mapping; PEInfo keeps it alive with the views
+        if (flags & ParseImportSymbols) {
+            const QVector<PEImage::ImportedModule> table = image.importTable();
+            info.imports.reserve(table.size());
+            info.importSymbols.reserve(table.size());
+            for (const PEImage::ImportedModule& module : table) {
+                info.imports.append(NameFolding::makeName(module.name.data, module.name.length));
+                info.importSymbols.append(module.symbols);
+            }
+        } else {
+            info.imports = toImportNames(image.importedModules());
+        }
+        info.delayImports = toImportNames(delayModules);
+        info.image = source;
+    } else {
+        info.dependencies = toStringList(image.importedModules());
+        info.delayDependencies = toStringList(delayModules);
+    }
     
-    // Get version information
-    QPair<QString, QString> versions = getVersionInfo(filePath);
-    info.fileVersion = versions.first;
-    info.productVersion = versions.second;
+    // Get version information from the same mapping
+    readVersionResource(image, &info, flags);
     
     info.isValid = true;
     return info;
 }
 
-QStringList PEParser::getImportedDLLs(const QString& filePath)
+void PEParser::detachImports(PEInfo* info)
+{
+    // One buffer for every name, NUL-terminated like the originals
+    qint64 total = 0;
+    for (const ImportName& name : info->imports) {
+        total += name.length + 1;
+    }
+    for (const ImportName& name : info->delayImports) {
+        total += name.length + 1;
+    }
+    for (const QVector<PEImage::ImportedSymbol>& symbols : info->importSymbols) {
+        for (const PEImage::ImportedSymbol& symbol : symbols) {
+            if (symbol.name.data) {
+                total += symbol.name.length + 1;
+            }
+        }
+    }
+
+    QByteArray* names = new QByteArray(int(total), '\0');
+    char* next = names->data();
+    const auto copy = [&next](const char* data, int length) {
+        memcpy(next, data, size_t(length));
+        const char* copied = next;
+        next += length + 1;
+        return copied;
+    };
+    for (ImportName& name : info->imports) {
+        name.data = copy(name.data, name.length);
+    }
+    for (ImportName& name : info->delayImports) {
+        name.data = copy(name.data, name.length);
+    }
+    for (QVector<PEImage::ImportedSymbol>& symbols : info->importSymbols) {
+        for (PEImage::ImportedSymbol& symbol : symbols) {
+            if (symbol.name.data) {
+                symbol.name.data = copy(symbol.name.data, symbol.name.length);
+            }
+        }
+    }
+    info->names = QSharedPointer<const QByteArray>(names);
+    info->image.clear();
+}
+
+PEParser::HeaderProbe PEParser::probeHeader(const QString& filePath)
 {
-    QStringList dlls;
+    HeaderProbe probe;
     
-    LoadedImageGuard imageGuard(filePath);
-    if (!imageGuard.isValid()) {
-        return dlls;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return probe;
     }
     
-    PLOADED_IMAGE loadedImage = imageGuard.get();
+    const qint64 fileSize = file.size();
+    const QByteArray page = file.read(kProbePageSize);
+    file.close();
     
-    // Get the import descriptor
-    ULONG size;
-    PIMAGE_IMPORT_DESCRIPTOR importDesc = (PIMAGE_IMPORT_DESCRIPTOR)ImageDirectoryEntryToData(
-        loadedImage->MappedAddress, FALSE, IMAGE_DIRECTORY_ENTRY_IMPORT, &size);
+    const PEImage image(reinterpret_cast<const uchar*>(page.constData()), page.size());
+    if (image.status() == PEImage::Truncated && fileSize > page.size()) {
+        // e_lfanew or the optional header lies beyond the first page
+        probe.kind = NeedsFullParse;
+        return probe;
+    }
+    if (!image.isValid()) {
+        return probe;
+    }
     
-    if (importDesc) {
-        // Iterate through import descriptors
-        while (importDesc->Name != 0) {
-            // Get DLL name
-            PSTR dllName = (PSTR)ImageRvaToVa(loadedImage->FileHeader, 
-                                             loadedImage->MappedAddress,
-                                             importDesc->Name, NULL);
-            if (dllName) {
-                dlls.append(QString::fromLatin1(dllName));
-            }
-            importDesc++;
+    probe.arch = architectureFromImage(image);
+
+    // An import directory past the page is not an absent one; never a false leaf
+    if (image.directoriesTruncated() && fileSize > page.size()) {
+        probe.kind = NeedsFullParse;
+        return probe;
+    }
+    
+    // Delay-load imports count as well: their DLLs are resolved for the missing report
+    const PEImage::DirectoryEntry directories[] = { PEImage::ImportDirectory, PEImage::DelayImportDirectory };
+    probe.kind = NoImports;
+    for (PEImage::DirectoryEntry entry : directories) {
+        quint32 rva = 0;
+        if (!image.directory(entry, &rva, nullptr)) {
+            continue;
+        }
+        // The descriptors must be backed by file data
+        const qint64 offset = image.rvaToOffset(rva);
+        if (offset < 0 || offset >= fileSize) {
+            probe.kind = NeedsFullParse;
+        } else {
+            probe.kind = HasImports;
+            return probe;
         }
     }
+    return probe;
+}
+
+QStringList PEParser::getImportedDLLs(const QString& filePath)
+{
+    WindowedImageGuard source(filePath);
+    if (!source.isValid()) {
+        return QStringList();
+    }
+    
+    return toStringList(PEImage(&source).importedModules());
+}
+
+QStringList PEParser::getDelayImportedDLLs(const QString& filePath)
+{
+    WindowedImageGuard source(filePath);
+    if (!source.isValid()) {
+        return QStringList();
+    }
     
-    return dlls;
+    return toStringList(PEImage(&source).delayImportedModules());
+}
+
+QSharedPointer<const ExportIndex> PEParser::getExportIndex(const QString& filePath)
+{
+    WindowedImageGuard source(filePath);
+    if (!source.isValid()) {
+        return QSharedPointer<const ExportIndex>();
+    }
+    
+    const PEImage image(&source);
+    if (!image.isValid()) {
+        return QSharedPointer<const ExportIndex>();
+    }
+    
+    return QSharedPointer<const ExportIndex>(new ExportIndex(image));
+}
+
+quint64 PEParser::getContentDigest(const QString& filePath)
+{
+    WindowedImageGuard source(filePath);
+    return source.contentDigest();
 }
 
 PEParser::Architecture PEParser::getArchitecture(const QString& filePath)
 {
-    // Open file
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
+    WindowedImageGuard source(filePath);
+    if (!source.isValid()) {
         return Unknown;
     }
     
-    // Read DOS header
-    IMAGE_DOS_HEADER dosHeader;
-    if (file.read((char*)&dosHeader, sizeof(dosHeader)) != sizeof(dosHeader)) {
-        file.close();
-        return Unknown;
+    return architectureFromImage(PEImage(&source));
+}
+
+QPair<QString, QString> PEParser::getVersionInfo(const QString& filePath)
+{
+    QPair<QString, QString> versions("", "");
+    
+    WindowedImageGuard source(filePath);
+    if (!source.isValid()) {
+        return versions;
     }
     
-    // Check DOS signature
-    if (dosHeader.e_magic != IMAGE_DOS_SIGNATURE) {
-        file.close();
-        return Unknown;
+    PEInfo info;
+    if (readVersionResource(PEImage(&source), &info, ParseDefault)) {
+        versions.first = info.fileVersion;
+        versions.second = info.productVersion;
+    }
+    
+    return versions;
+}
+
+QMap<QString, QString> PEParser::getVersionStrings(const QString& filePath)
+{
+    WindowedImageGuard source(filePath);
+    if (!source.isValid()) {
+        return QMap<QString, QString>();
     }
     
-    // Seek to PE header
-    file.seek(dosHeader.e_lfanew);
+    PEInfo info;
+    readVersionResource(PEImage(&source), &info, ParseVersionStrings);
+    return info.versionStrings;
+}
+
+bool PEParser::readVersionResource(const PEImage& image, PEInfo* info, int flags)
+{
+    qint64 offset = 0;
+    quint32 size = 0;
+    if (!image.versionResource(&offset, &size)) {
+        return false;
+    }
     
-    // Read PE signature
-    DWORD peSignature;
-    if (file.read((char*)&peSignature, sizeof(peSignature)) != sizeof(peSignature)) {
-        file.close();
-        return Unknown;
+    // Decode VS_VERSIONINFO in place; no extra I/O or copy of the block
+    const VersionResource resource(image.at(offset, size), size);
+    if (!resource.isValid()) {
+        return false;
     }
     
-    // Check PE signature
-    if (peSignature != IMAGE_NT_SIGNATURE) {
-        file.close();
-        return Unknown;
+    if (resource.hasFixedInfo()) {
+        info->fileVersion = formatVersion(resource.fileVersion());
+        info->productVersion = formatVersion(resource.productVersion());
     }
     
-    // Read file header
-    IMAGE_FILE_HEADER fileHeader;
-    if (file.read((char*)&fileHeader, sizeof(fileHeader)) != sizeof(fileHeader)) {
-        file.close();
-        return Unknown;
+    if (flags & ParseVersionStrings) {
+        for (const VersionResource::StringEntry& entry : resource.strings()) {
+            info->versionStrings.insert(toQString(entry.key), toQString(entry.value));
+        }
     }
     
-    file.close();
+    return resource.hasFixedInfo();
+}
+
+PEParser::Architecture PEParser::architectureFromImage(const PEImage& image)
+{
+    if (!image.isValid()) {
+        return Unknown;
+    }
     
     // Determine architecture from Machine field
-    switch (fileHeader.Machine) {
-        case IMAGE_FILE_MACHINE_I386:
+    switch (image.machine()) {
+        case PEImage::MachineI386:
             return x86;
-        case IMAGE_FILE_MACHINE_AMD64:
+        case PEImage::MachineAmd64:
             return x64;
         default:
             return Unknown;
     }
 }
 
-QPair<QString, QString> PEParser::getVersionInfo(const QString& filePath)
+QString PEParser::formatVersion(quint64 version)
 {
-    QPair<QString, QString> versions("", "");
-    
-    // Convert to wide string
-    std::wstring wFilePath = filePath.toStdWString();
-    
-    // Get version info size
-    DWORD handle = 0;
-    DWORD size = GetFileVersionInfoSizeW(wFilePath.c_str(), &handle);
-    if (size == 0) {
-        return versions;
+    return QString("%1.%2.%3.%4")
+        .arg((version >> 48) & 0xFFFF)
+        .arg((version >> 32) & 0xFFFF)
+        .arg((version >> 16) & 0xFFFF)
+        .arg(version & 0xFFFF);
+}
+
+QStringList PEParser::toStringList(const QVector<PEImage::NameRef>& names)
+{
+    QStringList list;
+    list.reserve(names.size());
+    for (const PEImage::NameRef& name : names) {
+        list.append(QString::fromLatin1(name.data, name.length));
     }
-    
-    // Allocate buffer using QByteArray for automatic memory management
-    QByteArray buffer(size, 0);
-    if (!GetFileVersionInfoW(wFilePath.c_str(), handle, size, buffer.data())) {
-        return versions;
+    return list;
+}
+
+QVector<PEParser::ImportName> PEParser::toImportNames(const QVector<PEImage::NameRef>& names)
+{
+    QVector<ImportName> views;
+    views.reserve(names.size());
+    for (const PEImage::NameRef& name : names) {
+        views.append(NameFolding::makeName(name.data, name.length));
     }
-    
-    // Get fixed file info
-    VS_FIXEDFILEINFO* fileInfo = nullptr;
-    UINT len = 0;
-    if (VerQueryValueW(buffer.data(), L"\\", (LPVOID*)&fileInfo, &len)) {
-        // Extract file version
-        DWORD fileVersionMS = fileInfo->dwFileVersionMS;
-        DWORD fileVersionLS = fileInfo->dwFileVersionLS;
-        versions.first = QString("%1.%2.%3.%4")
-            .arg(HIWORD(fileVersionMS))
-            .arg(LOWORD(fileVersionMS))
-            .arg(HIWORD(fileVersionLS))
-            .arg(LOWORD(fileVersionLS));
-        
-        // Extract product version
-        DWORD productVersionMS = fileInfo->dwProductVersionMS;
-        DWORD productVersionLS = fileInfo->dwProductVersionLS;
-        versions.second = QString("%1.%2.%3.%4")
-            .arg(HIWORD(productVersionMS))
-            .arg(LOWORD(productVersionMS))
-            .arg(HIWORD(productVersionLS))
-            .arg(LOWORD(productVersionLS));
+    return views;
+}
+
+QString PEParser::toQString(const VersionResource::Utf16Ref& text)
+{
+    QString result(text.length, Qt::Uninitialized);
+    for (int i = 0; i < text.length; ++i) {
+        result[i] = QChar(text.at(i));
     }
-    
-    return versions;
+    return result;
 }
 
 QString PEParser::architectureToString(Architecture arch)
@@ -1,6 +1,7 @@
 #include "reportgenerator.h"
 #include "peparser.h"
 #include <QMap>
+#include <QSet>
 #include <QStringList>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -11,7 +12,7 @@
 #include <QFile>
 #include <QTextStream>
 
-QString ReportGenerator::generateMissingReport(const QList<DependencyScanner::NodePtr>& roots,
+QString ReportGenerator::generateMissingReport(const QList<DependencyScanner::NodeHandle>& roots,
                                               ReportFormat format)
 {
     QByteArray data;
@@ -31,7 +32,7 @@ QString ReportGenerator::generateMissingReport(const QList<DependencyScanner::No
     return QString::fromUtf8(data);
 }
 
-bool ReportGenerator::writeMissingReport(const QList<DependencyScanner::NodePtr>& roots,
+bool ReportGenerator::writeMissingReport(const QList<DependencyScanner::NodeHandle>& roots,
                                          ReportFormat format,
                                          const QString& filePath)
 {
@@ -43,7 +44,7 @@ bool ReportGenerator::writeMissingReport(const QList<DependencyScanner::NodePtr>
     return writeMissingReportToFile(roots, format, &file);
 }
 
-bool ReportGenerator::writeMissingReportToFile(const QList<DependencyScanner::NodePtr>& roots,
+bool ReportGenerator::writeMissingReportToFile(const QList<DependencyScanner::NodeHandle>& roots,
                                                ReportFormat format,
                                                QIODevice* device)
 {
@@ -56,11 +57,13 @@ bool ReportGenerator::writeMissingReportToFile(const QList<DependencyScanner::No
 
     // Collect all missing dependencies grouped by DLL name
     QMap<QString, QStringList> missingMap;
-    for (const auto& root : roots) {
-        collectMissingDependencies(root, missingMap);
+    QMap<QString, QStringList> symbolMap;
+    for (const auto& module : DependencyScanner::modules(roots)) {
+        collectMissingDependencies(module, missingMap);
+        collectMissingSymbols(module, symbolMap);
     }
 
-    if (missingMap.isEmpty()) {
+    if (missingMap.isEmpty() && symbolMap.isEmpty()) {
         if (format == HTML) {
             stream << "<html><body><h2>No missing dependencies found!</h2></body></html>";
         } else {
@@ -85,7 +88,18 @@ bool ReportGenerator::writeMissingReportToFile(const QList<DependencyScanner::No
                               .arg(it.key())
                               .arg(it.value().join("<br>"));
             }
-            stream << "</table></body></html>";
+            stream << "</table>";
+            if (!symbolMap.isEmpty()) {
+                stream << "<h2>Missing Symbols</h2>";
+                stream << "<table><tr><th>DLL!Symbol</th><th>Required By</th></tr>";
+                for (auto it = symbolMap.begin(); it != symbolMap.end(); ++it) {
+                    stream << QString("<tr><td><b>%1</b></td><td>%2</td></tr>")
+                                  .arg(it.key())
+                                  .arg(it.value().join("<br>"));
+                }
+                stream << "</table>";
+            }
+            stream << "</body></html>";
             break;
 
         case CSV:
@@ -95,29 +109,46 @@ bool ReportGenerator::writeMissingReportToFile(const QList<DependencyScanner::No
                               .arg(it.key())
                               .arg(it.value().join("; "));
             }
+            if (!symbolMap.isEmpty()) {
+                stream << "\nMissing Symbol,Required By\n";
+                for (auto it = symbolMap.begin(); it != symbolMap.end(); ++it) {
+                    stream << QString("\"%1\",\"%2\"\n")
+                                  .arg(it.key())
+                                  .arg(it.value().join("; "));
+                }
+            }
             break;
 
         case JSON: {
-            stream << "{\n  \"missing_dependencies\": [\n";
-            bool firstEntry = true;
-            for (auto it = missingMap.begin(); it != missingMap.end(); ++it) {
-                if (!firstEntry) {
-                    stream << ",\n";
-                }
-                firstEntry = false;
-                stream << "    {\n";
-                stream << QString("      \"dll\": \"%1\",\n").arg(it.key());
-                stream << "      \"required_by\": [";
-                for (int i = 0; i < it.value().size(); ++i) {
-                    stream << QString("\"%1\"").arg(it.value().at(i));
-                    if (i < it.value().size() - 1) {
-                        stream << ", ";
+            auto writeEntries = [&stream](const QMap<QString, QStringList>& map, const char* keyName) {
+                bool firstEntry = true;
+                for (auto it = map.begin(); it != map.end(); ++it) {
+                    if (!firstEntry) {
+                        stream << ",\n";
+                    }
+                    firstEntry = false;
+                    stream << "    {\n";
+                    stream << QString("      \"%1\": \"%2\",\n").arg(keyName).arg(it.key());
+                    stream << "      \"required_by\": [";
+                    for (int i = 0; i < it.value().size(); ++i) {
+                        stream << QString("\"%1\"").arg(it.value().at(i));
+                        if (i < it.value().size() - 1) {
+                            stream << ", ";
+                        }
                     }
+                    stream << "]\n";
+                    stream << "    }";
                 }
-                stream << "]\n";
-                stream << "    }";
+            };
+            stream << "{\n  \"missing_dependencies\": [\n";
+            writeEntries(missingMap, "dll");
+            stream << "\n  ]";
+            if (!symbolMap.isEmpty()) {
+                stream << ",\n  \"missing_symbols\": [\n";
+                writeEntries(symbolMap, "symbol");
+                stream << "\n  ]";
             }
-            stream << "\n  ]\n}";
+            stream << "\n}";
             break;
         }
 
@@ -131,21 +162,30 @@ bool ReportGenerator::writeMissingReportToFile(const QList<DependencyScanner::No
                 }
                 stream << "\n";
             }
+            if (!symbolMap.isEmpty()) {
+                stream << "=== Missing Symbols ===\n\n";
+                for (auto it = symbolMap.begin(); it != symbolMap.end(); ++it) {
+                    stream << QString("Missing symbol: %1\n").arg(it.key());
+                    stream << "Required by:\n";
+                    for (const QString& file : it.value()) {
+                        stream << QString("  - %1\n").arg(file);
+                    }
+                    stream << "\n";
+                }
+            }
             break;
     }
 
     return true;
 }
 
-QString ReportGenerator::generateTargetMissingReport(const QList<DependencyScanner::NodePtr>& roots,
+QString ReportGenerator::generateTargetMissingReport(const QList<DependencyScanner::NodeHandle>& roots,
                                                      ReportFormat format)
 {
     // 收集所有缺失的DLL
     QStringList missingDLLs;
-    for (const auto& root : roots) {
-        if (root) {
-            collectMissingDLLsRecursive(root, missingDLLs);
-        }
+    for (const auto& module : DependencyScanner::modules(roots)) {
+        collectMissingDLLs(module, missingDLLs);
     }
     
     // 去重
@@ -214,25 +254,20 @@ QString ReportGenerator::generateTargetMissingReport(const QList<DependencyScann
     return report;
 }
 
-void ReportGenerator::collectMissingDLLsRecursive(const DependencyScanner::NodePtr& node,
-                                                  QStringList& missingDLLs)
+void ReportGenerator::collectMissingDLLs(const DependencyScanner::NodeHandle& node,
+                                         QStringList& missingDLLs)
 {
     if (!node) return;
     
     // 如果当前节点是缺失的DLL，添加到列表
-    if (!node->exists && !node->fileName.isEmpty()) {
-        if (!missingDLLs.contains(node->fileName)) {
-            missingDLLs.append(node->fileName);
+    if (!node.exists() && !node.fileName().isEmpty()) {
+        if (!missingDLLs.contains(node.fileName())) {
+            missingDLLs.append(node.fileName());
         }
     }
-    
-    // 递归处理子节点
-    for (const auto& child : node->children) {
-        collectMissingDLLsRecursive(child, missingDLLs);
-    }
 }
 
-QString ReportGenerator::generateDependencyTreeReport(const DependencyScanner::NodePtr& root,
+QString ReportGenerator::generateDependencyTreeReport(const DependencyScanner::NodeHandle& root,
                                                      ReportFormat format)
 {
     if (!root) {
@@ -240,6 +275,8 @@ QString ReportGenerator::generateDependencyTreeReport(const DependencyScanner::N
     }
     
     QString report;
+    const DependencyScanner::DependencyEdge rootEdge(root);
+    QSet<const DependencyScanner::DependencyNode*> printed;
     
     switch (format) {
         case HTML:
@@ -250,49 +287,96 @@ QString ReportGenerator::generateDependencyTreeReport(const DependencyScanner::N
                     ".mismatch { color: #ff9800; }"
                     "</style></head><body>";
             report += "<h2>Dependency Tree Report</h2>";
-            report += "<pre>" + generateTreeText(root, 0) + "</pre>";
+            report += "<pre>" + generateTreeText(rootEdge, 0, &printed) + "</pre>";
             report += "</body></html>";
             break;
             
         default: // PlainText
             report = "=== Dependency Tree Report ===\n\n";
-    report += generateTreeText(root, 0);
+    report += generateTreeText(rootEdge, 0, &printed);
     break;
     }
     
     return report;
 }
 
-void ReportGenerator::collectMissingDependencies(const DependencyScanner::NodePtr& node,
+void ReportGenerator::collectMissingDependencies(const DependencyScanner::NodeHandle& node,
                                                 QMap<QString, QStringList>& missingMap)
 {
     if (!node) return;
     
-    // Check children for missing dependencies
-    for (const auto& child : node->children) {
-        if (!child->exists) {
-            QString dllName = child->fileName;
+    // Imports of this module only; callers visit every module of the graph
+    for (const auto& edge : node.edges()) {
+        if (!edge.node.exists()) {
+            QString dllName = edge.node.fileName();
             if (!missingMap.contains(dllName)) {
                 missingMap[dllName] = QStringList();
             }
             // Include full path of the file that requires this DLL
-            QString requiredByInfo = node->fileName;
-            if (!node->filePath.isEmpty()) {
-                requiredByInfo += QString(" (%1)").arg(node->filePath);
+            QString requiredByInfo = node.fileName();
+            if (!node.filePath().isEmpty()) {
+                requiredByInfo += QString(" (%1)").arg(node.filePath());
+            }
+            if (edge.delayLoad) {
+                requiredByInfo += " [delay-load]";
+            } else if (edge.viaForwarder) {
+                requiredByInfo += " [forwarded export]";
             }
             if (!missingMap[dllName].contains(requiredByInfo)) {
                 missingMap[dllName].append(requiredByInfo);
             }
         }
-        
-        // Recursively collect from children
-        collectMissingDependencies(child, missingMap);
     }
 }
 
-QString ReportGenerator::generateTreeText(const DependencyScanner::NodePtr& node, int indent)
+void ReportGenerator::collectMissingSymbols(const DependencyScanner::NodeHandle& node,
+                                            QMap<QString, QStringList>& symbolMap)
+{
+    if (!node) return;
+    
+    // Keys use the DLL!Symbol notation of the loader's "entry point not found" error
+    for (const auto& edge : node.edges()) {
+        for (const QString& symbol : edge.missingSymbols) {
+            QStringList& requiredBy = symbolMap[QString("%1!%2").arg(edge.node.fileName()).arg(symbol)];
+            QString requiredByInfo = node.fileName();
+            if (!node.filePath().isEmpty()) {
+                requiredByInfo += QString(" (%1)").arg(node.filePath());
+            }
+            if (!requiredBy.contains(requiredByInfo)) {
+                requiredBy.append(requiredByInfo);
+            }
+        }
+    }
+}
+
+QString ReportGenerator::generateTreeText(const DependencyScanner::DependencyEdge& rootEdge, int rootIndent,
+                                          QSet<const DependencyScanner::DependencyNode*>* printed)
 {
-    if (!node) return QString();
+    // Pre-order on an explicit stack, so chains of any depth are safe to export
+    struct Pending {
+        DependencyScanner::DependencyEdge edge;
+        int indent;
+    };
+    QString result;
+    QVector<Pending> stack;
+    stack.append(Pending{rootEdge, rootIndent});
+    while (!stack.isEmpty()) {
+        const Pending current = stack.takeLast();
+        const QVector<DependencyScanner::DependencyEdge> children = appendTreeLine(current.edge, current.indent,
+                                                                                   printed, &result);
+        for (int i = children.size() - 1; i >= 0; --i) {
+            stack.append(Pending{children.at(i), current.indent + 1});
+        }
+    }
+    return result;
+}
+
+QVector<DependencyScanner::DependencyEdge> ReportGenerator::appendTreeLine(
+    const DependencyScanner::DependencyEdge& edge, int indent,
+    QSet<const DependencyScanner::DependencyNode*>* printed, QString* text)
+{
+    const DependencyScanner::NodeHandle& node = edge.node;
+    if (!node) return QVector<DependencyScanner::DependencyEdge>();
     
     QString result;
     QString indentStr = QString(indent * 2, ' ');
@@ -303,27 +387,47 @@ QString ReportGenerator::generateTreeText(const DependencyScanner::NodePtr& node
         result += "└─ ";
     }
     
-    result += node->fileName;
+    result += node.fileName();
     
     // Add status indicators
-    if (!node->exists) {
+    if (!node.exists()) {
         result += " [MISSING]";
     } else {
-        result += QString(" [%1]").arg(PEParser::architectureToString(node->arch));
-        if (!node->fileVersion.isEmpty()) {
-            result += QString(" v%1").arg(node->fileVersion);
+        result += QString(" [%1]").arg(PEParser::architectureToString(node.arch()));
+        if (!node.fileVersion().isEmpty()) {
+            result += QString(" v%1").arg(node.fileVersion());
+        }
+        if (node.contentDigest() != 0) {
+            // Equal digests mark byte-identical copies across app folders
+            result += QString(" xxh64:%1").arg(ContentDigest::toHex(node.contentDigest()));
         }
-        if (node->archMismatch) {
+        if (edge.archMismatch) {
             result += " [ARCH MISMATCH]";
         }
+        if (!edge.missingSymbols.isEmpty()) {
+            result += QString(" [MISSING SYMBOLS: %1]").arg(edge.missingSymbols.join(", "));
+        }
+    }
+    if (edge.delayLoad) {
+        result += node.delayPending() ? " [DELAY-LOAD, NOT EXPANDED]" : " [DELAY-LOAD]";
+    } else if (edge.viaForwarder) {
+        result += " [FORWARDED]";
+    }
+    if (edge.circular) {
+        result += " [CIRCULAR]";
     }
     
-    result += "\n";
-    
-    // Add children
-    for (const auto& child : node->children) {
-        result += generateTreeText(child, indent + 1);
+    // A shared module lists its dependencies once; later imports refer back to it
+    if (node.edgeCount() > 0 && printed->contains(node.data())) {
+        result += " [SEE ABOVE]\n";
+        *text += result;
+        return QVector<DependencyScanner::DependencyEdge>();
     }
+    printed->insert(node.data());
     
-    return result;
+    result += "\n";
+    *text += result;
+    
+    // Children are printed next, one level deeper
+    return node.edges();
 }
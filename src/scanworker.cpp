@@ -13,7 +13,7 @@ ScanWorker::ScanWorker(QObject *parent)
 
 ScanWorker::~ScanWorker()
 {
-    // Results are shared via QSharedPointer, no manual deletion required.
+    // Result handles keep their graph alive, no manual deletion required.
     m_results.clear();
 }
 
@@ -28,8 +28,10 @@ void ScanWorker::scanFile(const QString& filePath, bool includeSystemDLLs)
     m_scanner->clearCache();
     emit scanProgress(0, 1, QFileInfo(filePath).fileName());
 
-    DependencyScanner::NodePtr node = m_scanner->scanFile(filePath, includeSystemDLLs);
-    if (node) {
+    DependencyScanner::NodeHandle node = m_scanner->scanFile(filePath, includeSystemDLLs);
+    if (m_scanner->isGraphFull()) {
+        emit scanError(graphFullMessage());
+    } else if (node) {
         m_results.clear();
         m_results.append(node);
         emit scanProgress(1, 1, QFileInfo(filePath).fileName());
@@ -74,6 +76,11 @@ void ScanWorker::scanDirectory(const QString& dirPath, bool recursive, bool incl
 
     m_results.clear();
     m_results = m_scanner->scanDirectory(dirPath, recursive, includeSystemDLLs);
+    if (m_scanner->isGraphFull()) {
+        m_results.clear();
+        emit scanError(graphFullMessage());
+        return;
+    }
     LOG_INFO("ScanWorker", "目录扫描完成");
     emit scanFinished(m_results);
 }
@@ -100,6 +107,11 @@ void ScanWorker::scanDirectoryParallel(const QString& dirPath, bool recursive, b
 
     m_results.clear();
     m_results = m_scanner->scanDirectoryParallel(dirPath, recursive, includeSystemDLLs, threadCount);
+    if (m_scanner->isGraphFull()) {
+        m_results.clear();
+        emit scanError(graphFullMessage());
+        return;
+    }
     LOG_INFO("ScanWorker", "并行目录扫描完成");
     emit scanFinished(m_results);
 }
@@ -116,6 +128,12 @@ bool ScanWorker::isCancelled() const
     return m_cancelled.loadAcquire() != 0;
 }
 
+QString ScanWorker::graphFullMessage() const
+{
+    return tr("扫描已中止：依赖图已达到节点或字符串数量上限。\n\n"
+              "请缩小扫描范围（例如不递归子目录或不包含系统DLL）后重试。");
+}
+
 void ScanWorker::onScanProgress(int current, int total, const QString& currentFile)
 {
     if (m_cancelled.loadAcquire()) {
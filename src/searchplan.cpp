@@ -0,0 +1,109 @@
+#include "searchplan.h"
+
+SearchPlan SearchPlan::standard(bool safeDllSearchMode)
+{
+    QVector<Step> steps;
+    steps << ApplicationDirectory;
+    if (safeDllSearchMode) {
+        steps << SystemDirectories << WindowsDirectory << CurrentDirectory;
+    } else {
+        steps << CurrentDirectory << SystemDirectories << WindowsDirectory;
+    }
+    steps << PathDirectories;
+    return SearchPlan(steps);
+}
+
+SearchPlan SearchPlan::withDllDirectory(const QString& directory)
+{
+    QVector<Step> steps;
+    steps << ApplicationDirectory << DllDirectory << SystemDirectories << WindowsDirectory << PathDirectories;
+    SearchPlan plan(steps);
+    plan.setDllDirectory(directory);
+    return plan;
+}
+
+SearchPlan SearchPlan::defaultDirs(const QStringList& userDirectories)
+{
+    QVector<Step> steps;
+    steps << ApplicationDirectory << UserDirectories << System32Directory;
+    SearchPlan plan(steps);
+    for (const QString& directory : userDirectories) {
+        plan.addDllDirectory(directory);
+    }
+    return plan;
+}
+
+SearchPlan::SearchPlan()
+{
+    *this = standard();
+}
+
+SearchPlan::SearchPlan(const QVector<Step>& steps)
+    : m_steps(steps)
+{
+    updateKey();
+}
+
+void SearchPlan::setDllDirectory(const QString& directory)
+{
+    m_dllDirectory = directory;
+    updateKey();
+}
+
+void SearchPlan::addDllDirectory(const QString& directory)
+{
+    if (!directory.isEmpty()) {
+        m_userDirectories.append(directory);
+        updateKey();
+    }
+}
+
+QString SearchPlan::description() const
+{
+    QStringList parts;
+    for (Step step : m_steps) {
+        switch (step) {
+        case ApplicationDirectory:
+            parts << QString("应用程序目录");
+            break;
+        case DllDirectory:
+            parts << QString("SetDllDirectory(%1)").arg(m_dllDirectory);
+            break;
+        case UserDirectories:
+            parts << QString("AddDllDirectory(%1 个)").arg(m_userDirectories.size());
+            break;
+        case SystemDirectories:
+            parts << QString("系统目录");
+            break;
+        case System32Directory:
+            parts << QString("System32");
+            break;
+        case WindowsDirectory:
+            parts << QString("Windows目录");
+            break;
+        case CurrentDirectory:
+            parts << QString("当前目录");
+            break;
+        case PathDirectories:
+            parts << QString("PATH");
+            break;
+        }
+    }
+    return parts.join(QString(" → "));
+}
+
+void SearchPlan::updateKey()
+{
+    // Paths are compared as the loader would, without regard to case
+    QString key;
+    for (Step step : m_steps) {
+        key += QChar('0' + int(step));
+    }
+    key += QLatin1Char('|');
+    key += m_dllDirectory.toLower();
+    for (const QString& directory : m_userDirectories) {
+        key += QLatin1Char('|');
+        key += directory.toLower();
+    }
+    m_key = key;
+}
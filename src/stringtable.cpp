@@ -0,0 +1,112 @@
+#include "stringtable.h"
+#include "namefolding.h"
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QWriteLocker>
+
+const StringTable::Id StringTable::Empty;
+
+StringTable::StringTable()
+    : m_blocks(new Entry*[MAX_BLOCKS]())
+    , m_count(0)
+    , m_full(0)
+{
+    // ID 0; intern() answers empty strings without a lookup
+    allocate(QString(), NameFolding::hash(QString()));
+}
+
+StringTable::~StringTable()
+{
+    for (int i = 0; i < MAX_BLOCKS && m_blocks[i]; ++i) {
+        delete[] m_blocks[i];
+    }
+    delete[] m_blocks;
+}
+
+StringTable::Id StringTable::intern(const QString& text)
+{
+    if (text.isEmpty()) {
+        return Empty;
+    }
+
+    const uint hash = NameFolding::hash(text);
+    Stripe& stripe = m_stripes[hash % STRIPE_COUNT];
+    Id folded = Empty;
+    {
+        QReadLocker locker(&stripe.lock);
+        const Id id = find(stripe, text, hash, &folded);
+        if (id != Empty) {
+            return id;
+        }
+    }
+
+    QWriteLocker locker(&stripe.lock);
+    const Id existing = find(stripe, text, hash, &folded);
+    if (existing != Empty) {
+        return existing;
+    }
+    const Id id = allocate(text, hash);
+    if (id == Empty) {
+        return Empty;
+    }
+    m_blocks[id >> BLOCK_SHIFT][id & BLOCK_MASK].folded = folded != Empty ? folded : id;
+    stripe.ids.insert(hash, id);
+    return id;
+}
+
+StringTable::Id StringTable::find(const Stripe& stripe, const QString& text, uint hash, Id* folded) const
+{
+    // The exact string if present; *folded gets the folded ID of a case variant
+    for (auto it = stripe.ids.constFind(hash); it != stripe.ids.constEnd() && it.key() == hash; ++it) {
+        const Entry& candidate = entry(it.value());
+        if (candidate.text == text) {
+            return it.value();
+        }
+        if (*folded == Empty && NameFolding::equals(candidate.text, text)) {
+            *folded = candidate.folded;
+        }
+    }
+    return Empty;
+}
+
+StringTable::Id StringTable::allocate(const QString& text, uint hash)
+{
+    QMutexLocker locker(&m_allocMutex);
+    const Id id = m_count;
+    const Id block = id >> BLOCK_SHIFT;
+    if (block >= Id(MAX_BLOCKS)) {
+        m_full.storeRelease(1);
+        return Empty;
+    }
+    if (!m_blocks[block]) {
+        m_blocks[block] = new Entry[BLOCK_SIZE];
+    }
+    ++m_count;
+
+    Entry& added = m_blocks[block][id & BLOCK_MASK];
+    added.text = text;
+    added.hash = hash;
+    added.folded = id;
+    return id;
+}
+
+int StringTable::count() const
+{
+    QMutexLocker locker(&m_allocMutex);
+    return int(m_count);
+}
+
+qint64 StringTable::bytes() const
+{
+    qint64 indexed = 0;
+    for (int i = 0; i < STRIPE_COUNT; ++i) {
+        QReadLocker locker(&m_stripes[i].lock);
+        indexed += m_stripes[i].ids.size();
+    }
+    QMutexLocker locker(&m_allocMutex);
+    const qint64 blocks = (m_count + BLOCK_MASK) >> BLOCK_SHIFT;
+    // QMultiHash nodes hold the key, the value and a next pointer and hash
+    return qint64(sizeof(Entry*)) * MAX_BLOCKS +
+           blocks * BLOCK_SIZE * qint64(sizeof(Entry)) +
+           indexed * qint64(sizeof(void*) * 2 + sizeof(uint) * 2 + sizeof(Id));
+}
@@ -0,0 +1,502 @@
+#include "targetprofile.h"
+#include "namefolding.h"
+#include "peparser.h"
+#include "apisetschema.h"
+#include "knowndlls.h"
+#include <QDir>
+#include <QHash>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+const char kMagic[8] = { 'D', 'L', 'L', 'T', 'P', 'R', 'F', '1' };
+const quint32 kFormatVersion = 3;  // 2: names hashed with Windows upcase folding, 3: KnownDLLs
+const qint64 kHeaderSize = 56;
+const qint64 kDirectoryRecordSize = 12;
+const qint64 kFileRecordSize = 24;
+
+// Sanity limits so a damaged file cannot make us allocate or loop forever
+const quint32 kMaxDirectories = 1 << 20;
+const quint32 kMaxFiles = 1 << 24;
+
+struct CapturedDirectory {
+    QString relativePath;
+    TargetProfile::DirectoryKind kind;
+};
+
+struct CapturedFile {
+    QString name;
+    quint32 directory;
+    quint64 version;
+};
+
+void appendU32(QByteArray& buffer, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    buffer.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+void appendU64(QByteArray& buffer, quint64 value)
+{
+    uchar bytes[8];
+    qToLittleEndian(value, bytes);
+    buffer.append(reinterpret_cast<const char*>(bytes), 8);
+}
+
+quint32 appendString(QByteArray& strings, const QString& text, quint32* length)
+{
+    const QByteArray utf8 = text.toUtf8();
+    const quint32 offset = quint32(strings.size());
+    strings.append(utf8);
+    *length = quint32(utf8.size());
+    return offset;
+}
+
+QString normalizedDirectory(const QString& path)
+{
+    // Target paths use backslashes whatever the host is
+    QString normalized = QString(path).replace(QLatin1Char('\\'), QLatin1Char('/')).toLower();
+    while (normalized.size() > 1 && normalized.endsWith(QLatin1Char('/'))) {
+        normalized.chop(1);
+    }
+    return normalized;
+}
+
+// Child directory matched case-insensitively; mounted images keep the on-disk case
+QString findChildDirectory(const QDir& parent, const QString& name)
+{
+    const QStringList children = parent.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+    for (const QString& child : children) {
+        if (NameFolding::equals(child, name)) {
+            return child;
+        }
+    }
+    return QString();
+}
+
+// "a.b.c.d" as written by PEParser back into the packed VS_FIXEDFILEINFO form
+quint64 packVersion(const QString& version)
+{
+    const QStringList parts = version.split(QLatin1Char('.'));
+    if (parts.size() != 4) {
+        return 0;
+    }
+    quint64 packed = 0;
+    for (const QString& part : parts) {
+        packed = (packed << 16) | (part.toUInt() & 0xFFFF);
+    }
+    return packed;
+}
+
+bool isPEFileName(const QString& fileName)
+{
+    static const char* const kExtensions[] = { ".dll", ".exe", ".drv", ".sys", ".ocx", ".cpl", ".ax" };
+    for (const char* extension : kExtensions) {
+        if (fileName.endsWith(QLatin1String(extension), Qt::CaseInsensitive)) {
+            return true;
+        }
+    }
+    return false;
+}
+}
+
+TargetProfile::TargetProfile()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_directoryCount(0)
+    , m_fileCount(0)
+    , m_slotCount(0)
+    , m_directoriesOffset(0)
+    , m_filesOffset(0)
+    , m_slotsOffset(0)
+    , m_stringsOffset(0)
+    , m_stringsSize(0)
+{
+}
+
+TargetProfile::~TargetProfile()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar*>(m_data));
+    }
+}
+
+QSharedPointer<const TargetProfile> TargetProfile::load(const QString& filePath, QString* error)
+{
+    QSharedPointer<TargetProfile> profile(new TargetProfile());
+    profile->m_file.setFileName(filePath);
+    if (!profile->m_file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = QString("无法打开目标系统配置文件: %1").arg(filePath);
+        }
+        return QSharedPointer<const TargetProfile>();
+    }
+
+    profile->m_size = profile->m_file.size();
+    if (profile->m_size >= kHeaderSize) {
+        profile->m_data = profile->m_file.map(0, profile->m_size);
+    }
+    if (!profile->m_data || memcmp(profile->m_data, kMagic, sizeof(kMagic)) != 0 ||
+        profile->u32(8) != kFormatVersion) {
+        if (error) {
+            *error = QString("不是有效的目标系统配置文件: %1").arg(filePath);
+        }
+        return QSharedPointer<const TargetProfile>();
+    }
+
+    profile->m_directoryCount = profile->u32(12);
+    profile->m_fileCount = profile->u32(16);
+    profile->m_slotCount = profile->u32(20);
+    profile->m_stringsSize = profile->u32(24);
+    profile->m_directoriesOffset = kHeaderSize;
+    profile->m_filesOffset = kHeaderSize + qint64(profile->m_directoryCount) * kDirectoryRecordSize;
+    profile->m_slotsOffset = profile->m_filesOffset + qint64(profile->m_fileCount) * kFileRecordSize;
+    profile->m_stringsOffset = profile->m_slotsOffset + qint64(profile->m_slotCount) * 4;
+
+    const bool powerOfTwo = profile->m_slotCount != 0 && (profile->m_slotCount & (profile->m_slotCount - 1)) == 0;
+    if (profile->m_directoryCount > kMaxDirectories || profile->m_fileCount > kMaxFiles || !powerOfTwo ||
+        profile->m_slotCount <= profile->m_fileCount ||
+        profile->m_stringsOffset + profile->m_stringsSize > profile->m_size) {
+        if (error) {
+            *error = QString("目标系统配置文件已损坏: %1").arg(filePath);
+        }
+        return QSharedPointer<const TargetProfile>();
+    }
+
+    // Optional API set schema, parsed once into its lookup table
+    const quint32 apiSetOffset = profile->u32(36);
+    const quint32 apiSetSize = profile->u32(40);
+    if (apiSetSize != 0) {
+        if (apiSetOffset < profile->m_stringsOffset + profile->m_stringsSize ||
+            qint64(apiSetOffset) + apiSetSize > profile->m_size) {
+            if (error) {
+                *error = QString("目标系统配置文件已损坏: %1").arg(filePath);
+            }
+            return QSharedPointer<const TargetProfile>();
+        }
+        const QByteArray section = QByteArray::fromRawData(
+            reinterpret_cast<const char*>(profile->m_data + apiSetOffset), int(apiSetSize));
+        profile->m_apiSetSchema = ApiSetSchema::fromData(section);
+    }
+
+    // Optional KnownDLLs list, one UTF-8 name per line
+    const quint32 knownDllsOffset = profile->u32(44);
+    const quint32 knownDllsSize = profile->u32(48);
+    if (knownDllsSize != 0) {
+        if (knownDllsOffset < profile->m_stringsOffset + profile->m_stringsSize ||
+            qint64(knownDllsOffset) + knownDllsSize > profile->m_size) {
+            if (error) {
+                *error = QString("目标系统配置文件已损坏: %1").arg(filePath);
+            }
+            return QSharedPointer<const TargetProfile>();
+        }
+        const QString names = QString::fromUtf8(reinterpret_cast<const char*>(profile->m_data + knownDllsOffset),
+                                                int(knownDllsSize));
+        profile->m_knownDlls = KnownDlls::fromNames(names.split(QLatin1Char('\n'), Qt::SkipEmptyParts));
+    }
+
+    return profile;
+}
+
+bool TargetProfile::capture(const QString& windowsDir, const QString& outputPath,
+                            const QString& targetRoot, QString* error, const QString& knownDllsExport)
+{
+    const QDir root(windowsDir);
+    if (!root.exists()) {
+        if (error) {
+            *error = QString("Windows目录不存在: %1").arg(windowsDir);
+        }
+        return false;
+    }
+
+    QByteArray knownDllsBlock;
+    if (!knownDllsExport.isEmpty()) {
+        const QSharedPointer<const KnownDlls> knownDlls = KnownDlls::loadRegistryExport(knownDllsExport, error);
+        if (!knownDlls) {
+            return false;
+        }
+        knownDllsBlock = knownDlls->names().join(QLatin1Char('\n')).toUtf8();
+    }
+
+    // Directories in loader search order, then every WinSxS assembly
+    QVector<CapturedDirectory> directories;
+    const QString system32 = findChildDirectory(root, "System32");
+    if (!system32.isEmpty()) {
+        directories.append(CapturedDirectory{ system32, System32 });
+    }
+    const QString sysWow64 = findChildDirectory(root, "SysWOW64");
+    if (!sysWow64.isEmpty()) {
+        directories.append(CapturedDirectory{ sysWow64, SysWOW64 });
+    }
+    directories.append(CapturedDirectory{ QString(), WindowsDirectory });
+    const QString winSxS = findChildDirectory(root, "WinSxS");
+    if (!winSxS.isEmpty()) {
+        const QStringList assemblies = QDir(root.filePath(winSxS)).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (const QString& assembly : assemblies) {
+            directories.append(CapturedDirectory{ winSxS + QLatin1Char('/') + assembly, SideBySide });
+        }
+    }
+
+    QVector<CapturedFile> files;
+    QByteArray apiSetSection;
+    for (int i = 0; i < directories.size(); ++i) {
+        const QDir dir(directories.at(i).relativePath.isEmpty() ? root.absolutePath()
+                                                                : root.filePath(directories.at(i).relativePath));
+        const QStringList names = dir.entryList(QDir::Files | QDir::Hidden | QDir::System);
+        for (const QString& name : names) {
+            // The target's API set schema travels with the profile
+            if (directories.at(i).kind == System32 && apiSetSection.isEmpty() &&
+                NameFolding::equals(name, QString("apisetschema.dll"))) {
+                apiSetSection = ApiSetSchema::readSection(dir.filePath(name));
+            }
+
+            CapturedFile file;
+            file.name = name;
+            file.directory = quint32(i);
+            file.version = isPEFileName(name) ? packVersion(PEParser::getVersionInfo(dir.filePath(name)).first) : 0;
+            files.append(file);
+        }
+    }
+
+    // Slot table at most half full
+    quint32 slotCount = 16;
+    while (slotCount < quint32(files.size()) * 2) {
+        slotCount *= 2;
+    }
+
+    QByteArray strings;
+    quint32 rootLength = 0;
+    const quint32 rootOffset = appendString(strings, QString(targetRoot).replace(QLatin1Char('\\'), QLatin1Char('/')),
+                                           &rootLength);
+
+    QByteArray directoryTable;
+    for (const CapturedDirectory& directory : directories) {
+        quint32 length = 0;
+        const quint32 offset = appendString(strings, directory.relativePath, &length);
+        appendU32(directoryTable, offset);
+        appendU32(directoryTable, length);
+        appendU32(directoryTable, quint32(directory.kind));
+    }
+
+    QByteArray fileTable;
+    QVector<quint32> slotIndexes(int(slotCount), 0);
+    for (int i = 0; i < files.size(); ++i) {
+        const CapturedFile& file = files.at(i);
+        const quint32 hash = NameFolding::hash(file.name);
+        quint32 length = 0;
+        const quint32 offset = appendString(strings, file.name, &length);
+        appendU32(fileTable, hash);
+        appendU32(fileTable, offset);
+        appendU32(fileTable, length);
+        appendU32(fileTable, file.directory);
+        appendU64(fileTable, file.version);
+
+        quint32 slot = hash & (slotCount - 1);
+        while (slotIndexes.at(int(slot)) != 0) {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        slotIndexes[int(slot)] = quint32(i) + 1;
+    }
+
+    QByteArray header(kMagic, sizeof(kMagic));
+    appendU32(header, kFormatVersion);
+    appendU32(header, quint32(directories.size()));
+    appendU32(header, quint32(files.size()));
+    appendU32(header, slotCount);
+    appendU32(header, quint32(strings.size()));
+    appendU32(header, rootOffset);
+    appendU32(header, rootLength);
+    const qint64 apiSetOffset = kHeaderSize + directoryTable.size() + fileTable.size() +
+                                qint64(slotCount) * 4 + strings.size();
+    appendU32(header, apiSetSection.isEmpty() ? 0 : quint32(apiSetOffset));
+    appendU32(header, quint32(apiSetSection.size()));
+    const qint64 knownDllsOffset = apiSetOffset + apiSetSection.size();
+    appendU32(header, knownDllsBlock.isEmpty() ? 0 : quint32(knownDllsOffset));
+    appendU32(header, quint32(knownDllsBlock.size()));
+    header.append(QByteArray(int(kHeaderSize) - header.size(), 0));
+
+    QByteArray slotTable;
+    slotTable.reserve(int(slotCount) * 4);
+    for (quint32 slot : slotIndexes) {
+        appendU32(slotTable, slot);
+    }
+
+    QFile output(outputPath);
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        output.write(header) != header.size() ||
+        output.write(directoryTable) != directoryTable.size() ||
+        output.write(fileTable) != fileTable.size() ||
+        output.write(slotTable) != slotTable.size() ||
+        output.write(strings) != strings.size() ||
+        output.write(apiSetSection) != apiSetSection.size() ||
+        output.write(knownDllsBlock) != knownDllsBlock.size()) {
+        if (error) {
+            *error = QString("无法写入目标系统配置文件: %1").arg(outputPath);
+        }
+        return false;
+    }
+    return true;
+}
+
+QString TargetProfile::targetRoot() const
+{
+    return text(u32(28), u32(32));
+}
+
+int TargetProfile::directoryCount() const
+{
+    return int(m_directoryCount);
+}
+
+int TargetProfile::fileCount() const
+{
+    return int(m_fileCount);
+}
+
+QString TargetProfile::directoryPath(int directory) const
+{
+    if (directory < 0 || quint32(directory) >= m_directoryCount) {
+        return QString();
+    }
+    const qint64 record = m_directoriesOffset + qint64(directory) * kDirectoryRecordSize;
+    const QString relative = text(u32(record), u32(record + 4));
+    return relative.isEmpty() ? targetRoot() : targetRoot() + QLatin1Char('/') + relative;
+}
+
+TargetProfile::DirectoryKind TargetProfile::directoryKind(int directory) const
+{
+    if (directory < 0 || quint32(directory) >= m_directoryCount) {
+        return SideBySide;
+    }
+    const quint32 kind = u32(m_directoriesOffset + qint64(directory) * kDirectoryRecordSize + 8);
+    return kind <= quint32(SideBySide) ? DirectoryKind(kind) : SideBySide;
+}
+
+int TargetProfile::findDirectory(const QString& path) const
+{
+    const QString wanted = normalizedDirectory(path);
+    const QString root = normalizedDirectory(targetRoot());
+    if (wanted == root) {
+        for (quint32 i = 0; i < m_directoryCount; ++i) {
+            if (directoryKind(int(i)) == WindowsDirectory) {
+                return int(i);
+            }
+        }
+        return -1;
+    }
+    if (!wanted.startsWith(root + QLatin1Char('/'))) {
+        return -1;
+    }
+
+    // System directories come first, so the common lookups end early
+    const QString relative = wanted.mid(root.size() + 1);
+    for (quint32 i = 0; i < m_directoryCount; ++i) {
+        const qint64 record = m_directoriesOffset + qint64(i) * kDirectoryRecordSize;
+        if (text(u32(record), u32(record + 4)).toLower() == relative) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+QVector<uint> TargetProfile::fileHashes(int directory) const
+{
+    QVector<uint> hashes;
+    for (quint32 i = 0; i < m_fileCount; ++i) {
+        const qint64 record = m_filesOffset + qint64(i) * kFileRecordSize;
+        if (u32(record + 12) == quint32(directory)) {
+            hashes.append(u32(record));
+        }
+    }
+    return hashes;
+}
+
+QStringList TargetProfile::systemDirectories() const
+{
+    QStringList paths;
+    const DirectoryKind order[] = { System32, SysWOW64, WindowsDirectory };
+    for (DirectoryKind kind : order) {
+        for (quint32 i = 0; i < m_directoryCount; ++i) {
+            if (directoryKind(int(i)) == kind) {
+                paths.append(directoryPath(int(i)));
+                break;
+            }
+        }
+    }
+    return paths;
+}
+
+bool TargetProfile::findFile(const QString& fileName, int directory, FileEntry* entry) const
+{
+    return lookup(fileName, [directory](quint32 fileDirectory) {
+        return directory < 0 || fileDirectory == quint32(directory);
+    }, entry);
+}
+
+bool TargetProfile::findFileOfKind(const QString& fileName, DirectoryKind kind, FileEntry* entry) const
+{
+    return lookup(fileName, [this, kind](quint32 fileDirectory) {
+        return directoryKind(int(fileDirectory)) == kind;
+    }, entry);
+}
+
+QString TargetProfile::versionToString(quint64 version)
+{
+    if (version == 0) {
+        return QString();
+    }
+    return QString("%1.%2.%3.%4")
+        .arg((version >> 48) & 0xFFFF)
+        .arg((version >> 32) & 0xFFFF)
+        .arg((version >> 16) & 0xFFFF)
+        .arg(version & 0xFFFF);
+}
+
+template <typename Accept>
+bool TargetProfile::lookup(const QString& fileName, Accept accept, FileEntry* entry) const
+{
+    const quint32 hash = NameFolding::hash(fileName);
+    const quint32 mask = m_slotCount - 1;
+    for (quint32 slot = hash & mask, probes = 0; probes < m_slotCount; slot = (slot + 1) & mask, ++probes) {
+        const quint32 index = u32(m_slotsOffset + qint64(slot) * 4);
+        if (index == 0 || index > m_fileCount) {
+            return false;
+        }
+        const qint64 record = m_filesOffset + qint64(index - 1) * kFileRecordSize;
+        if (u32(record) != hash || !accept(u32(record + 12))) {
+            continue;
+        }
+        if (NameFolding::equals(text(u32(record + 4), u32(record + 8)), fileName)) {
+            if (entry) {
+                *entry = entryAt(index - 1);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+TargetProfile::FileEntry TargetProfile::entryAt(quint32 index) const
+{
+    const qint64 record = m_filesOffset + qint64(index) * kFileRecordSize;
+    FileEntry entry;
+    entry.directory = directoryPath(int(u32(record + 12)));
+    entry.fileName = text(u32(record + 4), u32(record + 8));
+    entry.kind = directoryKind(int(u32(record + 12)));
+    entry.fileVersion = qFromLittleEndian<quint64>(m_data + record + 16);
+    return entry;
+}
+
+quint32 TargetProfile::u32(qint64 offset) const
+{
+    return qFromLittleEndian<quint32>(m_data + offset);
+}
+
+QString TargetProfile::text(quint32 offset, quint32 length) const
+{
+    if (quint64(offset) + length > m_stringsSize) {
+        return QString();
+    }
+    return QString::fromUtf8(reinterpret_cast<const char*>(m_data + m_stringsOffset + offset), int(length));
+}
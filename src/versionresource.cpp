@@ -0,0 +1,152 @@
+#include "versionresource.h"
+
+namespace {
+const quint32 kFixedFileInfoSignature = 0xFEEF04BD;
+const qint64 kFixedFileInfoSize = 52;
+const qint64 kBlockHeaderSize = 6;   // wLength, wValueLength, wType
+
+inline qint64 align4(qint64 offset)
+{
+    return (offset + 3) & ~qint64(3);
+}
+}
+
+bool VersionResource::Utf16Ref::equals(const char* ascii) const
+{
+    int i = 0;
+    for (; i < length; ++i) {
+        if (ascii[i] == '\0' || at(i) != quint16(uchar(ascii[i]))) {
+            return false;
+        }
+    }
+    return ascii[i] == '\0';
+}
+
+VersionResource::VersionResource(const uchar* data, qint64 size)
+    : m_data(data)
+    , m_size(data ? size : 0)
+    , m_valid(false)
+    , m_hasFixedInfo(false)
+    , m_fileVersion(0)
+    , m_productVersion(0)
+{
+    if (!readBlock(0, m_size, &m_root) || !m_root.key.equals("VS_VERSION_INFO")) {
+        return;
+    }
+    m_valid = true;
+
+    // VS_FIXEDFILEINFO is the value of the root block
+    if (m_root.valueLength >= kFixedFileInfoSize && m_root.value + kFixedFileInfoSize <= m_root.end) {
+        const uchar* fixed = m_data + m_root.value;
+        auto u32 = [fixed](int offset) {
+            return quint32(fixed[offset]) | (quint32(fixed[offset + 1]) << 8) |
+                   (quint32(fixed[offset + 2]) << 16) | (quint32(fixed[offset + 3]) << 24);
+        };
+        if (u32(0) == kFixedFileInfoSignature) {
+            m_fileVersion = (quint64(u32(8)) << 32) | u32(12);
+            m_productVersion = (quint64(u32(16)) << 32) | u32(20);
+            m_hasFixedInfo = true;
+        }
+    }
+}
+
+bool VersionResource::readBlock(qint64 offset, qint64 limit, Block* block) const
+{
+    if (offset < 0 || offset + kBlockHeaderSize > limit) {
+        return false;
+    }
+
+    const uchar* header = m_data + offset;
+    const quint16 length = quint16(header[0] | (header[1] << 8));
+    if (length < kBlockHeaderSize) {
+        return false;
+    }
+
+    block->offset = offset;
+    block->end = qMin(offset + length, limit);
+    block->valueLength = quint16(header[2] | (header[3] << 8));
+    block->type = quint16(header[4] | (header[5] << 8));
+
+    // szKey: NUL-terminated UTF-16 right after the header
+    const qint64 keyOffset = offset + kBlockHeaderSize;
+    block->key.data = m_data + keyOffset;
+    block->key.length = 0;
+    qint64 cursor = keyOffset;
+    while (cursor + 2 <= block->end && (m_data[cursor] | m_data[cursor + 1]) != 0) {
+        cursor += 2;
+        block->key.length++;
+    }
+    if (cursor + 2 > block->end) {
+        return false;   // Unterminated key
+    }
+
+    // Text values are measured in WORDs, binary values in bytes
+    const qint64 valueBytes = block->type == 1 ? qint64(block->valueLength) * 2 : block->valueLength;
+    block->value = qMin(align4(cursor + 2), block->end);
+    block->children = qMin(align4(block->value + valueBytes), block->end);
+    return true;
+}
+
+bool VersionResource::findChild(const Block& parent, const char* key, Block* child) const
+{
+    qint64 cursor = parent.children;
+    while (cursor + kBlockHeaderSize <= parent.end) {
+        if (!readBlock(cursor, parent.end, child)) {
+            return false;
+        }
+        if (!key || child->key.equals(key)) {
+            return true;
+        }
+        cursor = align4(child->end);
+    }
+    return false;
+}
+
+bool VersionResource::firstStringTable(Block* table) const
+{
+    Block stringFileInfo;
+    if (!m_valid || !findChild(m_root, "StringFileInfo", &stringFileInfo)) {
+        return false;
+    }
+    return findChild(stringFileInfo, nullptr, table);
+}
+
+QVector<VersionResource::StringEntry> VersionResource::strings() const
+{
+    QVector<StringEntry> entries;
+
+    Block table;
+    if (!firstStringTable(&table)) {
+        return entries;
+    }
+
+    qint64 cursor = table.children;
+    Block item;
+    while (cursor + kBlockHeaderSize <= table.end && readBlock(cursor, table.end, &item)) {
+        StringEntry entry;
+        entry.key = item.key;
+        entry.value.data = m_data + item.value;
+
+        // Some linkers store the length in bytes; trust the block bounds and the terminator
+        const int maxLength = int((item.end - item.value) / 2);
+        while (entry.value.length < maxLength && entry.value.at(entry.value.length) != 0) {
+            entry.value.length++;
+        }
+        entries.append(entry);
+        cursor = align4(item.end);
+    }
+
+    return entries;
+}
+
+bool VersionResource::findString(const char* key, Utf16Ref* value) const
+{
+    const QVector<StringEntry> entries = strings();
+    for (const StringEntry& entry : entries) {
+        if (entry.key.equals(key)) {
+            *value = entry.value;
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,16 +1,34 @@
 #include "peparser.h"
 #include "comparisonengine.h"
+#include "dependencyscanner.h"
+#include "pathresolver.h"
+#include "targetprofile.h"
+#include "systemdlltable.h"
+#include "apisetschema.h"
+#include "bloomfilter.h"
+#include "knowndlls.h"
+#include "stringtable.h"
+#include "workstealingqueue.h"
+#include "testpeimage.h"
 #include <QtTest>
 #include <QTemporaryFile>
+#include <QTemporaryDir>
+#include <QDir>
 #include <QFile>
 #include <QDebug>
 #include <memory>
 
+using namespace TestPE;
+
 class TestPEParser : public QObject
 {
     Q_OBJECT
 
+public:
+    TestPEParser() : m_pathSaved(false) {}
+
 private slots:
+    void cleanup();
     void testX86Architecture();
     void testX64Architecture();
     void testNonExistentFile();
@@ -20,73 +38,165 @@ private slots:
     void testCorruptedPEHeader();
     void testMissingReportDedupAndRoundTrip();
     void testFindMissingDLLsInTree();
+    void testImportedDLLs();
+    void testFixedVersionInfo();
+    void testImportDirectoryOutOfBounds();
+    void testVersionStrings();
+    void testHeaderProbe();
+    void testImportViews();
+    void testDelayImports();
+    void testImportSymbolsAgainstExports();
+    void testUnsortedSectionTable();
+    void testContentDigest();
+    void testTargetProfile();
+    void testSystemDllTable();
+    void testApiSetSchema();
+    void testMissFilter();
+    void testCaseInsensitiveResolution();
+    void testSearchPlan();
+    void testKnownDlls();
+    void testSharedDependencyGraph();
+    void testDependencyGraphStorage();
+    void testStringInterning();
+    void testWorkStealingGraphScan();
+    void testDeepImportChain();
 
 private:
     bool createTempPEFile(QTemporaryFile& file, quint16 machine);
-    DependencyScanner::NodePtr createNode(const QString& fileName, const QString& filePath, bool exists);
+    bool writeTempFile(QTemporaryFile& file, const QByteArray& contents);
+    QByteArray buildPEImage(quint16 machine, const QStringList& imports, quint64 fileVersion = 0,
+                            const QMap<QString, QString>& versionStrings = QMap<QString, QString>());
+    DependencyGraph::Index createNode(DependencyGraph* graph, const QString& fileName, const QString& filePath,
+                                      bool exists);
+    bool writeModule(const QString& filePath, const QStringList& imports,
+                     const QStringList& delayImports = QStringList());
+    bool touchFiles(const QString& root, const QStringList& names);
+    bool loadTargetProfile(const QString& windowsDir, const QString& profilePath, QString* error,
+                           const QString& knownDllsExport = QString());
+    void setPath(const QString& directory);
+
+    QByteArray m_savedPath;
+    bool m_pathSaved;
 };
 
+void TestPEParser::cleanup()
+{
+    // Resolver state is process-wide; a failed check must not leak it into the next test
+    if (m_pathSaved) {
+        qputenv("PATH", m_savedPath);
+        m_pathSaved = false;
+    }
+    PathResolver::clearTargetProfile();
+    PathResolver::setSearchPlan(SearchPlan::standard());
+}
+
 bool TestPEParser::createTempPEFile(QTemporaryFile& file, quint16 machine)
+{
+    // DOS header + "PE\0\0"
+    QByteArray contents = dosHeader(0x5A4D);
+    contents += ntSignature(0x00004550);
+
+    // File header
+    QByteArray fileHeader(20, 0);
+    putU16(fileHeader, 0, machine);
+    putU16(fileHeader, 2, 1);          // NumberOfSections
+    putU16(fileHeader, 16, 0);         // SizeOfOptionalHeader
+    putU16(fileHeader, 18, 0x0102);    // EXECUTABLE_IMAGE | 32BIT_MACHINE
+    contents += fileHeader;
+
+    // The parser only needs the file header; pad so the file looks complete
+    contents += QByteArray(128, 0);
+
+    return writeTempFile(file, contents);
+}
+
+bool TestPEParser::writeTempFile(QTemporaryFile& file, const QByteArray& contents)
 {
     if (!file.open()) {
         return false;
     }
-
-    // Write DOS header
-    IMAGE_DOS_HEADER dosHeader = {0};
-    dosHeader.e_magic = IMAGE_DOS_SIGNATURE;  // "MZ"
-    dosHeader.e_lfanew = sizeof(IMAGE_DOS_HEADER);  // PE header starts right after DOS header
-
-    if (file.write((const char*)&dosHeader, sizeof(dosHeader)) != sizeof(dosHeader)) {
+    if (file.write(contents) != contents.size()) {
         return false;
     }
+    file.flush();
+    return true;
+}
 
-    // Write PE signature
-    DWORD peSignature = IMAGE_NT_SIGNATURE;
-    if (file.write((const char*)&peSignature, sizeof(peSignature)) != sizeof(peSignature)) {
-        return false;
+QByteArray TestPEParser::buildPEImage(quint16 machine, const QStringList& imports, quint64 fileVersion,
+                                      const QMap<QString, QString>& versionStrings)
+{
+    ImageBuilder builder(machine);
+    for (const QString& dllName : imports) {
+        builder.addImport(dllName);
+    }
+    if (fileVersion != 0) {
+        builder.setVersion(fileVersion, versionStrings);
     }
+    return builder.build();
+}
 
-    // Write file header
-    IMAGE_FILE_HEADER fileHeader = {0};
-    fileHeader.Machine = machine;
-    fileHeader.NumberOfSections = 1;
-    fileHeader.SizeOfOptionalHeader = 0;
-    fileHeader.Characteristics = IMAGE_FILE_EXECUTABLE_IMAGE | IMAGE_FILE_32BIT_MACHINE;
+DependencyGraph::Index TestPEParser::createNode(DependencyGraph* graph,
+                                                const QString& fileName,
+                                                const QString& filePath,
+                                                bool exists)
+{
+    const DependencyGraph::Index node = graph->addNode(filePath, fileName);
+    graph->node(node).exists = exists;
+    return node;
+}
 
-    if (file.write((const char*)&fileHeader, sizeof(fileHeader)) != sizeof(fileHeader)) {
-        return false;
+bool TestPEParser::writeModule(const QString& filePath, const QStringList& imports,
+                               const QStringList& delayImports)
+{
+    ImageBuilder builder(kMachineAmd64);
+    for (const QString& dllName : imports) {
+        builder.addImport(dllName);
     }
-
-    // Write optional header (minimal)
-    // For simplicity, we write a small optional header
-    // Actual size depends on architecture, but we just need enough for the parser
-    // The parser only reads the file header, so optional header is not needed
-    // However, we'll write some bytes to make the file look valid
-    char optionalHeader[128] = {0};
-    if (file.write(optionalHeader, sizeof(optionalHeader)) != sizeof(optionalHeader)) {
-        return false;
+    for (const QString& dllName : delayImports) {
+        builder.addDelayImport(dllName);
     }
+    QFile file(filePath);
+    return file.open(QIODevice::WriteOnly) && file.write(builder.build()) > 0;
+}
 
-    file.flush();
+// Empty files below root, creating their directories
+bool TestPEParser::touchFiles(const QString& root, const QStringList& names)
+{
+    for (const QString& name : names) {
+        const QString filePath = QDir(root).filePath(name);
+        if (!QDir().mkpath(QFileInfo(filePath).absolutePath())) {
+            return false;
+        }
+        QFile file(filePath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+    }
     return true;
 }
 
-DependencyScanner::NodePtr TestPEParser::createNode(const QString& fileName,
-                                                    const QString& filePath,
-                                                    bool exists)
+// Captures windowsDir as the C:/Windows of a target and makes it the resolver's
+bool TestPEParser::loadTargetProfile(const QString& windowsDir, const QString& profilePath, QString* error,
+                                     const QString& knownDllsExport)
 {
-    DependencyScanner::NodePtr node(new DependencyScanner::DependencyNode());
-    node->fileName = fileName;
-    node->filePath = filePath;
-    node->exists = exists;
-    return node;
+    return TargetProfile::capture(windowsDir, profilePath, "C:/Windows", error, knownDllsExport) &&
+           PathResolver::loadTargetProfile(profilePath, error);
+}
+
+// PATH for the rest of the test; cleanup() restores it
+void TestPEParser::setPath(const QString& directory)
+{
+    if (!m_pathSaved) {
+        m_savedPath = qgetenv("PATH");
+        m_pathSaved = true;
+    }
+    qputenv("PATH", QDir::toNativeSeparators(directory).toLocal8Bit());
 }
 
 void TestPEParser::testX86Architecture()
 {
     QTemporaryFile tempFile;
-    if (!createTempPEFile(tempFile, IMAGE_FILE_MACHINE_I386)) {
+    if (!createTempPEFile(tempFile, kMachineI386)) {
         QFAIL("Failed to create temporary x86 PE file");
     }
 
@@ -103,7 +213,7 @@ void TestPEParser::testX86Architecture()
 void TestPEParser::testX64Architecture()
 {
     QTemporaryFile tempFile;
-    if (!createTempPEFile(tempFile, IMAGE_FILE_MACHINE_AMD64)) {
+    if (!createTempPEFile(tempFile, kMachineAmd64)) {
         QFAIL("Failed to create temporary x64 PE file");
     }
 
@@ -154,11 +264,7 @@ void TestPEParser::testInvalidDOSHeader()
     }
     
     // Write invalid DOS signature
-    IMAGE_DOS_HEADER dosHeader = {0};
-    dosHeader.e_magic = 0x1234;  // Invalid
-    dosHeader.e_lfanew = sizeof(IMAGE_DOS_HEADER);
-    
-    tempFile.write((const char*)&dosHeader, sizeof(dosHeader));
+    tempFile.write(dosHeader(0x1234));
     tempFile.flush();
     
     PEParser::Architecture arch = PEParser::getArchitecture(tempFile.fileName());
@@ -178,14 +284,10 @@ void TestPEParser::testInvalidPEHeader()
     }
     
     // Write valid DOS header
-    IMAGE_DOS_HEADER dosHeader = {0};
-    dosHeader.e_magic = IMAGE_DOS_SIGNATURE;
-    dosHeader.e_lfanew = sizeof(IMAGE_DOS_HEADER);
-    tempFile.write((const char*)&dosHeader, sizeof(dosHeader));
+    tempFile.write(dosHeader(0x5A4D));
     
     // Write invalid PE signature
-    DWORD peSignature = 0x12345678;
-    tempFile.write((const char*)&peSignature, sizeof(peSignature));
+    tempFile.write(ntSignature(0x12345678));
     tempFile.flush();
     
     PEParser::Architecture arch = PEParser::getArchitecture(tempFile.fileName());
@@ -205,20 +307,16 @@ void TestPEParser::testCorruptedPEHeader()
     }
     
     // Write valid DOS header
-    IMAGE_DOS_HEADER dosHeader = {0};
-    dosHeader.e_magic = IMAGE_DOS_SIGNATURE;
-    dosHeader.e_lfanew = sizeof(IMAGE_DOS_HEADER);
-    tempFile.write((const char*)&dosHeader, sizeof(dosHeader));
+    tempFile.write(dosHeader(0x5A4D));
     
     // Write valid PE signature
-    DWORD peSignature = IMAGE_NT_SIGNATURE;
-    tempFile.write((const char*)&peSignature, sizeof(peSignature));
+    tempFile.write(ntSignature(0x00004550));
     
     // Write truncated file header (less than full size)
-    IMAGE_FILE_HEADER fileHeader = {0};
-    fileHeader.Machine = IMAGE_FILE_MACHINE_I386;
+    QByteArray fileHeader(20, 0);
+    putU16(fileHeader, 0, kMachineI386);
     // Write only half of the header
-    tempFile.write((const char*)&fileHeader, sizeof(fileHeader) / 2);
+    tempFile.write(fileHeader.left(fileHeader.size() / 2));
     tempFile.flush();
     
     PEParser::Architecture arch = PEParser::getArchitecture(tempFile.fileName());
@@ -232,17 +330,18 @@ void TestPEParser::testCorruptedPEHeader()
 
 void TestPEParser::testMissingReportDedupAndRoundTrip()
 {
-    auto root = createNode("app.exe", "C:/app/app.exe", true);
-    auto missingA = createNode("vcruntime140.dll", "vcruntime140.dll", false);
-    auto missingB = createNode("vcruntime140.dll", "vcruntime140.dll", false);
+    QSharedPointer<DependencyGraph> graph(new DependencyGraph());
+    const auto root = createNode(graph.data(), "app.exe", "C:/app/app.exe", true);
+    const auto missingA = createNode(graph.data(), "vcruntime140.dll", "vcruntime140.dll", false);
+    const auto missingB = createNode(graph.data(), "vcruntime140.dll", "vcruntime140.dll", false);
 
-    missingA->parent = root;
-    missingB->parent = root;
-    root->children.append(missingA);
-    root->children.append(missingB);
+    QVector<DependencyGraph::Edge> edges(2);
+    edges[0].node = missingA;
+    edges[1].node = missingB;
+    graph->setEdges(root, edges);
 
-    QList<DependencyScanner::NodePtr> roots;
-    roots.append(root);
+    QList<DependencyScanner::NodeHandle> roots;
+    roots.append(DependencyScanner::NodeHandle(graph, root));
 
     const ComparisonEngine::MissingReport report = ComparisonEngine::generateMissingReport(roots);
     QCOMPARE(report.missingDLLs.size(), 1);
@@ -262,27 +361,1151 @@ void TestPEParser::testMissingReportDedupAndRoundTrip()
 
 void TestPEParser::testFindMissingDLLsInTree()
 {
-    auto root = createNode("app.exe", "C:/app/app.exe", true);
-    auto present = createNode("Qt5Core.dll", "C:/app/Qt5Core.dll", true);
-    auto missing = createNode("msvcp140.dll", "msvcp140.dll", false);
-    present->parent = root;
-    missing->parent = root;
+    QSharedPointer<DependencyGraph> graph(new DependencyGraph());
+    const auto root = createNode(graph.data(), "app.exe", "C:/app/app.exe", true);
+    const auto present = createNode(graph.data(), "Qt5Core.dll", "C:/app/Qt5Core.dll", true);
+    const auto missing = createNode(graph.data(), "msvcp140.dll", "msvcp140.dll", false);
 
-    root->children.append(present);
-    root->children.append(missing);
+    QVector<DependencyGraph::Edge> edges(2);
+    edges[0].node = present;
+    edges[1].node = missing;
+    graph->setEdges(root, edges);
 
     ComparisonEngine::MissingReport report;
     report.missingDLLs << "msvcp140.dll";
 
-    QList<DependencyScanner::NodePtr> roots;
-    roots.append(root);
+    QList<DependencyScanner::NodeHandle> roots;
+    roots.append(DependencyScanner::NodeHandle(graph, root));
 
-    const QList<DependencyScanner::NodePtr> found =
+    const QList<DependencyScanner::NodeHandle> found =
         ComparisonEngine::findMissingDLLsInTree(roots, report);
 
     QCOMPARE(found.size(), 1);
-    QCOMPARE(found.first()->fileName.toLower(), QString("msvcp140.dll"));
-    QVERIFY(!found.first()->exists);
+    QCOMPARE(found.first().fileName().toLower(), QString("msvcp140.dll"));
+    QVERIFY(!found.first().exists());
+}
+
+void TestPEParser::testImportedDLLs()
+{
+    QTemporaryFile tempFile;
+    const QStringList imports = QStringList() << "KERNEL32.dll" << "Qt5Core.dll" << "msvcp140.dll";
+    if (!writeTempFile(tempFile, buildPEImage(kMachineAmd64, imports))) {
+        QFAIL("Failed to create temporary PE file");
+    }
+
+    QCOMPARE(PEParser::getImportedDLLs(tempFile.fileName()), imports);
+
+    PEParser::PEInfo info = PEParser::parsePEFile(tempFile.fileName());
+    QVERIFY(info.isValid);
+    QCOMPARE(info.arch, PEParser::x64);
+    QCOMPARE(info.dependencies, imports);
+    QVERIFY(info.fileVersion.isEmpty());
+}
+
+void TestPEParser::testFixedVersionInfo()
+{
+    QTemporaryFile tempFile;
+    const quint64 version = (quint64(5) << 48) | (quint64(15) << 32) | (quint64(2) << 16) | 3;
+    if (!writeTempFile(tempFile, buildPEImage(kMachineI386, QStringList() << "user32.dll", version))) {
+        QFAIL("Failed to create temporary PE file");
+    }
+
+    PEParser::PEInfo info = PEParser::parsePEFile(tempFile.fileName());
+    QVERIFY(info.isValid);
+    QCOMPARE(info.arch, PEParser::x86);
+    QCOMPARE(info.dependencies, QStringList() << "user32.dll");
+    QCOMPARE(info.fileVersion, QString("5.15.2.3"));
+    QCOMPARE(info.productVersion, QString("5.15.2.3"));
+
+    const QPair<QString, QString> versions = PEParser::getVersionInfo(tempFile.fileName());
+    QCOMPARE(versions.first, QString("5.15.2.3"));
+
+    // Import-less roots skip the full parse but keep their versions
+    QTemporaryDir leafDir;
+    QVERIFY(leafDir.isValid());
+    QFile leafFile(leafDir.filePath("resources.dll"));
+    QVERIFY(leafFile.open(QIODevice::WriteOnly));
+    QVERIFY(leafFile.write(buildPEImage(kMachineAmd64, QStringList(), version)) > 0);
+    leafFile.close();
+    DependencyScanner scanner;
+    QList<DependencyScanner::NodeHandle> leaves = scanner.scanDirectory(leafDir.path());
+    QCOMPARE(leaves.size(), 1);
+    QCOMPARE(scanner.statistics().leafFiles, 1);
+    QCOMPARE(leaves.first().fileVersion(), QString("5.15.2.3"));
+    QCOMPARE(leaves.first().productVersion(), QString("5.15.2.3"));
+    leaves = scanner.scanDirectoryParallel(leafDir.path(), false, false, 2);
+    QCOMPARE(leaves.size(), 1);
+    QCOMPARE(leaves.first().fileVersion(), QString("5.15.2.3"));
+    QCOMPARE(leaves.first().arch(), PEParser::x64);
+}
+
+void TestPEParser::testImportDirectoryOutOfBounds()
+{
+    QByteArray image = buildPEImage(kMachineAmd64, QStringList() << "a.dll");
+
+    // Point the import directory far past the end of the file
+    const int importDirectory = 88 + 108 + 4 + 1 * 8;
+    putU32(image, importDirectory, 0x7FFFFFF0);
+
+    PEImage view(reinterpret_cast<const uchar*>(image.constData()), image.size());
+    QVERIFY(view.isValid());
+    QVERIFY(view.importedModules().isEmpty());
+
+    // Truncating inside the section table must not read past the buffer
+    PEImage truncated(reinterpret_cast<const uchar*>(image.constData()), 300);
+    QVERIFY(truncated.importedModules().isEmpty());
+}
+
+void TestPEParser::testVersionStrings()
+{
+    QMap<QString, QString> strings;
+    strings.insert("CompanyName", "The Qt Company Ltd.");
+    strings.insert("OriginalFilename", "Qt5Core.dll");
+    strings.insert("Comments", "");
+
+    QTemporaryFile tempFile;
+    const quint64 version = (quint64(5) << 48) | (quint64(15) << 32) | (quint64(2) << 16);
+    if (!writeTempFile(tempFile, buildPEImage(kMachineAmd64, QStringList(), version, strings))) {
+        QFAIL("Failed to create temporary PE file");
+    }
+
+    // Strings are only decoded on request
+    PEParser::PEInfo info = PEParser::parsePEFile(tempFile.fileName());
+    QVERIFY(info.isValid);
+    QCOMPARE(info.fileVersion, QString("5.15.2.0"));
+    QVERIFY(info.versionStrings.isEmpty());
+
+    info = PEParser::parsePEFile(tempFile.fileName(), PEParser::ParseVersionStrings);
+    QCOMPARE(info.fileVersion, QString("5.15.2.0"));
+    QCOMPARE(info.versionStrings, strings);
+    QCOMPARE(PEParser::getVersionStrings(tempFile.fileName()).value("OriginalFilename"),
+             QString("Qt5Core.dll"));
+}
+
+void TestPEParser::testHeaderProbe()
+{
+    // Zero-byte placeholder
+    QTemporaryFile emptyFile;
+    QVERIFY(emptyFile.open());
+    QCOMPARE(PEParser::probeHeader(emptyFile.fileName()).kind, PEParser::NotPE);
+
+    // Renamed archive
+    QTemporaryFile zipFile;
+    QVERIFY(writeTempFile(zipFile, QByteArray("PK\x03\x04") + QByteArray(8192, 'x')));
+    QCOMPARE(PEParser::probeHeader(zipFile.fileName()).kind, PEParser::NotPE);
+
+    // Valid PE without an import directory becomes a leaf
+    QTemporaryFile leafFile;
+    QVERIFY(createTempPEFile(leafFile, kMachineI386));
+    PEParser::HeaderProbe probe = PEParser::probeHeader(leafFile.fileName());
+    QCOMPARE(probe.kind, PEParser::NoImports);
+    QCOMPARE(probe.arch, PEParser::x86);
+
+    // Valid PE with imports needs the full parse
+    QTemporaryFile importFile;
+    QVERIFY(writeTempFile(importFile, buildPEImage(kMachineAmd64, QStringList() << "Qt5Core.dll")));
+    probe = PEParser::probeHeader(importFile.fileName());
+    QCOMPARE(probe.kind, PEParser::HasImports);
+    QCOMPARE(probe.arch, PEParser::x64);
+
+    // Delay-load imports alone still need the parse, so their DLLs get resolved
+    QTemporaryFile delayFile;
+    QVERIFY(writeTempFile(delayFile, ImageBuilder(kMachineAmd64).addDelayImport("nvcuda.dll").build()));
+    probe = PEParser::probeHeader(delayFile.fileName());
+    QCOMPARE(probe.kind, PEParser::HasImports);
+    QCOMPARE(probe.arch, PEParser::x64);
+
+    // e_lfanew near the end of the page pushes the data directories past it
+    ImageBuilder farBuilder(kMachineAmd64);
+    farBuilder.addImport("Qt5Core.dll").setDataOffset(0x2000);
+    const QByteArray farHeaders = farBuilder.headers();
+    QByteArray farImage = farHeaders.left(64);
+    putU32(farImage, 0x3C, 0xF80);
+    farImage += QByteArray(0xF80 - 64, 0);
+    farImage += farHeaders.mid(64);
+    farImage += QByteArray(int(farBuilder.dataOffset()) - farImage.size(), 0);
+    farImage += farBuilder.section();
+    QTemporaryFile farFile;
+    QVERIFY(writeTempFile(farFile, farImage));
+    probe = PEParser::probeHeader(farFile.fileName());
+    QCOMPARE(probe.kind, PEParser::NeedsFullParse);
+    QCOMPARE(probe.arch, PEParser::x64);
+    QCOMPARE(PEParser::getImportedDLLs(farFile.fileName()), QStringList() << "Qt5Core.dll");
+}
+
+void TestPEParser::testImportViews()
+{
+    QTemporaryFile tempFile;
+    const QStringList imports = QStringList() << "KERNEL32.dll" << "Qt5Core.dll" << "MSVCP140.DLL";
+    if (!writeTempFile(tempFile, buildPEImage(kMachineAmd64, imports))) {
+        QFAIL("Failed to create temporary PE file");
+    }
+
+    PEParser::PEInfo info = PEParser::parsePEFile(tempFile.fileName(), PEParser::ParseImportViews);
+    QVERIFY(info.isValid);
+    QVERIFY(info.dependencies.isEmpty());
+    QVERIFY(!info.image.isNull());
+    QCOMPARE(info.imports.size(), imports.size());
+
+    // Views outlive the parse call and hash like their case-folded QString
+    for (int i = 0; i < imports.size(); ++i) {
+        const PEParser::ImportName& name = info.imports.at(i);
+        QCOMPARE(name.toString(), imports.at(i));
+        QCOMPARE(name.hash, NameFolding::hash(imports.at(i).toLower()));
+        QVERIFY(NameFolding::equals(name.data, name.length, imports.at(i).toUpper()));
+    }
+    QVERIFY(NameFolding::startsWith(info.imports.at(0).data, info.imports.at(0).length, "kernel"));
+    QVERIFY(!NameFolding::startsWith(info.imports.at(1).data, info.imports.at(1).length, "qt5core.dll.x"));
+}
+
+void TestPEParser::testDelayImports()
+{
+    // PE32+ with RVA-based descriptors next to a regular import directory
+    QTemporaryFile tempFile;
+    ImageBuilder builder(kMachineAmd64);
+    builder.addImport("KERNEL32.dll")
+           .addDelayImport("nvcuda.dll")
+           .addDelayImport("dxgi.dll")
+           .setVersion((quint64(1) << 48) | (quint64(2) << 32));
+    if (!writeTempFile(tempFile, builder.build())) {
+        QFAIL("Failed to create temporary PE file");
+    }
+
+    QCOMPARE(PEParser::getImportedDLLs(tempFile.fileName()), QStringList() << "KERNEL32.dll");
+    QCOMPARE(PEParser::getDelayImportedDLLs(tempFile.fileName()), QStringList() << "nvcuda.dll" << "dxgi.dll");
+
+    PEParser::PEInfo info = PEParser::parsePEFile(tempFile.fileName());
+    QVERIFY(info.isValid);
+    QCOMPARE(info.delayDependencies, QStringList() << "nvcuda.dll" << "dxgi.dll");
+    QCOMPARE(info.fileVersion, QString("1.2.0.0"));
+
+    info = PEParser::parsePEFile(tempFile.fileName(), PEParser::ParseImportViews);
+    QCOMPARE(info.delayImports.size(), 2);
+    QCOMPARE(info.delayImports.at(1).toString(), QString("dxgi.dll"));
+
+    // Old PE32 descriptors store VAs relative to the image base
+    QTemporaryFile vaFile;
+    ImageBuilder vaBuilder(kMachineI386);
+    vaBuilder.addDelayImport("WINMM.dll").setDelayImportsVaBased(true);
+    if (!writeTempFile(vaFile, vaBuilder.build())) {
+        QFAIL("Failed to create temporary PE file");
+    }
+    QCOMPARE(PEParser::getDelayImportedDLLs(vaFile.fileName()), QStringList() << "WINMM.dll");
+    QVERIFY(PEParser::getImportedDLLs(vaFile.fileName()).isEmpty());
+}
+
+void TestPEParser::testImportSymbolsAgainstExports()
+{
+    QTemporaryFile providerFile;
+    ImageBuilder provider(kMachineAmd64);
+    provider.addExport("GetValue")
+            .addExport("SetValue")
+            .addExport("HeapAlloc", "NTDLL.RtlAllocateHeap");
+    if (!writeTempFile(providerFile, provider.build())) {
+        QFAIL("Failed to create temporary PE file");
+    }
+
+    const QSharedPointer<const ExportIndex> index = PEParser::getExportIndex(providerFile.fileName());
+    QVERIFY(index);
+    QCOMPARE(index->size(), 3);
+    QVERIFY(index->findName("GetValue", 8));
+    QVERIFY(!index->findName("getvalue", 8));   // Export names are case-sensitive
+    const ExportIndex::Entry* forwarded = index->findName("HeapAlloc", 9);
+    QVERIFY(forwarded);
+    QCOMPARE(forwarded->ordinal, quint32(3));
+    QCOMPARE(QString(index->forwarder(*forwarded)), QString("NTDLL.RtlAllocateHeap"));
+    QVERIFY(index->findOrdinal(2));
+    QVERIFY(!index->findOrdinal(4));
+
+    QTemporaryFile importerFile;
+    ImageBuilder importer(kMachineAmd64);
+    importer.addImport("provider.dll", QStringList() << "GetValue" << "RemovedInV2" << "#2" << "#9");
+    if (!writeTempFile(importerFile, importer.build())) {
+        QFAIL("Failed to create temporary PE file");
+    }
+
+    const PEParser::PEInfo info = PEParser::parsePEFile(importerFile.fileName(), PEParser::ParseImportSymbols);
+    QVERIFY(info.isValid);
+    QCOMPARE(info.imports.size(), 1);
+    QCOMPARE(info.importSymbols.size(), 1);
+    QCOMPARE(info.importSymbols.first().size(), 4);
+
+    QStringList missing;
+    for (const PEImage::ImportedSymbol& symbol : info.importSymbols.first()) {
+        if (!index->contains(symbol)) {
+            missing << (symbol.name.data ? QString::fromLatin1(symbol.name.data, symbol.name.length)
+                                         : QString("#%1").arg(symbol.ordinal));
+        }
+    }
+    QCOMPARE(missing, QStringList() << "RemovedInV2" << "#9");
+
+    // f0.Fn forwards through f1 ... f16 to f17, one hop past the limit; the
+    // same chain entered at f5 ends within it, in whichever order they are walked
+    QTemporaryDir chain;
+    QVERIFY(chain.isValid());
+    for (int i = 0; i <= 17; ++i) {
+        ImageBuilder module(kMachineAmd64);
+        if (i < 17) {
+            module.addExport("Fn", QString("f%1.Fn").arg(i + 1));
+        } else {
+            module.addExport("Fn");
+        }
+        QFile file(chain.filePath(QString("f%1.dll").arg(i)));
+        QVERIFY(file.open(QIODevice::WriteOnly) && file.write(module.build()) > 0);
+    }
+    const QStringList orders[] = { QStringList() << "f0.dll" << "f5.dll", QStringList() << "f5.dll" << "f0.dll" };
+    for (const QStringList& order : orders) {
+        ImageBuilder app(kMachineAmd64);
+        for (const QString& dllName : order) {
+            app.addImport(dllName, QStringList() << "Fn");
+        }
+        QFile file(chain.filePath("app.exe"));
+        QVERIFY(file.open(QIODevice::WriteOnly) && file.write(app.build()) > 0);
+        file.close();
+
+        DependencyScanner scanner;
+        const DependencyScanner::NodeHandle root = scanner.scanFile(chain.filePath("app.exe"));
+        QVERIFY(root);
+        for (const DependencyScanner::DependencyEdge& edge : root.edges()) {
+            if (edge.node.fileName() == "f0.dll") {
+                QCOMPARE(edge.missingSymbols, QStringList() << "Fn -> f17.Fn");
+            } else if (edge.node.fileName() == "f5.dll") {
+                QVERIFY(edge.missingSymbols.isEmpty());
+            }
+        }
+    }
+}
+
+void TestPEParser::testUnsortedSectionTable()
+{
+    const quint16 machines[] = { kMachineI386, kMachineAmd64 };
+    for (quint16 machine : machines) {
+        ImageBuilder builder(machine);
+        builder.setExtraSections(16)
+               .addImport("KERNEL32.dll", QStringList() << "GetProcAddress" << "#12")
+               .addImport("USER32.dll");
+        QByteArray image = builder.build();
+
+        // Move the data section header to the front; lookups must not depend on table order
+        const int table = 88 + (machine == kMachineAmd64 ? 240 : 224);
+        const QByteArray first = image.mid(table, 40);
+        image.replace(table, 40, image.mid(table + 16 * 40, 40));
+        image.replace(table + 16 * 40, 40, first);
+
+        const PEImage pe(reinterpret_cast<const uchar*>(image.constData()), image.size());
+        QVERIFY(pe.isValid());
+        QCOMPARE(pe.is64Bit(), machine == kMachineAmd64);
+        QCOMPARE(pe.sections().size(), 17);
+        for (int i = 1; i < pe.sections().size(); ++i) {
+            QVERIFY(pe.sections().at(i - 1).virtualAddress < pe.sections().at(i).virtualAddress);
+        }
+
+        const QVector<PEImage::ImportedModule> modules = pe.importTable();
+        QCOMPARE(modules.size(), 2);
+        QCOMPARE(QByteArray(modules.at(1).name.data, modules.at(1).name.length), QByteArray("USER32.dll"));
+        QCOMPARE(modules.at(0).symbols.size(), 2);
+        QCOMPARE(QByteArray(modules.at(0).symbols.at(0).name.data, modules.at(0).symbols.at(0).name.length),
+                 QByteArray("GetProcAddress"));
+        QVERIFY(!modules.at(0).symbols.at(1).name.data);
+        QCOMPARE(modules.at(0).symbols.at(1).ordinal, quint16(12));
+    }
+}
+
+void TestPEParser::testContentDigest()
+{
+    // Reference XXH64 values (seed 0)
+    const QByteArray fox("The quick brown fox jumps over the lazy dog");
+    QCOMPARE(ContentDigest::compute(nullptr, 0), Q_UINT64_C(0xef46db3751d8e999));
+    QCOMPARE(ContentDigest::compute(reinterpret_cast<const uchar*>("abc"), 3), Q_UINT64_C(0x44bc2cf5ad770999));
+    QCOMPARE(ContentDigest::compute(reinterpret_cast<const uchar*>(fox.constData()), fox.size()),
+             Q_UINT64_C(0x0b242d361fda71bc));
+    QCOMPARE(ContentDigest::toHex(Q_UINT64_C(0x0b242d361fda71bc)), QString("0b242d361fda71bc"));
+
+    // Streaming in uneven pieces matches the one-shot digest
+    ImageBuilder builder(kMachineAmd64);
+    builder.addImport("pcl_common.dll", QStringList() << "pcl_free" << "#3")
+           .setVersion((quint64(1) << 48) | (quint64(12) << 32));
+    const QByteArray image = builder.build();
+    const uchar* bytes = reinterpret_cast<const uchar*>(image.constData());
+    ContentDigest streamed;
+    for (int offset = 0; offset < image.size(); offset += 37) {
+        streamed.update(bytes + offset, qMin(37, image.size() - offset));
+    }
+    QCOMPARE(streamed.finish(), ContentDigest::compute(bytes, image.size()));
+
+    // Byte-identical copies get the same digest; any change gives another
+    QTemporaryFile first;
+    QTemporaryFile second;
+    QTemporaryFile patched;
+    QByteArray changed = image;
+    changed[changed.size() - 1] = char(0x5A);
+    if (!writeTempFile(first, image) || !writeTempFile(second, image) || !writeTempFile(patched, changed)) {
+        QFAIL("Failed to create temporary PE file");
+    }
+
+    const PEParser::PEInfo info = PEParser::parsePEFile(first.fileName(), PEParser::ParseContentDigest);
+    QVERIFY(info.isValid);
+    QCOMPARE(info.contentDigest, ContentDigest::compute(bytes, image.size()));
+    QCOMPARE(PEParser::getContentDigest(second.fileName()), info.contentDigest);
+    QVERIFY(PEParser::getContentDigest(patched.fileName()) != info.contentDigest);
+    QCOMPARE(PEParser::parsePEFile(first.fileName()).contentDigest, quint64(0));
+
+    // A kept parse holds copies of its names, not the file
+    PEParser::PEInfo detached = PEParser::parsePEFile(first.fileName(), PEParser::ParseImportSymbols);
+    PEParser::detachImports(&detached);
+    QVERIFY(detached.image.isNull());
+    QCOMPARE(detached.imports.size(), 1);
+    QCOMPARE(detached.imports.at(0).toString(), QString("pcl_common.dll"));
+    QCOMPARE(detached.importSymbols.at(0).size(), 2);
+    QCOMPARE(QByteArray(detached.importSymbols.at(0).at(0).name.data), QByteArray("pcl_free"));
+    QVERIFY(!detached.importSymbols.at(0).at(1).name.data);
+
+    // Three copies in one scan: the first of its size is parsed alone, the
+    // second is kept for sharing and the third reuses it
+    QTemporaryDir work;
+    QVERIFY(work.isValid());
+    const char* const folders[] = { "a", "b", "c" };
+    for (const char* folder : folders) {
+        QVERIFY(QDir(work.path()).mkpath(folder));
+        QFile copy(QDir(work.filePath(folder)).filePath("pcl_io.dll"));
+        QVERIFY(copy.open(QIODevice::WriteOnly));
+        QVERIFY(copy.write(image) == image.size());
+    }
+    DependencyScanner scanner;
+    const QList<DependencyScanner::NodeHandle> roots = scanner.scanDirectory(work.path(), true);
+    QCOMPARE(roots.size(), 3);
+    QCOMPARE(scanner.statistics().modulesParsed, 2);
+    QCOMPARE(scanner.statistics().sharedParses, 1);
+    for (const DependencyScanner::NodeHandle& root : roots) {
+        QCOMPARE(root.contentDigest(), info.contentDigest);
+        QCOMPARE(root.edgeCount(), 1);
+        QCOMPARE(root.edge(0).node.fileName(), QString("pcl_common.dll"));
+    }
+}
+
+void TestPEParser::testTargetProfile()
+{
+    // A foreign Windows directory, as found on a mounted image
+    QTemporaryDir windows;
+    QTemporaryDir work;
+    QVERIFY(windows.isValid() && work.isValid());
+    QVERIFY(QDir(windows.path()).mkpath("system32"));
+    QVERIFY(QDir(windows.path()).mkpath("WinSxS/amd64_microsoft.vc90.crt_1fc8b3b9a1e18e3b_9.0.30729.9635"));
+    ImageBuilder builder(kMachineAmd64);
+    builder.setVersion((quint64(10) << 48) | (quint64(0) << 32) | (quint64(19041) << 16) | 3636);
+    QFile kernel32(QDir(windows.path()).filePath("system32/KERNEL32.dll"));
+    QVERIFY(kernel32.open(QIODevice::WriteOnly));
+    kernel32.write(builder.build());
+    kernel32.close();
+    QFile msvcr90(QDir(windows.path()).filePath(
+        "WinSxS/amd64_microsoft.vc90.crt_1fc8b3b9a1e18e3b_9.0.30729.9635/msvcr90.dll"));
+    QVERIFY(msvcr90.open(QIODevice::WriteOnly));
+    msvcr90.close();
+    QFile notepad(QDir(windows.path()).filePath("notepad.exe"));
+    QVERIFY(notepad.open(QIODevice::WriteOnly));
+    notepad.close();
+
+    const QString profilePath = work.filePath("target.dllprofile");
+    QString error;
+    QVERIFY2(TargetProfile::capture(windows.path(), profilePath, "C:/Windows", &error), qPrintable(error));
+
+    const QSharedPointer<const TargetProfile> profile = TargetProfile::load(profilePath, &error);
+    QVERIFY2(profile, qPrintable(error));
+    QCOMPARE(profile->fileCount(), 3);
+    QCOMPARE(profile->systemDirectories(), QStringList() << "C:/Windows/system32" << "C:/Windows");
+    QCOMPARE(profile->findDirectory("c:\\windows\\SYSTEM32\\"), 0);
+    QCOMPARE(profile->findDirectory("C:/Windows/SysWOW64"), -1);
+
+    // Case-insensitive lookups with the version captured from the image
+    TargetProfile::FileEntry entry;
+    QVERIFY(profile->findFile("kernel32.DLL", profile->findDirectory("C:/Windows/System32"), &entry));
+    QCOMPARE(entry.fileName, QString("KERNEL32.dll"));
+    QCOMPARE(entry.kind, TargetProfile::System32);
+    QCOMPARE(TargetProfile::versionToString(entry.fileVersion), QString("10.0.19041.3636"));
+    QVERIFY(profile->findFile("NOTEPAD.EXE", -1, &entry));
+    QCOMPARE(entry.kind, TargetProfile::WindowsDirectory);
+    QVERIFY(profile->findFileOfKind("MSVCR90.dll", TargetProfile::SideBySide));
+    QVERIFY(!profile->findFile("user32.dll", -1));
+
+    // Truncated files are rejected instead of read out of bounds
+    QFile source(profilePath);
+    QVERIFY(source.open(QIODevice::ReadOnly));
+    QTemporaryFile truncated;
+    if (!writeTempFile(truncated, source.readAll().left(60))) {
+        QFAIL("Failed to create temporary profile");
+    }
+    QVERIFY(!TargetProfile::load(truncated.fileName()));
+
+    // The resolver answers system directories from the profile, not the local disk
+    PathResolver::setTargetProfile(profile);
+    const PathResolver::ResolveResult resolved = PathResolver::resolveDLLPath("Kernel32.dll", work.path());
+    QVERIFY(resolved.found);
+    QVERIFY(resolved.fromTargetProfile);
+    QCOMPARE(resolved.foundPath, QString("C:/Windows/system32/KERNEL32.dll"));
+    QCOMPARE(resolved.fileVersion, QString("10.0.19041.3636"));
+    QVERIFY(PathResolver::isSystemDLL("msvcr90.dll"));
+    PathResolver::clearTargetProfile();
+    QVERIFY(!PathResolver::targetProfile());
+}
+
+void TestPEParser::testSystemDllTable()
+{
+    // Every built-in name owns its slot and matches in any case, as bytes or QString
+    for (const char* name : SystemDllTable::kNames) {
+        const QByteArray upper = QByteArray(name).toUpper();
+        QVERIFY(SystemDllTable::contains(NameFolding::makeName(upper.constData(), upper.size())));
+        QVERIFY(SystemDllTable::contains(QString::fromLatin1(name)));
+    }
+
+    const QByteArray apiSet("API-MS-WIN-CORE-FILE-L1-1-0.dll");
+    QVERIFY(SystemDllTable::contains(NameFolding::makeName(apiSet.constData(), apiSet.size())));
+    QVERIFY(SystemDllTable::contains(QString("ext-ms-win-ntuser-window-l1-1-0.dll")));
+    QVERIFY(SystemDllTable::contains(QString("UcrtBase.dll")));
+
+    // Near misses: truncated, extended and embedded names, short prefixes
+    const char* const others[] = { "kernel32.dl", "kernel32.dlll", "mykernel32.dll", "api-ms-wi",
+                                   "ucrtbas", "Qt5Core.dll", "" };
+    for (const char* name : others) {
+        QVERIFY2(!SystemDllTable::contains(QString::fromLatin1(name)), name);
+        QVERIFY2(!SystemDllTable::contains(NameFolding::makeName(name, int(qstrlen(name)))), name);
+    }
+
+    QVERIFY(PathResolver::isSystemDLL(QString("Kernel32.DLL")));
+    QVERIFY(!PathResolver::isSystemDLL(QString("definitely_not_a_system_dll_1234.dll")));
+}
+
+void TestPEParser::testApiSetSchema()
+{
+    QList<QPair<QString, QString> > contracts;
+    contracts << qMakePair(QString("api-ms-win-core-file-l1-2-4"), QString("kernelbase.dll"))
+              << qMakePair(QString("api-ms-win-crt-runtime-l1-1-0"), QString("ucrtbase.dll"))
+              << qMakePair(QString("ext-ms-win-gdi-dc-l1-2-0"), QString());
+    const QByteArray section = apiSetSchemaV6(contracts);
+
+    // Contracts match without ".dll" and regardless of the minor version
+    QString error;
+    const QSharedPointer<const ApiSetSchema> schema = ApiSetSchema::fromData(section, &error);
+    QVERIFY2(schema, qPrintable(error));
+    QCOMPARE(schema->version(), 6);
+    QCOMPARE(schema->contractCount(), 3);
+    QCOMPARE(schema->hostFor(QString("API-MS-WIN-CORE-FILE-L1-2-2.dll")), QString("kernelbase.dll"));
+    QCOMPARE(schema->hostFor(QString("api-ms-win-core-file-l1-2-4")), QString("kernelbase.dll"));
+    const QByteArray crt("api-ms-win-crt-runtime-l1-1-0.dll");
+    QCOMPARE(schema->hostFor(NameFolding::makeName(crt.constData(), crt.size())), QString("ucrtbase.dll"));
+    QVERIFY(schema->hostFor(QString("api-ms-win-core-file-l2-1-0.dll")).isEmpty());
+    QVERIFY(schema->hostFor(QString("ext-ms-win-gdi-dc-l1-2-0.dll")).isEmpty());
+
+    // Truncated and unknown layouts are rejected
+    QVERIFY(!ApiSetSchema::fromData(section.left(40)));
+    QByteArray future = section;
+    putU32(future, 0, 7);
+    QVERIFY(!ApiSetSchema::fromData(future, &error));
+
+    // A target whose System32 carries apisetschema.dll and one host
+    QTemporaryDir windows;
+    QTemporaryDir work;
+    QVERIFY(windows.isValid() && work.isValid());
+    QVERIFY(QDir(windows.path()).mkpath("System32"));
+    ImageBuilder schemaImage(kMachineAmd64);
+    schemaImage.setRawSection(".apiset", section);
+    QFile schemaFile(QDir(windows.path()).filePath("System32/apisetschema.dll"));
+    QVERIFY(schemaFile.open(QIODevice::WriteOnly));
+    schemaFile.write(schemaImage.build());
+    schemaFile.close();
+    QVERIFY(touchFiles(windows.path(), QStringList() << "System32/kernelbase.dll"));
+
+    QVERIFY(ApiSetSchema::load(schemaFile.fileName()));
+    QVERIFY2(loadTargetProfile(windows.path(), work.filePath("target.dllprofile"), &error), qPrintable(error));
+    QVERIFY(PathResolver::apiSetSchema());
+    QCOMPARE(PathResolver::apiSetSchema()->contractCount(), 3);
+
+    // Contracts resolve to their host; ones the target lacks are missing, not system
+    const PathResolver::ResolveResult file = PathResolver::resolveDLLPath("api-ms-win-core-file-l1-2-2.dll", work.path());
+    QVERIFY(file.found);
+    QCOMPARE(file.apiSetHost, QString("kernelbase.dll"));
+    QCOMPARE(file.foundPath, QString("C:/Windows/System32/kernelbase.dll"));
+    QVERIFY(PathResolver::isSystemDLL(QString("api-ms-win-core-file-l1-2-2.dll")));
+    QVERIFY(!PathResolver::resolveDLLPath("api-ms-win-core-file-l2-1-0.dll", work.path()).found);
+    QVERIFY(!PathResolver::isSystemDLL(QString("api-ms-win-core-file-l2-1-0.dll")));
+    QVERIFY(!PathResolver::isSystemDLL(QString("ext-ms-win-gdi-dc-l1-2-0.dll")));
+
+    // The host itself is absent on this target
+    const PathResolver::ResolveResult crtResult = PathResolver::resolveDLLPath("api-ms-win-crt-runtime-l1-1-0.dll",
+                                                                               work.path());
+    QVERIFY(!crtResult.found);
+    QCOMPARE(crtResult.apiSetHost, QString("ucrtbase.dll"));
+}
+
+void TestPEParser::testMissFilter()
+{
+    // No false negatives, and only a small share of absent hashes let through
+    BloomFilter filter(1000);
+    for (int i = 0; i < 1000; ++i) {
+        filter.insert(NameFolding::hash(QString("present%1.dll").arg(i)));
+    }
+    int falsePositives = 0;
+    for (int i = 0; i < 1000; ++i) {
+        QVERIFY(filter.mayContain(NameFolding::hash(QString("present%1.dll").arg(i))));
+        if (filter.mayContain(NameFolding::hash(QString("absent%1.dll").arg(i)))) {
+            ++falsePositives;
+        }
+    }
+    QVERIFY(falsePositives < 50);
+
+    // A target System32, one PATH directory and an app directory
+    QTemporaryDir windows;
+    QTemporaryDir work;
+    QVERIFY(windows.isValid() && work.isValid());
+    QVERIFY(touchFiles(windows.path(), QStringList() << "System32/kernel32.dll"));
+    QVERIFY(touchFiles(work.path(), QStringList() << "app/private.dll" << "tools/Tool.dll"));
+    QString error;
+    setPath(work.filePath("tools"));
+    QVERIFY2(loadTargetProfile(windows.path(), work.filePath("target.dllprofile"), &error), qPrintable(error));
+
+    // Hits in the profile, on PATH and in the app directory are unaffected
+    const QString appDir = work.filePath("app");
+    QVERIFY(PathResolver::resolveDLLPath("KERNEL32.DLL", appDir).found);
+    QCOMPARE(PathResolver::resolveDLLPath("tool.dll", appDir).foundPath, QDir(work.filePath("tools")).filePath("Tool.dll"));
+    QVERIFY(PathResolver::resolveDLLPath("private.dll", appDir).found);
+
+    // Misses skip the shared directories but still report the full search order
+    const PathResolver::LookupStatistics before = PathResolver::lookupStatistics();
+    const PathResolver::ResolveResult missing = PathResolver::resolveDLLPath("vendor_sdk.dll", appDir);
+    QVERIFY(!missing.found);
+    QCOMPARE(missing.searchedPaths.size(), PathResolver::context(appDir).searchPaths().size());
+    const PathResolver::LookupStatistics after = PathResolver::lookupStatistics();
+    QCOMPARE(after.missFilterHits + after.missFilterFalsePositives,
+             before.missFilterHits + before.missFilterFalsePositives + 1);
+
+    // The same answers without the filter
+    PathResolver::setMissFilterEnabled(false);
+    QVERIFY(PathResolver::resolveDLLPath("private.dll", appDir).found);
+    QVERIFY(!PathResolver::resolveDLLPath("vendor_sdk.dll", appDir).found);
+    PathResolver::setMissFilterEnabled(true);
+}
+
+void TestPEParser::testCaseInsensitiveResolution()
+{
+    // Windows upcase semantics: one unit at a time, no locale
+    QVERIFY(NameFolding::equals(QString(QChar(0x00FF)), QString(QChar(0x0178))));  // y with diaeresis
+    QVERIFY(NameFolding::equals(QString(QChar(0x0131)), QString("I")));            // dotless i upcases to I
+    QVERIFY(!NameFolding::equals(QString(QChar(0x0130)), QString("i")));           // dotted capital I stays apart
+    QVERIFY(!NameFolding::equals(QString(QChar(0x212A)), QString("k")));           // Kelvin sign stays apart
+    QCOMPARE(NameFolding::hash(QString("GxIAPICPPEx.dll")), NameFolding::hash(QString("gxiapicppex.DLL")));
+
+    // An app tree that kept its original mixed case
+    QTemporaryDir work;
+    QVERIFY(work.isValid());
+    QVERIFY(QDir(work.path()).mkpath("App/Plugins"));
+    const char* const files[] = { "App/GxIAPICPPEx.dll", "App/Plugins/Codec.DLL" };
+    for (const char* name : files) {
+        QFile file(work.filePath(name));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+    }
+    const QString appDir = work.filePath("App");
+
+    const bool indexModes[] = { true, false };
+    for (bool indexEnabled : indexModes) {
+        PathResolver::setDirectoryIndexEnabled(indexEnabled);
+        PathResolver::clearCache();
+
+        const PathResolver::ResolveResult plain = PathResolver::resolveDLLPath("gxiapicppex.dll", appDir);
+        QVERIFY(plain.found);
+        QVERIFY(QFileInfo::exists(plain.foundPath));
+        QVERIFY(NameFolding::equals(plain.foundPath, work.filePath("App/GxIAPICPPEx.dll")));
+
+        const PathResolver::ResolveResult nested = PathResolver::resolveDLLPath("PLUGINS\\codec.dll", appDir);
+        QVERIFY(nested.found);
+        QVERIFY(QFileInfo::exists(nested.foundPath));
+        QVERIFY(NameFolding::equals(nested.foundPath, work.filePath("App/Plugins/Codec.DLL")));
+
+        QVERIFY(!PathResolver::resolveDLLPath("gxiapicppex2.dll", appDir).found);
+    }
+    PathResolver::setDirectoryIndexEnabled(true);
+
+    // Absolute paths match component by component
+    const QString absolute = QDir(work.path()).filePath("app/plugins/CODEC.dll");
+    const PathResolver::ResolveResult direct = PathResolver::resolveDLLPath(absolute, QString());
+    QVERIFY(direct.found);
+    QVERIFY(QFileInfo::exists(direct.foundPath));
+    PathResolver::clearCache();
+}
+
+void TestPEParser::testSearchPlan()
+{
+    QCOMPARE(SearchPlan(), SearchPlan::standard());
+    QVERIFY(SearchPlan::standard(true) != SearchPlan::standard(false));
+    QCOMPARE(SearchPlan::withDllDirectory("D:/Plugins"), SearchPlan::withDllDirectory("d:/plugins"));
+    QVERIFY(SearchPlan::defaultDirs() != SearchPlan::defaultDirs(QStringList() << "D:/Sdk"));
+
+    // A target Windows directory, an app, SetDllDirectory/AddDllDirectory targets and PATH
+    QTemporaryDir windows;
+    QTemporaryDir work;
+    QVERIFY(windows.isValid() && work.isValid());
+    QVERIFY(QDir(windows.path()).mkpath("System32"));
+    QVERIFY(touchFiles(windows.path(), QStringList() << "SysWOW64/wow64only.dll"));
+    QVERIFY(QDir(work.path()).mkpath("app"));
+    QVERIFY(touchFiles(work.path(), QStringList() << "dlls/plugin.dll" << "user/sdk.dll" << "tools/tool.dll"));
+    QString error;
+    setPath(work.filePath("tools"));
+    QVERIFY2(loadTargetProfile(windows.path(), work.filePath("target.dllprofile"), &error), qPrintable(error));
+
+    const QString appDir = work.filePath("app");
+    const QString dllDir = work.filePath("dlls");
+    const QString userDir = work.filePath("user");
+    const QString toolsDir = work.filePath("tools");
+    const QString currentDir = QDir::currentPath();
+
+    QCOMPARE(PathResolver::context(appDir, SearchPlan::standard(true)).searchPaths(),
+             QStringList() << appDir << "C:/Windows/System32" << "C:/Windows/SysWOW64" << "C:/Windows"
+                           << currentDir << toolsDir);
+    QCOMPARE(PathResolver::context(appDir, SearchPlan::standard(false)).searchPaths(),
+             QStringList() << appDir << currentDir << "C:/Windows/System32" << "C:/Windows/SysWOW64"
+                           << "C:/Windows" << toolsDir);
+    QCOMPARE(PathResolver::context(appDir, SearchPlan::withDllDirectory(dllDir)).searchPaths(),
+             QStringList() << appDir << dllDir << "C:/Windows/System32" << "C:/Windows/SysWOW64"
+                           << "C:/Windows" << toolsDir);
+    const SearchPlan restricted = SearchPlan::defaultDirs(QStringList() << userDir);
+    QCOMPARE(PathResolver::context(appDir, restricted).searchPaths(),
+             QStringList() << appDir << userDir << "C:/Windows/System32");
+
+    // Restricted plans see neither PATH nor SysWOW64; the active plan applies to plain lookups
+    QVERIFY(PathResolver::resolveDLLPath("tool.dll", appDir).found);
+    QVERIFY(PathResolver::resolveDLLPath("wow64only.dll", appDir).found);
+    QVERIFY(!PathResolver::resolveDLLPath("sdk.dll", appDir).found);
+    PathResolver::setSearchPlan(restricted);
+    QCOMPARE(PathResolver::searchPlan(), restricted);
+    QVERIFY(!PathResolver::resolveDLLPath("tool.dll", appDir).found);
+    QVERIFY(!PathResolver::resolveDLLPath("wow64only.dll", appDir).found);
+    QVERIFY(PathResolver::resolveDLLPath("SDK.dll", appDir).found);
+    QVERIFY(PathResolver::resolveDLLPath("plugin.dll", PathResolver::context(appDir, SearchPlan::withDllDirectory(dllDir))).found);
+}
+
+void TestPEParser::testKnownDlls()
+{
+    // A regedit export (UTF-16 with BOM) with a wrapped hex value and an unrelated key
+    const QString exportText = QString(
+        "Windows Registry Editor Version 5.00\r\n\r\n"
+        "[HKEY_LOCAL_MACHINE\\SYSTEM\\CurrentControlSet\\Control\\Session Manager\\KnownDLLs]\r\n"
+        "\"DllDirectory\"=hex(2):25,00,53,00,79,00,73,00,\\\r\n  74,00,00,00\r\n"
+        "\"ole32\"=\"ole32.dll\"\r\n"
+        "\"combase\"=\"combase.dll\"\r\n"
+        "\"kernel32\"=\"KERNEL32.dll\"\r\n\r\n"
+        "[HKEY_LOCAL_MACHINE\\SYSTEM\\CurrentControlSet\\Control\\Session Manager\\Environment]\r\n"
+        "\"unrelated\"=\"unrelated.dll\"\r\n");
+    QByteArray exportData("\xFF\xFE", 2);
+    exportData.append(reinterpret_cast<const char*>(exportText.utf16()), exportText.size() * 2);
+    QTemporaryDir work;
+    QVERIFY(work.isValid());
+    const QString exportPath = work.filePath("knowndlls.reg");
+    QFile exportFile(exportPath);
+    QVERIFY(exportFile.open(QIODevice::WriteOnly));
+    exportFile.write(exportData);
+    exportFile.close();
+
+    QString error;
+    const QSharedPointer<const KnownDlls> knownDlls = KnownDlls::loadRegistryExport(exportPath, &error);
+    QVERIFY2(knownDlls, qPrintable(error));
+    QCOMPARE(knownDlls->count(), 3);
+    QVERIFY(knownDlls->contains(QString("Ole32.DLL")));
+    const QByteArray kernel32("kernel32.dll");
+    QVERIFY(knownDlls->contains(NameFolding::makeName(kernel32.constData(), kernel32.size())));
+    QVERIFY(!knownDlls->contains(QString("unrelated.dll")));
+    QVERIFY(!knownDlls->contains(QString("DllDirectory")));
+    QVERIFY(!KnownDlls::loadRegistryExport(work.filePath("missing.reg"), &error));
+
+    // The target ships ole32.dll in both system directories and a stray
+    // kernel32.dll in the Windows directory; the app carries its own ole32.dll and combase.dll
+    QTemporaryDir windows;
+    QVERIFY(windows.isValid());
+    QVERIFY(touchFiles(windows.path(), QStringList() << "System32/ole32.dll" << "SysWOW64/ole32.dll"
+                                                     << "kernel32.dll"));
+    QVERIFY(touchFiles(work.path(), QStringList() << "app/ole32.dll" << "app/combase.dll"));
+    const QString appDir = work.filePath("app");
+
+    // Without KnownDLLs the app-local copy shadows the system one
+    QVERIFY2(loadTargetProfile(windows.path(), work.filePath("plain.dllprofile"), &error), qPrintable(error));
+    QVERIFY(!PathResolver::knownDlls());
+    const PathResolver::ResolveResult shadowed = PathResolver::resolveDLLPath("ole32.dll", appDir);
+    QVERIFY(!shadowed.knownDll);
+    QCOMPARE(QFileInfo(shadowed.foundPath).absolutePath(), QFileInfo(appDir).absoluteFilePath());
+
+    // With the target's list captured into the profile, known names skip the search order
+    QVERIFY2(loadTargetProfile(windows.path(), work.filePath("target.dllprofile"), &error, exportPath),
+             qPrintable(error));
+    QVERIFY(PathResolver::knownDlls());
+    QCOMPARE(PathResolver::knownDlls()->count(), 3);
+    const PathResolver::ResolveResult known = PathResolver::resolveDLLPath("OLE32.dll", appDir);
+    QVERIFY(known.knownDll);
+    QVERIFY(known.fromTargetProfile);
+    QCOMPARE(known.foundPath, QString("C:/Windows/System32/ole32.dll"));
+    QCOMPARE(known.searchedPaths.size(), 1);
+
+    // A 32-bit importer maps its KnownDLLs from SysWOW64
+    const ResolverContext context = PathResolver::context(appDir);
+    const PathResolver::ResolveResult known32 = PathResolver::resolveDLLPath("ole32.dll", context, true);
+    QVERIFY(known32.knownDll);
+    QCOMPARE(known32.foundPath, QString("C:/Windows/SysWOW64/ole32.dll"));
+    QCOMPARE(PathResolver::resolveDLLPath("ole32.dll", context).foundPath, known.foundPath);
+
+    // The Windows directory holds no KnownDLL sections; the name goes through the search order
+    const PathResolver::ResolveResult windowsOnly = PathResolver::resolveDLLPath("kernel32.dll", appDir);
+    QVERIFY(!windowsOnly.knownDll);
+    QVERIFY(windowsOnly.searchedPaths.size() > 1);
+
+    // Known but absent on the target: the loader falls back to the normal search
+    const PathResolver::ResolveResult fallback = PathResolver::resolveDLLPath("combase.dll", appDir);
+    QVERIFY(fallback.found);
+    QVERIFY(!fallback.knownDll);
+    QVERIFY(PathResolver::isSystemDLL(QString("combase.dll")));
+}
+
+void TestPEParser::testSharedDependencyGraph()
+{
+    // app.exe imports a.dll and b.dll and delay-loads d.dll; a.dll and b.dll
+    // both import c.dll, which imports a.dll back; b.dll also needs a DLL
+    // that does not exist, and d.dll imports c.dll
+    QTemporaryDir work;
+    QVERIFY(work.isValid());
+    QVERIFY(writeModule(work.filePath("app.exe"), QStringList() << "a.dll" << "b.dll", QStringList() << "d.dll"));
+    QVERIFY(writeModule(work.filePath("a.dll"), QStringList() << "c.dll"));
+    QVERIFY(writeModule(work.filePath("b.dll"), QStringList() << "c.dll" << "missing.dll"));
+    QVERIFY(writeModule(work.filePath("c.dll"), QStringList() << "a.dll"));
+    QVERIFY(writeModule(work.filePath("d.dll"), QStringList() << "c.dll"));
+
+    DependencyScanner scanner;
+    const DependencyScanner::NodeHandle root = scanner.scanFile(work.filePath("app.exe"));
+    QVERIFY(root);
+    QCOMPARE(root.edgeCount(), 3);
+    const DependencyScanner::NodeHandle a = root.edge(0).node;
+    const DependencyScanner::NodeHandle b = root.edge(1).node;
+    const DependencyScanner::DependencyEdge delayEdge = root.edge(2);
+    QCOMPARE(a.fileName(), QString("a.dll"));
+    QCOMPARE(a.edgeCount(), 1);
+    QCOMPARE(b.edgeCount(), 2);
+
+    // c.dll is a single node shared by both importers; its import of a.dll is cut as a cycle
+    const DependencyScanner::NodeHandle c = a.edge(0).node;
+    QVERIFY(b.edge(0).node == c);
+    QCOMPARE(c.edgeCount(), 1);
+    QVERIFY(c.edge(0).circular);
+    QVERIFY(c.edge(0).node != a);
+    QCOMPARE(c.edge(0).node.edgeCount(), 0);
+    QVERIFY(!b.edge(1).node.exists());
+    QVERIFY(delayEdge.delayLoad);
+    QVERIFY(delayEdge.node.delayPending());
+
+    // Each module once, in pre-order: app, a, c, b, missing.dll, d
+    QList<DependencyScanner::NodeHandle> roots;
+    roots.append(root);
+    const QList<DependencyScanner::NodeHandle> modules = DependencyScanner::modules(roots);
+    QCOMPARE(modules.size(), 6);
+    QVERIFY(modules.at(2) == c);
+    const ComparisonEngine::MissingReport report = ComparisonEngine::generateMissingReport(roots);
+    QCOMPARE(report.missingDLLs, QStringList() << "missing.dll");
+
+    // Expanding the delay-load links the existing c.dll node instead of parsing it again
+    const DependencyScanner::NodeHandle d = delayEdge.node;
+    QVERIFY(scanner.expandDelayLoad(d, root));
+    QVERIFY(!d.delayPending());
+    QCOMPARE(d.edgeCount(), 1);
+    QVERIFY(d.edge(0).node == c);
+    QVERIFY(!scanner.expandDelayLoad(d, root));
+
+    // In a directory scan the roots share one graph: a delay-load expanded
+    // under one root links a DLL that only another root imports.
+    // plugin.drv is not a root itself (not *.dll or *.exe).
+    QVERIFY(QDir(work.path()).mkdir("app"));
+    QVERIFY(writeModule(work.filePath("app/app.exe"), QStringList(), QStringList() << "plugin.drv"));
+    QVERIFY(writeModule(work.filePath("app/plugin.drv"), QStringList() << "x.dll"));
+    QVERIFY(writeModule(work.filePath("app/tool.exe"), QStringList() << "x.dll"));
+    QVERIFY(writeModule(work.filePath("app/x.dll"), QStringList()));
+
+    DependencyScanner directoryScanner;
+    const QList<DependencyScanner::NodeHandle> appRoots = directoryScanner.scanDirectory(work.filePath("app"));
+    QCOMPARE(appRoots.size(), 3);
+    DependencyScanner::NodeHandle app;
+    DependencyScanner::NodeHandle x;
+    for (const DependencyScanner::NodeHandle& appRoot : appRoots) {
+        if (appRoot.fileName() == "app.exe") {
+            app = appRoot;
+        } else if (appRoot.fileName() == "x.dll") {
+            x = appRoot;
+        }
+    }
+    QVERIFY(app && x);
+    const DependencyScanner::NodeHandle plugin = app.edge(0).node;
+    QVERIFY(plugin.delayPending());
+
+    // Expanded by a short-lived scanner, as the tree view does
+    {
+        DependencyScanner expander;
+        QVERIFY(expander.expandDelayLoad(plugin, app));
+    }
+    QCOMPARE(plugin.edgeCount(), 1);
+    QVERIFY(plugin.edge(0).node == x);
+    QCOMPARE(DependencyScanner::modules(appRoots).size(), 4);
+
+    // Missing DLLs and cycle placeholders are one node per name, whatever
+    // the number of imports and the case they are spelled in
+    QVERIFY(QDir(work.path()).mkdir("dedup"));
+    QVERIFY(writeModule(work.filePath("dedup/host.exe"), QStringList() << "p.dll" << "q.dll"));
+    QVERIFY(writeModule(work.filePath("dedup/p.dll"), QStringList() << "gone.dll" << "host.exe"));
+    QVERIFY(writeModule(work.filePath("dedup/q.dll"), QStringList() << "GONE.DLL" << "host.exe"));
+
+    DependencyScanner dedupScanner;
+    const DependencyScanner::NodeHandle host = dedupScanner.scanFile(work.filePath("dedup/host.exe"));
+    QVERIFY(host);
+    const DependencyScanner::NodeHandle p = host.edge(0).node;
+    const DependencyScanner::NodeHandle q = host.edge(1).node;
+    QCOMPARE(p.edgeCount(), 2);
+    QCOMPARE(q.edgeCount(), 2);
+    QVERIFY(!p.edge(0).node.exists());
+    QVERIFY(p.edge(0).node == q.edge(0).node);
+    QVERIFY(p.edge(1).circular && q.edge(1).circular);
+    QVERIFY(p.edge(1).node == q.edge(1).node);
+    QCOMPARE(host.graph()->nodeCount(), 5);
+    QVERIFY(!dedupScanner.isGraphFull());
+}
+
+void TestPEParser::testDependencyGraphStorage()
+{
+    QSharedPointer<DependencyGraph> graph(new DependencyGraph());
+    const auto root = createNode(graph.data(), "app.exe", "C:/app/app.exe", true);
+    const DependencyGraph::Node* rootAddress = &graph->node(root);
+
+    // Enough nodes for several arena blocks; earlier nodes never move
+    QVector<DependencyGraph::Edge> edges;
+    for (int i = 0; i < 3000; ++i) {
+        DependencyGraph::Edge edge;
+        edge.node = createNode(graph.data(), QString("lib%1.dll").arg(i), QString("C:/app/lib%1.dll").arg(i), i % 2 == 0);
+        edge.delayLoad = i == 1;
+        edges.append(edge);
+    }
+    edges[2].symbolList = graph->addSymbolList(QStringList() << "Missing1" << "#7");
+    graph->setEdges(root, edges);
+    QVERIFY(&graph->node(root) == rootAddress);
+    QCOMPARE(graph->nodeCount(), 3001);
+
+    // A leaf that gets edges later occupies a new range; existing ranges stay intact
+    const auto leaf = edges.at(0).node;
+    QVector<DependencyGraph::Edge> leafEdges(1);
+    leafEdges[0].node = edges.at(1).node;
+    graph->setEdges(leaf, leafEdges);
+
+    const DependencyScanner::NodeHandle handle(graph, root);
+    QCOMPARE(handle.edgeCount(), 3000);
+    QCOMPARE(handle.edge(2999).node.fileName(), QString("lib2999.dll"));
+    QVERIFY(handle.edge(1).delayLoad);
+    QVERIFY(!handle.edge(1).node.exists());
+    QCOMPARE(handle.edge(2).missingSymbols, QStringList() << "Missing1" << "#7");
+    QVERIFY(handle.edge(3).missingSymbols.isEmpty());
+    QVERIFY(handle.edge(0).node.edge(0).node == handle.edge(1).node);
+
+    QCOMPARE(DependencyScanner::modules(QList<DependencyScanner::NodeHandle>() << handle).size(), 3001);
+    QVERIFY(graph->reaches(root, QVector<DependencyGraph::Index>() << edges.at(1).node));
+    QVERIFY(!graph->reaches(leaf, QVector<DependencyGraph::Index>() << root));
+
+    // A node walked again overwrites its range when the new edges fit; the
+    // slots it gives up are compacted away once they are the majority
+    graph->setEdges(root, edges.mid(0, 10));
+    QCOMPARE(handle.edgeCount(), 10);
+    QCOMPARE(handle.edge(9).node.fileName(), QString("lib9.dll"));
+    QVERIFY(handle.edge(0).node.edge(0).node == handle.edge(1).node);
+    QCOMPARE(graph->statistics().edges, 11);
+    QCOMPARE(graph->statistics().deadEdges, 0);
+    graph->setEdges(root, edges);
+    QCOMPARE(handle.edgeCount(), 3000);
+    QCOMPARE(handle.edge(2).missingSymbols, QStringList() << "Missing1" << "#7");
+    QCOMPARE(graph->statistics().deadEdges, 10);
+
+    // Handles keep the graph alive after the scanner-side owner lets go
+    const DependencyScanner::NodeHandle kept = handle.edge(2999).node;
+    graph.clear();
+    QCOMPARE(kept.fileName(), QString("lib2999.dll"));
+
+    const DependencyGraph::Statistics stats = kept.graph()->statistics();
+    QCOMPARE(stats.nodes, 3001);
+    QCOMPARE(stats.edges, 3001);
+    QVERIFY(stats.bytes > 0);
+}
+
+void TestPEParser::testStringInterning()
+{
+    StringTable strings;
+    QCOMPARE(strings.intern(QString()), StringTable::Empty);
+    QCOMPARE(strings.intern(QString("")), StringTable::Empty);
+    QVERIFY(strings.string(StringTable::Empty).isEmpty());
+
+    // Equal strings share an ID; case variants share a folded ID but keep their spelling
+    const StringTable::Id path = strings.intern("C:/App/Plugins/Qt5Core.dll");
+    QCOMPARE(strings.intern(QString("C:/App/Plugins/") + QString("Qt5Core.dll")), path);
+    const StringTable::Id variant = strings.intern("c:/app/plugins/QT5CORE.DLL");
+    QVERIFY(variant != path);
+    QCOMPARE(strings.folded(variant), path);
+    QCOMPARE(strings.folded(path), path);
+    QCOMPARE(strings.string(variant), QString("c:/app/plugins/QT5CORE.DLL"));
+    QCOMPARE(strings.foldedHash(variant), strings.foldedHash(path));
+    QCOMPARE(strings.foldedHash(path), NameFolding::hash(QString("c:/app/plugins/qt5core.dll")));
+
+    const StringTable::Id other = strings.intern("C:/App/Plugins/Qt5Gui.dll");
+    QVERIFY(strings.folded(other) != strings.folded(path));
+
+    // IDs and strings stay valid while the table grows past one block
+    const QString* stored = &strings.string(path);
+    for (int i = 0; i < 3000; ++i) {
+        strings.intern(QString("C:/App/lib%1.dll").arg(i));
+    }
+    QVERIFY(&strings.string(path) == stored);
+    QCOMPARE(strings.count(), 3 + 3000 + 1);
+    QCOMPARE(strings.string(strings.intern("C:/App/lib2999.dll")), QString("C:/App/lib2999.dll"));
+
+    // Node strings are IDs into the graph's table
+    QSharedPointer<DependencyGraph> graph(new DependencyGraph());
+    const auto first = createNode(graph.data(), "Qt5Core.dll", "C:/App/Qt5Core.dll", true);
+    const auto second = createNode(graph.data(), "qt5core.dll", "C:/App/Qt5Core.dll", true);
+    QCOMPARE(graph->node(first).filePath, graph->node(second).filePath);
+    QVERIFY(graph->node(first).fileName != graph->node(second).fileName);
+    QCOMPARE(graph->strings().folded(graph->node(second).fileName), graph->node(first).fileName);
+    QCOMPARE(DependencyScanner::NodeHandle(graph, second).fileName(), QString("qt5core.dll"));
+}
+
+void TestPEParser::testWorkStealingGraphScan()
+{
+    // The owner takes its newest job, a thief the oldest of another worker
+    WorkStealingQueue<int> queue(2);
+    queue.push(0, 1);
+    queue.push(0, 2);
+    queue.push(0, 3);
+    int job = 0;
+    QVERIFY(queue.take(1, &job));
+    QCOMPARE(job, 1);
+    QVERIFY(queue.take(0, &job));
+    QCOMPARE(job, 3);
+    QVERIFY(queue.take(0, &job));
+    QCOMPARE(job, 2);
+    queue.finish();
+    queue.finish();
+    queue.finish();
+    QVERIFY(!queue.take(1, &job));
+
+    // app.exe imports a.dll and b.dll; a.dll and b.dll import c.dll, which
+    // imports a.dll back; b.dll also needs a missing DLL and tool.exe imports
+    // c.dll. Every file is a root of the directory scan as well.
+    QTemporaryDir work;
+    QVERIFY(work.isValid());
+    QVERIFY(writeModule(work.filePath("app.exe"), QStringList() << "a.dll" << "b.dll"));
+    QVERIFY(writeModule(work.filePath("tool.exe"), QStringList() << "c.dll"));
+    QVERIFY(writeModule(work.filePath("a.dll"), QStringList() << "c.dll"));
+    QVERIFY(writeModule(work.filePath("b.dll"), QStringList() << "c.dll" << "missing.dll"));
+    QVERIFY(writeModule(work.filePath("c.dll"), QStringList() << "a.dll"));
+
+    // Each module is parsed once, although c.dll is reached from four importers
+    DependencyScanner scanner;
+    const QList<DependencyScanner::NodeHandle> roots = scanner.scanDirectoryParallel(work.path(), false, false, 4);
+    QCOMPARE(roots.size(), 5);
+    QCOMPARE(scanner.statistics().modulesParsed, 5);
+
+    QHash<QString, DependencyScanner::NodeHandle> byName;
+    for (const DependencyScanner::NodeHandle& root : roots) {
+        QVERIFY(root.graph() == roots.first().graph());
+        byName.insert(root.fileName(), root);
+    }
+    const DependencyScanner::NodeHandle a = byName.value("a.dll");
+    const DependencyScanner::NodeHandle b = byName.value("b.dll");
+    const DependencyScanner::NodeHandle c = byName.value("c.dll");
+    QVERIFY(a && b && c);
+
+    // Importers link the root nodes; the cycle is cut on exactly one side
+    QVERIFY(b.edge(0).node == c);
+    QVERIFY(byName.value("tool.exe").edge(0).node == c);
+    QVERIFY(byName.value("app.exe").edge(0).node == a);
+    QVERIFY(a.edge(0).circular != c.edge(0).circular);
+    QVERIFY(!b.edge(1).node.exists());
+
+    // Same modules as a sequential scan: the five files and missing.dll
+    QCOMPARE(DependencyScanner::modules(roots).size(), 6);
+    DependencyScanner sequential;
+    QCOMPARE(DependencyScanner::modules(sequential.scanDirectory(work.path())).size(), 6);
+}
+
+void TestPEParser::testDeepImportChain()
+{
+    // chain0.dll -> chain1.dll -> ... -> chain999.dll, which imports chain0.dll back
+    const int length = 1000;
+    QTemporaryDir work;
+    QVERIFY(work.isValid());
+    for (int i = 0; i < length; ++i) {
+        QVERIFY(writeModule(work.filePath(QString("chain%1.dll").arg(i)),
+                            QStringList() << QString("chain%1.dll").arg((i + 1) % length)));
+    }
+
+    // No depth limit by default: the whole chain is scanned and the cycle is cut at its end
+    DependencyScanner scanner;
+    QCOMPARE(scanner.maxDepth(), 0);
+    DependencyScanner::NodeHandle node = scanner.scanFile(work.filePath("chain0.dll"));
+    int depth = 0;
+    while (node.edgeCount() == 1 && !node.edge(0).circular) {
+        node = node.edge(0).node;
+        ++depth;
+    }
+    QCOMPARE(depth, length - 1);
+    QCOMPARE(node.fileName(), QString("chain999.dll"));
+    QVERIFY(node.edge(0).circular);
+    QCOMPARE(node.edge(0).node.fileName(), QString("chain0.dll"));
+
+    // The limit is a policy: modules below it are left out
+    scanner.setMaxDepth(10);
+    node = scanner.scanFile(work.filePath("chain0.dll"));
+    depth = 0;
+    while (node.edgeCount() == 1) {
+        node = node.edge(0).node;
+        ++depth;
+    }
+    QCOMPARE(depth, 10);
+    QCOMPARE(node.fileName(), QString("chain10.dll"));
+
+    // a.exe reaches x.drv five imports down, b.exe one: the limit counts from
+    // the nearest root, whichever walk gets to x.drv first
+    QTemporaryDir mixed;
+    QVERIFY(mixed.isValid());
+    const QStringList modules = QStringList() << "a.exe" << "s1.drv" << "s2.drv" << "s3.drv" << "s4.drv"
+                                              << "b.exe" << "x.drv" << "y.drv";
+    const QStringList imports = QStringList() << "s1.drv" << "s2.drv" << "s3.drv" << "s4.drv" << "x.drv"
+                                              << "x.drv" << "y.drv" << QString();
+    for (int i = 0; i < modules.size(); ++i) {
+        QVERIFY(writeModule(mixed.filePath(modules.at(i)),
+                            imports.at(i).isEmpty() ? QStringList() : QStringList(imports.at(i))));
+    }
+    for (int parallel = 0; parallel < 2; ++parallel) {
+        DependencyScanner limited;
+        limited.setMaxDepth(5);
+        const QList<DependencyScanner::NodeHandle> roots = parallel
+            ? limited.scanDirectoryParallel(mixed.path(), false, false, 4)
+            : limited.scanDirectory(mixed.path());
+        QCOMPARE(roots.size(), 2);
+        QCOMPARE(DependencyScanner::modules(roots).size(), modules.size());
+        for (const DependencyScanner::NodeHandle& module : DependencyScanner::modules(roots)) {
+            if (module.fileName() == "x.drv") {
+                QCOMPARE(module.edgeCount(), 1);
+                QCOMPARE(module.edge(0).node.fileName(), QString("y.drv"));
+            }
+        }
+    }
+
+    // In a directory scan every link of the chain is a root, so none is cut
+    for (int parallel = 0; parallel < 2; ++parallel) {
+        DependencyScanner limited;
+        limited.setMaxDepth(10);
+        const QList<DependencyScanner::NodeHandle> roots = parallel
+            ? limited.scanDirectoryParallel(work.path(), false, false, 4)
+            : limited.scanDirectory(work.path());
+        QCOMPARE(roots.size(), length);
+        QCOMPARE(DependencyScanner::modules(roots).size(), length);
+        for (const DependencyScanner::NodeHandle& root : roots) {
+            QCOMPARE(root.edgeCount(), 1);
+        }
+    }
 }
 
 QTEST_APPLESS_MAIN(TestPEParser)
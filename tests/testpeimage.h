@@ -0,0 +1,493 @@
+#ifndef TESTPEIMAGE_H
+#define TESTPEIMAGE_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QtEndian>
+
+// Helpers for building synthetic PE images in tests and benchmarks,
+// so nothing depends on real system DLLs or Windows headers.
+namespace TestPE {
+
+const quint16 kMachineI386 = 0x014c;
+const quint16 kMachineAmd64 = 0x8664;
+const int kHeadersSize = 0x200;
+const quint32 kFirstRva = 0x1000;
+const quint64 kImageBase32 = 0x10000000;
+const quint64 kImageBase64 = 0x180000000ull;
+
+inline void putU16(QByteArray& buffer, int offset, quint16 value)
+{
+    qToLittleEndian(value, reinterpret_cast<uchar*>(buffer.data() + offset));
+}
+
+inline void putU32(QByteArray& buffer, int offset, quint32 value)
+{
+    qToLittleEndian(value, reinterpret_cast<uchar*>(buffer.data() + offset));
+}
+
+inline void padTo(QByteArray& buffer, int alignment)
+{
+    buffer += QByteArray((alignment - buffer.size() % alignment) % alignment, 0);
+}
+
+// 64-byte DOS header with the PE header expected right after it
+inline QByteArray dosHeader(quint16 magic)
+{
+    QByteArray header(64, 0);
+    putU16(header, 0, magic);
+    putU32(header, 0x3C, 64);
+    return header;
+}
+
+inline QByteArray ntSignature(quint32 signature)
+{
+    QByteArray bytes(4, 0);
+    putU32(bytes, 0, signature);
+    return bytes;
+}
+
+inline QByteArray utf16Text(const QString& text)
+{
+    QByteArray bytes;
+    for (const QChar& ch : text + QChar(0)) {
+        QByteArray unit(2, 0);
+        putU16(unit, 0, ch.unicode());
+        bytes += unit;
+    }
+    return bytes;
+}
+
+// One VS_VERSIONINFO-style block: header, key, value and children
+inline QByteArray versionBlock(const QString& key, const QByteArray& value, quint16 type,
+                               quint16 valueLength, const QByteArray& children = QByteArray())
+{
+    QByteArray block(6, 0);
+    block += utf16Text(key);
+    padTo(block, 4);
+    block += value;
+    if (!children.isEmpty()) {
+        padTo(block, 4);
+        block += children;
+    }
+    putU16(block, 0, quint16(block.size()));
+    putU16(block, 2, valueLength);
+    putU16(block, 4, type);
+    return block;
+}
+
+// Builds a PE32/PE32+ image with one data section holding the import,
+// delay-load import and export directories and an optional RT_VERSION resource.
+class ImageBuilder
+{
+public:
+    explicit ImageBuilder(quint16 machine)
+        : m_machine(machine), m_delayVaBased(false), m_fileVersion(0), m_extraSections(0), m_dataOffset(0),
+          m_sectionName(".rdata") {}
+
+    // Functions are imported by name; "#n" imports ordinal n
+    ImageBuilder& addImport(const QString& dllName, const QStringList& functions = QStringList())
+    {
+        m_imports.append(dllName);
+        m_importFunctions.append(functions);
+        return *this;
+    }
+
+    // Exports get ordinals 1, 2, ... in the order they are added
+    ImageBuilder& addExport(const QString& name, const QString& forwarder = QString())
+    {
+        m_exports.append(name);
+        m_forwarders.append(forwarder);
+        return *this;
+    }
+
+    ImageBuilder& addDelayImport(const QString& dllName)
+    {
+        m_delayImports.append(dllName);
+        return *this;
+    }
+
+    // Emit pre-VC7 delay-load descriptors, which hold VAs instead of RVAs
+    ImageBuilder& setDelayImportsVaBased(bool vaBased)
+    {
+        m_delayVaBased = vaBased;
+        return *this;
+    }
+
+    ImageBuilder& setVersion(quint64 fileVersion,
+                             const QMap<QString, QString>& strings = QMap<QString, QString>())
+    {
+        m_fileVersion = fileVersion;
+        m_versionStrings = strings;
+        return *this;
+    }
+
+    // Place the data section at a large file offset; the gap is described by
+    // a filler section, like the code/fatbin sections of big vendor DLLs.
+    ImageBuilder& setDataOffset(qint64 offset)
+    {
+        m_dataOffset = offset & ~qint64(0x1FF);
+        return *this;
+    }
+
+    // Empty sections placed before the data section, so lookups have to
+    // search a section table of realistic size
+    ImageBuilder& setExtraSections(int count)
+    {
+        m_extraSections = qMax(0, count);
+        return *this;
+    }
+
+    // Replace the data section by a named section with fixed contents, e.g. ".apiset"
+    ImageBuilder& setRawSection(const QByteArray& name, const QByteArray& contents)
+    {
+        m_sectionName = name.left(8);
+        m_rawSection = contents;
+        return *this;
+    }
+
+    qint64 dataOffset() const { return qMax<qint64>(m_dataOffset, headersSize()); }
+
+    // Bytes written at offset 0
+    QByteArray headers() const
+    {
+        const QByteArray data = section();
+        const bool pe64 = (m_machine == kMachineAmd64);
+        const int optionalHeaderSize = pe64 ? 240 : 224;
+        const int headersSize = this->headersSize();
+        const bool hasFiller = dataOffset() > headersSize;
+
+        QByteArray headers(headersSize, 0);
+        headers.replace(0, 64, dosHeader(0x5A4D));
+        headers.replace(64, 4, ntSignature(0x00004550));
+        putU16(headers, 68, m_machine);
+        putU16(headers, 70, quint16((hasFiller ? 2 : 1) + m_extraSections));
+        putU16(headers, 84, quint16(optionalHeaderSize));
+
+        const int optionalHeader = 88;
+        putU16(headers, optionalHeader, pe64 ? 0x20b : 0x10b);
+        if (pe64) {
+            putU32(headers, optionalHeader + 24, quint32(kImageBase64));
+            putU32(headers, optionalHeader + 28, quint32(kImageBase64 >> 32));
+        } else {
+            putU32(headers, optionalHeader + 28, quint32(kImageBase32));
+        }
+        putU32(headers, optionalHeader + 60, quint32(headersSize));
+        const int directories = optionalHeader + (pe64 ? 108 : 92);
+        putU32(headers, directories, 16);
+        if (!m_imports.isEmpty()) {
+            putU32(headers, directories + 4 + 1 * 8, dataRva());
+            putU32(headers, directories + 4 + 1 * 8 + 4, importSize());
+        }
+        if (!m_exports.isEmpty()) {
+            putU32(headers, directories + 4, dataRva() + exportStart());
+            putU32(headers, directories + 4 + 4, quint32(exportBlock(0).size()));
+        }
+        if (!m_delayImports.isEmpty()) {
+            putU32(headers, directories + 4 + 13 * 8, dataRva() + delayImportStart());
+            putU32(headers, directories + 4 + 13 * 8 + 4, quint32(m_delayImports.size() + 1) * 32);
+        }
+        if (m_fileVersion != 0) {
+            putU32(headers, directories + 4 + 2 * 8, dataRva() + resourceStart());
+            putU32(headers, directories + 4 + 2 * 8 + 4, quint32(data.size()) - resourceStart());
+        }
+
+        int sectionHeader = optionalHeader + optionalHeaderSize;
+        if (hasFiller) {
+            const quint32 fillerSize = fillerBytes();
+            headers.replace(sectionHeader, 5, QByteArray(".text"));
+            putU32(headers, sectionHeader + 8, fillerSize);
+            putU32(headers, sectionHeader + 12, kFirstRva);
+            putU32(headers, sectionHeader + 16, fillerSize);
+            putU32(headers, sectionHeader + 20, quint32(headersSize));
+            sectionHeader += 40;
+        }
+        for (int i = 0; i < m_extraSections; ++i) {
+            headers.replace(sectionHeader, 4, QByteArray(".bss"));
+            putU32(headers, sectionHeader + 8, 0x1000);
+            putU32(headers, sectionHeader + 12, extraSectionsRva() + quint32(i) * 0x1000);
+            sectionHeader += 40;
+        }
+        headers.replace(sectionHeader, m_sectionName.size(), m_sectionName);
+        putU32(headers, sectionHeader + 8, quint32(data.size()));
+        putU32(headers, sectionHeader + 12, dataRva());
+        putU32(headers, sectionHeader + 16, quint32(data.size()));
+        putU32(headers, sectionHeader + 20, quint32(dataOffset()));
+        return headers;
+    }
+
+    // Bytes written at dataOffset()
+    QByteArray section() const
+    {
+        if (!m_rawSection.isEmpty()) {
+            QByteArray data = m_rawSection;
+            padTo(data, 0x200);
+            return data;
+        }
+
+        const quint32 base = dataRva();
+        QByteArray data = importBlock(base);
+        padTo(data, 8);
+        data += delayImportBlock(base + quint32(data.size()));
+        padTo(data, 8);
+        data += exportBlock(base + quint32(data.size()));
+        padTo(data, 8);
+
+        if (m_fileVersion != 0) {
+            const quint32 resourceRva = base + quint32(data.size());
+            const QByteArray versionInfo = versionResource();
+
+            // Type(RT_VERSION) -> Name(1) -> Language(0x409) -> data entry
+            QByteArray tree(88, 0);
+            putU16(tree, 14, 1);
+            putU32(tree, 16, 16);
+            putU32(tree, 20, 0x80000000u | 24);
+            putU16(tree, 24 + 14, 1);
+            putU32(tree, 24 + 16, 1);
+            putU32(tree, 24 + 20, 0x80000000u | 48);
+            putU16(tree, 48 + 14, 1);
+            putU32(tree, 48 + 16, 0x409);
+            putU32(tree, 48 + 20, 72);
+            putU32(tree, 72, resourceRva + 88);
+            putU32(tree, 76, quint32(versionInfo.size()));
+
+            data += tree;
+            data += versionInfo;
+        }
+        padTo(data, 0x200);
+        return data;
+    }
+
+    // Complete image; only practical when dataOffset() is small
+    QByteArray build() const
+    {
+        QByteArray image = headers();
+        image += QByteArray(int(dataOffset()) - image.size(), 0);
+        image += section();
+        return image;
+    }
+
+private:
+    int headersSize() const
+    {
+        const int optionalHeaderSize = (m_machine == kMachineAmd64) ? 240 : 224;
+        const int tableEnd = 88 + optionalHeaderSize + (2 + m_extraSections) * 40;
+        return qMax(kHeadersSize, (tableEnd + 0x1FF) & ~0x1FF);
+    }
+
+    quint32 fillerBytes() const
+    {
+        return quint32(dataOffset() - headersSize());
+    }
+
+    quint32 extraSectionsRva() const
+    {
+        return kFirstRva + ((fillerBytes() + 0xFFF) & ~quint32(0xFFF));
+    }
+
+    quint32 dataRva() const
+    {
+        return extraSectionsRva() + quint32(m_extraSections) * 0x1000;
+    }
+
+    quint32 importSize() const
+    {
+        return quint32(m_imports.size() + 1) * 20;
+    }
+
+    static quint32 align8(int size)
+    {
+        return quint32((size + 7) & ~7);
+    }
+
+    // Import descriptors, then per module its lookup table, hint/name entries and name
+    QByteArray importBlock(quint32 rva) const
+    {
+        QByteArray block;
+        if (m_imports.isEmpty()) {
+            return block;
+        }
+
+        const bool pe64 = (m_machine == kMachineAmd64);
+        const int thunkSize = pe64 ? 8 : 4;
+        block = QByteArray(int(importSize()), 0);
+        for (int i = 0; i < m_imports.size(); ++i) {
+            const QStringList& functions = m_importFunctions.at(i);
+            if (!functions.isEmpty()) {
+                const int thunks = block.size();
+                block += QByteArray((functions.size() + 1) * thunkSize, 0);
+                putU32(block, i * 20, rva + quint32(thunks));
+                putU32(block, i * 20 + 16, rva + quint32(thunks));
+                for (int j = 0; j < functions.size(); ++j) {
+                    const int thunk = thunks + j * thunkSize;
+                    if (functions.at(j).startsWith('#')) {
+                        const quint32 ordinal = functions.at(j).mid(1).toUInt();
+                        if (pe64) {
+                            putU32(block, thunk, ordinal);
+                            putU32(block, thunk + 4, 0x80000000u);
+                        } else {
+                            putU32(block, thunk, 0x80000000u | ordinal);
+                        }
+                    } else {
+                        putU32(block, thunk, rva + quint32(block.size()));
+                        block += QByteArray(2, 0);   // Hint
+                        block += functions.at(j).toLatin1();
+                        block += '\0';
+                        padTo(block, 2);
+                    }
+                }
+            }
+            putU32(block, i * 20 + 12, rva + quint32(block.size()));
+            block += m_imports.at(i).toLatin1();
+            block += '\0';
+        }
+        return block;
+    }
+
+    // IMAGE_EXPORT_DIRECTORY, address/name/ordinal tables, then names and forwarders
+    QByteArray exportBlock(quint32 rva) const
+    {
+        QByteArray block;
+        if (m_exports.isEmpty()) {
+            return block;
+        }
+
+        const int count = m_exports.size();
+        const int functions = 40;
+        const int names = functions + count * 4;
+        const int ordinals = names + count * 4;
+        block = QByteArray(ordinals + count * 2, 0);
+        padTo(block, 4);
+        putU32(block, 16, 1);                  // Base
+        putU32(block, 20, quint32(count));     // NumberOfFunctions
+        putU32(block, 24, quint32(count));     // NumberOfNames
+        putU32(block, 28, rva + functions);
+        putU32(block, 32, rva + names);
+        putU32(block, 36, rva + ordinals);
+        for (int i = 0; i < count; ++i) {
+            putU16(block, ordinals + i * 2, quint16(i));
+            putU32(block, names + i * 4, rva + quint32(block.size()));
+            block += m_exports.at(i).toLatin1();
+            block += '\0';
+            if (m_forwarders.at(i).isEmpty()) {
+                putU32(block, functions + i * 4, kFirstRva);   // Any code RVA outside the directory
+            } else {
+                putU32(block, functions + i * 4, rva + quint32(block.size()));
+                block += m_forwarders.at(i).toLatin1();
+                block += '\0';
+            }
+        }
+        return block;
+    }
+
+    // IMAGE_DELAYLOAD_DESCRIPTORs followed by the module names
+    QByteArray delayImportBlock(quint32 rva) const
+    {
+        QByteArray block;
+        if (!m_delayImports.isEmpty()) {
+            block = QByteArray((m_delayImports.size() + 1) * 32, 0);
+            const quint64 imageBase = (m_machine == kMachineAmd64) ? kImageBase64 : kImageBase32;
+            for (int i = 0; i < m_delayImports.size(); ++i) {
+                const quint32 nameRva = rva + quint32(block.size());
+                putU32(block, i * 32, m_delayVaBased ? 0 : 1);
+                putU32(block, i * 32 + 4, m_delayVaBased ? quint32(imageBase + nameRva) : nameRva);
+                block += m_delayImports.at(i).toLatin1();
+                block += '\0';
+            }
+        }
+        return block;
+    }
+
+    quint32 delayImportStart() const
+    {
+        return align8(importBlock(0).size());
+    }
+
+    quint32 exportStart() const
+    {
+        return align8(int(delayImportStart()) + delayImportBlock(0).size());
+    }
+
+    quint32 resourceStart() const
+    {
+        return align8(int(exportStart()) + exportBlock(0).size());
+    }
+
+    QByteArray versionResource() const
+    {
+        // VS_VERSIONINFO: VS_FIXEDFILEINFO plus an optional StringFileInfo table
+        QByteArray fixedInfo(52, 0);
+        putU32(fixedInfo, 0, 0xFEEF04BD);
+        putU32(fixedInfo, 8, quint32(m_fileVersion >> 32));
+        putU32(fixedInfo, 12, quint32(m_fileVersion));
+        putU32(fixedInfo, 16, quint32(m_fileVersion >> 32));
+        putU32(fixedInfo, 20, quint32(m_fileVersion));
+
+        QByteArray children;
+        if (!m_versionStrings.isEmpty()) {
+            QByteArray entries;
+            for (auto it = m_versionStrings.begin(); it != m_versionStrings.end(); ++it) {
+                entries += versionBlock(it.key(), utf16Text(it.value()), 1, quint16(it.value().size() + 1));
+                padTo(entries, 4);
+            }
+            const QByteArray table = versionBlock("040904b0", QByteArray(), 1, 0, entries);
+            children = versionBlock("StringFileInfo", QByteArray(), 1, 0, table);
+            padTo(children, 4);
+        }
+        return versionBlock("VS_VERSION_INFO", fixedInfo, 0, 52, children);
+    }
+
+    quint16 m_machine;
+    QStringList m_imports;
+    QList<QStringList> m_importFunctions;
+    QStringList m_exports;
+    QStringList m_forwarders;
+    QStringList m_delayImports;
+    bool m_delayVaBased;
+    quint64 m_fileVersion;
+    QMap<QString, QString> m_versionStrings;
+    int m_extraSections;
+    qint64 m_dataOffset;
+    QByteArray m_sectionName;
+    QByteArray m_rawSection;
+};
+
+// Version 6 API set namespace (Windows 10+) mapping each contract, given without
+// ".dll" (e.g. "api-ms-win-core-file-l1-2-4"), to its default host; an empty
+// host gives a contract without values
+inline QByteArray apiSetSchemaV6(const QList<QPair<QString, QString> >& contracts)
+{
+    const int entryOffset = 28;
+    const int valuesOffset = entryOffset + contracts.size() * 24;
+    QByteArray schema(valuesOffset + contracts.size() * 20, 0);
+    putU32(schema, 0, 6);
+    putU32(schema, 12, quint32(contracts.size()));
+    putU32(schema, 16, quint32(entryOffset));
+
+    for (int i = 0; i < contracts.size(); ++i) {
+        const QString& name = contracts.at(i).first;
+        const QString& host = contracts.at(i).second;
+        const int entry = entryOffset + i * 24;
+        const int value = valuesOffset + i * 20;
+
+        putU32(schema, entry + 4, quint32(schema.size()));
+        putU32(schema, entry + 8, quint32(name.size() * 2));
+        putU32(schema, entry + 12, quint32(name.lastIndexOf('-') * 2));
+        schema += utf16Text(name).left(name.size() * 2);
+        putU32(schema, entry + 16, quint32(value));
+        putU32(schema, entry + 20, host.isEmpty() ? 0 : 1);
+
+        putU32(schema, value + 12, quint32(schema.size()));
+        putU32(schema, value + 16, quint32(host.size() * 2));
+        schema += utf16Text(host).left(host.size() * 2);
+    }
+    putU32(schema, 4, quint32(schema.size()));
+    return schema;
+}
+
+} // namespace TestPE
+
+#endif // TESTPEIMAGE_H
@@ -1,4 +1,4 @@
-QT += core testlib
+QT += core testlib concurrent
 QT -= gui
 
 CONFIG += qt console warn_on depend_includepath testcase
@@ -13,17 +13,43 @@ INCLUDEPATH += ../include
 SOURCES += \
     test_peparser.cpp \
     ../src/peparser.cpp \
-    ../src/comparisonengine.cpp
+    ../src/peimage.cpp \
+    ../src/versionresource.cpp \
+    ../src/exportindex.cpp \
+    ../src/contentdigest.cpp \
+    ../src/pathresolver.cpp \
+    ../src/searchplan.cpp \
+    ../src/targetprofile.cpp \
+    ../src/apisetschema.cpp \
+    ../src/knowndlls.cpp \
+    ../src/comparisonengine.cpp \
+    ../src/stringtable.cpp \
+    ../src/dependencygraph.cpp \
+    ../src/dependencyscanner.cpp \
+    ../src/logger.cpp
 
 HEADERS += \
+    testpeimage.h \
     ../include/peparser.h \
+    ../include/namefolding.h \
+    ../include/peimage.h \
+    ../include/versionresource.h \
+    ../include/exportindex.h \
+    ../include/contentdigest.h \
+    ../include/pathresolver.h \
+    ../include/searchplan.h \
+    ../include/stripedcache.h \
+    ../include/systemdlltable.h \
+    ../include/targetprofile.h \
+    ../include/apisetschema.h \
+    ../include/knowndlls.h \
+    ../include/bloomfilter.h \
     ../include/comparisonengine.h \
-    ../include/dependencyscanner.h
-
-# Windows libraries
-win32 {
-    LIBS += -limagehlp -lversion
-}
+    ../include/stringtable.h \
+    ../include/dependencygraph.h \
+    ../include/workstealingqueue.h \
+    ../include/dependencyscanner.h \
+    ../include/logger.h
 
 # Enable RTTI and exceptions
 QMAKE_CXXFLAGS += -frtti -fexceptions